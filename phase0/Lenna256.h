@@ -4098,4 +4098,4 @@ int input_data[65536] = {
  17,  17,  24,  25,  26,  25,  22,  21,  24,  29,  37,  49,  50,  54,  50,  47, 
  36,  25,  15,  11,  11,   9,   7,   7,   8,  12,  16,  19,  27,  35,  35,  39};
 
-struct frame input_frame = { 256, 256, 8, input_data };
+struct frame input_frame = { 256, 256, 8, input_data, NULL };
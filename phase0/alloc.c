@@ -0,0 +1,264 @@
+#include "alloc.h"
+#include "common.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static void *std_malloc(void *context, size_t size)
+{
+	(void) context;
+
+	return malloc(size);
+}
+
+static void *std_realloc(void *context, void *ptr, size_t size)
+{
+	(void) context;
+
+	return realloc(ptr, size);
+}
+
+static void std_free(void *context, void *ptr)
+{
+	(void) context;
+
+	free(ptr);
+}
+
+static struct allocator current = { std_malloc, std_realloc, std_free, NULL };
+
+void alloc_set_allocator(const struct allocator *allocator)
+{
+	if (allocator == NULL) {
+		current.malloc = std_malloc;
+		current.realloc = std_realloc;
+		current.free = std_free;
+		current.context = NULL;
+	} else {
+		assert(allocator->malloc != NULL);
+		assert(allocator->realloc != NULL);
+		assert(allocator->free != NULL);
+
+		current = *allocator;
+	}
+}
+
+void *alloc_malloc(size_t size)
+{
+	return current.malloc(current.context, size);
+}
+
+void *alloc_realloc(void *ptr, size_t size)
+{
+	return current.realloc(current.context, ptr, size);
+}
+
+void alloc_free(void *ptr)
+{
+	current.free(current.context, ptr);
+}
+
+void *alloc_calloc(size_t count, size_t size)
+{
+	void *ptr;
+
+	if (size != 0 && count > SIZE_MAX_ / size) {
+		return NULL;
+	}
+
+	ptr = alloc_malloc(count * size);
+
+	if (ptr != NULL) {
+		memset(ptr, 0, count * size);
+	}
+
+	return ptr;
+}
+
+/* the blocks are aligned for any of these types */
+union arena_align {
+	long l;
+	double d;
+	void *p;
+	size_t s;
+};
+
+#define ARENA_ALIGNMENT sizeof(union arena_align)
+
+/* the arena->last of the empty arena */
+#define ARENA_NONE SIZE_MAX_
+
+/* the header preceding each block */
+struct arena_block {
+	/** capacity of the block (multiple of ARENA_ALIGNMENT) */
+	size_t size;
+	/** offset of the previous block */
+	size_t prev;
+	/** the block has been released */
+	int released;
+};
+
+static size_t ceil_multiple_alignment(size_t n)
+{
+	return (n + (ARENA_ALIGNMENT - 1)) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+static size_t sizeof_header(void)
+{
+	return ceil_multiple_alignment(sizeof(struct arena_block));
+}
+
+static struct arena_block *get_block(struct arena *arena, size_t offset)
+{
+	return (struct arena_block *) (arena->base + offset);
+}
+
+size_t arena_sizeof(size_t size)
+{
+	if (size > SIZE_MAX_ - sizeof_header() - ARENA_ALIGNMENT) {
+		return SIZE_MAX_;
+	}
+
+	return sizeof_header() + ceil_multiple_alignment(size);
+}
+
+void arena_init(struct arena *arena, void *ptr, size_t size)
+{
+	size_t skip;
+
+	assert(arena != NULL);
+	assert(ptr != NULL || size == 0);
+
+	skip = (ARENA_ALIGNMENT - (size_t) ptr % ARENA_ALIGNMENT) % ARENA_ALIGNMENT;
+
+	if (skip > size) {
+		skip = size;
+	}
+
+	arena->base = (unsigned char *) ptr + skip;
+	arena->size = size - skip;
+	arena->used = 0;
+	arena->peak = 0;
+	arena->last = ARENA_NONE;
+}
+
+static void *arena_malloc(void *context, size_t size)
+{
+	struct arena *arena = context;
+	struct arena_block *block;
+	size_t total;
+
+	assert(arena != NULL);
+
+	total = arena_sizeof(size);
+
+	if (total > arena->size - arena->used) {
+		return NULL;
+	}
+
+	block = get_block(arena, arena->used);
+
+	block->size = total - sizeof_header();
+	block->prev = arena->last;
+	block->released = 0;
+
+	arena->last = arena->used;
+	arena->used += total;
+
+	if (arena->peak < arena->used) {
+		arena->peak = arena->used;
+	}
+
+	return (unsigned char *) block + sizeof_header();
+}
+
+static void arena_free(void *context, void *ptr)
+{
+	struct arena *arena = context;
+	struct arena_block *block;
+
+	assert(arena != NULL);
+
+	if (ptr == NULL) {
+		return;
+	}
+
+	assert((unsigned char *) ptr >= arena->base + sizeof_header() && (unsigned char *) ptr <= arena->base + arena->used);
+
+	block = (struct arena_block *) ((unsigned char *) ptr - sizeof_header());
+
+	block->released = 1;
+
+	/* return the released blocks on the top */
+	while (arena->last != ARENA_NONE && get_block(arena, arena->last)->released) {
+		arena->used = arena->last;
+		arena->last = get_block(arena, arena->last)->prev;
+	}
+}
+
+static void *arena_realloc(void *context, void *ptr, size_t size)
+{
+	struct arena *arena = context;
+	struct arena_block *block;
+	size_t offset, total;
+	void *new_ptr;
+
+	assert(arena != NULL);
+
+	if (ptr == NULL) {
+		return arena_malloc(context, size);
+	}
+
+	if (size == 0) {
+		arena_free(context, ptr);
+		return NULL;
+	}
+
+	block = (struct arena_block *) ((unsigned char *) ptr - sizeof_header());
+	offset = (size_t) ((unsigned char *) block - arena->base);
+	total = arena_sizeof(size);
+
+	/* the last block is resized in place */
+	if (offset == arena->last) {
+		if (total > arena->size - offset) {
+			return NULL;
+		}
+
+		block->size = total - sizeof_header();
+		arena->used = offset + total;
+
+		if (arena->peak < arena->used) {
+			arena->peak = arena->used;
+		}
+
+		return ptr;
+	}
+
+	if (total - sizeof_header() <= block->size) {
+		return ptr;
+	}
+
+	new_ptr = arena_malloc(context, size);
+
+	if (new_ptr == NULL) {
+		return NULL;
+	}
+
+	memcpy(new_ptr, ptr, block->size);
+
+	arena_free(context, ptr);
+
+	return new_ptr;
+}
+
+void arena_get_allocator(struct arena *arena, struct allocator *allocator)
+{
+	assert(arena != NULL);
+	assert(allocator != NULL);
+
+	allocator->malloc = arena_malloc;
+	allocator->realloc = arena_realloc;
+	allocator->free = arena_free;
+	allocator->context = arena;
+}
@@ -0,0 +1,81 @@
+/**
+ * \file alloc.h
+ * \brief Memory allocation hooks and the arena allocator
+ *
+ * All the library routines allocate their memory through alloc_malloc(),
+ * alloc_realloc() and alloc_free(), which call the allocator installed by
+ * alloc_set_allocator(). The standard library is used by default.
+ */
+#ifndef ALLOC_H_
+#define ALLOC_H_
+
+#include <stddef.h>
+
+/**
+ * \brief Allocator interface
+ *
+ * The functions follow malloc(), realloc() and free(), the \c context is passed as the first argument.
+ */
+struct allocator {
+	void *(*malloc)(void *context, size_t size);
+	void *(*realloc)(void *context, void *ptr, size_t size);
+	void (*free)(void *context, void *ptr);
+
+	void *context;
+};
+
+/**
+ * \brief Install the \p allocator, NULL restores the standard library
+ *
+ * The allocator is shared by all the threads. Memory must be released by the allocator which
+ * allocated it, so the allocator should be installed before any frame, workspace or context
+ * is initialized.
+ */
+void alloc_set_allocator(const struct allocator *allocator);
+
+void *alloc_malloc(size_t size);
+void *alloc_realloc(void *ptr, size_t size);
+void alloc_free(void *ptr);
+
+/**
+ * \brief Allocate the zero-initialized array of \p count elements of \p size bytes
+ */
+void *alloc_calloc(size_t count, size_t size);
+
+/**
+ * \brief Arena allocator
+ *
+ * The blocks are carved one after another from a single caller-provided memory. The last block
+ * is resized in place, and it is returned to the arena when released, together with any released
+ * blocks below it. Other blocks are reclaimed only once the blocks above them are released.
+ * The arena is not thread-safe.
+ */
+struct arena {
+	unsigned char *base;
+	size_t size;
+
+	/** bytes in use, and the maximum of them */
+	size_t used, peak;
+
+	/** offset of the last block */
+	size_t last;
+};
+
+/**
+ * \brief Set up the arena in \p size bytes of memory at \p ptr
+ *
+ * Memory not aligned as by malloc() loses a few leading bytes.
+ */
+void arena_init(struct arena *arena, void *ptr, size_t size);
+
+/**
+ * \brief Fill the \p allocator to carve the blocks from the \p arena
+ */
+void arena_get_allocator(struct arena *arena, struct allocator *allocator);
+
+/**
+ * \brief Number of bytes of an arena taken by the block of \p size bytes
+ */
+size_t arena_sizeof(size_t size);
+
+#endif /* ALLOC_H_ */
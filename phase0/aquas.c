@@ -4,20 +4,27 @@
 #include "config.h"
 #include "common.h"
 #include "frame.h"
-#include "dwt.h"
 #include "bio.h"
-#include "bpe.h"
+#include "alloc.h"
+#include "open122.h"
 
 #include "Lenna256.h"
 
 /* 1<<19 == 512 kilobytes */
 unsigned char compressed_bitstream[1<<19];
 
+/* all the memory of the codec, 1<<21 == 2 megabytes */
+double arena_memory[(1<<21) / sizeof(double)];
+
 int main()
 {
 	struct parameters parameters;
+	struct arena arena;
+	struct allocator allocator;
+	struct open122_encoder encoder;
+	struct open122_decoder decoder;
 	struct bio bio;
-	struct frame output_frame;
+	size_t size;
 
 	init_parameters(&parameters);
 
@@ -28,45 +35,66 @@ int main()
 		return EXIT_FAILURE;
 	}
 
-	dprint (("[DEBUG] wavelet transform...\n"));
+	/* from now on, the memory is carved from the arena */
+	size = open122_encoder_sizeof(input_frame.height, input_frame.width, &parameters)
+		+ open122_decoder_sizeof(input_frame.height, input_frame.width, &parameters);
+
+	if (size > sizeof arena_memory) {
+		fprintf(stderr, "[ERROR] the arena is too small, %lu bytes required\n", (unsigned long) size);
+		return EXIT_FAILURE;
+	}
+
+	arena_init(&arena, arena_memory, sizeof arena_memory);
+	arena_get_allocator(&arena, &allocator);
+	alloc_set_allocator(&allocator);
 
-	if (dwt_encode(&input_frame, &parameters)) {
-		fprintf(stderr, "[ERROR] transform failed\n");
+	if (open122_encoder_init(&encoder, input_frame.height, input_frame.width, &parameters)) {
+		fprintf(stderr, "[ERROR] unable to initialize the encoder\n");
 		return EXIT_FAILURE;
 	}
 
-	dprint (("[DEBUG] bit-plane encoder...\n"));
+	if (open122_decoder_init(&decoder, input_frame.height, input_frame.width, &parameters)) {
+		fprintf(stderr, "[ERROR] unable to initialize the decoder\n");
+		return EXIT_FAILURE;
+	}
+
+	dprint (("[DEBUG] encoder...\n"));
 
 	bio_open(&bio, compressed_bitstream, BIO_MODE_WRITE);
-	bpe_encode(&input_frame, &parameters, &bio);
+
+	if (open122_encode(&encoder, &input_frame, &bio)) {
+		fprintf(stderr, "[ERROR] encoding failed\n");
+		return EXIT_FAILURE;
+	}
+
 	bio_close(&bio);
 
 	dprint (("coded stream size: %lu bytes\n", (unsigned long)(bio.ptr - (unsigned char *)compressed_bitstream)));
 
-	dprint (("[DEBUG] bit-plane decoder...\n"));
-
-	output_frame = input_frame;
-	output_frame.data = NULL;
+	dprint (("[DEBUG] decoder...\n"));
 
 	bio_open(&bio, compressed_bitstream, BIO_MODE_READ);
-	bpe_decode(&output_frame, &parameters, &bio);
-	bio_close(&bio);
-
-	dprint (("[DEBUG] inverse wavelet transform...\n"));
 
-	if (dwt_decode(&output_frame, &parameters)) {
-		fprintf(stderr, "[ERROR] inverse transform failed\n");
+	if (open122_decode(&decoder, &bio)) {
+		fprintf(stderr, "[ERROR] decoding failed\n");
 		return EXIT_FAILURE;
 	}
 
+	bio_close(&bio);
+
+	dprint (("arena: %lu bytes required, %lu bytes used\n", (unsigned long) size, (unsigned long) arena.peak));
+
 	dprint (("[DEBUG] saving the output image...\n"));
 
-	if (frame_save_pgm(&output_frame, "output.pgm")) {
+	if (frame_save_pgm(&decoder.frame, "output.pgm")) {
 		fprintf(stderr, "[ERROR] unable to save an output raster\n");
 		return EXIT_FAILURE;
 	}
 
-	frame_destroy(&output_frame);
+	open122_decoder_destroy(&decoder);
+	open122_encoder_destroy(&encoder);
+
+	alloc_set_allocator(NULL);
 
 	return 0;
 }
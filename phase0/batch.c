@@ -0,0 +1,364 @@
+/**
+ * Compresses many images into the raw CCSDS 122.0 streams
+ *
+ * The paths of the PGM images are read from the list (one per line), e.g.,
+ * `find dir -name '*.pgm' | batch -`. Each image is saved as the stream
+ * <path>.bin, or into the output directory. When compiled with OpenMP, the
+ * images are distributed among threads, so that the files of some threads
+ * are read while the others encode. Each thread reuses its framebuffer,
+ * encoder context and stream buffer across the images.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _OPENMP
+#	include <omp.h>
+#endif
+
+#include "config.h"
+#include "common.h"
+#include "frame.h"
+#include "bio.h"
+#include "bpe.h"
+#include "open122.h"
+#include "worker.h"
+
+/*
+ * Image of the list
+ */
+struct batch_item {
+	char *path;
+
+	/** result */
+	int err;
+	size_t bytes;
+	double seconds;
+};
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "[ERROR] usage: %s [<options>] <list>\n", name);
+	fprintf(stderr, "The list holds the paths of the PGM images, one per line, the \"-\" stands for the standard input. Options:\n");
+	fprintf(stderr, "  -t <DWTtype>       0 for Float DWT (default), 1 for Integer DWT\n");
+	fprintf(stderr, "  -s <S>             segment size in blocks (16 to 1048576)\n");
+	fprintf(stderr, "  -l <SegByteLimit>  maximum number of bytes in a coded segment\n");
+	fprintf(stderr, "  -b <TargetBytes>   target size of each stream in bytes\n");
+	fprintf(stderr, "  -o <directory>     save the streams into the directory\n");
+	fprintf(stderr, "  -j <threads>       number of threads (requires OpenMP)\n");
+}
+
+/* wall-clock time in seconds, the processor time without OpenMP */
+static double get_time(void)
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* read the non-empty lines of the list, *count is set to the number of the lines */
+static struct batch_item *load_list(const char *path, size_t *count)
+{
+	FILE *stream;
+	struct batch_item *items;
+	size_t capacity = 256;
+	char line[FILENAME_MAX + 2];
+
+	if (0 == strcmp(path, "-"))
+		stream = stdin;
+	else
+		stream = fopen(path, "r");
+
+	if (stream == NULL) {
+		return NULL;
+	}
+
+	items = malloc(capacity * sizeof *items);
+
+	if (items == NULL) {
+		if (stream != stdin)
+			fclose(stream);
+		return NULL;
+	}
+
+	*count = 0;
+
+	while (fgets(line, (int) sizeof line, stream) != NULL) {
+		size_t length = strlen(line);
+
+		while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+			line[--length] = '\0';
+		}
+
+		if (length == 0) {
+			continue;
+		}
+
+		if (*count == capacity) {
+			struct batch_item *new_items;
+
+			capacity *= 2;
+
+			new_items = realloc(items, capacity * sizeof *items);
+
+			if (new_items == NULL) {
+				break;
+			}
+
+			items = new_items;
+		}
+
+		items[*count].path = malloc(length + 1);
+
+		if (items[*count].path == NULL) {
+			break;
+		}
+
+		strcpy(items[*count].path, line);
+
+		items[*count].err = RET_SUCCESS;
+		items[*count].bytes = 0;
+		items[*count].seconds = 0.;
+
+		++*count;
+	}
+
+	/* a memory allocation failed */
+	if (!feof(stream) || ferror(stream)) {
+		while (*count > 0) {
+			free(items[--*count].path);
+		}
+		free(items);
+		items = NULL;
+	}
+
+	if (stream != stdin)
+		fclose(stream);
+
+	return items;
+}
+
+/* <path>.bin, or <directory>/<file name>.bin */
+static char *get_output_path(const char *path, const char *directory)
+{
+	char *output;
+
+	if (directory != NULL) {
+		const char *name = strrchr(path, '/');
+
+		name = name != NULL ? name + 1 : path;
+
+		output = malloc(strlen(directory) + 1 + strlen(name) + 5);
+
+		if (output != NULL) {
+			sprintf(output, "%s/%s.bin", directory, name);
+		}
+	} else {
+		output = malloc(strlen(path) + 5);
+
+		if (output != NULL) {
+			sprintf(output, "%s.bin", path);
+		}
+	}
+
+	return output;
+}
+
+static int save_stream(const char *path, const unsigned char *ptr, size_t size)
+{
+	FILE *stream;
+	int err = RET_SUCCESS;
+
+	stream = fopen(path, "wb");
+
+	if (stream == NULL) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	if (fwrite(ptr, 1, size, stream) != size) {
+		err = RET_FAILURE_FILE_IO;
+	}
+
+	if (EOF == fclose(stream) && !err) {
+		err = RET_FAILURE_FILE_IO;
+	}
+
+	return err;
+}
+
+static int encode_item(struct worker *worker, struct batch_item *item, const char *directory)
+{
+	struct frame *frame = &worker->frame;
+	struct bio bio;
+	size_t size;
+	char *output;
+	int err;
+
+	err = frame_reload_pgm(frame, item->path);
+
+	if (err) {
+		return err;
+	}
+
+	if (frame->width > (1<<20) || frame->width < 17 || frame->height < 17) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	size = get_maximum_stream_size(frame);
+
+	err = worker_reserve_buffer(worker, size);
+
+	if (err) {
+		return err;
+	}
+
+	bio_open(&bio, worker->buffer, BIO_MODE_WRITE);
+
+	err = open122_encode(&worker->encoder, frame, &bio);
+
+	bio_close(&bio);
+
+	if (err) {
+		return err;
+	}
+
+	item->bytes = (size_t) (bio.ptr - worker->buffer);
+
+	output = get_output_path(item->path, directory);
+
+	if (output == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	err = save_stream(output, worker->buffer, item->bytes);
+
+	free(output);
+
+	return err;
+}
+
+int main(int argc, char *argv[])
+{
+	struct parameters parameters;
+	struct worker *workers;
+	struct batch_item *items;
+	size_t count, num_workers;
+	const char *list = NULL, *directory = NULL;
+	size_t k, failed = 0, total = 0;
+	double begin, end;
+	ptrdiff_t n;
+	int i;
+
+	init_parameters(&parameters);
+
+	for (i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if (arg[0] != '-' || arg[1] == '\0') {
+			list = arg;
+			continue;
+		}
+
+		if (value == NULL || arg[2] != '\0') {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		switch (arg[1]) {
+			case 't':
+				parameters.DWTtype = atoi(value);
+				break;
+			case 's':
+				parameters.S = (size_t) atol(value);
+				break;
+			case 'l':
+				parameters.SegByteLimit = (size_t) atol(value);
+				break;
+			case 'b':
+				parameters.TargetBytes = (size_t) atol(value);
+				break;
+			case 'o':
+				directory = value;
+				break;
+			case 'j':
+#ifdef _OPENMP
+				omp_set_num_threads(atoi(value));
+#else
+				fprintf(stderr, "[WARNING] compiled without OpenMP, the number of threads is ignored\n");
+#endif
+				break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+
+		++i;
+	}
+
+	if (list == NULL) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if ((parameters.DWTtype != 0 && parameters.DWTtype != 1) || parameters.S < 16 || parameters.S > (1<<20) || parameters.SegByteLimit > 134217727) {
+		fprintf(stderr, "[ERROR] invalid parameters\n");
+		return EXIT_FAILURE;
+	}
+
+	items = load_list(list, &count);
+
+	if (items == NULL) {
+		fprintf(stderr, "[ERROR] unable to load the list\n");
+		return EXIT_FAILURE;
+	}
+
+	num_workers = worker_get_count();
+
+	/* the framebuffers and the encoders grow with the images */
+	workers = workers_create(num_workers, 0, 0, &parameters, 0);
+
+	if (workers == NULL) {
+		fprintf(stderr, "[ERROR] unable to initialize the encoders\n");
+		return EXIT_FAILURE;
+	}
+
+	begin = get_time();
+
+#ifdef _OPENMP
+#	pragma omp parallel for schedule(dynamic)
+#endif
+	for (n = 0; n < (ptrdiff_t) count; ++n) {
+		struct worker *worker = workers + worker_get_index();
+		double item_begin = get_time();
+
+		items[n].err = encode_item(worker, &items[n], directory);
+		items[n].seconds = get_time() - item_begin;
+	}
+
+	end = get_time();
+
+	for (k = 0; k < count; ++k) {
+		if (items[k].err) {
+			printf("%s: [ERROR] failed with 0x%04x\n", items[k].path, (unsigned) items[k].err);
+			failed++;
+		} else {
+			printf("%s: %lu bytes, %f ms\n", items[k].path, (unsigned long) items[k].bytes, 1e3 * items[k].seconds);
+			total += items[k].bytes;
+		}
+
+		free(items[k].path);
+	}
+
+	printf("[INFO] %lu images (%lu failed), %lu bytes, %f s, %f images/s, %lu threads\n",
+		(unsigned long) count, (unsigned long) failed, (unsigned long) total, end - begin,
+		end > begin ? (double) count / (end - begin) : 0., (unsigned long) num_workers);
+
+	workers_destroy(workers, num_workers, 0);
+	free(items);
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -19,6 +19,9 @@ int bio_open(struct bio *bio, unsigned char *ptr, int mode)
 	bio->mode = mode;
 
 	bio->ptr = ptr;
+	bio->base = ptr;
+
+	bio_reset_limit(bio);
 
 	if (ptr == NULL) {
 		return RET_FAILURE_LOGIC_ERROR;
@@ -103,7 +106,8 @@ int bio_reload_buffer(struct bio *bio)
 	return RET_SUCCESS;
 }
 
-int bio_put_bit(struct bio *bio, unsigned char b)
+/* bio_put_bit() regardless of the limit */
+static int put_bit(struct bio *bio, unsigned char b)
 {
 	assert(bio != NULL);
 
@@ -131,8 +135,21 @@ int bio_put_bit(struct bio *bio, unsigned char b)
 	return RET_SUCCESS;
 }
 
-/* c' = CHAR_BIT - c */
-int bio_get_bit(struct bio *bio, unsigned char *b)
+int bio_put_bit(struct bio *bio, unsigned char b)
+{
+	assert(bio != NULL);
+
+	if (bio->limit == 0) {
+		return RET_FAILURE_NO_MORE_DATA;
+	}
+
+	bio->limit --;
+
+	return put_bit(bio, b);
+}
+
+/* bio_get_bit() regardless of the limit, c' = CHAR_BIT - c */
+static int get_bit(struct bio *bio, unsigned char *b)
 {
 	assert(bio != NULL);
 
@@ -157,15 +174,45 @@ int bio_get_bit(struct bio *bio, unsigned char *b)
 	return RET_SUCCESS;
 }
 
+int bio_get_bit(struct bio *bio, unsigned char *b)
+{
+	assert(bio != NULL);
+
+	if (bio->limit == 0) {
+		return RET_FAILURE_NO_MORE_DATA;
+	}
+
+	bio->limit --;
+
+	return get_bit(bio, b);
+}
+
+/* take up to n bits of the limit at once, returns the number of bits that can be transferred */
+static size_t take_limit(struct bio *bio, size_t n)
+{
+	assert(bio != NULL);
+
+	if (n > bio->limit) {
+		n = bio->limit;
+	}
+
+	bio->limit -= n;
+
+	return n;
+}
+
 int bio_write_bits(struct bio *bio, UINT32 b, size_t n)
 {
-	size_t i;
+	size_t i, m;
 
 	assert(n <= 32);
 
-	for (i = 0; i < n; ++i) {
+	/* the bits up to the limit are written anyway */
+	m = take_limit(bio, n);
+
+	for (i = 0; i < m; ++i) {
 		/* masking the LSB omitted */
-		int err = bio_put_bit(bio, (unsigned char)b);
+		int err = put_bit(bio, (unsigned char)b);
 
 		b >>= 1;
 
@@ -174,20 +221,27 @@ int bio_write_bits(struct bio *bio, UINT32 b, size_t n)
 		}
 	}
 
+	if (m < n) {
+		return RET_FAILURE_NO_MORE_DATA;
+	}
+
 	return RET_SUCCESS;
 }
 
 int bio_read_bits(struct bio *bio, UINT32 *b, size_t n)
 {
-	size_t i;
+	size_t i, m;
 	UINT32 word = 0;
 
 	assert(n <= 32);
 
-	for (i = 0; i < n; ++i) {
+	/* the bits up to the limit are read anyway */
+	m = take_limit(bio, n);
+
+	for (i = 0; i < m; ++i) {
 		unsigned char bit;
 
-		int err = bio_get_bit(bio, &bit);
+		int err = get_bit(bio, &bit);
 
 		if (err) {
 			return err;
@@ -201,6 +255,10 @@ int bio_read_bits(struct bio *bio, UINT32 *b, size_t n)
 #endif
 	}
 
+	if (m < n) {
+		return RET_FAILURE_NO_MORE_DATA;
+	}
+
 	assert(b);
 
 	*b = word;
@@ -210,12 +268,14 @@ int bio_read_bits(struct bio *bio, UINT32 *b, size_t n)
 
 int bio_read_dc_bits(struct bio *bio, UINT32 *b, size_t n)
 {
-	size_t i;
+	size_t i, m;
 	unsigned char bit = 0;
 	UINT32 word = 0;
 
-	for (i = 0; i < n; ++i) {
-		int err = bio_get_bit(bio, &bit);
+	m = take_limit(bio, n);
+
+	for (i = 0; i < m; ++i) {
+		int err = get_bit(bio, &bit);
 
 		if (err) {
 			return err;
@@ -229,6 +289,10 @@ int bio_read_dc_bits(struct bio *bio, UINT32 *b, size_t n)
 #endif
 	}
 
+	if (m < n) {
+		return RET_FAILURE_NO_MORE_DATA;
+	}
+
 	for (; i < 32; ++i) {
 		word |= (UINT32)bit << i;
 	}
@@ -251,19 +315,57 @@ int bio_close(struct bio *bio)
 	return RET_SUCCESS;
 }
 
+void bio_set_limit(struct bio *bio, size_t bits)
+{
+	assert(bio != NULL);
+
+	bio->limit = bits;
+}
+
+void bio_reset_limit(struct bio *bio)
+{
+	assert(bio != NULL);
+
+	bio->limit = ~(size_t) 0;
+}
+
+size_t bio_tell(const struct bio *bio)
+{
+	size_t bytes;
+
+	assert(bio != NULL);
+
+	bytes = (size_t) (bio->ptr - bio->base);
+
+	if (bio->mode == BIO_MODE_WRITE) {
+		/* bits buffered in bio->b */
+		return bytes * CHAR_BIT + bio->c;
+	}
+
+	/* bits remaining in bio->b */
+	return bytes * CHAR_BIT - (CHAR_BIT - bio->c);
+}
+
 int bio_write_unary(struct bio *bio, UINT32 N)
 {
-	UINT32 n;
+	size_t n, m;
 	int err;
 
-	for (n = 0; n < N; ++n) {
-		int err = bio_put_bit(bio, 0);
+	/* the zeros up to the limit are written anyway */
+	m = take_limit(bio, (size_t) N);
+
+	for (n = 0; n < m; ++n) {
+		int err = put_bit(bio, 0);
 
 		if (err) {
 			return err;
 		}
 	}
 
+	if (m < (size_t) N) {
+		return RET_FAILURE_NO_MORE_DATA;
+	}
+
 	err = bio_put_bit(bio, 1);
 
 	if (err) {
@@ -16,14 +16,25 @@ struct bio {
 	int mode;
 
 	unsigned char *ptr;
+	unsigned char *base; /* the beginning of the stream */
 
 	unsigned char b; /* buffer */
 	size_t c; /* counter */
+
+	size_t limit; /* the number of bits that can still be written or read */
 };
 
 int bio_open(struct bio *bio, unsigned char *ptr, int mode);
 int bio_close(struct bio *bio);
 
+/* the number of bits written or read since bio_open */
+size_t bio_tell(const struct bio *bio);
+
+/* allow only the next 'bits' bits to be written or read, then fail with RET_FAILURE_NO_MORE_DATA */
+void bio_set_limit(struct bio *bio, size_t bits);
+/* remove the limit */
+void bio_reset_limit(struct bio *bio);
+
 /* write entire UINT32 */
 int bio_write_int(struct bio *bio, UINT32 i);
 /* read entire UINT32 */
@@ -85,6 +85,62 @@ int main()
 
 	bio_close(&bio);
 
+	/* the limit, the bits up to it are transferred by the failing call */
+
+	bio_open(&bio, ptr, BIO_MODE_WRITE);
+
+	bio_set_limit(&bio, 12);
+
+	err = bio_write_bits(&bio, x, 7);
+
+	if (err) {
+		abort();
+	}
+
+	err = bio_write_bits(&bio, y, 7);
+
+	if (err != RET_FAILURE_NO_MORE_DATA) {
+		abort();
+	}
+
+	err = bio_put_bit(&bio, 1);
+
+	if (err != RET_FAILURE_NO_MORE_DATA || bio_tell(&bio) != 12) {
+		abort();
+	}
+
+	bio_close(&bio);
+
+	bio_open(&bio, ptr, BIO_MODE_READ);
+
+	bio_set_limit(&bio, 12);
+
+	err = bio_read_bits(&bio, &x, 7);
+
+	if (err) {
+		abort();
+	}
+
+	err = bio_read_bits(&bio, &y, 7);
+
+	if (err != RET_FAILURE_NO_MORE_DATA || bio_tell(&bio) != 12) {
+		abort();
+	}
+
+	assert(x == 42);
+
+	bio_reset_limit(&bio);
+
+	err = bio_read_bits(&bio, &y, 2);
+
+	if (err) {
+		abort();
+	}
+
+	assert(y == 0);
+
+	bio_close(&bio);
+
 	free(ptr);
 
 	return 0;
@@ -1,5 +1,6 @@
 #include "bpe.h"
 #include "common.h"
+#include "alloc.h"
 #include <assert.h>
 #include <stdlib.h>
 
@@ -18,8 +19,10 @@
 #define M27 134217727
 #define M31 2147483647
 
+/* 8x8 block of the frame, either data or data16 is used (see struct frame) */
 struct block {
 	int *data;
+	short *data16;
 	size_t stride;
 };
 
@@ -136,13 +139,10 @@ static const unsigned char lut_codeword_length[8] = {
 	8, 40, 16, 48, 24, 56, 32, 64
 };
 
-int bpe_init(struct bpe *bpe, const struct parameters *parameters, struct bio *bio, struct frame *frame)
+/* no buffers allocated */
+static void bpe_clear(struct bpe *bpe, int reuse)
 {
-	int i;
-	int err;
-
 	assert(bpe != NULL);
-	assert(parameters != NULL);
 
 	bpe->segment = NULL;
 	bpe->quantized_dc = NULL;
@@ -152,6 +152,52 @@ int bpe_init(struct bpe *bpe, const struct parameters *parameters, struct bio *b
 	bpe->type = NULL;
 	bpe->sign = NULL;
 	bpe->magnitude = NULL;
+	bpe->segment_capacity = 0;
+
+	bpe->rate_buffer = NULL;
+	bpe->limit_buffer = NULL;
+	bpe->rate_capacity = 0;
+
+	bpe->capacity = 0;
+
+	bpe->reuse_width = 0;
+	bpe->reuse_bpp = 0;
+
+	bpe->reuse = reuse;
+}
+
+int bpe_init(struct bpe *bpe, const struct parameters *parameters, struct bio *bio, struct frame *frame)
+{
+	bpe_clear(bpe, 0);
+
+	return bpe_reset(bpe, parameters, bio, frame);
+}
+
+void bpe_init_reuse(struct bpe *bpe)
+{
+	bpe_clear(bpe, 1);
+}
+
+/* the subband weights of init_parameters() */
+static void set_default_weight(int *weight)
+{
+	struct parameters parameters;
+	int i;
+
+	init_parameters(&parameters);
+
+	for (i = 0; i < 12; ++i) {
+		weight[i] = parameters.weight[i];
+	}
+}
+
+int bpe_reset(struct bpe *bpe, const struct parameters *parameters, struct bio *bio, struct frame *frame)
+{
+	int i;
+	int err;
+
+	assert(bpe != NULL);
+	assert(parameters != NULL);
 
 	bpe->bio = bio;
 
@@ -161,6 +207,27 @@ int bpe_init(struct bpe *bpe, const struct parameters *parameters, struct bio *b
 
 	bpe->frame = frame;
 
+	bpe->region = NULL;
+
+	bpe->container = NULL;
+
+	bpe->rate = NULL;
+
+	bpe->stripe = NULL;
+	bpe->stripe_context = NULL;
+
+	assert(parameters->DecodeStageStop >= 0 && parameters->DecodeStageStop <= 3);
+	assert(parameters->StageStop >= 0 && parameters->StageStop <= 3);
+
+	bpe->decode_bit_plane_stop = parameters->DecodeBitPlaneStop;
+	bpe->decode_stage_stop = (UINT32)parameters->DecodeStageStop;
+
+	/* the rows of the reused framebuffer are kept */
+	if (!bpe->reuse) {
+		bpe->capacity = 0;
+	}
+	bpe->height_hint = parameters->DecodeHeightHint;
+
 	/* init Segment Header */
 
 	assert(bpe->frame != NULL);
@@ -176,8 +243,8 @@ int bpe_init(struct bpe *bpe, const struct parameters *parameters, struct bio *b
 	bpe->segment_header.PadRows = (UINT32)((8 - bpe->frame->height % 8) % 8);
 	bpe->segment_header.SegByteLimit = (UINT32)parameters->SegByteLimit;
 	bpe->segment_header.DCStop = parameters->DCStop; /* 1 => Terminate coded segment after coding quantized DC coefficient information and additional DC bit planes */
-	bpe->segment_header.BitPlaneStop = 0; /* When BitPlaneStop = b and StageStop = s, coded segment terminates once stage s of bit plane b has been completed */
-	bpe->segment_header.StageStop = 3; /* 3 => stage 4 */
+	bpe->segment_header.BitPlaneStop = (UINT32)parameters->BitPlaneStop; /* When BitPlaneStop = b and StageStop = s, coded segment terminates once stage s of bit plane b has been completed */
+	bpe->segment_header.StageStop = (UINT32)parameters->StageStop; /* 3 => stage 4 */
 	bpe->segment_header.UseFill = 0;
 	bpe->segment_header.S = (UINT32) parameters->S;
 	bpe->segment_header.OptDCSelect = parameters->OptDCSelect; /* 0 => heuristic selection of k parameter, 1 => optimum selection */
@@ -189,12 +256,13 @@ int bpe_init(struct bpe *bpe, const struct parameters *parameters, struct bio *b
 	bpe->segment_header.ImageWidth = (UINT32)bpe->frame->width;
 	bpe->segment_header.TransposeImg = 0;
 	bpe->segment_header.CodeWordLength = 6; /* 6 => 32-bit coded words */
-	bpe->segment_header.CustomWtFlag = 0; /* no custom weights */
-
 	for (i = 0; i < 12; ++i) {
 		bpe->segment_header.weight[i] = parameters->weight[i];
 	}
 
+	/* the weights are signaled when the Integer DWT uses other than the default ones */
+	bpe->segment_header.CustomWtFlag = parameters->DWTtype == 1 && !is_default_weight(parameters->weight);
+
 	err = bpe_realloc_segment(bpe, parameters->S);
 
 	if (err) {
@@ -211,7 +279,7 @@ int bpe_is_last_segment(struct bpe *bpe)
 	return bpe->segment_header.EndImgFlag;
 }
 
-/* the S has been changed, realloc bpe->segment[] */
+/* the S has been changed, realloc bpe->segment[], the buffers only grow */
 int bpe_realloc_segment(struct bpe *bpe, size_t S)
 {
 	assert(bpe != NULL);
@@ -219,54 +287,181 @@ int bpe_realloc_segment(struct bpe *bpe, size_t S)
 	bpe->S = S;
 	bpe->segment_header.S = (UINT32) S;
 
-	bpe->segment = realloc(bpe->segment, S * BLOCK_SIZE * sizeof(INT32));
+	if (S <= bpe->segment_capacity) {
+		return RET_SUCCESS;
+	}
+
+	bpe->segment = alloc_realloc(bpe->segment, S * BLOCK_SIZE * sizeof(INT32));
 
 	if (bpe->segment == NULL && S != 0) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	bpe->quantized_dc = realloc(bpe->quantized_dc, S * sizeof(INT32));
+	bpe->quantized_dc = alloc_realloc(bpe->quantized_dc, S * sizeof(INT32));
 
 	if (bpe->quantized_dc == NULL && S != 0) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	bpe->mapped_quantized_dc = realloc(bpe->mapped_quantized_dc, S * sizeof(UINT32));
+	bpe->mapped_quantized_dc = alloc_realloc(bpe->mapped_quantized_dc, S * sizeof(UINT32));
 
 	if (bpe->mapped_quantized_dc == NULL && S != 0) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	bpe->bitDepthAC_Block = realloc(bpe->bitDepthAC_Block, S * sizeof(UINT32));
+	bpe->bitDepthAC_Block = alloc_realloc(bpe->bitDepthAC_Block, S * sizeof(UINT32));
 
 	if (bpe->bitDepthAC_Block == NULL && S != 0) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	bpe->mapped_BitDepthAC_Block = realloc(bpe->mapped_BitDepthAC_Block, S * sizeof(UINT32));
+	bpe->mapped_BitDepthAC_Block = alloc_realloc(bpe->mapped_BitDepthAC_Block, S * sizeof(UINT32));
 
 	if (bpe->mapped_BitDepthAC_Block == NULL && S != 0) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	bpe->type = realloc(bpe->type, S * BLOCK_SIZE * sizeof(int));
+	bpe->type = alloc_realloc(bpe->type, S * BLOCK_SIZE * sizeof(int));
 
 	if (bpe->type == NULL && S != 0) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	bpe->sign = realloc(bpe->sign, S * BLOCK_SIZE * sizeof(INT32));
+	bpe->sign = alloc_realloc(bpe->sign, S * BLOCK_SIZE * sizeof(INT32));
 
 	if (bpe->sign == NULL && S != 0) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	bpe->magnitude = realloc(bpe->magnitude, S * BLOCK_SIZE * sizeof(UINT32));
+	bpe->magnitude = alloc_realloc(bpe->magnitude, S * BLOCK_SIZE * sizeof(UINT32));
 
 	if (bpe->magnitude == NULL && S != 0) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
+	bpe->segment_capacity = S;
+
+	return RET_SUCCESS;
+}
+
+/* resize the framebuffer for 'rows' rows, the frame->height is kept */
+static int frame_realloc_rows(struct frame *frame, size_t rows)
+{
+	size_t height;
+	int err;
+
+	assert(frame != NULL);
+
+	height = frame->height;
+
+	frame->height = rows;
+
+	err = frame_realloc_data(frame);
+
+	frame->height = height;
+
+	return err;
+}
+
+/* frame_realloc_rows(), the storage is selected according to the bit depth */
+static int frame_reset_rows(struct frame *frame, size_t rows)
+{
+	size_t height;
+	int err;
+
+	assert(frame != NULL);
+
+	height = frame->height;
+
+	frame->height = rows;
+
+	err = frame_reset_data(frame);
+
+	frame->height = height;
+
+	return err;
+}
+
+/* frame_realloc_rows(), the storage is changed to int */
+static int frame_widen_rows(struct frame *frame, size_t rows)
+{
+	size_t height;
+	int err;
+
+	assert(frame != NULL);
+
+	height = frame->height;
+
+	frame->height = rows;
+
+	err = frame_widen_data(frame);
+
+	frame->height = height;
+
+	return err;
+}
+
+/* frame_realloc_rows(), the custom weights may scale the coefficients beyond the 16-bit storage */
+static int bpe_realloc_rows(struct bpe *bpe, struct frame *frame, size_t rows)
+{
+	int err;
+
+	assert(bpe != NULL);
+
+	err = frame_realloc_rows(frame, rows);
+
+	if (err) {
+		return err;
+	}
+
+	if (bpe->segment_header.CustomWtFlag) {
+		return frame_widen_rows(frame, rows);
+	}
+
+	return RET_SUCCESS;
+}
+
+/* make room for frame->height rows, the framebuffer grows geometrically to at least the height hint */
+static int bpe_reserve_frame_height(struct bpe *bpe, struct frame *frame)
+{
+	size_t capacity, hint;
+	int err;
+
+	assert(bpe != NULL);
+	assert(frame != NULL);
+
+	if (frame->height <= bpe->capacity) {
+		return RET_SUCCESS;
+	}
+
+	capacity = bpe->capacity > SIZE_MAX_ / 2 ? SIZE_MAX_ : 2 * bpe->capacity;
+
+	if (capacity < frame->height) {
+		capacity = frame->height;
+	}
+
+	/* the rows are allocated in multiples of 8 anyway, the padded frame fits into the hint */
+	hint = bpe->height_hint < SIZE_MAX_ - 7 ? ceil_multiple8(bpe->height_hint) : SIZE_MAX_ - 7;
+
+	/* the hint is not validated, when it cannot be allocated, it is dropped and the framebuffer grows as without it */
+	if (capacity < hint) {
+		if (bpe_realloc_rows(bpe, frame, hint) == RET_SUCCESS) {
+			bpe->capacity = hint;
+
+			return RET_SUCCESS;
+		}
+
+		bpe->height_hint = 0;
+	}
+
+	err = bpe_realloc_rows(bpe, frame, capacity);
+
+	if (err) {
+		return err;
+	}
+
+	bpe->capacity = capacity;
+
 	return RET_SUCCESS;
 }
 
@@ -289,14 +484,37 @@ int bpe_realloc_frame_width(struct bpe *bpe)
 
 	bpe->frame->width = (size_t) bpe->segment_header.ImageWidth;
 
-	/* call frame_realloc_data */
-	err = frame_realloc_data(bpe->frame);
+	if (bpe->region != NULL) {
+		/* only the region is stored */
+		size_t width = bpe->frame->width > bpe->region_x ? bpe->frame->width - bpe->region_x : 0;
 
-	if (err) {
-		return err;
+		bpe->region->width = width < bpe->region_width ? width : bpe->region_width;
+
+		return bpe_realloc_rows(bpe, bpe->region, bpe->capacity);
 	}
 
-	return RET_SUCCESS;
+	/* nothing has been decoded yet, a reused framebuffer takes the storage of the bit depth */
+	if (bpe->frame->height == 0) {
+		/* the framebuffer of the previous frame of the same geometry is taken as it is */
+		if (bpe->reuse && bpe->frame->width == bpe->reuse_width && bpe->frame->bpp == bpe->reuse_bpp
+			&& (bpe->frame->data != NULL || bpe->frame->data16 != NULL)) {
+			err = RET_SUCCESS;
+		} else {
+			err = frame_reset_rows(bpe->frame, bpe->capacity);
+		}
+
+		if (err) {
+			return err;
+		}
+
+		if (bpe->segment_header.CustomWtFlag) {
+			return frame_widen_rows(bpe->frame, bpe->capacity);
+		}
+
+		return RET_SUCCESS;
+	}
+
+	return bpe_realloc_rows(bpe, bpe->frame, bpe->capacity);
 }
 
 int bpe_realloc_frame_bpp(struct bpe *bpe)
@@ -306,6 +524,10 @@ int bpe_realloc_frame_bpp(struct bpe *bpe)
 
 	bpe->frame->bpp = (size_t) ((!!bpe->segment_header.ExtendedPixelBitDepthFlag * 1UL) * 16 + bpe->segment_header.PixelBitDepth);
 
+	if (bpe->region != NULL) {
+		bpe->region->bpp = bpe->frame->bpp;
+	}
+
 	return RET_SUCCESS;
 }
 
@@ -319,7 +541,22 @@ int bpe_increase_frame_height(struct bpe *bpe)
 
 	bpe->frame->height += 8;
 
-	err = frame_realloc_data(bpe->frame);
+	if (bpe->region != NULL) {
+		/* the stripe ends at bpe->frame->height */
+		if (bpe->frame->height > bpe->region_y && bpe->region->height < bpe->region_height) {
+			bpe->region->height += 8;
+
+			if (bpe->region->height > bpe->region_height) {
+				bpe->region->height = bpe->region_height;
+			}
+
+			return bpe_reserve_frame_height(bpe, bpe->region);
+		}
+
+		return RET_SUCCESS;
+	}
+
+	err = bpe_reserve_frame_height(bpe, bpe->frame);
 
 	if (err) {
 		return err;
@@ -334,6 +571,10 @@ void bpe_initialize_frame_height(struct bpe *bpe)
 	assert(bpe->frame != NULL);
 
 	bpe->frame->height = 0;
+
+	if (bpe->region != NULL) {
+		bpe->region->height = 0;
+	}
 }
 
 void bpe_correct_frame_height(struct bpe *bpe)
@@ -342,25 +583,46 @@ void bpe_correct_frame_height(struct bpe *bpe)
 	assert(bpe->frame != NULL);
 
 	bpe->frame->height -= bpe->segment_header.PadRows;
+
+	if (bpe->region != NULL && bpe->region_y + bpe->region->height > bpe->frame->height) {
+		bpe->region->height = bpe->frame->height > bpe->region_y ? bpe->frame->height - bpe->region_y : 0;
+	}
+}
+
+/* pass the transform read from the segment header to the inverse DWT */
+static void bpe_get_parameters(const struct bpe *bpe, struct parameters *parameters)
+{
+	int i;
+
+	parameters->DWTtype = bpe->segment_header.DWTtype;
+
+	for (i = 0; i < 12; ++i) {
+		parameters->weight[i] = bpe->segment_header.weight[i];
+	}
 }
 
 int bpe_destroy(struct bpe *bpe, struct parameters *parameters)
 {
 	assert(bpe != NULL);
 
-	free(bpe->segment);
-	free(bpe->quantized_dc);
-	free(bpe->mapped_quantized_dc);
-	free(bpe->bitDepthAC_Block);
-	free(bpe->mapped_BitDepthAC_Block);
-	free(bpe->type);
-	free(bpe->sign);
-	free(bpe->magnitude);
+	alloc_free(bpe->segment);
+	alloc_free(bpe->quantized_dc);
+	alloc_free(bpe->mapped_quantized_dc);
+	alloc_free(bpe->bitDepthAC_Block);
+	alloc_free(bpe->mapped_BitDepthAC_Block);
+	alloc_free(bpe->type);
+	alloc_free(bpe->sign);
+	alloc_free(bpe->magnitude);
+
+	alloc_free(bpe->rate_buffer);
+	alloc_free(bpe->limit_buffer);
 
 	if (parameters != NULL) {
-		parameters->DWTtype = bpe->segment_header.DWTtype;
+		bpe_get_parameters(bpe, parameters);
 	}
 
+	bpe_clear(bpe, 0);
+
 	return RET_SUCCESS;
 }
 
@@ -484,16 +746,16 @@ int bpe_write_segment_header_part4(struct bpe *bpe)
 	 word = 0;
 	 word |= SET_BOOL_INTO_UINT32(bpe->segment_header.CustomWtFlag, 0);
 	 if (bpe->segment_header.CustomWtFlag) {
-		word |= SET_UINT_INTO_UINT32(bpe->segment_header.weight[DWT_HH0] - 1,  1, M2); /* CustomWtHH1 (DWT_HH0) */
-		word |= SET_UINT_INTO_UINT32(bpe->segment_header.weight[DWT_HL0] - 1,  3, M2); /* CustomWtHL1 (DWT_HL0) */
-		word |= SET_UINT_INTO_UINT32(bpe->segment_header.weight[DWT_LH0] - 1,  5, M2); /* CustomWtLH1 (DWT_LH0) */
-		word |= SET_UINT_INTO_UINT32(bpe->segment_header.weight[DWT_HH1] - 1,  7, M2); /* CustomWtHH2 (DWT_HH1) */
-		word |= SET_UINT_INTO_UINT32(bpe->segment_header.weight[DWT_HL1] - 1,  9, M2); /* CustomWtHL2 (DWT_HL1) */
-		word |= SET_UINT_INTO_UINT32(bpe->segment_header.weight[DWT_LH1] - 1, 11, M2); /* CustomWtLH2 (DWT_LH1) */
-		word |= SET_UINT_INTO_UINT32(bpe->segment_header.weight[DWT_HH2] - 1, 13, M2); /* CustomWtHH3 (DWT_HH2) */
-		word |= SET_UINT_INTO_UINT32(bpe->segment_header.weight[DWT_HL2] - 1, 15, M2); /* CustomWtHL3 (DWT_HL2) */
-		word |= SET_UINT_INTO_UINT32(bpe->segment_header.weight[DWT_LH2] - 1, 17, M2); /* CustomWtLH3 (DWT_LH2) */
-		word |= SET_UINT_INTO_UINT32(bpe->segment_header.weight[DWT_LL2] - 1, 19, M2); /* CustomWtLL3 (DWT_LL2) */
+		word |= SET_UINT_INTO_UINT32((UINT32) bpe->segment_header.weight[DWT_HH0],  1, M2); /* CustomWtHH1 (DWT_HH0) */
+		word |= SET_UINT_INTO_UINT32((UINT32) bpe->segment_header.weight[DWT_HL0],  3, M2); /* CustomWtHL1 (DWT_HL0) */
+		word |= SET_UINT_INTO_UINT32((UINT32) bpe->segment_header.weight[DWT_LH0],  5, M2); /* CustomWtLH1 (DWT_LH0) */
+		word |= SET_UINT_INTO_UINT32((UINT32) bpe->segment_header.weight[DWT_HH1],  7, M2); /* CustomWtHH2 (DWT_HH1) */
+		word |= SET_UINT_INTO_UINT32((UINT32) bpe->segment_header.weight[DWT_HL1],  9, M2); /* CustomWtHL2 (DWT_HL1) */
+		word |= SET_UINT_INTO_UINT32((UINT32) bpe->segment_header.weight[DWT_LH1], 11, M2); /* CustomWtLH2 (DWT_LH1) */
+		word |= SET_UINT_INTO_UINT32((UINT32) bpe->segment_header.weight[DWT_HH2], 13, M2); /* CustomWtHH3 (DWT_HH2) */
+		word |= SET_UINT_INTO_UINT32((UINT32) bpe->segment_header.weight[DWT_HL2], 15, M2); /* CustomWtHL3 (DWT_HL2) */
+		word |= SET_UINT_INTO_UINT32((UINT32) bpe->segment_header.weight[DWT_LH2], 17, M2); /* CustomWtLH3 (DWT_LH2) */
+		word |= SET_UINT_INTO_UINT32((UINT32) bpe->segment_header.weight[DWT_LL2], 19, M2); /* CustomWtLL3 (DWT_LL2) */
 	 }
 	 /* +21 Reserved : 11 */
 
@@ -630,16 +892,18 @@ int bpe_read_segment_header_part4(struct bpe *bpe)
 
 	bpe->segment_header.CustomWtFlag = GET_BOOL_FROM_UINT32(word, 0);
 	if (bpe->segment_header.CustomWtFlag) {
-		bpe->segment_header.weight[DWT_HH0] = 1 + (int)GET_UINT_FROM_UINT32(word,  1, M2); /* CustomWtHH1 (DWT_HH0) */
-		bpe->segment_header.weight[DWT_HL0] = 1 + (int)GET_UINT_FROM_UINT32(word,  3, M2); /* CustomWtHL1 (DWT_HL0) */
-		bpe->segment_header.weight[DWT_LH0] = 1 + (int)GET_UINT_FROM_UINT32(word,  5, M2); /* CustomWtLH1 (DWT_LH0) */
-		bpe->segment_header.weight[DWT_HH1] = 1 + (int)GET_UINT_FROM_UINT32(word,  7, M2); /* CustomWtHH2 (DWT_HH1) */
-		bpe->segment_header.weight[DWT_HL1] = 1 + (int)GET_UINT_FROM_UINT32(word,  9, M2); /* CustomWtHL2 (DWT_HL1) */
-		bpe->segment_header.weight[DWT_LH1] = 1 + (int)GET_UINT_FROM_UINT32(word, 11, M2); /* CustomWtLH2 (DWT_LH1) */
-		bpe->segment_header.weight[DWT_HH2] = 1 + (int)GET_UINT_FROM_UINT32(word, 13, M2); /* CustomWtHH3 (DWT_HH2) */
-		bpe->segment_header.weight[DWT_HL2] = 1 + (int)GET_UINT_FROM_UINT32(word, 15, M2); /* CustomWtHL3 (DWT_HL2) */
-		bpe->segment_header.weight[DWT_LH2] = 1 + (int)GET_UINT_FROM_UINT32(word, 17, M2); /* CustomWtLH3 (DWT_LH2) */
-		bpe->segment_header.weight[DWT_LL2] = 1 + (int)GET_UINT_FROM_UINT32(word, 19, M2); /* CustomWtLL3 (DWT_LL2) */
+		bpe->segment_header.weight[DWT_HH0] = (int)GET_UINT_FROM_UINT32(word,  1, M2); /* CustomWtHH1 (DWT_HH0) */
+		bpe->segment_header.weight[DWT_HL0] = (int)GET_UINT_FROM_UINT32(word,  3, M2); /* CustomWtHL1 (DWT_HL0) */
+		bpe->segment_header.weight[DWT_LH0] = (int)GET_UINT_FROM_UINT32(word,  5, M2); /* CustomWtLH1 (DWT_LH0) */
+		bpe->segment_header.weight[DWT_HH1] = (int)GET_UINT_FROM_UINT32(word,  7, M2); /* CustomWtHH2 (DWT_HH1) */
+		bpe->segment_header.weight[DWT_HL1] = (int)GET_UINT_FROM_UINT32(word,  9, M2); /* CustomWtHL2 (DWT_HL1) */
+		bpe->segment_header.weight[DWT_LH1] = (int)GET_UINT_FROM_UINT32(word, 11, M2); /* CustomWtLH2 (DWT_LH1) */
+		bpe->segment_header.weight[DWT_HH2] = (int)GET_UINT_FROM_UINT32(word, 13, M2); /* CustomWtHH3 (DWT_HH2) */
+		bpe->segment_header.weight[DWT_HL2] = (int)GET_UINT_FROM_UINT32(word, 15, M2); /* CustomWtHL3 (DWT_HL2) */
+		bpe->segment_header.weight[DWT_LH2] = (int)GET_UINT_FROM_UINT32(word, 17, M2); /* CustomWtLH3 (DWT_LH2) */
+		bpe->segment_header.weight[DWT_LL2] = (int)GET_UINT_FROM_UINT32(word, 19, M2); /* CustomWtLL3 (DWT_LL2) */
+	} else {
+		set_default_weight(bpe->segment_header.weight);
 	}
 	/* +21 Reserved : 11 */
 
@@ -704,6 +968,30 @@ int bpe_write_segment_header(struct bpe *bpe)
 	return RET_SUCCESS;
 }
 
+/* the length of the segment header in bits, see bpe_write_segment_header() */
+static size_t segment_header_bits(const struct segment_header *segment_header)
+{
+	size_t bits = 24;
+
+	if (segment_header->EndImgFlag) {
+		bits += 8;
+	}
+
+	if (segment_header->StartImgFlag || segment_header->Part2Flag) {
+		bits += 40;
+	}
+
+	if (segment_header->StartImgFlag || segment_header->Part3Flag) {
+		bits += 24;
+	}
+
+	if (segment_header->StartImgFlag || segment_header->Part4Flag) {
+		bits += 64;
+	}
+
+	return bits;
+}
+
 int bpe_read_segment_header(struct bpe *bpe)
 {
 	int err;
@@ -3025,6 +3313,14 @@ void block_magnitude_sign_set(INT32 *data, INT32 *sign, UINT32 *magnitude, size_
 	}
 }
 
+/* record the end of the stage 'stage' of the bit plane 'b' */
+static void bpe_segment_mark(struct bpe *bpe, size_t b, int stage)
+{
+	if (bpe->rate != NULL && b < 32) {
+		bpe->rate->stage[b][stage] = bio_tell(bpe->bio);
+	}
+}
+
 /* Section 4.5 */
 int bpe_encode_segment_bit_plane_coding(struct bpe *bpe)
 {
@@ -3071,6 +3367,8 @@ int bpe_encode_segment_bit_plane_coding(struct bpe *bpe)
 			return err;
 		}
 
+		bpe_segment_mark(bpe, b, 0);
+
 		if (b == bpe->segment_header.BitPlaneStop && bpe->segment_header.StageStop == 0) {
 			break;
 		}
@@ -3082,18 +3380,24 @@ int bpe_encode_segment_bit_plane_coding(struct bpe *bpe)
 			return err;
 		}
 
+		bpe_segment_mark(bpe, b, 1);
+
 		if (b == bpe->segment_header.BitPlaneStop && bpe->segment_header.StageStop == 1) {
 			break;
 		}
 
 		/* TODO Stage 3 */
 
+		bpe_segment_mark(bpe, b, 2);
+
 		if (b == bpe->segment_header.BitPlaneStop && bpe->segment_header.StageStop == 2) {
 			break;
 		}
 
 		/* TODO Stage 4 */
 
+		bpe_segment_mark(bpe, b, 3);
+
 		if (b == bpe->segment_header.BitPlaneStop && bpe->segment_header.StageStop == 3) {
 			break;
 		}
@@ -3102,6 +3406,45 @@ int bpe_encode_segment_bit_plane_coding(struct bpe *bpe)
 	return RET_SUCCESS;
 }
 
+/* freeze the AC coefficients decoded so far into bpe->segment[] */
+static void bpe_decode_segment_freeze(struct bpe *bpe)
+{
+	size_t m;
+
+	for (m = 0; m < bpe->S; ++m) {
+		INT32 *block_coeff = bpe->segment + m * BLOCK_SIZE;
+		INT32 *block_sign = bpe->sign + m * BLOCK_SIZE;
+		UINT32 *block_magnitude = bpe->magnitude + m * BLOCK_SIZE;
+
+		block_magnitude_sign_set(block_coeff, block_sign, block_magnitude, 8);
+	}
+}
+
+/*
+ * Checks the stop points after the stage 'stage' of the bit plane 'b'.
+ * Returns nonzero when no more bits of the segment have to be read.
+ * The decoder stop freezes the coefficients, the rest of the segment is then parsed only to find its end.
+ * There is nothing to parse after the last segment.
+ */
+static int bpe_decode_segment_stop(struct bpe *bpe, size_t b, UINT32 stage, int *stopped)
+{
+	if (b == bpe->segment_header.BitPlaneStop && bpe->segment_header.StageStop == stage) {
+		return 1;
+	}
+
+	if (!*stopped && b == bpe->decode_bit_plane_stop && bpe->decode_stage_stop == stage) {
+		dprint (("BPE: decoder stop reached at bit plane %lu, stage %lu\n", (unsigned long)b, (unsigned long)stage));
+
+		bpe_decode_segment_freeze(bpe);
+
+		*stopped = 1;
+
+		return bpe_is_last_segment(bpe);
+	}
+
+	return 0;
+}
+
 /* Section 4.5 */
 int bpe_decode_segment_bit_plane_coding(struct bpe *bpe)
 {
@@ -3109,6 +3452,7 @@ int bpe_decode_segment_bit_plane_coding(struct bpe *bpe)
 	size_t b_;
 	size_t S;
 	size_t m;
+	int stopped = 0;
 
 	assert(bpe != NULL);
 
@@ -3136,6 +3480,11 @@ int bpe_decode_segment_bit_plane_coding(struct bpe *bpe)
 		/* Stage 0 */
 		err = bpe_decode_segment_bit_plane_coding_stage0(bpe, b);
 
+		/* truncated segment, see SegByteLimit */
+		if (err == RET_FAILURE_NO_MORE_DATA) {
+			break;
+		}
+
 		if (err) {
 			return err;
 		}
@@ -3143,92 +3492,147 @@ int bpe_decode_segment_bit_plane_coding(struct bpe *bpe)
 		/* TODO Stage 1 */
 		err = bpe_decode_segment_bit_plane_coding_stage1(bpe, b);
 
+		/* truncated segment, see SegByteLimit */
+		if (err == RET_FAILURE_NO_MORE_DATA) {
+			break;
+		}
+
 		if (err) {
 			return err;
 		}
 
-		if (b == bpe->segment_header.BitPlaneStop && bpe->segment_header.StageStop == 0) {
+		bpe_segment_mark(bpe, b, 0);
+
+		if (bpe_decode_segment_stop(bpe, b, 0, &stopped)) {
 			break;
 		}
 
 		/* TODO Stage 2 */
 		err = bpe_decode_segment_bit_plane_coding_stage2(bpe, b);
 
+		/* truncated segment, see SegByteLimit */
+		if (err == RET_FAILURE_NO_MORE_DATA) {
+			break;
+		}
+
 		if (err) {
 			return err;
 		}
 
-		if (b == bpe->segment_header.BitPlaneStop && bpe->segment_header.StageStop == 1) {
+		bpe_segment_mark(bpe, b, 1);
+
+		if (bpe_decode_segment_stop(bpe, b, 1, &stopped)) {
 			break;
 		}
 
 		/* TODO Stage 3 */
 
-		if (b == bpe->segment_header.BitPlaneStop && bpe->segment_header.StageStop == 2) {
+		bpe_segment_mark(bpe, b, 2);
+
+		if (bpe_decode_segment_stop(bpe, b, 2, &stopped)) {
 			break;
 		}
 
 		/* TODO Stage 4 */
 
-		if (b == bpe->segment_header.BitPlaneStop && bpe->segment_header.StageStop == 3) {
+		bpe_segment_mark(bpe, b, 3);
+
+		if (bpe_decode_segment_stop(bpe, b, 3, &stopped)) {
 			break;
 		}
 	}
 
 	/* after decoding */
-	for (m = 0; m < S; ++m) {
-		INT32 *block_coeff = bpe->segment + m * BLOCK_SIZE;
-		INT32 *block_sign = bpe->sign + m * BLOCK_SIZE;
-		UINT32 *block_magnitude = bpe->magnitude + m * BLOCK_SIZE;
+	if (!stopped) {
+		bpe_decode_segment_freeze(bpe);
+	} else {
+		/*
+		 * drop the DC bit planes below the stop refined by Stage 0 in the meantime,
+		 * the bit planes from 'q' up come from the initial coding of the DC coefficients
+		 */
+		size_t planes = bpe->decode_bit_plane_stop < bpe->q ? bpe->decode_bit_plane_stop : bpe->q;
+		UINT32 mask = planes < 32 ? ~(((UINT32)1 << planes) - 1) : 0;
 
-		block_magnitude_sign_set(block_coeff, block_sign, block_magnitude, 8);
+		for (m = 0; m < S; ++m) {
+			INT32 *dc = bpe->segment + m * BLOCK_SIZE;
+
+			*dc = (INT32)((UINT32)*dc & mask);
+		}
 	}
 
 	return RET_SUCCESS;
 }
 
-/* write segment into bitstream */
-int bpe_encode_segment(struct bpe *bpe, int flush)
+/* limit the rest of the segment started at 'bit_offset' to SegByteLimit bytes */
+static void bpe_set_segment_limit(struct bpe *bpe, size_t bit_offset)
 {
-#if (DEBUG_ENCODE_BLOCKS == 1)
-	size_t blk;
-#endif
-	int err;
+	size_t limit = (size_t) bpe->segment_header.SegByteLimit * 8;
+	size_t used = bio_tell(bpe->bio) - bit_offset;
 
-	assert(bpe != NULL);
+	bio_set_limit(bpe->bio, limit > used ? limit - used : 0);
+}
 
-	dprint (("BPE: encoding segment %lu (%lu blocks)\n", bpe->segment_index, bpe->S));
+/* set the prefix and all the truncation points to 'pos' */
+static void segment_rate_fill(struct segment_rate *rate, size_t pos)
+{
+	size_t b;
 
-	/* next block is not valid block (behind the image) */
-	if (flush) {
-		dprint (("BPE: the last segment indicated\n"));
-		bpe->segment_header.EndImgFlag = 1;
-		bpe->segment_header.Part3Flag = 1; /* signal new "S" */
+	for (b = 0; b < 32; ++b) {
+		int stage;
+
+		for (stage = 0; stage < 4; ++stage) {
+			rate->stage[b][stage] = pos;
+		}
 	}
 
-	bpe->segment_header.StartImgFlag = (bpe->block_index == 0);
-	bpe->segment_header.SegmentCount = bpe->segment_index & M8;
-	bpe->segment_header.BitDepthDC = (UINT32) BitDepthDC(bpe);
-	bpe->segment_header.BitDepthAC = (UINT32) BitDepthAC(bpe);
-	/* Part 2: */
-	/* SegByteLimit */
+	rate->dc = pos;
+	rate->prefix = pos;
+}
 
-	err = bpe_write_segment_header(bpe);
+/* make the truncation points monotonic (the bit planes not coded end where the coded ones end) */
+static void bpe_close_segment_rate(struct segment_rate *rate)
+{
+	size_t last;
+	size_t b_;
 
-	if (err) {
-		return err;
+	if (rate->prefix < rate->dc) {
+		rate->prefix = rate->dc;
 	}
 
-	/* after writing of the first segment, set some flags to zero */
-	bpe->segment_header.StartImgFlag = 0;
-	bpe->segment_header.Part2Flag = 0;
-	bpe->segment_header.Part3Flag = 0;
-	bpe->segment_header.Part4Flag = 0;
+	last = rate->prefix;
 
-	bpe->segment_index ++;
+	for (b_ = 0; b_ < 32; ++b_) {
+		size_t b = 31 - b_;
+		int stage;
+
+		for (stage = 0; stage < 4; ++stage) {
+			if (rate->stage[b][stage] < last) {
+				rate->stage[b][stage] = last;
+			}
+
+			last = rate->stage[b][stage];
+		}
+	}
+}
+
+/* code the segment after the header */
+static int bpe_encode_segment_body(struct bpe *bpe)
+{
+#if (DEBUG_ENCODE_BLOCKS == 1)
+	size_t blk;
+#endif
+	int err;
 
 	/* Section 4.3 The initial coding of DC coefficients in a segment is performed in two steps. */
-	bpe_encode_segment_initial_coding_of_DC_coefficients(bpe);
+	err = bpe_encode_segment_initial_coding_of_DC_coefficients(bpe);
+
+	if (err) {
+		return err;
+	}
+
+	if (bpe->rate != NULL) {
+		segment_rate_fill(bpe->rate, bio_tell(bpe->bio));
+	}
 
 	if (bpe->segment_header.DCStop == 1) {
 		dprint (("DCStop is set, stopping the encoding process\n"));
@@ -3243,6 +3647,15 @@ int bpe_encode_segment(struct bpe *bpe, int flush)
 		return err;
 	}
 
+	if (bpe->rate != NULL) {
+		size_t dc = bpe->rate->dc;
+
+		/* the bit planes above BitDepthAC are empty */
+		segment_rate_fill(bpe->rate, bio_tell(bpe->bio));
+
+		bpe->rate->dc = dc;
+	}
+
 	/* Section 4.5 */
 	err = bpe_encode_segment_bit_plane_coding(bpe);
 
@@ -3260,6 +3673,85 @@ int bpe_encode_segment(struct bpe *bpe, int flush)
 	return RET_SUCCESS;
 }
 
+/* write segment into bitstream */
+int bpe_encode_segment(struct bpe *bpe, int flush)
+{
+	size_t bit_offset;
+	int err;
+
+	assert(bpe != NULL);
+
+	dprint (("BPE: encoding segment %lu (%lu blocks)\n", bpe->segment_index, bpe->S));
+
+	/* next block is not valid block (behind the image) */
+	if (flush) {
+		dprint (("BPE: the last segment indicated\n"));
+		bpe->segment_header.EndImgFlag = 1;
+		bpe->segment_header.Part3Flag = 1; /* signal new "S" */
+	}
+
+	bpe->segment_header.StartImgFlag = (bpe->block_index == 0);
+	bpe->segment_header.SegmentCount = bpe->segment_index & M8;
+	bpe->segment_header.BitDepthDC = (UINT32) BitDepthDC(bpe);
+	bpe->segment_header.BitDepthAC = (UINT32) BitDepthAC(bpe);
+	/* Part 2: */
+	/* SegByteLimit */
+
+	bit_offset = bio_tell(bpe->bio);
+
+	if (bpe->container != NULL) {
+		err = container_add_segment(bpe->container, bit_offset, bpe->S);
+
+		if (err) {
+			return err;
+		}
+	}
+
+	err = bpe_write_segment_header(bpe);
+
+	if (err) {
+		return err;
+	}
+
+	if (bpe->rate != NULL) {
+		bpe->rate->segment_header = bpe->segment_header;
+		bpe->rate->start = bit_offset;
+		bpe->rate->header = bio_tell(bpe->bio);
+		bpe->rate->part2 = bpe->segment_header.Part2Flag;
+		/* in the case of DCStop or truncation */
+		segment_rate_fill(bpe->rate, bpe->rate->header);
+	}
+
+	/* after writing of the first segment, set some flags to zero */
+	bpe->segment_header.StartImgFlag = 0;
+	bpe->segment_header.Part2Flag = 0;
+	bpe->segment_header.Part3Flag = 0;
+	bpe->segment_header.Part4Flag = 0;
+
+	bpe->segment_index ++;
+
+	/* the coding stops once the segment reaches SegByteLimit bytes */
+	bpe_set_segment_limit(bpe, bit_offset);
+
+	err = bpe_encode_segment_body(bpe);
+
+	if (bpe->rate != NULL) {
+		bpe->rate->end = bio_tell(bpe->bio);
+		bpe->rate->truncated = (bpe->bio->limit == 0);
+		bpe_close_segment_rate(bpe->rate);
+		bpe->rate ++;
+	}
+
+	bio_reset_limit(bpe->bio);
+
+	if (err == RET_FAILURE_NO_MORE_DATA) {
+		dprint (("BPE: the segment reached SegByteLimit\n"));
+		return RET_SUCCESS;
+	}
+
+	return err;
+}
+
 int bpe_zero_block(INT32 *data, size_t stride)
 {
 	size_t y, x;
@@ -3288,16 +3780,79 @@ int bpe_decode_block(INT32 *data, size_t stride, struct bio *bio)
 }
 #endif
 
+/* decode the segment after the header */
+static int bpe_decode_segment_body(struct bpe *bpe)
+{
+#if (DEBUG_ENCODE_BLOCKS == 1)
+	size_t blk;
+#endif
+	int err;
+
+	err = bpe_decode_segment_initial_coding_of_DC_coefficients(bpe);
+
+	if (err) {
+		return err;
+	}
+
+	if (bpe->rate != NULL) {
+		bpe->rate->dc = bio_tell(bpe->bio);
+	}
+
+	if (bpe->segment_header.DCStop == 1) {
+		return RET_SUCCESS;
+	}
+
+	/* Section 4.4 */
+	err = bpe_decode_segment_specifying_the_ac_bit_depth_in_each_block(bpe);
+
+	if (err) {
+		return err;
+	}
+
+	if (bpe->rate != NULL) {
+		size_t b;
+		int stage;
+
+		bpe->rate->prefix = bio_tell(bpe->bio);
+
+		/* the bit planes above BitDepthAC are empty */
+		for (b = (size_t) bpe->segment_header.BitDepthAC; b < 32; ++b) {
+			for (stage = 0; stage < 4; ++stage) {
+				bpe->rate->stage[b][stage] = bpe->rate->prefix;
+			}
+		}
+	}
+
+	/* Section 4.5 */
+	err = bpe_decode_segment_bit_plane_coding(bpe);
+
+	if (err) {
+		return err;
+	}
+
+#if (DEBUG_ENCODE_BLOCKS == 1)
+	for (blk = 0; blk < bpe->S; ++blk) {
+		/* decode the block */
+		bpe_decode_block(bpe->segment + blk * BLOCK_SIZE, 8, bpe->bio);
+	}
+#endif
+
+	return RET_SUCCESS;
+}
+
 int bpe_decode_segment(struct bpe *bpe)
 {
 	size_t S;
 	size_t blk;
+	size_t bit_offset;
 	int err;
 
 	assert(bpe != NULL);
 
 	S = bpe->S;
 
+	bit_offset = bio_tell(bpe->bio);
+
 	/* the 'S' in the last block should be decoded from Part 4 of the Segment Header */
 
 	err = bpe_read_segment_header(bpe);
@@ -3330,14 +3885,15 @@ int bpe_decode_segment(struct bpe *bpe)
 	if (bpe->segment_header.Part4Flag) {
 		int err;
 
+		/* the bit depth selects the storage of frame->data[] */
+		bpe_realloc_frame_bpp(bpe);
+
 		err = bpe_realloc_frame_width(bpe);
 
 		if (err) {
 			return err;
 		}
 
-		bpe_realloc_frame_bpp(bpe);
-
 		assert(bpe->segment_header.CodeWordLength < 8);
 
 		if (lut_codeword_length[bpe->segment_header.CodeWordLength] > 32){
@@ -3347,6 +3903,14 @@ int bpe_decode_segment(struct bpe *bpe)
 		/* what about DWTtype, etc.? */
 	}
 
+	if (bpe->container != NULL) {
+		err = container_add_segment(bpe->container, bit_offset, S);
+
+		if (err) {
+			return err;
+		}
+	}
+
 	dprint (("BPE: decoding segment %lu (%lu blocks)\n", bpe->segment_index, S));
 
 	bpe->segment_index ++;
@@ -3357,47 +3921,101 @@ int bpe_decode_segment(struct bpe *bpe)
 	}
 #endif
 
-	err = bpe_decode_segment_initial_coding_of_DC_coefficients(bpe);
+	if (bpe->rate != NULL) {
+		bpe->rate->segment_header = bpe->segment_header;
+		bpe->rate->start = bit_offset;
+		bpe->rate->header = bio_tell(bpe->bio);
+		bpe->rate->part2 = bpe->segment_header.Part2Flag;
+		/* nothing reached yet */
+		segment_rate_fill(bpe->rate, SIZE_MAX_);
+	}
 
-	if (err) {
-		return err;
+	/* the segment may have been truncated at SegByteLimit bytes */
+	bpe_set_segment_limit(bpe, bit_offset);
+
+	err = bpe_decode_segment_body(bpe);
+
+	if (bpe->rate != NULL) {
+		bpe->rate->end = bio_tell(bpe->bio);
+		/* the bit-plane coding does not report the truncation */
+		bpe->rate->truncated = (bpe->bio->limit == 0);
+		bpe->rate ++;
 	}
 
-	if (bpe->segment_header.DCStop == 1) {
+	bio_reset_limit(bpe->bio);
+
+	if (err == RET_FAILURE_NO_MORE_DATA) {
+		dprint (("BPE: the segment reached SegByteLimit\n"));
 		return RET_SUCCESS;
 	}
 
-	/* Section 4.4 */
-	err = bpe_decode_segment_specifying_the_ac_bit_depth_in_each_block(bpe);
+	return err;
+}
 
-	if (err) {
-		return err;
-	}
+/* copy the block of the frame into the local buffer of 8x8 coefficients */
+static void block_gather(INT32 *local, const struct block *block)
+{
+	size_t stride;
+	size_t y, x;
 
-	/* Section 4.5 */
-	err = bpe_decode_segment_bit_plane_coding(bpe);
+	assert(block != NULL);
 
-	if (err) {
-		return err;
-	}
+	stride = block->stride;
 
-#if (DEBUG_ENCODE_BLOCKS == 1)
-	for (blk = 0; blk < S; ++blk) {
-		/* decode the block */
-		bpe_decode_block(bpe->segment + blk * BLOCK_SIZE, 8, bpe->bio);
+	if (block->data16 != NULL) {
+		const short *data = block->data16;
+
+		for (y = 0; y < 8; ++y) {
+			for (x = 0; x < 8; ++x) {
+				local[y*8 + x] = data[y*stride + x];
+			}
+		}
+	} else {
+		const int *data = block->data;
+
+		for (y = 0; y < 8; ++y) {
+			for (x = 0; x < 8; ++x) {
+				local[y*8 + x] = data[y*stride + x];
+			}
+		}
 	}
-#endif
+}
 
-	return RET_SUCCESS;
+/* copy the local buffer of 8x8 coefficients into the block of the frame */
+static void block_scatter(const struct block *block, const INT32 *local)
+{
+	size_t stride;
+	size_t y, x;
+
+	assert(block != NULL);
+
+	stride = block->stride;
+
+	if (block->data16 != NULL) {
+		short *data = block->data16;
+
+		for (y = 0; y < 8; ++y) {
+			for (x = 0; x < 8; ++x) {
+				data[y*stride + x] = (short) local[y*8 + x];
+			}
+		}
+	} else {
+		int *data = block->data;
+
+		for (y = 0; y < 8; ++y) {
+			for (x = 0; x < 8; ++x) {
+				data[y*stride + x] = local[y*8 + x];
+			}
+		}
+	}
 }
 
 /* push block into bpe->segment[] */
-int bpe_push_block(struct bpe *bpe, INT32 *data, size_t stride, int flush)
+int bpe_push_block(struct bpe *bpe, const struct block *block, int flush)
 {
 	size_t S;
 	size_t s;
 	INT32 *local;
-	size_t y, x;
 
 	assert(bpe != NULL);
 
@@ -3408,11 +4026,7 @@ int bpe_push_block(struct bpe *bpe, INT32 *data, size_t stride, int flush)
 
 	local = bpe->segment + s * BLOCK_SIZE;
 
-	for (y = 0; y < 8; ++y) {
-		for (x = 0; x < 8; ++x) {
-			local[y*8 + x] = data[y*stride + x];
-		}
-	}
+	block_gather(local, block);
 
 	if (flush) {
 		bpe_realloc_segment(bpe, s + 1);
@@ -3458,23 +4072,11 @@ int bpe_pop_block_decode(struct bpe *bpe)
 	return RET_SUCCESS;
 }
 
-int bpe_pop_block_copy_data(struct bpe *bpe, INT32 *data, size_t stride)
+/* drop the block from bpe->segment[] */
+static int bpe_pop_block_skip(struct bpe *bpe)
 {
-	INT32 *local;
-	size_t y, x;
-
 	assert(bpe != NULL);
 
-	/* pop the block from bpe->segment[] */
-	local = bpe->segment + bpe->s * BLOCK_SIZE;
-
-	/* access frame->data[] */
-	for (y = 0; y < 8; ++y) {
-		for (x = 0; x < 8; ++x) {
-			data[y*stride + x] = local[y*8 + x];
-		}
-	}
-
 	/* next block will be */
 	bpe->s ++;
 
@@ -3486,6 +4088,23 @@ int bpe_pop_block_copy_data(struct bpe *bpe, INT32 *data, size_t stride)
 	return RET_SUCCESS;
 }
 
+int bpe_pop_block_copy_data(struct bpe *bpe, const struct block *block)
+{
+	INT32 *local;
+
+	assert(bpe != NULL);
+
+	/* pop the block from bpe->segment[] */
+	local = bpe->segment + bpe->s * BLOCK_SIZE;
+
+	/* access frame->data[] */
+	block_scatter(block, local);
+
+	bpe_pop_block_skip(bpe);
+
+	return RET_SUCCESS;
+}
+
 size_t get_total_no_blocks(struct frame *frame)
 {
 	size_t height, width;
@@ -3502,7 +4121,6 @@ int block_by_index(struct block *block, struct frame *frame, size_t block_index)
 {
 	size_t width;
 	size_t y, x;
-	int *data;
 
 	assert(frame != NULL);
 
@@ -3511,11 +4129,16 @@ int block_by_index(struct block *block, struct frame *frame, size_t block_index)
 	y = block_index / (width / 8) * 8;
 	x = block_index % (width / 8) * 8;
 
-	data = frame->data;
-
 	assert(block != NULL);
 
-	block->data = data + y*width + x;
+	block->data = NULL;
+	block->data16 = NULL;
+
+	if (frame->data16 != NULL) {
+		block->data16 = frame->data16 + y*width + x;
+	} else {
+		block->data = frame->data + y*width + x;
+	}
 	block->stride = width;
 
 	return RET_SUCCESS;
@@ -3535,23 +4158,45 @@ int block_starts_new_stripe(struct frame *frame, size_t block_index)
 	return x == 0;
 }
 
+/* complete the index of the segments with the geometry and the end of the stream */
+static void bpe_close_index(struct bpe *bpe)
+{
+	assert(bpe != NULL);
+
+	if (bpe->container != NULL) {
+		bpe->container->height = bpe->frame->height;
+		bpe->container->width = bpe->frame->width;
+		bpe->container->bpp = bpe->frame->bpp;
+		bpe->container->DWTtype = bpe->segment_header.DWTtype;
+		bpe->container->bits = bio_tell(bpe->bio);
+	}
+}
+
 int bpe_encode(struct frame *frame, const struct parameters *parameters, struct bio *bio)
+{
+	return bpe_encode_indexed(frame, parameters, bio, NULL);
+}
+
+/* a single pass of the encoder using the buffers of the 'bpe', see struct bpe for 'container' and 'rate' */
+static int bpe_encode_pass(struct bpe *bpe, struct frame *frame, const struct parameters *parameters, struct bio *bio, struct container *container, struct segment_rate *rate)
 {
 	size_t block_index;
 	size_t total_no_blocks;
-	struct bpe bpe;
 	int err;
 
 	assert(frame != NULL);
 
 	total_no_blocks = get_total_no_blocks(frame);
 
-	err = bpe_init(&bpe, parameters, bio, frame);
+	err = bpe_reset(bpe, parameters, bio, frame);
 
 	if (err) {
 		return err;
 	}
 
+	bpe->container = container;
+	bpe->rate = rate;
+
 	/* push all blocks into the BPE engine */
 	for (block_index = 0; block_index < total_no_blocks; ++block_index) {
 		int err;
@@ -3559,46 +4204,565 @@ int bpe_encode(struct frame *frame, const struct parameters *parameters, struct
 
 		block_by_index(&block, frame, block_index);
 
-		err = bpe_push_block(&bpe, block.data, block.stride, (block_index + 1 == total_no_blocks));
+		err = bpe_push_block(bpe, &block, (block_index + 1 == total_no_blocks));
 
 		if (err) {
 			return err;
 		}
 	}
 
-	bpe_destroy(&bpe, NULL);
+	bpe_close_index(bpe);
 
 	return RET_SUCCESS;
 }
 
-int bpe_decode(struct frame *frame, struct parameters *parameters, struct bio *bio)
+/* the size of the segment truncated at the level 't' in bytes, Part 2 of the header is always counted */
+static size_t segment_rate_bytes(const struct segment_rate *rate, size_t t)
 {
-	size_t block_index;
-	struct bpe bpe;
-	int err;
-
-	assert(frame != NULL);
+	size_t pos;
+	size_t bits;
 
-	err = bpe_init(&bpe, parameters, bio, frame);
+	switch (t) {
+		case 0:
+			pos = rate->dc;
+			break;
+		case 1:
+			pos = rate->prefix;
+			break;
+		default:
+			pos = rate->stage[31 - (t - 2) / 4][(t - 2) % 4];
+	}
+
+	bits = pos - rate->start + (rate->part2 ? 0 : 40);
+
+	return (bits + 7) / 8;
+}
+
+/* the number of truncation levels: the DC coefficients, the AC bit depths, and 4 stages of 32 bit planes */
+#define TRUNCATION_LEVELS (2 + 32 * 4)
+
+/*
+ * The length of the segment cut at 'limit' bytes in bits, when all the segments share the same limit.
+ * Part 2 of the header is then written into the first segment only.
+ */
+static size_t segment_rate_bits_shared(const struct segment_rate *rate, size_t limit, int first)
+{
+	size_t part2 = (first ? 40 : 0);
+	size_t header = rate->header - rate->start - (rate->part2 ? 40 : 0) + part2;
+	size_t whole = rate->stage[0][3] - rate->start - (rate->part2 ? 40 : 0) + part2;
+	size_t bits = whole < limit * 8 ? whole : limit * 8;
+
+	/* the header is never cut */
+	return bits > header ? bits : header;
+}
+
+static size_t sum_rate_bits_shared(const struct segment_rate *rate, size_t count, size_t limit)
+{
+	size_t k;
+	size_t sum = 0;
+
+	for (k = 0; k < count; ++k) {
+		sum += segment_rate_bits_shared(rate + k, limit, k == 0);
+	}
+
+	return sum;
+}
+
+/*
+ * Distribute 'bytes' across 'count' segments into 'limit'. All the segments are truncated at
+ * the same (finest possible) level, the bytes left are distributed in proportion
+ * to the sizes of the next level. The distortion reduction of a bit plane does not
+ * depend on the segment, so this roughly equalizes the slopes of the segments.
+ * When not even the DC coefficients fit, all the segments share the largest limit that fits.
+ * When the whole stream fits, the 'SegByteLimit' is used. Fails when not even the headers fit.
+ */
+static int bpe_allocate_bytes(const struct segment_rate *rate, size_t count, size_t bytes, size_t SegByteLimit, size_t *limit)
+{
+	size_t t, k;
+	size_t total = 0;
+	size_t level = 0;
+
+	/* the finest level that fits */
+	for (t = 0; t < TRUNCATION_LEVELS; ++t) {
+		size_t sum = 0;
+
+		for (k = 0; k < count; ++k) {
+			sum += segment_rate_bytes(rate + k, t);
+		}
+
+		if (t > 0 && sum > bytes) {
+			break;
+		}
+
+		level = t;
+		total = sum;
+	}
+
+	if (total > bytes) {
+		/* not even the DC coefficients fit, find the largest shared limit by bisection */
+		size_t lo = 1, hi = 1;
+
+		if (bytes > SIZE_MAX_ / 8 || sum_rate_bits_shared(rate, count, lo) > bytes * 8) {
+			dprint (("BPE: not even the segment headers fit into %lu bytes\n", (unsigned long) bytes));
+			return RET_FAILURE_OVERFLOW_ERROR;
+		}
+
+		while (hi < bytes && sum_rate_bits_shared(rate, count, hi) <= bytes * 8) {
+			lo = hi;
+			hi *= 2;
+		}
+
+		while (hi - lo > 1) {
+			size_t mid = lo + (hi - lo) / 2;
+
+			if (sum_rate_bits_shared(rate, count, mid) <= bytes * 8) {
+				lo = mid;
+			} else {
+				hi = mid;
+			}
+		}
+
+		dprint (("BPE: the DC coefficients do not fit into %lu bytes, the segments are cut at %lu bytes\n", (unsigned long) bytes, (unsigned long) lo));
+
+		for (k = 0; k < count; ++k) {
+			limit[k] = lo;
+		}
+
+		return RET_SUCCESS;
+	}
+
+	if (level + 1 == TRUNCATION_LEVELS) {
+		/* the whole stream fits */
+		for (k = 0; k < count; ++k) {
+			limit[k] = SegByteLimit;
+		}
+
+		return RET_SUCCESS;
+	}
+
+	for (k = 0; k < count; ++k) {
+		limit[k] = segment_rate_bytes(rate + k, level);
+	}
+
+	{
+		size_t left = bytes - total;
+		size_t increase = 0;
+
+		for (k = 0; k < count; ++k) {
+			increase += segment_rate_bytes(rate + k, level + 1) - limit[k];
+		}
+
+		if (increase > 0) {
+			for (k = 0; k < count; ++k) {
+				size_t inc = segment_rate_bytes(rate + k, level + 1) - limit[k];
+
+				limit[k] += (size_t) ((double) inc * (double) left / (double) increase);
+			}
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+/* make room for the truncation points and the byte limits of 'count' segments, the buffers only grow */
+static int bpe_reserve_rate(struct bpe *bpe, size_t count)
+{
+	struct segment_rate *rate;
+	size_t *limit;
+
+	assert(bpe != NULL);
+
+	if (count <= bpe->rate_capacity) {
+		return RET_SUCCESS;
+	}
+
+	rate = alloc_realloc(bpe->rate_buffer, count * sizeof(struct segment_rate));
+
+	if (rate == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	bpe->rate_buffer = rate;
+
+	limit = alloc_realloc(bpe->limit_buffer, count * sizeof(size_t));
+
+	if (limit == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	bpe->limit_buffer = limit;
+
+	bpe->rate_capacity = count;
+
+	return RET_SUCCESS;
+}
+
+/* the number of segments of the frame of 'height' x 'width' pixels */
+static size_t count_segments(size_t height, size_t width, size_t S)
+{
+	return (ceil_multiple8(height) / 8 * (ceil_multiple8(width) / 8) + S - 1) / S;
+}
+
+int bpe_reserve(struct bpe *bpe, size_t height, size_t width, const struct parameters *parameters)
+{
+	int err;
+
+	assert(bpe != NULL);
+	assert(parameters != NULL);
+	assert(parameters->S > 0);
+
+	err = bpe_realloc_segment(bpe, parameters->S);
 
 	if (err) {
 		return err;
 	}
 
-	/* NOTE bpe_init already called bpe_realloc_segment */
+	if (parameters->TargetBytes == 0) {
+		return RET_SUCCESS;
+	}
 
-	/* initialize frame->height */
-	bpe_initialize_frame_height(&bpe);
+	return bpe_reserve_rate(bpe, count_segments(height, width, parameters->S));
+}
+
+size_t bpe_sizeof(size_t height, size_t width, const struct parameters *parameters)
+{
+	size_t S, count, size;
+
+	assert(parameters != NULL);
+	assert(parameters->S > 0);
+
+	S = parameters->S;
+
+	/* the buffers of bpe_realloc_segment() */
+	size = arena_sizeof(S * BLOCK_SIZE * sizeof(INT32)) /* segment */
+		+ arena_sizeof(S * sizeof(INT32)) /* quantized_dc */
+		+ 3 * arena_sizeof(S * sizeof(UINT32)) /* mapped_quantized_dc, bitDepthAC_Block, mapped_BitDepthAC_Block */
+		+ arena_sizeof(S * BLOCK_SIZE * sizeof(int)) /* type */
+		+ arena_sizeof(S * BLOCK_SIZE * sizeof(INT32)) /* sign */
+		+ arena_sizeof(S * BLOCK_SIZE * sizeof(UINT32)); /* magnitude */
+
+	if (parameters->TargetBytes == 0) {
+		return size;
+	}
+
+	count = count_segments(height, width, S);
+
+	if (count == 0) {
+		return size;
+	}
+
+	return size + arena_sizeof(count * sizeof(struct segment_rate)) + arena_sizeof(count * sizeof(size_t));
+}
+
+/* is the stop (b0, s0) reached before (b1, s1) in the coding order */
+static int stop_precedes(UINT32 b0, UINT32 s0, UINT32 b1, UINT32 s1)
+{
+	return b0 > b1 || (b0 == b1 && s0 < s1);
+}
+
+/* copy 'n' bits */
+static int bio_copy_bits(struct bio *dst, struct bio *src, size_t n)
+{
+	while (n > 0) {
+		size_t len = n < 32 ? n : 32;
+		UINT32 word;
+		int err;
+
+		err = bio_read_bits(src, &word, len);
+
+		if (err) {
+			return err;
+		}
+
+		if (dst != NULL) {
+			err = bio_write_bits(dst, word, len);
+
+			if (err) {
+				return err;
+			}
+		}
+
+		n -= len;
+	}
+
+	return RET_SUCCESS;
+}
+
+/*
+ * Rewrite the segment described by 'rate' (read by 'src') into 'dst' cut at 'limit' bytes.
+ * The new stops are taken from 'parameters', the 'last' holds Part 2 of the previously written segment header.
+ */
+static int bpe_truncate_segment(struct bio *dst, struct bio *src, const struct segment_rate *rate, const struct parameters *parameters, size_t limit, struct segment_header *last)
+{
+	struct bpe writer;
+	struct segment_header *h = &writer.segment_header;
+	UINT32 BitPlaneStop = (UINT32) parameters->BitPlaneStop;
+	UINT32 StageStop = (UINT32) parameters->StageStop;
+	size_t cut;
+	size_t header_bits;
+	size_t body;
+	int changed;
+	int err;
+
+	*h = rate->segment_header;
+	writer.bio = dst;
+
+	/* a stop below BitDepthAC never triggers, i.e. the whole segment is coded */
+	if (h->BitPlaneStop >= h->BitDepthAC) {
+		h->BitPlaneStop = 0;
+		h->StageStop = 3;
+	}
+
+	if (BitPlaneStop >= h->BitDepthAC) {
+		BitPlaneStop = 0;
+		StageStop = 3;
+	}
 
-	/* initialize frame->width & frame->data[] */
-	err = bpe_realloc_frame_width(&bpe);
+	/* the stops can only move towards the beginning of the segment */
+	h->DCStop = h->DCStop || parameters->DCStop;
+
+	if (!stop_precedes(h->BitPlaneStop, h->StageStop, BitPlaneStop, StageStop)) {
+		h->BitPlaneStop = BitPlaneStop;
+		h->StageStop = StageStop;
+	}
+
+	if (h->DCStop) {
+		cut = rate->dc;
+	} else if (h->BitPlaneStop < h->BitDepthAC) {
+		cut = rate->stage[h->BitPlaneStop][h->StageStop];
+	} else {
+		cut = rate->prefix;
+	}
+
+	if (h->BitPlaneStop == BitPlaneStop && h->StageStop == StageStop) {
+		/* keep the requested values (possibly behind BitDepthAC) to avoid repeating Part 2 */
+		h->BitPlaneStop = (UINT32) parameters->BitPlaneStop;
+		h->StageStop = (UINT32) parameters->StageStop;
+	}
+
+	if (cut == SIZE_MAX_) {
+		/* the stop lies behind the SegByteLimit of the original stream */
+		if (!rate->truncated) {
+			return RET_FAILURE_LOGIC_ERROR;
+		}
+
+		cut = rate->end;
+	}
+
+	/* Part 2 is repeated only when it changes */
+	changed = h->DCStop != last->DCStop || h->BitPlaneStop != last->BitPlaneStop || h->StageStop != last->StageStop || h->UseFill != last->UseFill;
+
+	h->SegByteLimit = (UINT32) limit;
+	h->Part2Flag = changed || h->SegByteLimit != last->SegByteLimit;
+
+	header_bits = segment_header_bits(h);
+	body = cut - rate->header;
+
+	if (limit * 8 < header_bits + body) {
+		/* cut by the new limit */
+		body = limit * 8 > header_bits ? limit * 8 - header_bits : 0;
+	} else if (cut == rate->end && rate->truncated) {
+		/* keep the original cut, the header parts are whole bytes so the limit is exact */
+		h->Part2Flag = changed || h->StartImgFlag;
+		header_bits = segment_header_bits(h);
+
+		assert((header_bits + body) % 8 == 0);
+
+		h->SegByteLimit = (UINT32) ((header_bits + body) / 8);
+
+		if (!h->Part2Flag && h->SegByteLimit != last->SegByteLimit) {
+			h->Part2Flag = 1;
+			h->SegByteLimit += 5;
+		}
+	}
+
+	/* skip the original header first, so that the 'dst' may rewrite the stream in place */
+	err = bio_copy_bits(NULL, src, rate->header - rate->start);
 
 	if (err) {
 		return err;
 	}
 
-	/* initialize frame->bpp */
-	bpe_realloc_frame_bpp(&bpe);
+	err = bpe_write_segment_header(&writer);
+
+	if (err) {
+		return err;
+	}
+
+	err = bio_copy_bits(dst, src, body);
+
+	if (err) {
+		return err;
+	}
+
+	err = bio_copy_bits(NULL, src, rate->end - rate->header - body);
+
+	if (err) {
+		return err;
+	}
+
+	last->SegByteLimit = h->SegByteLimit;
+	last->DCStop = h->DCStop;
+	last->BitPlaneStop = h->BitPlaneStop;
+	last->StageStop = h->StageStop;
+	last->UseFill = h->UseFill;
+
+	return RET_SUCCESS;
+}
+
+/* Part 2 is always written into the first segment */
+static void segment_header_reset_part2(struct segment_header *last)
+{
+	last->SegByteLimit = M27 + 1;
+	last->DCStop = 0;
+	last->BitPlaneStop = 0;
+	last->StageStop = 3;
+	last->UseFill = 0;
+}
+
+/*
+ * Encode the frame using the buffers of the 'bpe'. For the TargetBytes, the whole stream is coded behind the room
+ * for Part 2 of each segment header, and the segments are then cut in place at the allocated limits.
+ */
+static int bpe_encode_frame(struct bpe *bpe, struct frame *frame, const struct parameters *parameters, struct bio *bio, struct container *container)
+{
+	size_t count, total_no_blocks;
+	size_t shift;
+	struct bio probe;
+	struct segment_header last;
+	size_t i;
+	int err;
+
+	assert(frame != NULL);
+	assert(parameters != NULL);
+	assert(bio != NULL);
+
+	if (parameters->TargetBytes == 0) {
+		return bpe_encode_pass(bpe, frame, parameters, bio, container, NULL);
+	}
+
+	assert(bio->c == 0);
+
+	total_no_blocks = get_total_no_blocks(frame);
+	count = (total_no_blocks + parameters->S - 1) / parameters->S;
+
+	err = bpe_reserve_rate(bpe, count);
+
+	if (err) {
+		return err;
+	}
+
+	/* the cut segments may repeat Part 2 of the header (5 bytes), so the output never overtakes the input */
+	shift = 5 * count;
+
+	bio_open(&probe, bio->ptr + shift, BIO_MODE_WRITE);
+
+	err = bpe_encode_pass(bpe, frame, parameters, &probe, NULL, bpe->rate_buffer);
+
+	if (err) {
+		return err;
+	}
+
+	bio_close(&probe);
+
+	err = bpe_allocate_bytes(bpe->rate_buffer, count, parameters->TargetBytes, parameters->SegByteLimit, bpe->limit_buffer);
+
+	if (err) {
+		return err;
+	}
+
+	bio_open(&probe, bio->ptr + shift, BIO_MODE_READ);
+
+	segment_header_reset_part2(&last);
+
+	for (i = 0; i < count; ++i) {
+		if (container != NULL) {
+			size_t blocks = total_no_blocks - i * parameters->S;
+
+			err = container_add_segment(container, bio_tell(bio), blocks < parameters->S ? blocks : parameters->S);
+
+			if (err) {
+				return err;
+			}
+		}
+
+		err = bpe_truncate_segment(bio, &probe, bpe->rate_buffer + i, parameters, bpe->limit_buffer[i], &last);
+
+		if (err) {
+			return err;
+		}
+	}
+
+	bpe->bio = bio;
+	bpe->container = container;
+
+	bpe_close_index(bpe);
+
+	return RET_SUCCESS;
+}
+
+int bpe_encode_indexed(struct frame *frame, const struct parameters *parameters, struct bio *bio, struct container *container)
+{
+	struct bpe bpe;
+	int err;
+
+	bpe_clear(&bpe, 0);
+
+	err = bpe_encode_frame(&bpe, frame, parameters, bio, container);
+
+	bpe_destroy(&bpe, NULL);
+
+	return err;
+}
+
+int bpe_encode_reuse(struct bpe *bpe, struct frame *frame, const struct parameters *parameters, struct bio *bio, struct container *container)
+{
+	assert(bpe != NULL);
+	assert(bpe->reuse);
+
+	return bpe_encode_frame(bpe, frame, parameters, bio, container);
+}
+
+/* decode the whole frame using the buffers of the 'bpe', see bpe_decode_indexed() and bpe_decode_stripes() */
+static int bpe_decode_frame(struct bpe *bpe, struct frame *frame, struct parameters *parameters, struct bio *bio, struct container *container, int (*callback)(void *context, struct frame *frame), void *context)
+{
+	size_t block_index;
+	int err;
+
+	assert(frame != NULL);
+
+	err = bpe_reset(bpe, parameters, bio, frame);
+
+	if (err) {
+		return err;
+	}
+
+	bpe->container = container;
+
+	bpe->stripe = callback;
+	bpe->stripe_context = context;
+
+	/* NOTE bpe_reset already called bpe_realloc_segment */
+
+	/* initialize frame->height */
+	bpe_initialize_frame_height(bpe);
+
+	if (bpe->reuse) {
+		/* the framebuffer is kept, and resized once the width is read */
+		bpe->reuse_width = frame->width;
+		bpe->reuse_bpp = frame->bpp;
+		frame->width = 0;
+	} else {
+		/* initialize frame->bpp */
+		bpe_realloc_frame_bpp(bpe);
+
+		/* initialize frame->width & frame->data[] */
+		err = bpe_realloc_frame_width(bpe);
+
+		if (err) {
+			return err;
+		}
+	}
 
 	/* push all blocks into the BPE engine */
 	for (block_index = 0; ; ++block_index) {
@@ -3606,18 +4770,23 @@ int bpe_decode(struct frame *frame, struct parameters *parameters, struct bio *b
 		struct block block;
 
 		/* NOTE: the bpe_pop_block_decode reallocates frame->data[] */
-		err = bpe_pop_block_decode(&bpe);
+		err = bpe_pop_block_decode(bpe);
 
 		/* other error */
 		if (err) {
 			return err;
 		}
 
+		/* the first segment header has been read, the stripe callback may run the inverse transform */
+		if (block_index == 0) {
+			bpe_get_parameters(bpe, parameters);
+		}
+
 		if (block_starts_new_stripe(frame, block_index)) {
 			int err;
 
 			/* increase height */
-			err = bpe_increase_frame_height(&bpe);
+			err = bpe_increase_frame_height(bpe);
 
 			if (err) {
 				return err;
@@ -3626,21 +4795,343 @@ int bpe_decode(struct frame *frame, struct parameters *parameters, struct bio *b
 
 		block_by_index(&block, frame, block_index);
 
-		bpe_pop_block_copy_data(&bpe, block.data, block.stride);
+		bpe_pop_block_copy_data(bpe, &block);
+
+		if (bpe->stripe != NULL && block_starts_new_stripe(frame, block_index + 1)) {
+			int err;
+
+			/* the stripe is complete */
+			err = bpe->stripe(bpe->stripe_context, frame);
+
+			if (err) {
+				return err;
+			}
+		}
+
+		if (bpe_is_last_segment(bpe) && bpe->s == 0) {
+			dprint (("BPE: the last segment indicated, breaking the decoding loop!\n"));
+			break;
+		}
+	}
+
+	bpe_correct_frame_height(bpe);
+
+	/* release the rows reserved in advance, unless they are reused */
+	if (!bpe->reuse) {
+		err = frame_realloc_data(frame);
+
+		if (err) {
+			return err;
+		}
+	}
+
+	bpe_close_index(bpe);
+
+	return RET_SUCCESS;
+}
+
+/* bpe_decode_frame() with the buffers allocated for this frame only */
+static int bpe_decode_once(struct frame *frame, struct parameters *parameters, struct bio *bio, struct container *container, int (*callback)(void *context, struct frame *frame), void *context)
+{
+	struct bpe bpe;
+	int err;
+
+	bpe_clear(&bpe, 0);
+
+	err = bpe_decode_frame(&bpe, frame, parameters, bio, container, callback, context);
+
+	bpe_destroy(&bpe, NULL);
+
+	return err;
+}
+
+int bpe_decode(struct frame *frame, struct parameters *parameters, struct bio *bio)
+{
+	return bpe_decode_indexed(frame, parameters, bio, NULL);
+}
+
+int bpe_decode_indexed(struct frame *frame, struct parameters *parameters, struct bio *bio, struct container *container)
+{
+	return bpe_decode_once(frame, parameters, bio, container, NULL, NULL);
+}
+
+int bpe_decode_stripes(struct frame *frame, struct parameters *parameters, struct bio *bio, int (*callback)(void *context, struct frame *frame), void *context)
+{
+	return bpe_decode_once(frame, parameters, bio, NULL, callback, context);
+}
+
+int bpe_decode_reuse(struct bpe *bpe, struct frame *frame, struct parameters *parameters, struct bio *bio)
+{
+	assert(bpe != NULL);
+	assert(bpe->reuse);
+
+	return bpe_decode_frame(bpe, frame, parameters, bio, NULL, NULL, NULL);
+}
+
+/* decode the blocks of the region into the 'frame', the 'image' receives the geometry of the whole image */
+static int bpe_decode_region_blocks(struct bpe *bpe, struct frame *frame, struct frame *image, struct parameters *parameters, struct bio *bio, size_t y, size_t x, size_t height, size_t width)
+{
+	size_t block_index;
+	int err;
+
+	err = bpe_reset(bpe, parameters, bio, image);
+
+	if (err) {
+		return err;
+	}
+
+	bpe->region = frame;
+	bpe->region_y = y;
+	bpe->region_x = x;
+	bpe->region_height = height;
+	bpe->region_width = width;
+
+	/* the region is allocated at once */
+	bpe->height_hint = height;
+
+	bpe_initialize_frame_height(bpe);
+
+	bpe_realloc_frame_bpp(bpe);
+
+	err = bpe_realloc_frame_width(bpe);
+
+	if (err) {
+		return err;
+	}
+
+	for (block_index = 0; ; ++block_index) {
+		size_t block_y, block_x;
+
+		/* the next stripe exists, so the region is complete (and not at the bottom of the image) */
+		if (block_index > 0 && block_starts_new_stripe(image, block_index) && image->height >= y + height) {
+			dprint (("BPE: the region is complete, breaking the decoding loop!\n"));
+			break;
+		}
+
+		err = bpe_pop_block_decode(bpe);
+
+		if (err) {
+			return err;
+		}
+
+		if (block_starts_new_stripe(image, block_index)) {
+			err = bpe_increase_frame_height(bpe);
+
+			if (err) {
+				return err;
+			}
+		}
+
+		block_y = block_index / (ceil_multiple8(image->width) / 8) * 8;
+		block_x = block_index % (ceil_multiple8(image->width) / 8) * 8;
+
+		if (block_y >= y && block_y < y + frame->height && block_x >= x && block_x < x + frame->width) {
+			struct block block;
+
+			block_by_index(&block, frame, (block_y - y) / 8 * (ceil_multiple8(frame->width) / 8) + (block_x - x) / 8);
 
-		if (bpe_is_last_segment(&bpe) && bpe.s == 0) {
+			bpe_pop_block_copy_data(bpe, &block);
+		} else {
+			bpe_pop_block_skip(bpe);
+		}
+
+		if (bpe_is_last_segment(bpe) && bpe->s == 0) {
 			dprint (("BPE: the last segment indicated, breaking the decoding loop!\n"));
+			bpe_correct_frame_height(bpe);
 			break;
 		}
 	}
 
-	bpe_correct_frame_height(&bpe);
+	return RET_SUCCESS;
+}
+
+int bpe_decode_region(struct frame *frame, struct parameters *parameters, struct bio *bio, size_t y, size_t x, size_t height, size_t width)
+{
+	struct frame image;
+	struct bpe bpe;
+	int err;
+
+	assert(frame != NULL);
+	assert(y % 8 == 0 && x % 8 == 0);
 
+	/* the geometry of the whole image, no framebuffer */
+	image.height = 0;
+	image.width = 0;
+	image.bpp = 0;
+	image.data = NULL;
+	image.data16 = NULL;
+
+	bpe_clear(&bpe, 0);
+
+	err = bpe_decode_region_blocks(&bpe, frame, &image, parameters, bio, y, x, height, width);
+
+	/* the buffers are released on failure as well */
 	bpe_destroy(&bpe, parameters);
 
+	if (err) {
+		return err;
+	}
+
+	if (frame->height == 0 || frame->width == 0) {
+		/* the region lies outside the image */
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	/* the region may have been clipped by the image */
+	err = frame_realloc_data(frame);
+
+	if (err) {
+		return err;
+	}
+
 	return RET_SUCCESS;
 }
 
+int bpe_truncate(struct bio *dst, struct bio *src, const struct parameters *parameters)
+{
+	struct frame image;
+	struct parameters decode_parameters;
+	struct bpe bpe;
+	struct segment_rate *rate = NULL;
+	size_t count = 0;
+	size_t capacity = 0;
+	struct bio reader;
+	struct segment_header last;
+	size_t i;
+	int err;
+
+	assert(dst != NULL);
+	assert(src != NULL);
+	assert(parameters != NULL);
+	assert(parameters->StageStop >= 0 && parameters->StageStop <= 3);
+
+	/* the geometry only, no framebuffer is allocated */
+	image.height = 0;
+	image.width = 0;
+	image.bpp = 0;
+	image.data = NULL;
+	image.data16 = NULL;
+
+	/* parse everything */
+	decode_parameters = *parameters;
+	decode_parameters.DecodeBitPlaneStop = 0;
+	decode_parameters.DecodeStageStop = 3;
+
+	reader = *src;
+
+	err = bpe_init(&bpe, &decode_parameters, src, &image);
+
+	if (err) {
+		return err;
+	}
+
+	bpe_realloc_frame_bpp(&bpe);
+
+	do {
+		if (count == capacity) {
+			size_t new_capacity = capacity ? 2 * capacity : 64;
+			void *new_rate = alloc_realloc(rate, new_capacity * sizeof *rate);
+
+			if (new_rate == NULL) {
+				err = RET_FAILURE_MEMORY_ALLOCATION;
+				break;
+			}
+
+			rate = new_rate;
+			capacity = new_capacity;
+		}
+
+		bpe.rate = rate + count;
+
+		/* the segment is decoded but its blocks are not stored */
+		err = bpe_decode_segment(&bpe);
+
+		if (err) {
+			break;
+		}
+
+		count++;
+	} while (!bpe_is_last_segment(&bpe));
+
+	bpe_destroy(&bpe, NULL);
+
+	segment_header_reset_part2(&last);
+
+	for (i = 0; !err && i < count; ++i) {
+		err = bpe_truncate_segment(dst, &reader, rate + i, parameters, parameters->SegByteLimit, &last);
+	}
+
+	alloc_free(rate);
+
+	return err;
+}
+
+int bpe_encode_multirate(struct frame *frame, const struct parameters *parameters, struct bio *bio, size_t count, const size_t *bytes, struct bio *outputs)
+{
+	struct bpe bpe;
+	struct segment_rate *rate;
+	size_t *limit;
+	size_t segments;
+	unsigned char *start;
+	size_t k;
+	int err;
+
+	assert(frame != NULL);
+	assert(parameters != NULL);
+	assert(bio != NULL && bio->c == 0);
+
+	segments = (get_total_no_blocks(frame) + parameters->S - 1) / parameters->S;
+
+	rate = alloc_malloc(segments * sizeof(struct segment_rate));
+	limit = alloc_malloc(segments * sizeof(size_t));
+
+	if (rate == NULL || limit == NULL) {
+		alloc_free(rate);
+		alloc_free(limit);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	start = bio->ptr;
+
+	bpe_clear(&bpe, 0);
+
+	err = bpe_encode_pass(&bpe, frame, parameters, bio, NULL, rate);
+
+	bpe_destroy(&bpe, NULL);
+
+	if (!err) {
+		/* flush the last byte, the caller closes the bio */
+		struct bio tail = *bio;
+
+		bio_close(&tail);
+	}
+
+	for (k = 0; !err && k < count; ++k) {
+		struct bio reader;
+		struct segment_header last;
+		size_t i;
+
+		err = bpe_allocate_bytes(rate, segments, bytes[k], parameters->SegByteLimit, limit);
+
+		if (err) {
+			break;
+		}
+
+		bio_open(&reader, start, BIO_MODE_READ);
+
+		segment_header_reset_part2(&last);
+
+		for (i = 0; !err && i < segments; ++i) {
+			err = bpe_truncate_segment(outputs + k, &reader, rate + i, parameters, limit[i], &last);
+		}
+	}
+
+	alloc_free(rate);
+	alloc_free(limit);
+
+	return err;
+}
+
 size_t get_maximum_stream_size(struct frame *frame)
 {
 	size_t width, height;
@@ -8,6 +8,7 @@
 #include "common.h"
 #include "frame.h"
 #include "bio.h"
+#include "container.h"
 
 /* Segment Header */
 struct segment_header {
@@ -44,6 +45,27 @@ struct segment_header {
 	int weight[12];
 };
 
+/* the positions (in bits) of the truncation points of a coded segment,
+ * the decoder leaves the points it has not reached at SIZE_MAX_ */
+struct segment_rate {
+	/* the header of the segment */
+	struct segment_header segment_header;
+	/* the start of the segment */
+	size_t start;
+	/* the end of the header, the header includes Part 2 */
+	size_t header;
+	int part2;
+	/* the end of the DC coefficients */
+	size_t dc;
+	/* the end of the AC bit depths */
+	size_t prefix;
+	/* the end of the stage s of the bit plane b */
+	size_t stage[32][4];
+	/* the end of the segment, and whether it has reached SegByteLimit */
+	size_t end;
+	int truncated;
+};
+
 struct bpe {
 	/* the number of block in the segment,
 	 * the S is given in struct parameters */
@@ -81,11 +103,52 @@ struct bpe {
 	 * the sign when the coefficient is nonzero. */
 	INT32 *sign;
 	UINT32 *magnitude;
+
+	/* the number of blocks the arrays above are allocated for, they only grow */
+	size_t segment_capacity;
+
+	/* the decoder stops refining the segment after stage 'decode_stage_stop' of bit plane 'decode_bit_plane_stop' */
+	size_t decode_bit_plane_stop;
+	UINT32 decode_stage_stop;
+
+	/* the number of rows allocated in the framebuffer of bpe->frame (or bpe->region), at least the height hint */
+	size_t capacity;
+	size_t height_hint;
+
+	/* the width and the bit depth of the previous frame decoded into the reused framebuffer */
+	size_t reuse_width, reuse_bpp;
+
+	/* region decoding: when not NULL, only the blocks inside the region are stored into this frame,
+	 * the bpe->frame then only tracks the geometry of the whole image */
+	struct frame *region;
+	/* the top-left corner (multiples of 8) and the requested size of the region in pixels */
+	size_t region_y, region_x;
+	size_t region_height, region_width;
+
+	/* when not NULL, the segments are recorded into this index */
+	struct container *container;
+
+	/* when not NULL, the truncation points of the current segment are recorded here (advanced after each segment) */
+	struct segment_rate *rate;
+
+	/* when not NULL, called with bpe->frame whenever a stripe of blocks has been decoded */
+	int (*stripe)(void *context, struct frame *frame);
+	void *stripe_context;
+
+	/* the truncation points and the byte limits of the segments for TargetBytes, allocated for rate_capacity segments */
+	struct segment_rate *rate_buffer;
+	size_t *limit_buffer;
+	size_t rate_capacity;
+
+	/* the buffers and the framebuffer of the decoded frame are kept across the frames, see bpe_init_reuse() */
+	int reuse;
 };
 
 size_t BitShift(const struct bpe *bpe, int subband);
 
 int bpe_init(struct bpe *bpe, const struct parameters *parameters, struct bio *bio, struct frame *frame);
+/* as bpe_init(), but the buffers are kept */
+int bpe_reset(struct bpe *bpe, const struct parameters *parameters, struct bio *bio, struct frame *frame);
 int bpe_realloc_segment(struct bpe *bpe, size_t S);
 int bpe_realloc_frame_width(struct bpe *bpe);
 
@@ -94,10 +157,102 @@ int bpe_destroy(struct bpe *bpe, struct parameters *parameters);
 /* helper function (to be removed in future) */
 size_t get_total_no_blocks(struct frame *frame);
 
+/**
+ * \brief Encode the \p frame
+ *
+ * When \c TargetBytes is set in the \p parameters, the frame is encoded once and
+ * the segments are then cut in place at the limits allocated from their measured sizes.
+ * The \p bio must therefore start at a byte boundary and hold the whole untruncated stream
+ * (get_maximum_stream_size() bytes). Returns \c RET_FAILURE_OVERFLOW_ERROR when
+ * not even the segment headers fit into \c TargetBytes.
+ */
 int bpe_encode(struct frame *frame, const struct parameters *parameters, struct bio *bio);
 
 int bpe_decode(struct frame *frame, struct parameters *parameters, struct bio *bio);
 
+/**
+ * \brief Encode the \p frame and record the geometry and the segments into the \p container
+ *
+ * The stream is attached by container_finish() after bio_close().
+ */
+int bpe_encode_indexed(struct frame *frame, const struct parameters *parameters, struct bio *bio, struct container *container);
+
+/**
+ * \brief Decode the stream and record the geometry and the segments into the \p container
+ */
+int bpe_decode_indexed(struct frame *frame, struct parameters *parameters, struct bio *bio, struct container *container);
+
+/**
+ * \brief Decode the stream, handing each decoded stripe of blocks over to the \p callback
+ *
+ * The \p callback is called whenever the blocks of the next 8 rows have been stored into the \p frame.
+ * Its \c height then covers the stripes decoded so far, the padding rows of the last stripe included.
+ * The final height is only known after the function returns. A nonzero return value of the \p callback
+ * stops the decoding and is returned. The \c DWTtype and the weights of the \p parameters are set from
+ * the first segment header before the first call, so that the \p callback can run the inverse transform.
+ */
+int bpe_decode_stripes(struct frame *frame, struct parameters *parameters, struct bio *bio, int (*callback)(void *context, struct frame *frame), void *context);
+
+/**
+ * \brief Decode the coefficients of the blocks covering the rectangle of \p height x \p width pixels at (\p y, \p x)
+ *
+ * The \p y and \p x must be multiples of 8. The \p frame holds the coefficients of the region only,
+ * clipped to the image. The segments after the region are not read.
+ */
+int bpe_decode_region(struct frame *frame, struct parameters *parameters, struct bio *bio, size_t y, size_t x, size_t height, size_t width);
+
+/**
+ * \brief Truncate the coded stream read from \p src into \p dst without decoding the image
+ *
+ * The segments are parsed (no DWT is performed) to find their truncation points,
+ * then copied with the headers rewritten, each cut at the SegByteLimit, DCStop,
+ * BitPlaneStop, and StageStop given in the \p parameters. The stops already
+ * present in the stream are kept when they come first.
+ */
+int bpe_truncate(struct bio *dst, struct bio *src, const struct parameters *parameters);
+
+/**
+ * \brief Encode the \p frame once into \p bio and write \p count streams of \p bytes[i] bytes into \p outputs[i]
+ *
+ * The truncation points of the segments are recorded while encoding the untruncated stream,
+ * each output is then cut from it as bpe_encode() with \c TargetBytes = \p bytes[i] would code it.
+ * The \p bio must start at a byte boundary.
+ */
+int bpe_encode_multirate(struct frame *frame, const struct parameters *parameters, struct bio *bio, size_t count, const size_t *bytes, struct bio *outputs);
+
+/**
+ * \brief Initialize the \p bpe with no buffers, to be reused by bpe_encode_reuse() or bpe_decode_reuse()
+ *
+ * The buffers grow as needed, and they are released by bpe_destroy().
+ */
+void bpe_init_reuse(struct bpe *bpe);
+
+/**
+ * \brief Allocate the buffers of the \p bpe for the frames of \p height x \p width pixels coded with the \p parameters
+ */
+int bpe_reserve(struct bpe *bpe, size_t height, size_t width, const struct parameters *parameters);
+
+/**
+ * \brief Number of bytes of an arena taken by the buffers of bpe_reserve(), see arena_sizeof()
+ */
+size_t bpe_sizeof(size_t height, size_t width, const struct parameters *parameters);
+
+/**
+ * \brief Encode the \p frame as bpe_encode() does, using the buffers of the \p bpe
+ *
+ * No memory is allocated once the buffers have grown for the geometry and the parameters, see bpe_reserve().
+ * When the \p container is not NULL, the segments are recorded into it as by bpe_encode_indexed().
+ */
+int bpe_encode_reuse(struct bpe *bpe, struct frame *frame, const struct parameters *parameters, struct bio *bio, struct container *container);
+
+/**
+ * \brief Decode the stream as bpe_decode() does, using the buffers of the \p bpe
+ *
+ * The framebuffer of the \p frame is kept as well, the same \p frame must therefore be passed each time.
+ * Its rows beyond the \c height stay allocated.
+ */
+int bpe_decode_reuse(struct bpe *bpe, struct frame *frame, struct parameters *parameters, struct bio *bio);
+
 size_t get_maximum_stream_size(struct frame *frame);
 
 #endif /* BPE_H_ */
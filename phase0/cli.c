@@ -0,0 +1,177 @@
+#include "cli.h"
+#include "bpe.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+int cli_parse_size(const char *s, size_t *value)
+{
+	char *end;
+	unsigned long n;
+
+	assert(s != NULL);
+	assert(value != NULL);
+
+	/* strtoul() accepts the sign and the leading white space */
+	if (*s < '0' || *s > '9') {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	errno = 0;
+
+	n = strtoul(s, &end, 10);
+
+	if (*end != '\0') {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	if (errno == ERANGE || n > (unsigned long) SIZE_MAX_) {
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	*value = (size_t) n;
+
+	return RET_SUCCESS;
+}
+
+int cli_parse_format(const char *s)
+{
+	assert(s != NULL);
+
+	if (0 == strcmp(s, "8"))
+		return FRAME_RAW_8;
+	if (0 == strcmp(s, "16le"))
+		return FRAME_RAW_16LE;
+	if (0 == strcmp(s, "16be"))
+		return FRAME_RAW_16BE;
+	if (0 == strcmp(s, "raw10"))
+		return FRAME_RAW_PACKED10;
+	if (0 == strcmp(s, "raw12"))
+		return FRAME_RAW_PACKED12;
+
+	return -1;
+}
+
+unsigned char *cli_load_file(const char *path, size_t *size)
+{
+	FILE *stream;
+	unsigned char *ptr = NULL;
+	size_t capacity = 0;
+
+	assert(path != NULL);
+	assert(size != NULL);
+
+	if (0 == strcmp(path, "-"))
+		stream = stdin;
+	else
+		stream = fopen(path, "rb");
+
+	if (stream == NULL) {
+		return NULL;
+	}
+
+	*size = 0;
+
+	do {
+		unsigned char *new_ptr;
+
+		capacity = capacity ? 2 * capacity : 65536;
+
+		new_ptr = realloc(ptr, capacity);
+
+		if (new_ptr == NULL) {
+			free(ptr);
+			if (stream != stdin)
+				fclose(stream);
+			return NULL;
+		}
+
+		ptr = new_ptr;
+
+		*size += fread(ptr + *size, 1, capacity - *size, stream);
+	} while (*size == capacity);
+
+	if (ferror(stream)) {
+		free(ptr);
+		ptr = NULL;
+	}
+
+	if (stream != stdin)
+		fclose(stream);
+
+	return ptr;
+}
+
+int cli_save_file(const char *path, const void *ptr, size_t size)
+{
+	FILE *stream;
+
+	assert(path != NULL);
+
+	if (0 == strcmp(path, "-"))
+		stream = stdout;
+	else
+		stream = fopen(path, "wb");
+
+	if (stream == NULL) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	if (fwrite(ptr, 1, size, stream) != size) {
+		if (stream != stdout)
+			fclose(stream);
+		return RET_FAILURE_FILE_IO;
+	}
+
+	if ((stream != stdout ? fclose(stream) : fflush(stream)) == EOF) {
+		return RET_FAILURE_FILE_IO;
+	}
+
+	return RET_SUCCESS;
+}
+
+int cli_encode_multirate(struct frame *frame, const struct parameters *parameters, struct bio *bio, size_t count, const size_t *bytes, const char **paths)
+{
+	struct bio *outputs;
+	unsigned char *ptr;
+	size_t size;
+	size_t k;
+	int err;
+
+	assert(paths != NULL);
+
+	size = get_maximum_stream_size(frame);
+
+	if (size != 0 && count > SIZE_MAX_ / size) {
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	outputs = malloc(count * sizeof *outputs);
+	ptr = malloc(count * size);
+
+	if (outputs == NULL || ptr == NULL) {
+		free(outputs);
+		free(ptr);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	for (k = 0; k < count; ++k) {
+		bio_open(&outputs[k], ptr + k * size, BIO_MODE_WRITE);
+	}
+
+	err = bpe_encode_multirate(frame, parameters, bio, count, bytes, outputs);
+
+	for (k = 0; !err && k < count; ++k) {
+		bio_close(&outputs[k]);
+
+		err = cli_save_file(paths[k], ptr + k * size, (size_t) (outputs[k].ptr - (ptr + k * size)));
+	}
+
+	free(outputs);
+	free(ptr);
+
+	return err;
+}
@@ -0,0 +1,49 @@
+/**
+ * \file cli.h
+ * \brief Helpers shared by the command-line tools
+ *
+ * The paths given as "-" stand for the standard input or output.
+ */
+#ifndef CLI_H_
+#define CLI_H_
+
+#include "common.h"
+#include "frame.h"
+#include "bio.h"
+
+#include <stddef.h>
+
+/**
+ * \brief Parse the non-negative decimal number \p s into \p value
+ *
+ * The whole string must be the number, and the number must fit into \c size_t.
+ */
+int cli_parse_size(const char *s, size_t *value);
+
+/**
+ * \brief Parse the raw sample format (\c 8, \c 16le, \c 16be, \c raw10, \c raw12), see \c FRAME_RAW_*
+ *
+ * Returns -1 for an unknown format.
+ */
+int cli_parse_format(const char *s);
+
+/**
+ * \brief Load the whole file at \p path, \p size is set to its size
+ *
+ * Returns NULL on failure, the memory is released by free().
+ */
+unsigned char *cli_load_file(const char *path, size_t *size);
+
+/**
+ * \brief Write \p size bytes at \p ptr into the file at \p path
+ */
+int cli_save_file(const char *path, const void *ptr, size_t size);
+
+/**
+ * \brief Encode the transformed \p frame into \p bio, and save the streams truncated to each of the \p count sizes
+ *
+ * The stream truncated to \p bytes[k] is saved as \p paths[k], see bpe_encode_multirate().
+ */
+int cli_encode_multirate(struct frame *frame, const struct parameters *parameters, struct bio *bio, size_t count, const size_t *bytes, const char **paths);
+
+#endif /* CLI_H_ */
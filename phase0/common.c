@@ -56,9 +56,34 @@ int init_parameters(struct parameters *parameters)
 
 	parameters->DCStop = 0; /* 1 => Terminate coded segment after coding quantized DC coefficient information and additional DC bit planes */
 
+	parameters->BitPlaneStop = 0; /* When BitPlaneStop = b and StageStop = s, coded segment terminates once stage s of bit plane b has been completed */
+	parameters->StageStop = 3; /* 3 => stage 4 */
+
+	parameters->DecodeBitPlaneStop = 0; /* decode all bit planes */
+	parameters->DecodeStageStop = 3; /* 3 => stage 4 */
+	parameters->DecodeHeightHint = 0; /* unknown */
+
+	parameters->TargetBytes = 0; /* no rate control */
+
 	return RET_SUCCESS;
 }
 
+int is_default_weight(const int weight[12])
+{
+	struct parameters parameters;
+	int i;
+
+	init_parameters(&parameters);
+
+	for (i = 0; i < 12; ++i) {
+		if (weight[i] != parameters.weight[i]) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
 static INT32 int32_abs(INT32 j)
 {
 #if (USHRT_MAX == UINT32_MAX_)
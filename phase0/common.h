@@ -51,6 +51,7 @@ enum {
 	RET_FAILURE_FILE_IO           = 0x1000, /**< I/O error */
 	RET_FAILURE_FILE_UNSUPPORTED  = 0x1001, /**< unsupported feature or file type */
 	RET_FAILURE_FILE_OPEN         = 0x1002, /**< file open failure */
+	RET_FAILURE_FILE_CORRUPTED    = 0x1003, /**< checksum mismatch */
 	/* 0x2xxx memory errors */
 	RET_FAILURE_MEMORY_ALLOCATION = 0x2000, /**< unable to allocate dynamic memory */
 	/* 0x3xxx general exceptions */
@@ -120,16 +121,66 @@ struct parameters {
 	 * \brief Subband weights for Integer DWT
 	 *
 	 * The order of subbands is LL0, HL0, LH0, HH0, LL1, HL1, LH1, HH1, LL2, HL2, LH2, HH2.
-	 * The LL0 and LL1 weight must be set to zero.
+	 * The LL0 and LL1 weight must be set to zero, the others range from 0 to 3. Other than
+	 * the default weights are signaled in the stream, the decoder reads them from there.
 	 */
 	int weight[12];
 
+	/**
+	 * \brief Maximum number of bytes in a coded segment
+	 *
+	 * The coding of the segment (including its header) stops once the limit
+	 * is reached, possibly in the middle of a stage. The decoder reconstructs
+	 * the truncated segment from the bits available.
+	 * \f$ SegByteLimit < 2^{27} \f$
+	 */
 	size_t SegByteLimit;
 
 	int OptDCSelect;
 	int OptACSelect;
 
 	int DCStop;
+
+	/**
+	 * \brief Bit plane and stage stop
+	 *
+	 * The coded segment terminates once stage StageStop (0 to 3) of bit plane BitPlaneStop has been completed.
+	 * The default BitPlaneStop = 0 and StageStop = 3 codes all the bit planes.
+	 */
+	size_t BitPlaneStop;
+	int StageStop;
+
+	/**
+	 * \brief Decoder bit plane and stage stop
+	 *
+	 * The decoder stops refining each segment once stage DecodeStageStop (0 to 3) of bit plane DecodeBitPlaneStop has been completed.
+	 * The remaining bits of the segment are parsed but discarded, so a fully coded stream decodes into the image of the stream
+	 * coded with the same BitPlaneStop and StageStop.
+	 * The default DecodeBitPlaneStop = 0 and DecodeStageStop = 3 decodes everything.
+	 */
+	size_t DecodeBitPlaneStop;
+	int DecodeStageStop;
+
+	/**
+	 * \brief Expected number of rows of the decoded image
+	 *
+	 * The decoder learns the image height only at the last segment. The framebuffer is allocated
+	 * for DecodeHeightHint rows at once and grows geometrically beyond it. Zero if unknown.
+	 * A hint which cannot be allocated is ignored.
+	 */
+	size_t DecodeHeightHint;
+
+	/**
+	 * \brief Target size of the coded stream in bytes
+	 *
+	 * When nonzero, the encoder measures the sizes of the segments at their truncation points
+	 * (the ends of the stages), and distributes the budget across the segments by per-segment
+	 * SegByteLimit, so that all the segments are truncated at about the same bit plane.
+	 * When not even the DC coefficients fit, all the segments share the largest SegByteLimit
+	 * that fits. The stream never exceeds TargetBytes, the encoding fails when not even the
+	 * segment headers fit. The target bpp corresponds to TargetBytes = bpp * height * width / 8.
+	 */
+	size_t TargetBytes;
 };
 
 /* subbands */
@@ -175,6 +226,11 @@ struct parameters {
 
 int init_parameters(struct parameters *parameters);
 
+/**
+ * \brief Decide whether the subband \p weight are those of init_parameters()
+ */
+int is_default_weight(const int weight[12]);
+
 /**
  * \brief Compute the absolute value of an integer
  *
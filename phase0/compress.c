@@ -17,11 +17,57 @@
 #include "dwt.h"
 #include "bio.h"
 #include "bpe.h"
+#include "cli.h"
+
+/* the size of the "stream-<size>.bin" path, an unsigned long has fewer than 3 decimal digits per byte */
+#define STREAM_PATH_SIZE (sizeof "stream-.bin" + 3 * sizeof(unsigned long))
+
+/* encode the frame into 'bio', and save the streams truncated to each of the 'count' sizes as stream-<size>.bin */
+static int encode_multirate(struct frame *frame, const struct parameters *parameters, struct bio *bio, size_t count, char *sizes[])
+{
+	size_t *bytes;
+	const char **paths;
+	char *names;
+	size_t k;
+	int err = RET_SUCCESS;
+
+	bytes = malloc(count * sizeof *bytes);
+	paths = malloc(count * sizeof *paths);
+	names = malloc(count * STREAM_PATH_SIZE);
+
+	if (bytes == NULL || paths == NULL || names == NULL) {
+		free(bytes);
+		free(paths);
+		free(names);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	for (k = 0; !err && k < count; ++k) {
+		err = cli_parse_size(sizes[k], &bytes[k]);
+
+		if (!err) {
+			sprintf(names + k * STREAM_PATH_SIZE, "stream-%lu.bin", (unsigned long) bytes[k]);
+
+			paths[k] = names + k * STREAM_PATH_SIZE;
+		}
+	}
+
+	if (!err) {
+		err = cli_encode_multirate(frame, parameters, bio, count, bytes, paths);
+	}
+
+	free(bytes);
+	free(paths);
+	free(names);
+
+	return err;
+}
 
 int main(int argc, char *argv[])
 {
 	struct frame frame, input_frame;
 	struct parameters parameters;
+	struct dwt dwt;
 	struct bio bio;
 	void *ptr;
 
@@ -56,6 +102,11 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 
+	if (dwt_init(&dwt, frame.height, frame.width)) {
+		fprintf(stderr, "[ERROR] unable to allocate the DWT workspace\n");
+		return EXIT_FAILURE;
+	}
+
 	init_parameters(&parameters);
 
 	parameters.DWTtype = 0;
@@ -64,7 +115,7 @@ int main(int argc, char *argv[])
 	dprint (("[DEBUG] transform...\n"));
 
 	/** (2) forward DWT */
-	if (dwt_encode(&frame, &parameters)) {
+	if (dwt_encode(&dwt, &frame, &parameters)) {
 		fprintf(stderr, "[ERROR] transform failed\n");
 		return EXIT_FAILURE;
 	}
@@ -84,7 +135,17 @@ int main(int argc, char *argv[])
 	}
 
 	bio_open(&bio, ptr, BIO_MODE_WRITE);
-	bpe_encode(&frame, &parameters, &bio);
+
+	if (argc > 2) {
+		/* the remaining arguments are the sizes of the truncated streams in bytes */
+		if (encode_multirate(&frame, &parameters, &bio, (size_t)(argc - 2), argv + 2)) {
+			fprintf(stderr, "[ERROR] multi-rate encoding failed\n");
+			return EXIT_FAILURE;
+		}
+	} else {
+		bpe_encode(&frame, &parameters, &bio);
+	}
+
 	bio_close(&bio);
 
 	dprint (("coded stream size: %lu bytes\n", (unsigned long)(bio.ptr - (unsigned char *)ptr)));
@@ -103,7 +164,7 @@ int main(int argc, char *argv[])
 	dprint (("[DEBUG] inverse transform...\n"));
 
 	/** (2) inverse DWT */
-	if (dwt_decode(&frame, &parameters)) {
+	if (dwt_decode(&dwt, &frame, &parameters)) {
 		fprintf(stderr, "[ERROR] inverse transform failed\n");
 		return EXIT_FAILURE;
 	}
@@ -130,5 +191,7 @@ int main(int argc, char *argv[])
 
 	frame_destroy(&input_frame);
 
+	dwt_destroy(&dwt);
+
 	return EXIT_SUCCESS;
 }
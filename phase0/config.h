@@ -21,10 +21,35 @@
 #define CONFIG_DWT2_MODE 2
 
 /*
- * 0 for processing transform levels sequentially, 1 for interleaving the individual levels in strips, 2 for interleaving the individual levels in blocks
+ * 0 for processing transform levels sequentially, 1 for interleaving the individual levels in strips, 2 for interleaving the individual levels in blocks, 3 for interleaving the individual levels in blocks within tiles
  */
 #define CONFIG_DWT_MS_MODE 2
 
+/*
+ * height of the tiles in pixels (multiple of 8), used with CONFIG_DWT_MS_MODE 3, the horizontal lifting state is kept for one row of tiles only
+ */
+#define CONFIG_DWT_TILE_HEIGHT 64
+
+/*
+ * width of the tiles in pixels (multiple of 8), used with CONFIG_DWT_MS_MODE 3
+ */
+#define CONFIG_DWT_TILE_WIDTH 256
+
+/*
+ * 0 for rounding the Float DWT coefficients to integers after each level, 1 for keeping the coefficients in floats across the levels (requires CONFIG_DWT_MS_MODE > 0)
+ */
+#define CONFIG_DWTFLOAT_MODE 1
+
+/*
+ * maximum pixel bit depth (up to 10) for which the frames store the pixels and the DWT coefficients in 16-bit integers, 0 for always using int (values > 0 require CONFIG_DWT_MS_MODE > 0 and CONFIG_DWTFLOAT_MODE 1), the Integer DWT with custom weights always uses int
+ */
+#define CONFIG_FRAME_DATA16_BPP 10
+
+/*
+ * 0 for reading the PGM files using stdio, 1 for mapping them into memory using mmap() (requires POSIX)
+ */
+#define CONFIG_FRAME_MMAP 0
+
 /*
  * 0 for forward transform, 1 for inverse transform
  */
@@ -0,0 +1,516 @@
+#include "container.h"
+#include "common.h"
+#include "bio.h"
+#include "alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define CONTAINER_VERSION 1
+
+/* the number of words in the header and in the segment table entry */
+#define CONTAINER_HEADER_WORDS 9
+#define CONTAINER_SEGMENT_WORDS 6
+
+static const UINT32 lut_crc32[256] = {
+	0x00000000UL, 0x77073096UL, 0xee0e612cUL, 0x990951baUL, 0x076dc419UL, 0x706af48fUL,
+	0xe963a535UL, 0x9e6495a3UL, 0x0edb8832UL, 0x79dcb8a4UL, 0xe0d5e91eUL, 0x97d2d988UL,
+	0x09b64c2bUL, 0x7eb17cbdUL, 0xe7b82d07UL, 0x90bf1d91UL, 0x1db71064UL, 0x6ab020f2UL,
+	0xf3b97148UL, 0x84be41deUL, 0x1adad47dUL, 0x6ddde4ebUL, 0xf4d4b551UL, 0x83d385c7UL,
+	0x136c9856UL, 0x646ba8c0UL, 0xfd62f97aUL, 0x8a65c9ecUL, 0x14015c4fUL, 0x63066cd9UL,
+	0xfa0f3d63UL, 0x8d080df5UL, 0x3b6e20c8UL, 0x4c69105eUL, 0xd56041e4UL, 0xa2677172UL,
+	0x3c03e4d1UL, 0x4b04d447UL, 0xd20d85fdUL, 0xa50ab56bUL, 0x35b5a8faUL, 0x42b2986cUL,
+	0xdbbbc9d6UL, 0xacbcf940UL, 0x32d86ce3UL, 0x45df5c75UL, 0xdcd60dcfUL, 0xabd13d59UL,
+	0x26d930acUL, 0x51de003aUL, 0xc8d75180UL, 0xbfd06116UL, 0x21b4f4b5UL, 0x56b3c423UL,
+	0xcfba9599UL, 0xb8bda50fUL, 0x2802b89eUL, 0x5f058808UL, 0xc60cd9b2UL, 0xb10be924UL,
+	0x2f6f7c87UL, 0x58684c11UL, 0xc1611dabUL, 0xb6662d3dUL, 0x76dc4190UL, 0x01db7106UL,
+	0x98d220bcUL, 0xefd5102aUL, 0x71b18589UL, 0x06b6b51fUL, 0x9fbfe4a5UL, 0xe8b8d433UL,
+	0x7807c9a2UL, 0x0f00f934UL, 0x9609a88eUL, 0xe10e9818UL, 0x7f6a0dbbUL, 0x086d3d2dUL,
+	0x91646c97UL, 0xe6635c01UL, 0x6b6b51f4UL, 0x1c6c6162UL, 0x856530d8UL, 0xf262004eUL,
+	0x6c0695edUL, 0x1b01a57bUL, 0x8208f4c1UL, 0xf50fc457UL, 0x65b0d9c6UL, 0x12b7e950UL,
+	0x8bbeb8eaUL, 0xfcb9887cUL, 0x62dd1ddfUL, 0x15da2d49UL, 0x8cd37cf3UL, 0xfbd44c65UL,
+	0x4db26158UL, 0x3ab551ceUL, 0xa3bc0074UL, 0xd4bb30e2UL, 0x4adfa541UL, 0x3dd895d7UL,
+	0xa4d1c46dUL, 0xd3d6f4fbUL, 0x4369e96aUL, 0x346ed9fcUL, 0xad678846UL, 0xda60b8d0UL,
+	0x44042d73UL, 0x33031de5UL, 0xaa0a4c5fUL, 0xdd0d7cc9UL, 0x5005713cUL, 0x270241aaUL,
+	0xbe0b1010UL, 0xc90c2086UL, 0x5768b525UL, 0x206f85b3UL, 0xb966d409UL, 0xce61e49fUL,
+	0x5edef90eUL, 0x29d9c998UL, 0xb0d09822UL, 0xc7d7a8b4UL, 0x59b33d17UL, 0x2eb40d81UL,
+	0xb7bd5c3bUL, 0xc0ba6cadUL, 0xedb88320UL, 0x9abfb3b6UL, 0x03b6e20cUL, 0x74b1d29aUL,
+	0xead54739UL, 0x9dd277afUL, 0x04db2615UL, 0x73dc1683UL, 0xe3630b12UL, 0x94643b84UL,
+	0x0d6d6a3eUL, 0x7a6a5aa8UL, 0xe40ecf0bUL, 0x9309ff9dUL, 0x0a00ae27UL, 0x7d079eb1UL,
+	0xf00f9344UL, 0x8708a3d2UL, 0x1e01f268UL, 0x6906c2feUL, 0xf762575dUL, 0x806567cbUL,
+	0x196c3671UL, 0x6e6b06e7UL, 0xfed41b76UL, 0x89d32be0UL, 0x10da7a5aUL, 0x67dd4accUL,
+	0xf9b9df6fUL, 0x8ebeeff9UL, 0x17b7be43UL, 0x60b08ed5UL, 0xd6d6a3e8UL, 0xa1d1937eUL,
+	0x38d8c2c4UL, 0x4fdff252UL, 0xd1bb67f1UL, 0xa6bc5767UL, 0x3fb506ddUL, 0x48b2364bUL,
+	0xd80d2bdaUL, 0xaf0a1b4cUL, 0x36034af6UL, 0x41047a60UL, 0xdf60efc3UL, 0xa867df55UL,
+	0x316e8eefUL, 0x4669be79UL, 0xcb61b38cUL, 0xbc66831aUL, 0x256fd2a0UL, 0x5268e236UL,
+	0xcc0c7795UL, 0xbb0b4703UL, 0x220216b9UL, 0x5505262fUL, 0xc5ba3bbeUL, 0xb2bd0b28UL,
+	0x2bb45a92UL, 0x5cb36a04UL, 0xc2d7ffa7UL, 0xb5d0cf31UL, 0x2cd99e8bUL, 0x5bdeae1dUL,
+	0x9b64c2b0UL, 0xec63f226UL, 0x756aa39cUL, 0x026d930aUL, 0x9c0906a9UL, 0xeb0e363fUL,
+	0x72076785UL, 0x05005713UL, 0x95bf4a82UL, 0xe2b87a14UL, 0x7bb12baeUL, 0x0cb61b38UL,
+	0x92d28e9bUL, 0xe5d5be0dUL, 0x7cdcefb7UL, 0x0bdbdf21UL, 0x86d3d2d4UL, 0xf1d4e242UL,
+	0x68ddb3f8UL, 0x1fda836eUL, 0x81be16cdUL, 0xf6b9265bUL, 0x6fb077e1UL, 0x18b74777UL,
+	0x88085ae6UL, 0xff0f6a70UL, 0x66063bcaUL, 0x11010b5cUL, 0x8f659effUL, 0xf862ae69UL,
+	0x616bffd3UL, 0x166ccf45UL, 0xa00ae278UL, 0xd70dd2eeUL, 0x4e048354UL, 0x3903b3c2UL,
+	0xa7672661UL, 0xd06016f7UL, 0x4969474dUL, 0x3e6e77dbUL, 0xaed16a4aUL, 0xd9d65adcUL,
+	0x40df0b66UL, 0x37d83bf0UL, 0xa9bcae53UL, 0xdebb9ec5UL, 0x47b2cf7fUL, 0x30b5ffe9UL,
+	0xbdbdf21cUL, 0xcabac28aUL, 0x53b39330UL, 0x24b4a3a6UL, 0xbad03605UL, 0xcdd70693UL,
+	0x54de5729UL, 0x23d967bfUL, 0xb3667a2eUL, 0xc4614ab8UL, 0x5d681b02UL, 0x2a6f2b94UL,
+	0xb40bbe37UL, 0xc30c8ea1UL, 0x5a05df1bUL, 0x2d02ef8dUL
+};
+
+UINT32 crc32(const unsigned char *ptr, size_t size)
+{
+	UINT32 crc = 0xffffffffUL;
+	size_t n;
+
+	assert(ptr != NULL || size == 0);
+
+	for (n = 0; n < size; ++n) {
+		crc = lut_crc32[(crc ^ ptr[n]) & 0xff] ^ (crc >> 8);
+	}
+
+	return crc ^ 0xffffffffUL;
+}
+
+void container_init(struct container *container)
+{
+	assert(container != NULL);
+
+	container->height = 0;
+	container->width = 0;
+	container->bpp = 0;
+	container->DWTtype = 0;
+	container->S = 0;
+	container->count = 0;
+	container->capacity = 0;
+	container->segments = NULL;
+	container->bits = 0;
+	container->size = 0;
+	container->stream = NULL;
+}
+
+void container_destroy(struct container *container)
+{
+	assert(container != NULL);
+
+	alloc_free(container->segments);
+	alloc_free(container->stream);
+
+	container_init(container);
+}
+
+static int container_reserve(struct container *container, size_t count)
+{
+	struct container_segment *segments;
+
+	assert(container != NULL);
+
+	if (count <= container->capacity) {
+		return RET_SUCCESS;
+	}
+
+	/* grow geometrically, the number of segments is not known in advance */
+	if (count < 2 * container->capacity) {
+		count = 2 * container->capacity;
+	}
+
+	segments = alloc_realloc(container->segments, count * sizeof(struct container_segment));
+
+	if (segments == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	container->segments = segments;
+	container->capacity = count;
+
+	return RET_SUCCESS;
+}
+
+int container_add_segment(struct container *container, size_t bit_offset, size_t blocks)
+{
+	struct container_segment *segment;
+	int err;
+
+	assert(container != NULL);
+
+	err = container_reserve(container, container->count + 1);
+
+	if (err) {
+		return err;
+	}
+
+	segment = container->segments + container->count;
+
+	segment->offset = bit_offset / 8;
+	segment->shift = bit_offset % 8;
+	segment->bits = 0;
+	segment->first_block = container->count > 0 ? segment[-1].first_block + segment[-1].blocks : 0;
+	segment->blocks = blocks;
+	segment->crc = 0;
+
+	container->count ++;
+
+	return RET_SUCCESS;
+}
+
+/* the number of bytes covering the segment */
+static size_t segment_size(const struct container_segment *segment)
+{
+	return (segment->shift + segment->bits + 7) / 8;
+}
+
+int container_finish(struct container *container, const unsigned char *stream, size_t size)
+{
+	size_t i;
+
+	assert(container != NULL);
+	assert(stream != NULL || size == 0);
+
+	if ((container->bits + 7) / 8 > size) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	alloc_free(container->stream);
+
+	container->stream = alloc_malloc(size);
+
+	if (container->stream == NULL && size != 0) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	if (size != 0) {
+		memcpy(container->stream, stream, size);
+	}
+
+	container->size = size;
+
+	container->S = container->count > 0 ? container->segments[0].blocks : 0;
+
+	for (i = 0; i < container->count; ++i) {
+		struct container_segment *segment = container->segments + i;
+		size_t end = i + 1 < container->count ? segment[1].offset * 8 + segment[1].shift : container->bits;
+
+		segment->bits = end - (segment->offset * 8 + segment->shift);
+		segment->crc = crc32(container->stream + segment->offset, segment_size(segment));
+	}
+
+	return RET_SUCCESS;
+}
+
+int container_verify(const struct container *container)
+{
+	size_t i;
+
+	assert(container != NULL);
+
+	for (i = 0; i < container->count; ++i) {
+		const struct container_segment *segment = container->segments + i;
+
+		if (crc32(container->stream + segment->offset, segment_size(segment)) != segment->crc) {
+			dprint (("[ERROR] segment %lu corrupted\n", (unsigned long) i));
+			return RET_FAILURE_FILE_CORRUPTED;
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+int container_open_segment(const struct container *container, size_t i, struct bio *bio)
+{
+	const struct container_segment *segment;
+	int err;
+
+	assert(container != NULL);
+
+	if (i >= container->count) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	segment = container->segments + i;
+
+	err = bio_open(bio, container->stream + segment->offset, BIO_MODE_READ);
+
+	if (err) {
+		return err;
+	}
+
+	if (segment->shift > 0) {
+		UINT32 bits;
+
+		return bio_read_bits(bio, &bits, segment->shift);
+	}
+
+	return RET_SUCCESS;
+}
+
+static void store_word(unsigned char *ptr, UINT32 word)
+{
+	ptr[0] = (unsigned char) (word >> 24);
+	ptr[1] = (unsigned char) (word >> 16);
+	ptr[2] = (unsigned char) (word >> 8);
+	ptr[3] = (unsigned char) (word);
+}
+
+static UINT32 load_word(const unsigned char *ptr)
+{
+	return (UINT32) ptr[0] << 24 | (UINT32) ptr[1] << 16 | (UINT32) ptr[2] << 8 | (UINT32) ptr[3];
+}
+
+/* store the value into the next word, fail if it does not fit */
+static int store_size(unsigned char **ptr, size_t value)
+{
+	if (value > UINT32_MAX_) {
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	store_word(*ptr, (UINT32) value);
+
+	*ptr += 4;
+
+	return RET_SUCCESS;
+}
+
+static size_t load_size(const unsigned char **ptr)
+{
+	size_t value = (size_t) load_word(*ptr);
+
+	*ptr += 4;
+
+	return value;
+}
+
+int container_write(const struct container *container, FILE *stream)
+{
+	size_t header_size;
+	unsigned char *header, *ptr;
+	size_t i;
+	int err = RET_SUCCESS;
+
+	assert(container != NULL);
+	assert(stream != NULL);
+
+	header_size = 4 * (CONTAINER_HEADER_WORDS + CONTAINER_SEGMENT_WORDS * container->count + 1);
+
+	header = alloc_malloc(header_size);
+
+	if (header == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	ptr = header;
+
+	memcpy(ptr, "O122", 4);
+	ptr += 4;
+
+	err |= store_size(&ptr, CONTAINER_VERSION);
+	err |= store_size(&ptr, container->height);
+	err |= store_size(&ptr, container->width);
+	err |= store_size(&ptr, container->bpp);
+	err |= store_size(&ptr, (size_t) container->DWTtype);
+	err |= store_size(&ptr, container->S);
+	err |= store_size(&ptr, container->count);
+	err |= store_size(&ptr, container->size);
+
+	for (i = 0; i < container->count; ++i) {
+		const struct container_segment *segment = container->segments + i;
+
+		err |= store_size(&ptr, segment->offset);
+		err |= store_size(&ptr, segment->shift);
+		err |= store_size(&ptr, segment->bits);
+		err |= store_size(&ptr, segment->first_block);
+		err |= store_size(&ptr, segment->blocks);
+		store_word(ptr, segment->crc);
+		ptr += 4;
+	}
+
+	if (err) {
+		alloc_free(header);
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	store_word(ptr, crc32(header, header_size - 4));
+
+	if (fwrite(header, 1, header_size, stream) != header_size || fwrite(container->stream, 1, container->size, stream) != container->size) {
+		err = RET_FAILURE_FILE_IO;
+	}
+
+	alloc_free(header);
+
+	return err;
+}
+
+int container_save(const struct container *container, const char *path)
+{
+	FILE *stream;
+	int err;
+
+	assert(container != NULL);
+	assert(path != NULL);
+
+	stream = fopen(path, "wb");
+
+	if (stream == NULL) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	err = container_write(container, stream);
+
+	if (EOF == fclose(stream)) {
+		return RET_FAILURE_FILE_IO;
+	}
+
+	return err;
+}
+
+/* read exactly 'size' bytes */
+static int read_bytes(FILE *stream, unsigned char *ptr, size_t size)
+{
+	if (fread(ptr, 1, size, stream) != size) {
+		return RET_FAILURE_FILE_IO;
+	}
+
+	return RET_SUCCESS;
+}
+
+/* see container_read() */
+static int container_read_fields(struct container *container, FILE *stream)
+{
+	unsigned char fixed[4 * CONTAINER_HEADER_WORDS];
+	const unsigned char *ptr;
+	unsigned char *header;
+	size_t header_size;
+	size_t i, count;
+	int err;
+
+	err = read_bytes(stream, fixed, sizeof fixed);
+
+	if (err) {
+		return err;
+	}
+
+	if (memcmp(fixed, "O122", 4) != 0 || load_word(fixed + 4) != CONTAINER_VERSION) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	count = (size_t) load_word(fixed + 4 * 7);
+
+	header_size = 4 * (CONTAINER_HEADER_WORDS + CONTAINER_SEGMENT_WORDS * count + 1);
+
+	if ((header_size / 4 - CONTAINER_HEADER_WORDS - 1) / CONTAINER_SEGMENT_WORDS != count) {
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	header = alloc_malloc(header_size);
+
+	if (header == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	memcpy(header, fixed, sizeof fixed);
+
+	err = read_bytes(stream, header + sizeof fixed, header_size - sizeof fixed);
+
+	if (err) {
+		alloc_free(header);
+		return err;
+	}
+
+	if (crc32(header, header_size - 4) != load_word(header + header_size - 4)) {
+		alloc_free(header);
+		return RET_FAILURE_FILE_CORRUPTED;
+	}
+
+	ptr = header + 8;
+
+	container->height = load_size(&ptr);
+	container->width = load_size(&ptr);
+	container->bpp = load_size(&ptr);
+	container->DWTtype = (int) load_size(&ptr);
+	container->S = load_size(&ptr);
+	ptr += 4; /* count */
+	container->size = load_size(&ptr);
+
+	err = container_reserve(container, count);
+
+	if (err) {
+		alloc_free(header);
+		return err;
+	}
+
+	container->bits = 0;
+
+	for (i = 0; i < count; ++i) {
+		struct container_segment *segment = container->segments + i;
+
+		segment->offset = load_size(&ptr);
+		segment->shift = load_size(&ptr);
+		segment->bits = load_size(&ptr);
+		segment->first_block = load_size(&ptr);
+		segment->blocks = load_size(&ptr);
+		segment->crc = load_word(ptr);
+		ptr += 4;
+
+		/* the segment must lie inside the stream */
+		if (segment->shift > 7 || segment->offset > container->size || segment_size(segment) > container->size - segment->offset) {
+			alloc_free(header);
+			return RET_FAILURE_FILE_CORRUPTED;
+		}
+
+		container->bits = segment->offset * 8 + segment->shift + segment->bits;
+	}
+
+	container->count = count;
+
+	alloc_free(header);
+
+	container->stream = alloc_malloc(container->size);
+
+	if (container->stream == NULL && container->size != 0) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	return read_bytes(stream, container->stream, container->size);
+}
+
+int container_read(struct container *container, FILE *stream)
+{
+	int err;
+
+	assert(container != NULL);
+	assert(stream != NULL);
+
+	container_init(container);
+
+	err = container_read_fields(container, stream);
+
+	if (err) {
+		container_destroy(container);
+	}
+
+	return err;
+}
+
+int container_load(struct container *container, const char *path)
+{
+	FILE *stream;
+	int err;
+
+	assert(container != NULL);
+	assert(path != NULL);
+
+	container_init(container);
+
+	stream = fopen(path, "rb");
+
+	if (stream == NULL) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	err = container_read(container, stream);
+
+	fclose(stream);
+
+	return err;
+}
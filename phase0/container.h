@@ -0,0 +1,128 @@
+/**
+ * \file container.h
+ * \brief Indexed container of the coded stream
+ *
+ * The coded segments are contiguous in bits, and the stream does not carry
+ * their lengths. The container wraps the unchanged stream together with
+ * a header (geometry and parameters) and a table of the segments, so that
+ * the individual segments can be located and checked without decoding
+ * everything that comes before them.
+ *
+ * The file layout (all the fields are 32-bit big-endian words):
+ * - magic "O122", version
+ * - height, width, bpp, DWTtype, S, number of segments, stream size in bytes
+ * - for each segment: byte offset, bit shift, bit length, first block, number of blocks, CRC-32
+ * - CRC-32 of all the preceding words
+ * - the stream
+ */
+#ifndef CONTAINER_H_
+#define CONTAINER_H_
+
+#include "common.h"
+#include "bio.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * \brief Entry of the segment table
+ */
+struct container_segment {
+	/** the segment starts at the bit \c shift (0 to 7) of the byte \c offset */
+	size_t offset;
+	size_t shift;
+	/** length of the segment in bits */
+	size_t bits;
+	/** index of the first block and the number of blocks in the segment */
+	size_t first_block;
+	size_t blocks;
+	/** CRC-32 of the bytes covering the segment */
+	UINT32 crc;
+};
+
+/**
+ * \brief Indexed container
+ */
+struct container {
+	/** geometry */
+	size_t height, width, bpp;
+
+	/** parameters */
+	int DWTtype;
+	size_t S;
+
+	/** segment table */
+	size_t count;
+	size_t capacity;
+	struct container_segment *segments;
+
+	/** length of the stream in bits */
+	size_t bits;
+
+	/** the stream, owned by the container */
+	size_t size;
+	unsigned char *stream;
+};
+
+/**
+ * \brief Compute the CRC-32 (ISO 3309) of \p size bytes at \p ptr
+ */
+UINT32 crc32(const unsigned char *ptr, size_t size);
+
+/**
+ * \brief Initialize an empty container
+ */
+void container_init(struct container *container);
+
+/**
+ * \brief Release the container
+ */
+void container_destroy(struct container *container);
+
+/**
+ * \brief Append the segment of \p blocks blocks starting at the bit \p bit_offset of the stream
+ */
+int container_add_segment(struct container *container, size_t bit_offset, size_t blocks);
+
+/**
+ * \brief Copy the \p stream of \p size bytes into the container and complete the segment table
+ *
+ * The segments must have been added, and the \c bits set. This computes the bit lengths and the checksums.
+ */
+int container_finish(struct container *container, const unsigned char *stream, size_t size);
+
+/**
+ * \brief Check the checksums of all the segments
+ *
+ * Returns \c RET_FAILURE_FILE_CORRUPTED on a mismatch.
+ */
+int container_verify(const struct container *container);
+
+/**
+ * \brief Open the \p bio for reading of the segment \p i
+ */
+int container_open_segment(const struct container *container, size_t i, struct bio *bio);
+
+/**
+ * \brief Save the container into the file
+ */
+int container_save(const struct container *container, const char *path);
+
+/**
+ * \brief Write the container at the current position of the \p stream, see container_save()
+ */
+int container_write(const struct container *container, FILE *stream);
+
+/**
+ * \brief Load the container from the file
+ *
+ * The header and the segment table are checked, the segments are not (see container_verify()).
+ */
+int container_load(struct container *container, const char *path);
+
+/**
+ * \brief Read the container from the current position of the \p stream, see container_load()
+ */
+int container_read(struct container *container, FILE *stream);
+
+#endif /* CONTAINER_H_ */
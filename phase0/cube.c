@@ -0,0 +1,710 @@
+#include "config.h"
+#include "common.h"
+#include "cube.h"
+#include "frame.h"
+#include "dwt.h"
+#include "bio.h"
+#include "bpe.h"
+#include "container.h"
+#include "open122.h"
+#include "worker.h"
+#include "alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/* width of the tiles (in pixels) in which the pixel-interleaved rows are (de)interleaved */
+#define CUBE_TILE 16
+
+/* the first error of the bands */
+static int first_error(const int *errors, size_t bands)
+{
+	size_t b;
+
+	for (b = 0; b < bands; ++b) {
+		if (errors[b]) {
+			return errors[b];
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+void cube_init(struct cube *cube)
+{
+	assert(cube != NULL);
+
+	cube->bands = 0;
+	cube->frames = NULL;
+}
+
+void cube_destroy(struct cube *cube)
+{
+	size_t b;
+
+	assert(cube != NULL);
+
+	for (b = 0; b < cube->bands; ++b) {
+		frame_destroy(&cube->frames[b]);
+	}
+
+	alloc_free(cube->frames);
+
+	cube_init(cube);
+}
+
+/* allocate 'bands' frames with no framebuffer */
+static int cube_alloc(struct cube *cube, size_t bands)
+{
+	size_t b;
+
+	assert(cube != NULL);
+
+	cube_init(cube);
+
+	if (bands == 0 || bands > SIZE_MAX_ / sizeof *cube->frames) {
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	cube->frames = alloc_malloc(bands * sizeof *cube->frames);
+
+	if (cube->frames == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	for (b = 0; b < bands; ++b) {
+		cube->frames[b].height = 0;
+		cube->frames[b].width = 0;
+		cube->frames[b].bpp = 0;
+		cube->frames[b].data = NULL;
+		cube->frames[b].data16 = NULL;
+	}
+
+	cube->bands = bands;
+
+	return RET_SUCCESS;
+}
+
+/* separate the bands of the pixel-interleaved row, the tiles of the row stay in the cache */
+static void deinterleave_row(int *planar, const int *interleaved, size_t width, size_t bands)
+{
+	size_t x0, x, b;
+
+	for (x0 = 0; x0 < width; x0 += CUBE_TILE) {
+		size_t x1 = x0 + CUBE_TILE < width ? x0 + CUBE_TILE : width;
+
+		for (b = 0; b < bands; ++b) {
+			for (x = x0; x < x1; ++x) {
+				planar[b*width + x] = interleaved[x*bands + b];
+			}
+		}
+	}
+}
+
+/* see deinterleave_row() */
+static void interleave_row(int *interleaved, const int *planar, size_t width, size_t bands)
+{
+	size_t x0, x, b;
+
+	for (x0 = 0; x0 < width; x0 += CUBE_TILE) {
+		size_t x1 = x0 + CUBE_TILE < width ? x0 + CUBE_TILE : width;
+
+		for (b = 0; b < bands; ++b) {
+			for (x = x0; x < x1; ++x) {
+				interleaved[x*bands + b] = planar[b*width + x];
+			}
+		}
+	}
+}
+
+/* the band and the row of the n-th row of the file */
+static void locate_row(size_t n, size_t height, size_t bands, int interleave, size_t *b, size_t *y)
+{
+	switch (interleave) {
+		case CUBE_BSQ:
+			*b = n / height;
+			*y = n % height;
+			break;
+		case CUBE_BIL:
+			*b = n % bands;
+			*y = n / bands;
+			break;
+		default:
+			*b = 0;
+			*y = n;
+	}
+}
+
+/* skip 'size' bytes, the stdin cannot seek */
+static int skip_bytes(FILE *stream, size_t size)
+{
+	size_t n;
+
+	if (size == 0 || fseek(stream, (long) size, SEEK_CUR) == 0) {
+		return RET_SUCCESS;
+	}
+
+	for (n = 0; n < size; ++n) {
+		if (getc(stream) == EOF) {
+			return RET_FAILURE_FILE_IO;
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+static int cube_read_raw(struct cube *cube, FILE *stream, const struct frame_raw *raw, int interleave)
+{
+	struct frame_raw layout;
+	size_t bands;
+	size_t row, stride;
+	size_t n, lines;
+	unsigned char *line;
+	int *samples, *planar;
+	int err = RET_SUCCESS;
+
+	bands = cube->bands;
+
+	/* the layout of the rows in the file */
+	layout = *raw;
+
+	if (interleave == CUBE_BIP) {
+		if (raw->width > SIZE_MAX_ / 8 / bands) {
+			return RET_FAILURE_OVERFLOW_ERROR;
+		}
+
+		layout.width = raw->width * bands;
+	}
+
+	row = frame_raw_row_size(&layout);
+	stride = raw->stride != 0 ? raw->stride : row;
+
+	if (row == 0 || stride < row) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	lines = interleave == CUBE_BIP ? raw->height : raw->height * bands;
+
+	line = alloc_malloc(stride);
+	/* the packed formats are unpacked in whole groups */
+	samples = alloc_malloc(ceil_multiple8(layout.width) * sizeof *samples);
+	planar = interleave == CUBE_BIP ? alloc_malloc(layout.width * sizeof *planar) : NULL;
+
+	if (line == NULL || samples == NULL || (interleave == CUBE_BIP && planar == NULL)) {
+		alloc_free(line);
+		alloc_free(samples);
+		alloc_free(planar);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	for (n = 0; n < lines; ++n) {
+		/* the bytes beyond the last row need not be present */
+		size_t size = n + 1 < lines ? stride : row;
+		size_t b, y;
+
+		if (fread(line, 1, size, stream) < size) {
+			err = RET_FAILURE_FILE_IO;
+			break;
+		}
+
+		frame_raw_unpack_row(&layout, samples, line);
+
+		locate_row(n, raw->height, bands, interleave, &b, &y);
+
+		if (interleave == CUBE_BIP) {
+			deinterleave_row(planar, samples, raw->width, bands);
+
+			for (b = 0; b < bands; ++b) {
+				frame_store_row(&cube->frames[b], y, planar + b * raw->width);
+			}
+		} else {
+			frame_store_row(&cube->frames[b], y, samples);
+		}
+	}
+
+	alloc_free(line);
+	alloc_free(samples);
+	alloc_free(planar);
+
+	return err;
+}
+
+int cube_load_raw(struct cube *cube, const char *path, const struct frame_raw *raw, size_t bands, int interleave)
+{
+	FILE *stream;
+	size_t b;
+	int err;
+
+	assert(cube != NULL);
+	assert(raw != NULL);
+
+	if (frame_raw_row_size(raw) == 0 || raw->height == 0 || raw->height > SIZE_MAX_ / (bands + 1) || interleave < CUBE_BSQ || interleave > CUBE_BIP) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	err = cube_alloc(cube, bands);
+
+	if (err) {
+		return err;
+	}
+
+	for (b = 0; b < bands && !err; ++b) {
+		cube->frames[b].height = raw->height;
+		cube->frames[b].width = raw->width;
+		cube->frames[b].bpp = raw->bpp;
+
+		err = frame_alloc_data(&cube->frames[b]);
+	}
+
+	if (err) {
+		cube_destroy(cube);
+		return err;
+	}
+
+	/* open file */
+	if (0 == strcmp(path, "-"))
+		stream = stdin;
+	else
+		stream = fopen(path, "rb");
+
+	if (NULL == stream) {
+		cube_destroy(cube);
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	err = skip_bytes(stream, raw->offset);
+
+	if (!err) {
+		err = cube_read_raw(cube, stream, raw, interleave);
+	}
+
+	if (stream != stdin) {
+		if (EOF == fclose(stream) && !err) {
+			err = RET_FAILURE_FILE_IO;
+		}
+	}
+
+	if (err) {
+		cube_destroy(cube);
+	}
+
+	return err;
+}
+
+/* store the samples as 8-bit or 16-bit bytes */
+static void pack_row(unsigned char *line, const int *samples, size_t count, int format)
+{
+	size_t x;
+
+	switch (format) {
+		case FRAME_RAW_8:
+			for (x = 0; x < count; ++x) {
+				line[x] = (unsigned char) samples[x];
+			}
+			break;
+		case FRAME_RAW_16LE:
+			for (x = 0; x < count; ++x) {
+				line[2*x+0] = (unsigned char) (samples[x] & 255);
+				line[2*x+1] = (unsigned char) (samples[x] >> 8);
+			}
+			break;
+		case FRAME_RAW_16BE:
+			for (x = 0; x < count; ++x) {
+				line[2*x+0] = (unsigned char) (samples[x] >> 8);
+				line[2*x+1] = (unsigned char) (samples[x] & 255);
+			}
+			break;
+	}
+}
+
+int cube_save_raw(const struct cube *cube, const char *path, int format, int interleave)
+{
+	const struct frame *frame;
+	size_t bands;
+	size_t width, count;
+	size_t n, lines;
+	size_t b;
+	unsigned char *line;
+	int *samples, *planar;
+	FILE *stream;
+	int err = RET_SUCCESS;
+
+	assert(cube != NULL);
+
+	if (cube->bands == 0 || interleave < CUBE_BSQ || interleave > CUBE_BIP) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	bands = cube->bands;
+	frame = &cube->frames[0];
+	width = frame->width;
+
+	for (b = 0; b < bands; ++b) {
+		if (cube->frames[b].height != frame->height || cube->frames[b].width != width || cube->frames[b].bpp != frame->bpp) {
+			return RET_FAILURE_FILE_UNSUPPORTED;
+		}
+	}
+
+	if ((format != FRAME_RAW_8 && format != FRAME_RAW_16LE && format != FRAME_RAW_16BE) || (format == FRAME_RAW_8 && frame->bpp > 8)) {
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	if (width > SIZE_MAX_ / 8 / bands) {
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	count = interleave == CUBE_BIP ? width * bands : width;
+	lines = interleave == CUBE_BIP ? frame->height : frame->height * bands;
+
+	line = alloc_malloc(count * 2);
+	samples = alloc_malloc(count * sizeof *samples);
+	planar = interleave == CUBE_BIP ? alloc_malloc(count * sizeof *planar) : NULL;
+
+	if (line == NULL || samples == NULL || (interleave == CUBE_BIP && planar == NULL)) {
+		alloc_free(line);
+		alloc_free(samples);
+		alloc_free(planar);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	if (0 == strcmp(path, "-"))
+		stream = stdout;
+	else
+		stream = fopen(path, "wb");
+
+	if (NULL == stream) {
+		alloc_free(line);
+		alloc_free(samples);
+		alloc_free(planar);
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	for (n = 0; n < lines && !err; ++n) {
+		size_t y;
+
+		locate_row(n, frame->height, bands, interleave, &b, &y);
+
+		/* the samples are clamped to the bit depth */
+		if (interleave == CUBE_BIP) {
+			for (b = 0; b < bands && !err; ++b) {
+				err = frame_export_rows(&cube->frames[b], y, 1, planar + b * width, width * sizeof *planar, FRAME_TYPE_INT);
+			}
+
+			interleave_row(samples, planar, width, bands);
+		} else {
+			err = frame_export_rows(&cube->frames[b], y, 1, samples, width * sizeof *samples, FRAME_TYPE_INT);
+		}
+
+		pack_row(line, samples, count, format);
+
+		if (!err && fwrite(line, format == FRAME_RAW_8 ? 1 : 2, count, stream) != count) {
+			err = RET_FAILURE_FILE_IO;
+		}
+	}
+
+	alloc_free(line);
+	alloc_free(samples);
+	alloc_free(planar);
+
+	if (stream != stdout) {
+		if (EOF == fclose(stream) && !err) {
+			err = RET_FAILURE_FILE_IO;
+		}
+	}
+
+	return err;
+}
+
+/* transform and encode the band, the stream is copied out of the worker buffer into the container */
+static int cube_compress_band(struct worker *worker, struct frame *frame, struct container *container)
+{
+	struct bio bio;
+	int err;
+
+	bio_open(&bio, worker->buffer, BIO_MODE_WRITE);
+
+	err = open122_encode_indexed(&worker->encoder, frame, &bio, container);
+
+	bio_close(&bio);
+
+	if (err) {
+		return err;
+	}
+
+	return container_finish(container, worker->buffer, (size_t) (bio.ptr - worker->buffer));
+}
+
+static void free_containers(struct container *containers, size_t bands)
+{
+	size_t b;
+
+	if (containers != NULL) {
+		for (b = 0; b < bands; ++b) {
+			container_destroy(&containers[b]);
+		}
+	}
+
+	alloc_free(containers);
+}
+
+/* save the containers of all the bands one after another */
+static int cube_save_containers(const struct container *containers, size_t bands, const char *path)
+{
+	FILE *stream;
+	size_t b;
+	int err = RET_SUCCESS;
+
+	stream = fopen(path, "wb");
+
+	if (stream == NULL) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	for (b = 0; b < bands && !err; ++b) {
+		err = container_write(&containers[b], stream);
+	}
+
+	if (EOF == fclose(stream) && !err) {
+		err = RET_FAILURE_FILE_IO;
+	}
+
+	return err;
+}
+
+int cube_compress(struct cube *cube, const struct parameters *parameters, const char *path)
+{
+	struct worker *workers;
+	struct container *containers;
+	struct frame *frame;
+	size_t count, size;
+	int *errors;
+	ptrdiff_t b;
+	size_t i;
+	int err = RET_SUCCESS;
+
+	assert(cube != NULL);
+	assert(parameters != NULL);
+
+	if (cube->bands == 0) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	/* all the bands have the same geometry */
+	frame = &cube->frames[0];
+
+	count = worker_get_count();
+	size = get_maximum_stream_size(frame);
+
+	workers = workers_create(count, frame->height, frame->width, parameters, 0);
+
+	containers = alloc_malloc(cube->bands * sizeof *containers);
+	errors = alloc_calloc(cube->bands, sizeof *errors);
+
+	if (workers == NULL || containers == NULL || errors == NULL) {
+		err = RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	for (i = 0; !err && i < count; ++i) {
+		err = worker_reserve_buffer(&workers[i], size);
+	}
+
+	if (err) {
+		if (workers != NULL) {
+			workers_destroy(workers, count, 0);
+		}
+		alloc_free(containers);
+		alloc_free(errors);
+		return err;
+	}
+
+	for (i = 0; i < cube->bands; ++i) {
+		container_init(&containers[i]);
+	}
+
+#ifdef _OPENMP
+#	pragma omp parallel for schedule(dynamic)
+#endif
+	for (b = 0; b < (ptrdiff_t) cube->bands; ++b) {
+		struct worker *worker = workers + worker_get_index();
+
+		if (cube->frames[b].height != frame->height || cube->frames[b].width != frame->width || cube->frames[b].bpp != frame->bpp) {
+			errors[b] = RET_FAILURE_LOGIC_ERROR;
+		} else {
+			errors[b] = cube_compress_band(worker, &cube->frames[b], &containers[b]);
+		}
+	}
+
+	err = first_error(errors, cube->bands);
+
+	if (!err) {
+		err = cube_save_containers(containers, cube->bands, path);
+	}
+
+	workers_destroy(workers, count, 0);
+	free_containers(containers, cube->bands);
+	alloc_free(errors);
+
+	return err;
+}
+
+/* load the containers of all the bands until the end of the file */
+static int cube_load_containers(struct container **containers, size_t *bands, const char *path)
+{
+	FILE *stream;
+	size_t capacity = 0;
+	int c;
+	int err = RET_SUCCESS;
+
+	*containers = NULL;
+	*bands = 0;
+
+	stream = fopen(path, "rb");
+
+	if (stream == NULL) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	while (!err && (c = getc(stream)) != EOF) {
+		ungetc(c, stream);
+
+		if (*bands == capacity) {
+			struct container *grown;
+
+			capacity = capacity ? 2 * capacity : 16;
+
+			grown = capacity <= SIZE_MAX_ / sizeof *grown ? alloc_realloc(*containers, capacity * sizeof *grown) : NULL;
+
+			if (grown == NULL) {
+				err = RET_FAILURE_MEMORY_ALLOCATION;
+				break;
+			}
+
+			*containers = grown;
+		}
+
+		err = container_read(&(*containers)[*bands], stream);
+
+		if (!err) {
+			++*bands;
+		}
+	}
+
+	if (!err && (ferror(stream) || *bands == 0)) {
+		err = *bands == 0 ? RET_FAILURE_FILE_UNSUPPORTED : RET_FAILURE_FILE_IO;
+	}
+
+	fclose(stream);
+
+	if (err) {
+		free_containers(*containers, *bands);
+		*containers = NULL;
+		*bands = 0;
+	}
+
+	return err;
+}
+
+/* decode and inverse transform the band straight into its framebuffer */
+static int cube_decompress_band(struct worker *worker, struct frame *frame, const struct container *container)
+{
+	struct bio bio;
+	int err;
+
+	err = container_verify(container);
+
+	if (err) {
+		return err;
+	}
+
+	frame->height = container->height;
+	frame->width = container->width;
+	frame->bpp = container->bpp;
+
+	err = frame_alloc_data(frame);
+
+	if (err) {
+		return err;
+	}
+
+	bio_open(&bio, container->stream, BIO_MODE_READ);
+
+	if (frame->data16 != NULL) {
+		err = open122_decode_into(&worker->decoder, &bio, frame->data16, ceil_multiple8(frame->width) * sizeof *frame->data16, FRAME_TYPE_USHORT);
+	} else {
+		err = open122_decode_into(&worker->decoder, &bio, frame->data, ceil_multiple8(frame->width) * sizeof *frame->data, FRAME_TYPE_INT);
+	}
+
+	bio_close(&bio);
+
+	return err;
+}
+
+int cube_decompress(struct cube *cube, const struct parameters *parameters, const char *path)
+{
+	struct parameters band_parameters;
+	struct worker *workers;
+	struct container *containers;
+	size_t count;
+	size_t bands;
+	int *errors;
+	ptrdiff_t b;
+	int err;
+
+	assert(cube != NULL);
+	assert(parameters != NULL);
+
+	err = cube_load_containers(&containers, &bands, path);
+
+	if (err) {
+		return err;
+	}
+
+	err = cube_alloc(cube, bands);
+
+	if (err) {
+		free_containers(containers, bands);
+		return err;
+	}
+
+	count = worker_get_count();
+
+	/* the decoders are reserved for the first band, the others grow them */
+	band_parameters = *parameters;
+	band_parameters.DWTtype = containers[0].DWTtype;
+
+	workers = workers_create(count, containers[0].height, containers[0].width, &band_parameters, 1);
+	errors = alloc_calloc(bands, sizeof *errors);
+
+	if (workers == NULL || errors == NULL) {
+		if (workers != NULL) {
+			workers_destroy(workers, count, 1);
+		}
+		alloc_free(errors);
+		free_containers(containers, bands);
+		cube_destroy(cube);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+#ifdef _OPENMP
+#	pragma omp parallel for schedule(dynamic)
+#endif
+	for (b = 0; b < (ptrdiff_t) bands; ++b) {
+		struct worker *worker = workers + worker_get_index();
+
+		errors[b] = cube_decompress_band(worker, &cube->frames[b], &containers[b]);
+	}
+
+	err = first_error(errors, bands);
+
+	workers_destroy(workers, count, 1);
+	alloc_free(errors);
+	free_containers(containers, bands);
+
+	if (err) {
+		cube_destroy(cube);
+	}
+
+	return err;
+}
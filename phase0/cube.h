@@ -0,0 +1,74 @@
+/**
+ * \file cube.h
+ * \brief Multiband image cubes
+ *
+ * Each band of the cube is an independent CCSDS 122.0 image. The bands are
+ * compressed into separate streams, which are stored together in a single
+ * file. When compiled with OpenMP, the bands are distributed among threads,
+ * each thread reusing its own encoder or decoder context (see open122.h).
+ *
+ * The file holds the indexed containers (see container.h) of the bands,
+ * one after another.
+ */
+#ifndef CUBE_H_
+#define CUBE_H_
+
+#include "common.h"
+#include "frame.h"
+
+#include <stddef.h>
+
+/**
+ * \brief Interleaving of the bands in the raw cube files
+ */
+enum {
+	CUBE_BSQ, /**< \brief band sequential, the bands follow each other */
+	CUBE_BIL, /**< \brief band interleaved by line, the rows of all bands follow each other */
+	CUBE_BIP  /**< \brief band interleaved by pixel, the samples of all bands follow each other */
+};
+
+/**
+ * \brief Multiband image, one frame per band
+ */
+struct cube {
+	size_t bands;
+	struct frame *frames;
+};
+
+/**
+ * \brief Initialize an empty cube
+ */
+void cube_init(struct cube *cube);
+
+/**
+ * \brief Release the cube
+ */
+void cube_destroy(struct cube *cube);
+
+/**
+ * \brief Load the raw cube of \p bands bands with the given \p interleave
+ *
+ * The \p raw describes the geometry and the sample format of each band. Its \c stride is the distance of the
+ * rows in the file: the rows of a single band for BSQ and BIL, the rows of the interleaved samples for BIP.
+ * The file is read in a single pass, the bands are separated as the rows arrive.
+ */
+int cube_load_raw(struct cube *cube, const char *path, const struct frame_raw *raw, size_t bands, int interleave);
+
+/**
+ * \brief Save the cube as raw 8-bit or 16-bit (\c FRAME_RAW_8, \c FRAME_RAW_16LE, \c FRAME_RAW_16BE) samples
+ */
+int cube_save_raw(const struct cube *cube, const char *path, int format, int interleave);
+
+/**
+ * \brief Compress all the bands and save the streams into the file
+ *
+ * The bands are transformed <em>in situ</em>, the cube holds the DWT coefficients afterwards.
+ */
+int cube_compress(struct cube *cube, const struct parameters *parameters, const char *path);
+
+/**
+ * \brief Load the streams from the file and decompress all the bands
+ */
+int cube_decompress(struct cube *cube, const struct parameters *parameters, const char *path);
+
+#endif /* CUBE_H_ */
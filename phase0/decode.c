@@ -0,0 +1,397 @@
+/**
+ * Decompresses the raw CCSDS 122.0 stream into the image
+ *
+ * Nothing but the image is written unless the debug output is requested.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#	include <omp.h>
+#endif
+
+#include "config.h"
+#include "common.h"
+#include "frame.h"
+#include "dwt.h"
+#include "bio.h"
+#include "bpe.h"
+#include "cli.h"
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "[ERROR] usage: %s [<options>] <input stream> [<output image>]\n", name);
+	fprintf(stderr, "The image is PGM, or the raw samples with -s, the \"-\" stands for the standard input and output (default output). Options:\n");
+	fprintf(stderr, "  -p <DecodeBitPlaneStop>,<DecodeStageStop> stop refining the segments at the bit plane and stage\n");
+	fprintf(stderr, "  -h <height>                  expected number of rows of the image\n");
+	fprintf(stderr, "  -r <y>,<x>,<height>,<width>  decode the rectangle of pixels only\n");
+	fprintf(stderr, "  -l <level>                   decode the preview at 1/2, 1/4 or 1/8 resolution (level 1, 2, 3)\n");
+	fprintf(stderr, "  -s                           write the raw samples (8-bit, or 16-bit big-endian above 8 bpp) row by row as soon as they are decoded, not with -r, -l, -v\n");
+	fprintf(stderr, "  -j <threads>                 number of threads (requires OpenMP)\n");
+	fprintf(stderr, "  -v                           dump the decoded coefficients (not with -s)\n");
+}
+
+/* the rows completed by the streaming inverse transform are written right away */
+struct stream_output {
+	struct dwt_stream stream;
+	FILE *file;
+	unsigned short *line;
+	unsigned char *bytes;
+};
+
+static int stream_stripe(void *context, struct frame *frame)
+{
+	struct stream_output *output = context;
+
+	return dwt_stream_push(&output->stream, frame);
+}
+
+/* the samples are written as in the PGM raster, one byte or two big-endian bytes */
+static int stream_rows(void *context, const struct frame *frame, size_t y, size_t height)
+{
+	struct stream_output *output = context;
+	size_t depth = frame->bpp > 8 ? 2 : 1;
+	size_t y_, x;
+
+	if (output->line == NULL) {
+		output->line = malloc(frame->width * sizeof *output->line);
+		output->bytes = malloc(frame->width * depth);
+
+		if (output->line == NULL || output->bytes == NULL) {
+			return RET_FAILURE_MEMORY_ALLOCATION;
+		}
+	}
+
+	for (y_ = y; y_ < y + height; ++y_) {
+		int err = frame_export_rows(frame, y_, 1, output->line, frame->width * sizeof *output->line, FRAME_TYPE_USHORT);
+
+		if (err) {
+			return err;
+		}
+
+		for (x = 0; x < frame->width; ++x) {
+			if (depth == 1) {
+				output->bytes[x] = (unsigned char) output->line[x];
+			} else {
+				output->bytes[2 * x + 0] = (unsigned char) (output->line[x] >> 8);
+				output->bytes[2 * x + 1] = (unsigned char) (output->line[x] & 0xff);
+			}
+		}
+
+		if (fwrite(output->bytes, depth, frame->width, output->file) != frame->width) {
+			return RET_FAILURE_FILE_IO;
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+/* decode the stream and write the image stripe by stripe */
+static int decode_streaming(struct parameters *parameters, struct bio *bio, const char *path)
+{
+	struct stream_output output;
+	struct frame frame;
+	struct dwt dwt;
+	int err;
+
+	/* the frame and the workspace grow with the stripes */
+	frame.height = 0;
+	frame.width = 0;
+	frame.bpp = 0;
+	frame.data = NULL;
+	frame.data16 = NULL;
+
+	if (dwt_init(&dwt, 0, 0)) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	output.file = 0 == strcmp(path, "-") ? stdout : fopen(path, "wb");
+	output.line = NULL;
+	output.bytes = NULL;
+
+	if (output.file == NULL) {
+		dwt_destroy(&dwt);
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	dwt_stream_init(&output.stream, &dwt, parameters, stream_rows, &output);
+
+	err = bpe_decode_stripes(&frame, parameters, bio, stream_stripe, &output);
+
+	if (!err) {
+		err = dwt_stream_finish(&output.stream, &frame);
+	}
+
+	if (output.file != stdout && EOF == fclose(output.file) && !err) {
+		err = RET_FAILURE_FILE_IO;
+	}
+
+	free(output.line);
+	free(output.bytes);
+	frame_destroy(&frame);
+	dwt_destroy(&dwt);
+
+	return err;
+}
+
+/* decode the blocks supporting the rectangle, and save the rectangle */
+static int decode_region(struct parameters *parameters, struct bio *bio, const size_t rectangle[4], int verbose, const char *path)
+{
+	size_t y = rectangle[0], x = rectangle[1], height = rectangle[2], width = rectangle[3];
+	struct frame window, region;
+	struct dwt dwt;
+	int err;
+
+	window.data = NULL;
+	window.data16 = NULL;
+	region.data = NULL;
+	region.data16 = NULL;
+
+	err = dwt_region_support(&y, &x, &height, &width);
+
+	if (err) {
+		fprintf(stderr, "[ERROR] the region is too large\n");
+		return err;
+	}
+
+	err = bpe_decode_region(&window, parameters, bio, y, x, height, width);
+
+	/* the window is clipped to the image, the region must start inside it */
+	if (err == RET_FAILURE_LOGIC_ERROR || (!err && (rectangle[0] - y >= window.height || rectangle[1] - x >= window.width))) {
+		fprintf(stderr, "[ERROR] the region lies outside the image\n");
+		frame_destroy(&window);
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	if (err) {
+		frame_destroy(&window);
+		return err;
+	}
+
+	if (verbose) {
+		frame_dump_chunked_as_semiplanar(&window, "dwt3-decoded.pgm", 8);
+	}
+
+	if (dwt_init(&dwt, window.height, window.width)) {
+		frame_destroy(&window);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	err = dwt_decode_region(&dwt, &window, parameters, rectangle[0] - y, rectangle[1] - x, rectangle[2], rectangle[3], &region);
+
+	if (!err) {
+		err = frame_save_pgm(&region, path);
+	}
+
+	frame_destroy(&region);
+	frame_destroy(&window);
+	dwt_destroy(&dwt);
+
+	return err;
+}
+
+int main(int argc, char *argv[])
+{
+	struct frame frame, preview;
+	struct parameters parameters;
+	struct dwt dwt;
+	struct bio bio;
+	unsigned char *ptr;
+	size_t size;
+	const char *input = NULL, *output = "-";
+	int verbose = 0, streaming = 0;
+	size_t level = 0;
+	/* the zero height stands for the whole image */
+	size_t rectangle[4] = { 0, 0, 0, 0 };
+	int i;
+
+	init_parameters(&parameters);
+
+	for (i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+		unsigned long stop, y, x, height, width;
+		int stage;
+
+		if (arg[0] != '-' || arg[1] == '\0') {
+			if (input == NULL) {
+				input = arg;
+			} else {
+				output = arg;
+			}
+			continue;
+		}
+
+		if (0 == strcmp(arg, "-v")) {
+			verbose = 1;
+			continue;
+		}
+
+		if (0 == strcmp(arg, "-s")) {
+			streaming = 1;
+			continue;
+		}
+
+		if (value == NULL || arg[2] != '\0') {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		switch (arg[1]) {
+			case 'p':
+				if (sscanf(value, "%lu,%d", &stop, &stage) != 2) {
+					usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				parameters.DecodeBitPlaneStop = (size_t) stop;
+				parameters.DecodeStageStop = stage;
+				break;
+			case 'h':
+				if (cli_parse_size(value, &parameters.DecodeHeightHint)) {
+					usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'r':
+				if (sscanf(value, "%lu,%lu,%lu,%lu", &y, &x, &height, &width) != 4 || height == 0 || width == 0) {
+					usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				rectangle[0] = (size_t) y;
+				rectangle[1] = (size_t) x;
+				rectangle[2] = (size_t) height;
+				rectangle[3] = (size_t) width;
+				break;
+			case 'l':
+				if (cli_parse_size(value, &level) || level > 3) {
+					usage(argv[0]);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'j':
+#ifdef _OPENMP
+				omp_set_num_threads(atoi(value));
+#else
+				fprintf(stderr, "[WARNING] compiled without OpenMP, the number of threads is ignored\n");
+#endif
+				break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+
+		++i;
+	}
+
+	if (input == NULL) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* the streaming, the region and the preview exclude each other */
+	if (streaming && (rectangle[2] != 0 || level != 0 || verbose)) {
+		fprintf(stderr, "[ERROR] the streaming output (-s) cannot be combined with -r, -l, or -v\n");
+		return EXIT_FAILURE;
+	}
+
+	if (rectangle[2] != 0 && level != 0) {
+		fprintf(stderr, "[ERROR] the region (-r) cannot be combined with the preview (-l)\n");
+		return EXIT_FAILURE;
+	}
+
+	if (parameters.DecodeBitPlaneStop > 31 || parameters.DecodeStageStop < 0 || parameters.DecodeStageStop > 3) {
+		fprintf(stderr, "[ERROR] invalid parameters\n");
+		return EXIT_FAILURE;
+	}
+
+	ptr = cli_load_file(input, &size);
+
+	if (ptr == NULL) {
+		fprintf(stderr, "[ERROR] unable to load the stream\n");
+		return EXIT_FAILURE;
+	}
+
+	if (streaming || rectangle[2] != 0) {
+		int err;
+
+		bio_open(&bio, ptr, BIO_MODE_READ);
+
+		if (streaming) {
+			err = decode_streaming(&parameters, &bio, output);
+		} else {
+			err = decode_region(&parameters, &bio, rectangle, verbose, output);
+		}
+
+		bio_close(&bio);
+
+		free(ptr);
+
+		if (err) {
+			fprintf(stderr, "[ERROR] decoding failed\n");
+			return EXIT_FAILURE;
+		}
+
+		return EXIT_SUCCESS;
+	}
+
+	/* the frame is allocated by the decoder */
+	frame.height = 0;
+	frame.width = 0;
+	frame.bpp = 0;
+	frame.data = NULL;
+	frame.data16 = NULL;
+
+	bio_open(&bio, ptr, BIO_MODE_READ);
+
+	if (bpe_decode(&frame, &parameters, &bio)) {
+		fprintf(stderr, "[ERROR] decoding failed\n");
+		return EXIT_FAILURE;
+	}
+
+	bio_close(&bio);
+
+	free(ptr);
+
+	if (verbose) {
+		frame_dump_chunked_as_semiplanar(&frame, "dwt3-decoded.pgm", 8);
+	}
+
+	if (dwt_init(&dwt, frame.height, frame.width)) {
+		fprintf(stderr, "[ERROR] unable to allocate the DWT workspace\n");
+		return EXIT_FAILURE;
+	}
+
+	if (level != 0) {
+		preview.data = NULL;
+		preview.data16 = NULL;
+
+		if (dwt_decode_preview(&dwt, &frame, &parameters, (int) level, &preview)) {
+			fprintf(stderr, "[ERROR] inverse transform failed\n");
+			return EXIT_FAILURE;
+		}
+
+		if (frame_save_pgm(&preview, output)) {
+			fprintf(stderr, "[ERROR] unable to save an output raster\n");
+			return EXIT_FAILURE;
+		}
+
+		frame_destroy(&preview);
+	} else {
+		if (dwt_decode(&dwt, &frame, &parameters)) {
+			fprintf(stderr, "[ERROR] inverse transform failed\n");
+			return EXIT_FAILURE;
+		}
+
+		if (frame_save_pgm(&frame, output)) {
+			fprintf(stderr, "[ERROR] unable to save an output raster\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	frame_destroy(&frame);
+
+	dwt_destroy(&dwt);
+
+	return EXIT_SUCCESS;
+}
@@ -1,35 +1,505 @@
+#include "config.h"
 #include "common.h"
 #include "dwt.h"
 #include "dwtfloat.h"
 #include "dwtint.h"
+#include "alloc.h"
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
-int dwt_encode(struct frame *frame, const struct parameters *parameters)
+#if (CONFIG_FRAME_DATA16_BPP > 0) && ((CONFIG_DWT_MS_MODE == 0) || (CONFIG_DWTFLOAT_MODE == 0))
+#	error "CONFIG_FRAME_DATA16_BPP requires CONFIG_DWT_MS_MODE > 0 and CONFIG_DWTFLOAT_MODE 1"
+#endif
+
+/* the coefficients of the Integer DWT weighted by default take up to 16 bits at 10 bpp */
+#if (CONFIG_FRAME_DATA16_BPP > 10)
+#	error "CONFIG_FRAME_DATA16_BPP must not exceed 10"
+#endif
+
+#if (CONFIG_DWT_TILE_HEIGHT < 8) || (CONFIG_DWT_TILE_HEIGHT % 8 != 0)
+#	error "CONFIG_DWT_TILE_HEIGHT must be a positive multiple of 8"
+#endif
+
+/*
+ * the number of pixels affected by a coefficient beyond its block, or by
+ * a boundary extension, accumulated over the three levels (4 lifting steps
+ * per level at the sample distance of 4, 2, 1 pixels)
+ */
+#define DWT_REGION_MARGIN 32
+
+/*
+ * rows of the float window of the streaming transform, twice the rows touched by one strip,
+ * so that the window slides once per DWT_STREAM_ROWS - DWT_STRIP_DELAY rows
+ */
+#define DWT_STREAM_ROWS (2 * (DWT_STRIP_DELAY + 8))
+
+/* alignment of the lifting buffers (cache line size) */
+#define DWT_ALIGNMENT 64
+
+static size_t ceil_multiple_alignment(size_t n)
+{
+	return (n + (DWT_ALIGNMENT - 1)) / DWT_ALIGNMENT * DWT_ALIGNMENT;
+}
+
+/*
+ * size of one lifting buffer entry in bytes, enough for both
+ * the Integer DWT (5 ints) and the Float DWT (4 floats)
+ */
+static size_t sizeof_entry(void)
+{
+	return 5 * sizeof(int) > 4 * sizeof(float) ? 5 * sizeof(int) : 4 * sizeof(float);
+}
+
+/* size of the lifting buffer for the signal of 'size' samples at level 'j' in bytes */
+static size_t sizeof_buff(size_t size, int j)
+{
+	return ceil_multiple_alignment((2 * ((size >> j) >> 1) + ((size_t) 32 >> j) - 2) * sizeof_entry());
+}
+
+/* size of the ring of the horizontal lifting state of one level in bytes, see DWT_BUFF_Y_ROWS */
+static size_t sizeof_ring(void)
+{
+	return ceil_multiple_alignment(2 * DWT_BUFF_Y_ROWS * sizeof_entry());
+}
+
+/* whether the transform of the 'parameters' keeps the coefficients in the float plane */
+static int uses_floats(const struct parameters *parameters)
+{
+	assert(parameters != NULL);
+
+#if (CONFIG_DWTFLOAT_MODE == 1)
+	return parameters->DWTtype == 0;
+#else
+	(void) parameters;
+
+	return 0;
+#endif
+}
+
+/* size of the workspace for 'height' x 'width' pixels (multiples of 8) in bytes, with the float plane if 'floats' */
+static size_t sizeof_workspace(size_t height, size_t width, int floats)
+{
+	int j;
+	size_t size = DWT_ALIGNMENT - 1;
+
+	for (j = 0; j < 3; ++j) {
+		size += sizeof_ring();
+		size += sizeof_buff(width, j);
+	}
+
+	if (floats) {
+		size += ceil_multiple_alignment(height * width * sizeof(float));
+	}
+
+	return size;
+}
+
+size_t dwt_sizeof(size_t height, size_t width, const struct parameters *parameters)
+{
+	return arena_sizeof(sizeof_workspace(ceil_multiple8(height), ceil_multiple8(width), uses_floats(parameters)));
+}
+
+/* grow the workspace, the float plane is added if 'floats', and kept once allocated */
+static int dwt_reserve_floats(struct dwt *dwt, size_t height, size_t width, int floats)
+{
+	int j;
+	size_t size;
+	unsigned char *ptr;
+
+	assert(dwt != NULL);
+
+	height = ceil_multiple8(height);
+	width  = ceil_multiple8(width);
+
+	floats = floats || dwt->data != NULL;
+
+	if (dwt->ptr != NULL && height <= dwt->height && width <= dwt->width && (!floats || dwt->data != NULL)) {
+		return RET_SUCCESS;
+	}
+
+	if (height < dwt->height)
+		height = dwt->height;
+	if (width < dwt->width)
+		width = dwt->width;
+
+	size = sizeof_workspace(height, width, floats);
+
+	alloc_free(dwt->ptr);
+
+	dwt->ptr = alloc_malloc(size);
+
+	if (dwt->ptr == NULL) {
+		dwt->height = 0;
+		dwt->width = 0;
+		dwt->data = NULL;
+
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	ptr = dwt->ptr;
+	ptr += (DWT_ALIGNMENT - (size_t) ptr % DWT_ALIGNMENT) % DWT_ALIGNMENT;
+
+	for (j = 0; j < 3; ++j) {
+		dwt->buff_y[j] = ptr;
+		ptr += sizeof_ring();
+
+		dwt->buff_x[j] = ptr;
+		ptr += sizeof_buff(width, j);
+	}
+
+	dwt->data = floats ? ptr : NULL;
+
+	dwt->height = height;
+	dwt->width = width;
+
+	return RET_SUCCESS;
+}
+
+int dwt_init(struct dwt *dwt, size_t height, size_t width)
+{
+	assert(dwt != NULL);
+
+	dwt->height = 0;
+	dwt->width = 0;
+	dwt->ptr = NULL;
+	dwt->data = NULL;
+
+	return dwt_reserve_floats(dwt, height, width, 0);
+}
+
+int dwt_reserve(struct dwt *dwt, size_t height, size_t width, const struct parameters *parameters)
+{
+	return dwt_reserve_floats(dwt, height, width, uses_floats(parameters));
+}
+
+void dwt_destroy(struct dwt *dwt)
+{
+	assert(dwt != NULL);
+
+	alloc_free(dwt->ptr);
+
+	dwt->ptr = NULL;
+	dwt->height = 0;
+	dwt->width = 0;
+	dwt->data = NULL;
+}
+
+/* the custom weights of the Integer DWT may scale the coefficients beyond the 16-bit storage */
+static int widen_weighted(struct frame *frame, const struct parameters *parameters)
+{
+	assert(parameters != NULL);
+
+	if (parameters->DWTtype == 1 && !is_default_weight(parameters->weight)) {
+		return frame_widen_data(frame);
+	}
+
+	return RET_SUCCESS;
+}
+
+int dwt_encode(struct dwt *dwt, struct frame *frame, const struct parameters *parameters)
+{
+	int err;
+
+	assert(frame != NULL);
+	assert(parameters != NULL);
+
+	err = dwt_reserve(dwt, frame->height, frame->width, parameters);
+
+	if (err) {
+		return err;
+	}
+
+	err = widen_weighted(frame, parameters);
+
+	if (err) {
+		return err;
+	}
+
+	switch (parameters->DWTtype) {
+		case 0:
+			return dwtfloat_encode(dwt, frame);
+		case 1:
+			return dwtint_encode(dwt, frame, parameters->weight);
+		default:
+			return RET_FAILURE_LOGIC_ERROR;
+	}
+}
+
+int dwt_decode(struct dwt *dwt, struct frame *frame, const struct parameters *parameters)
 {
+	int err;
+
+	assert(frame != NULL);
 	assert(parameters != NULL);
 
+	err = dwt_reserve(dwt, frame->height, frame->width, parameters);
+
+	if (err) {
+		return err;
+	}
+
+	err = widen_weighted(frame, parameters);
+
+	if (err) {
+		return err;
+	}
+
 	switch (parameters->DWTtype) {
 		case 0:
-			return dwtfloat_encode(frame);
+			return dwtfloat_decode(dwt, frame);
 		case 1:
-			return dwtint_encode(frame, parameters->weight);
+			return dwtint_decode(dwt, frame, parameters->weight);
 		default:
 			return RET_FAILURE_LOGIC_ERROR;
 	}
 }
 
-int dwt_decode(struct frame *frame, const struct parameters *parameters)
+/* transform the strips up to the row 'y1', and pass the completed stripes to the callback */
+static int dwt_stream_strips(struct dwt_stream *stream, struct frame *frame, size_t y1)
+{
+	assert(stream != NULL);
+	assert(frame != NULL);
+
+	for (; stream->y < y1; stream->y += 8) {
+		size_t y = stream->y;
+		int err;
+
+		switch (stream->parameters->DWTtype) {
+			case 0:
+				err = dwtfloat_decode_strips(stream->dwt, frame, (ptrdiff_t) y, (ptrdiff_t) y + 8, &stream->top);
+				break;
+			case 1:
+				err = dwtint_decode_strips(stream->dwt, frame, stream->parameters->weight, (ptrdiff_t) y, (ptrdiff_t) y + 8);
+				break;
+			default:
+				err = RET_FAILURE_LOGIC_ERROR;
+		}
+
+		if (err) {
+			return err;
+		}
+
+		if (y >= DWT_STRIP_DELAY && y - DWT_STRIP_DELAY < frame->height) {
+			size_t height = frame->height - (y - DWT_STRIP_DELAY);
+
+			err = stream->callback(stream->context, frame, y - DWT_STRIP_DELAY, height < 8 ? height : 8);
+
+			if (err) {
+				return err;
+			}
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+void dwt_stream_init(struct dwt_stream *stream, struct dwt *dwt, const struct parameters *parameters, int (*callback)(void *context, const struct frame *frame, size_t y, size_t height), void *context)
 {
+	assert(stream != NULL);
+	assert(dwt != NULL);
 	assert(parameters != NULL);
+	assert(callback != NULL);
+
+	stream->dwt = dwt;
+	stream->parameters = parameters;
+	stream->y = 0;
+	stream->top = 0;
+	stream->callback = callback;
+	stream->context = context;
+}
+
+/*
+ * reserve the workspace of the streaming transform before the first strip, the float plane
+ * holds a window of DWT_STREAM_ROWS rows, and the workspace does not depend on the height
+ */
+static int dwt_stream_reserve(struct dwt_stream *stream, const struct frame *frame)
+{
+	assert(stream != NULL);
+	assert(frame != NULL);
+
+	/* the lifting state of the strips done so far is kept in the workspace */
+	if (stream->y > 0) {
+		return RET_SUCCESS;
+	}
+
+	return dwt_reserve(stream->dwt, DWT_STREAM_ROWS, frame->width, stream->parameters);
+}
+
+int dwt_stream_push(struct dwt_stream *stream, struct frame *frame)
+{
+	int err;
+
+	assert(stream != NULL);
+	assert(frame != NULL);
+	assert(is_multiple8(frame->height));
+
+	err = dwt_stream_reserve(stream, frame);
+
+	if (err) {
+		return err;
+	}
+
+	/* the strip at the row y reads the coefficients up to the row y + 8 */
+	return dwt_stream_strips(stream, frame, frame->height);
+}
+
+int dwt_stream_finish(struct dwt_stream *stream, struct frame *frame)
+{
+	int err;
+
+	assert(stream != NULL);
+	assert(frame != NULL);
+
+	err = dwt_stream_reserve(stream, frame);
+
+	if (err) {
+		return err;
+	}
+
+	return dwt_stream_strips(stream, frame, ceil_multiple8(frame->height) + DWT_STRIP_DELAY);
+}
+
+int dwt_decode_into(struct dwt *dwt, struct frame *frame, const struct parameters *parameters, void *ptr, size_t stride, int type)
+{
+	int err;
+
+	assert(frame != NULL);
+
+	err = dwt_decode(dwt, frame, parameters);
+
+	if (err) {
+		return err;
+	}
+
+	return frame_export(frame, ptr, stride, type);
+}
+
+/**
+ * \brief Divide the samples of the \p frame by 2^shift, rounding to nearest if \p round is nonzero, otherwise towards minus infinity
+ */
+static void scale_samples(struct frame *frame, int shift, int round)
+{
+	size_t n, size;
+	int offset;
+
+	assert(frame != NULL);
+
+	if (shift == 0) {
+		return;
+	}
+
+	size = ceil_multiple8(frame->height) * ceil_multiple8(frame->width);
+	offset = round ? 1 << (shift - 1) : 0;
+
+	if (frame->data16 != NULL) {
+		for (n = 0; n < size; ++n) {
+			frame->data16[n] = (short) ((frame->data16[n] + offset) >> shift);
+		}
+	} else {
+		for (n = 0; n < size; ++n) {
+			frame->data[n] = (frame->data[n] + offset) >> shift;
+		}
+	}
+}
+
+int dwt_decode_preview(struct dwt *dwt, struct frame *frame, const struct parameters *parameters, int level, struct frame *preview)
+{
+	int err;
+	int shift, round;
+
+	assert(frame != NULL);
+	assert(parameters != NULL);
+	assert(preview != NULL);
+
+	if (level < 0 || level > 3) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	err = dwt_reserve(dwt, frame->height, frame->width, parameters);
+
+	if (err) {
+		return err;
+	}
 
 	switch (parameters->DWTtype) {
 		case 0:
-			return dwtfloat_decode(frame);
+			err = dwtfloat_decode_partial(dwt, frame, level);
+			/* the DC gain of the low-pass filter is sqrt(2), i.e. 2 per level */
+			shift = level;
+			round = 1;
+			break;
 		case 1:
-			return dwtint_decode(frame, parameters->weight);
+			err = dwtint_decode_partial(dwt, frame, parameters->weight, level);
+			/*
+			 * the DC gain of the low-pass filter is 1; the LL bands at the levels 1 and 2 are produced by the
+			 * inverse transform of the coarser levels, which removes the weights, so only the LL band at the
+			 * level 3, which is not inverse transformed, keeps its weight (DWT_LL2)
+			 */
+			shift = level == 3 ? parameters->weight[DWT_LL2] : 0;
+			round = 0;
+			break;
 		default:
 			return RET_FAILURE_LOGIC_ERROR;
 	}
+
+	if (err) {
+		return err;
+	}
+
+	err = frame_decimate(preview, frame, level);
+
+	if (err) {
+		return err;
+	}
+
+	scale_samples(preview, shift, round);
+
+	return RET_SUCCESS;
+}
+
+int dwt_region_support(size_t *y, size_t *x, size_t *height, size_t *width)
+{
+	size_t y1, x1;
+
+	assert(y != NULL && x != NULL);
+	assert(height != NULL && width != NULL);
+
+	/* the end of the support rounded up to a multiple of 8 must not wrap */
+	if (*y > SIZE_MAX_ - 7 - DWT_REGION_MARGIN || *height > SIZE_MAX_ - 7 - DWT_REGION_MARGIN - *y) {
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	if (*x > SIZE_MAX_ - 7 - DWT_REGION_MARGIN || *width > SIZE_MAX_ - 7 - DWT_REGION_MARGIN - *x) {
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	y1 = ceil_multiple8(*y + *height + DWT_REGION_MARGIN);
+	x1 = ceil_multiple8(*x + *width + DWT_REGION_MARGIN);
+
+	*y = *y > DWT_REGION_MARGIN ? (*y - DWT_REGION_MARGIN) / 8 * 8 : 0;
+	*x = *x > DWT_REGION_MARGIN ? (*x - DWT_REGION_MARGIN) / 8 * 8 : 0;
+
+	*height = y1 - *y;
+	*width = x1 - *x;
+
+	return RET_SUCCESS;
+}
+
+int dwt_decode_region(struct dwt *dwt, struct frame *window, const struct parameters *parameters, size_t y, size_t x, size_t height, size_t width, struct frame *region)
+{
+	int err;
+
+	assert(window != NULL);
+	assert(region != NULL);
+
+	err = dwt_decode(dwt, window, parameters);
+
+	if (err) {
+		return err;
+	}
+
+	return frame_crop(region, window, y, x, height, width);
 }
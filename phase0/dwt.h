@@ -8,20 +8,180 @@
 #include "frame.h"
 #include "common.h"
 
+#include <stddef.h>
+
+/**
+ * \brief DWT workspace
+ *
+ * Owns the lifting buffers of the multi-scale transform for frames up to
+ * \c height x \c width pixels. All the buffers are carved from a single
+ * allocation and aligned to a cache line. The workspace is intended to be
+ * reused across frames.
+ */
+struct dwt {
+	/** capacity (multiples of 8) */
+	size_t height, width;
+
+	/** the underlying allocation */
+	void *ptr;
+
+	/** lifting state of the horizontal filters, one ring of DWT_BUFF_Y_ROWS quad rows per level */
+	void *buff_y[3];
+	/** lifting state of the vertical filters, one buffer per level */
+	void *buff_x[3];
+
+	/** float coefficients of the Float DWT (CONFIG_DWTFLOAT_MODE 1 only), NULL until reserved for the Float DWT */
+	void *data;
+};
+
+/**
+ * \brief Number of the quad rows of the horizontal lifting state per level
+ *
+ * The quad row \c n keeps its state in the slot <tt>n % DWT_BUFF_Y_ROWS</tt>. The slots of a row
+ * of tiles (or a strip, or a row of blocks) are reset before it is processed, so the workspace does
+ * not depend on the height of the frame. A row of tiles covers up to CONFIG_DWT_TILE_HEIGHT pixels.
+ */
+#define DWT_BUFF_Y_ROWS (CONFIG_DWT_TILE_HEIGHT / 2)
+
+/**
+ * \brief Delay of the strip-wise inverse transform in rows
+ *
+ * The inverse transform of the strip at the row \c y completes the pixels of the stripe
+ * at the row <tt>y - DWT_STRIP_DELAY</tt>.
+ */
+#define DWT_STRIP_DELAY 24
+
+/**
+ * \brief Streaming inverse transform
+ *
+ * The coefficients are handed over as the stripes of blocks get decoded, see bpe_decode_stripes().
+ * The inverse transform runs strip by strip behind them, and each stripe of 8 rows of pixels is passed
+ * to the \c callback as soon as it is complete.
+ */
+struct dwt_stream {
+	struct dwt *dwt;
+	const struct parameters *parameters;
+
+	/** the next strip to be transformed */
+	size_t y;
+
+	/** the first row of the frame held by the float window of the workspace (Float DWT only) */
+	ptrdiff_t top;
+
+	/** receives the rows [y; y + height) of pixels of the frame, a nonzero return value stops the transform */
+	int (*callback)(void *context, const struct frame *frame, size_t y, size_t height);
+	void *context;
+};
+
+/**
+ * \brief Initialize the workspace for frames up to \p height x \p width pixels
+ *
+ * Only the lifting buffers are allocated, the float plane of the Float DWT is added by dwt_reserve().
+ */
+int dwt_init(struct dwt *dwt, size_t height, size_t width);
+
+/**
+ * \brief Grow the workspace to frames of \p height x \p width pixels transformed as the \p parameters say
+ *
+ * The float plane is reserved for the Float DWT only (CONFIG_DWTFLOAT_MODE 1), and it is kept once allocated.
+ * Does nothing if the current capacity is sufficient.
+ */
+int dwt_reserve(struct dwt *dwt, size_t height, size_t width, const struct parameters *parameters);
+
+/**
+ * \brief Release the workspace
+ */
+void dwt_destroy(struct dwt *dwt);
+
+/**
+ * \brief Number of bytes of an arena taken by dwt_reserve() for \p height x \p width pixels, see arena_sizeof()
+ */
+size_t dwt_sizeof(size_t height, size_t width, const struct parameters *parameters);
+
 /**
  * \brief Forward wavelet transform
  *
  * The transform is computed <em>in situ</em> using the \p frame buffer.
  * Either Float or Integer DWT is used, according to the \p parameters.
+ * The workspace \p dwt is grown when the \p frame does not fit into it.
  */
-int dwt_encode(struct frame *frame, const struct parameters *parameters);
+int dwt_encode(struct dwt *dwt, struct frame *frame, const struct parameters *parameters);
 
 /**
  * \brief Inverse wavelet transform
  *
  * The transform is computed <em>in situ</em> using the \p frame buffer.
  * Either Float or Integer DWT is used, according to the \p parameters.
+ * The workspace \p dwt is grown when the \p frame does not fit into it.
+ */
+int dwt_decode(struct dwt *dwt, struct frame *frame, const struct parameters *parameters);
+
+/**
+ * \brief Start the streaming inverse transform using the workspace \p dwt
+ */
+void dwt_stream_init(struct dwt_stream *stream, struct dwt *dwt, const struct parameters *parameters, int (*callback)(void *context, const struct frame *frame, size_t y, size_t height), void *context);
+
+/**
+ * \brief Transform the strips covered by the stripes of coefficients stored in the \p frame so far
+ *
+ * The height of the \p frame is a multiple of 8 and may grow between the calls, its width may not.
+ * The workspace is reserved at the first call for a window of a few strips of the width of the \p frame,
+ * so it does not depend on the height.
+ * The strips that depend on the bottom border are deferred until dwt_stream_finish().
+ */
+int dwt_stream_push(struct dwt_stream *stream, struct frame *frame);
+
+/**
+ * \brief Transform the remaining strips once the height of the \p frame is final
+ */
+int dwt_stream_finish(struct dwt_stream *stream, struct frame *frame);
+
+/**
+ * \brief Inverse wavelet transform into the caller buffer
+ *
+ * The \p frame holding the coefficients serves as the workspace of the
+ * transform. The reconstructed pixels are clamped and stored directly into
+ * the buffer at \p ptr of the pixel \p type and \p stride in bytes, see
+ * frame_export().
+ */
+int dwt_decode_into(struct dwt *dwt, struct frame *frame, const struct parameters *parameters, void *ptr, size_t stride, int type);
+
+/**
+ * \brief Reduced-resolution inverse wavelet transform
+ *
+ * Only the levels coarser than \p level are inverse transformed. The LL band
+ * at the \p level is then stored into \p preview, scaled to the pixel range.
+ * The \p level 1, 2, 3 gives 1/2, 1/4, 1/8 resolution preview (0 gives the full
+ * resolution). For a smooth image, the preview matches every (1 << \p level)-th
+ * pixel of the full reconstruction up to the rounding of the scaled LL band to
+ * integers. The \p frame is overwritten by the partially reconstructed
+ * coefficients. The \p preview must be either a valid frame or have \c data
+ * and \c data16 set to \c NULL, its framebuffer is reused if possible.
+ */
+int dwt_decode_preview(struct dwt *dwt, struct frame *frame, const struct parameters *parameters, int level, struct frame *preview);
+
+/**
+ * \brief Expand the rectangle of pixels to the support of its wavelet coefficients
+ *
+ * The rectangle at (\p y, \p x) of \p height x \p width pixels is grown
+ * by the spread of the synthesis filters over the three levels and
+ * aligned to 8x8 blocks. The result may exceed the image, it is clipped
+ * when decoded by bpe_decode_region(). Fails with RET_FAILURE_OVERFLOW_ERROR
+ * when the support does not fit into size_t.
+ */
+int dwt_region_support(size_t *y, size_t *x, size_t *height, size_t *width);
+
+/**
+ * \brief Inverse wavelet transform of a region
+ *
+ * The \p window holds the coefficients of the support computed by
+ * dwt_region_support(). It is inverse transformed <em>in situ</em>, and
+ * the rectangle of \p height x \p width pixels at (\p y, \p x), relative
+ * to the \p window, is stored into \p region. The rectangle is clipped to
+ * the \p window, so the \p region is smaller when the rectangle crosses the
+ * border of the image. The \p region must be either a valid frame or have
+ * \c data and \c data16 set to \c NULL.
  */
-int dwt_decode(struct frame *frame, const struct parameters *parameters);
+int dwt_decode_region(struct dwt *dwt, struct frame *window, const struct parameters *parameters, size_t y, size_t x, size_t height, size_t width, struct frame *region);
 
 #endif /* DWT_H_ */
@@ -1,10 +1,13 @@
 #include "config.h"
 #include "common.h"
+#include "dwt.h"
 #include "dwtfloat.h"
+#include "alloc.h"
 
 #include <stddef.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 static void zero(float *line, size_t size)
 {
@@ -46,6 +49,74 @@ static int int_roundf(float x)
 	return i - (int) ( (float) i > x );
 }
 
+/*
+ * Round the array of floats to nearest integers
+ *
+ * Gives the same results as int_roundf(). The loop body has no branches,
+ * so the compiler can vectorize the loop.
+ */
+#if (CONFIG_DWTFLOAT_MODE == 1)
+static void round_array(int *dst, const float *src, size_t size)
+{
+	size_t n;
+
+	for (n = 0; n < size; ++n) {
+		float x = src[n] + .5f;
+		int i = (int) x;
+
+		dst[n] = i - (int) ( (float) i > x );
+	}
+}
+
+static void convert_array(float *dst, const int *src, size_t size)
+{
+	size_t n;
+
+	for (n = 0; n < size; ++n) {
+		dst[n] = (float) src[n];
+	}
+}
+
+/* round_array() for the frames with 16-bit storage */
+static void round_array16(short *dst, const float *src, size_t size)
+{
+	size_t n;
+
+	for (n = 0; n < size; ++n) {
+		float x = src[n] + .5f;
+		int i = (int) x;
+
+		dst[n] = (short) ( i - (int) ( (float) i > x ) );
+	}
+}
+
+static void convert_array16(float *dst, const short *src, size_t size)
+{
+	size_t n;
+
+	for (n = 0; n < size; ++n) {
+		dst[n] = (float) src[n];
+	}
+}
+#endif
+
+/*
+ * Coefficients of the multi-scale transform
+ *
+ * With CONFIG_DWTFLOAT_MODE 1, the levels pass the coefficients to each other
+ * in floats. The coefficients are rounded only once, after the last level.
+ */
+#if (CONFIG_DWTFLOAT_MODE == 1)
+#	if (CONFIG_DWT_MS_MODE == 0)
+#		error "CONFIG_DWTFLOAT_MODE 1 is not implemented for CONFIG_DWT_MS_MODE 0"
+#	endif
+typedef float coef;
+#	define round_coef(x) (x)
+#else
+typedef int coef;
+#	define round_coef(x) int_roundf(x)
+#endif
+
 /*
  * The CCSDS standard states that pixel bit depth shall not exceed the limit
  * of 28 bits for the signed pixel type (sign bit + 27 bit magnitude).
@@ -239,6 +310,107 @@ static void dwtfloat_decode_core(float data[2], float buff[4], const int lever[4
 	buff[3] = l3;
 }
 
+/*
+ * dwtfloat_encode_core() specialized for zero levers, i.e., for the interior
+ * of the signal
+ */
+static void dwtfloat_encode_core_interior(float data[2], float buff[4])
+{
+	const float w0 = +delta;
+	const float w1 = +gamma;
+	const float w2 = +beta;
+	const float w3 = +alpha;
+
+	float l0, l1, l2, l3;
+	float c0, c1, c2, c3;
+	float r0, r1, r2, r3;
+	float x0, x1;
+	float y0, y1;
+
+	l0 = buff[0];
+	l1 = buff[1];
+	l2 = buff[2];
+	l3 = buff[3];
+
+	x0 = data[0];
+	x1 = data[1];
+
+	c0 = l1;
+	c1 = l2;
+	c2 = l3;
+	c3 = x0;
+
+	r3 = x1;
+	r2 = c3 + w3 * ( l3 + r3 );
+	r1 = c2 + w2 * ( l2 + r2 );
+	r0 = c1 + w1 * ( l1 + r1 );
+	y0 = c0 + w0 * ( l0 + r0 );
+	y1 = r0;
+
+	l0 = r0;
+	l1 = r1;
+	l2 = r2;
+	l3 = r3;
+
+	data[0] = y0;
+	data[1] = y1;
+
+	buff[0] = l0;
+	buff[1] = l1;
+	buff[2] = l2;
+	buff[3] = l3;
+}
+
+/*
+ * dwtfloat_decode_core() specialized for zero levers
+ */
+static void dwtfloat_decode_core_interior(float data[2], float buff[4])
+{
+	const float w0 = -alpha;
+	const float w1 = -beta;
+	const float w2 = -gamma;
+	const float w3 = -delta;
+
+	float l0, l1, l2, l3;
+	float c0, c1, c2, c3;
+	float r0, r1, r2, r3;
+	float x0, x1;
+	float y0, y1;
+
+	l0 = buff[0];
+	l1 = buff[1];
+	l2 = buff[2];
+	l3 = buff[3];
+
+	x0 = data[0];
+	x1 = data[1];
+
+	c0 = l1;
+	c1 = l2;
+	c2 = l3;
+	c3 = x0;
+
+	r3 = x1;
+	r2 = c3 + w3 * ( l3 + r3 );
+	r1 = c2 + w2 * ( l2 + r2 );
+	r0 = c1 + w1 * ( l1 + r1 );
+	y0 = c0 + w0 * ( l0 + r0 );
+	y1 = r0;
+
+	l0 = r0;
+	l1 = r1;
+	l2 = r2;
+	l3 = r3;
+
+	data[0] = y0;
+	data[1] = y1;
+
+	buff[0] = l0;
+	buff[1] = l1;
+	buff[2] = l2;
+	buff[3] = l3;
+}
+
 /*
  * Compute a part of one-dimensional wavelet transform.
  * The n0 and n1 define coordinates of the part to be computed.
@@ -285,11 +457,9 @@ void dwtfloat_encode_line_segment(int *line, ptrdiff_t size, ptrdiff_t stride, f
 	}
 	/* regular */
 	for (; n < n1 && n < N; n++) {
-		int lever[4] = { 0, 0, 0, 0 };
-
 		data[0] = (float) d(n-1);
 		data[1] = (float) c(n);
-		dwtfloat_encode_core(data, buff, lever);
+		dwtfloat_encode_core_interior(data, buff);
 		c(n-2) = int_roundf( data[0] * (    +zeta) );
 		d(n-2) = int_roundf( data[1] * (-rcp_zeta) );
 	}
@@ -358,8 +528,10 @@ void dwtfloat_encode_step(int *line, ptrdiff_t N, ptrdiff_t stride, float *buff,
 
 /*
  * encode 2x2 coefficients
+ *
+ * The buff_y points to the horizontal lifting state of the quad row n_y.
  */
-void dwtfloat_encode_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, float *buff_y, float *buff_x, ptrdiff_t n_y, ptrdiff_t n_x)
+void dwtfloat_encode_quad(coef *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, float *buff_y, float *buff_x, ptrdiff_t n_y, ptrdiff_t n_x)
 {
 	/* vertical lever at [0], horizontal at [1] */
 	int lever[2][4];
@@ -383,13 +555,13 @@ void dwtfloat_encode_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t str
 	core[2] = signal_defined(n_y-0, N_y) && signal_defined(n_x-1, N_x) ? (float) dc(n_y-0, n_x-1) : 0; /* HL */
 	core[3] = signal_defined(n_y-0, N_y) && signal_defined(n_x-0, N_x) ? (float) cc(n_y-0, n_x-0) : 0; /* LL */
 
-	dwtfloat_encode_core2(core, buff_y + 4*(2*n_y+0), buff_x + 4*(2*n_x+0), lever);
+	dwtfloat_encode_core2(core, buff_y, buff_x + 4*(2*n_x+0), lever);
 
 	if (signal_defined(n_y-2, N_y) && signal_defined(n_x-2, N_x)) {
-		cc(n_y-2, n_x-2) = int_roundf( core[0] * sqr_zeta     ); /* LL */
-		dc(n_y-2, n_x-2) = int_roundf( core[1] * -1           ); /* HL */
-		cd(n_y-2, n_x-2) = int_roundf( core[2] * -1           ); /* LH */
-		dd(n_y-2, n_x-2) = int_roundf( core[3] * rcp_sqr_zeta ); /* HH */
+		cc(n_y-2, n_x-2) = round_coef( core[0] * sqr_zeta     ); /* LL */
+		dc(n_y-2, n_x-2) = round_coef( core[1] * -1           ); /* HL */
+		cd(n_y-2, n_x-2) = round_coef( core[2] * -1           ); /* LH */
+		dd(n_y-2, n_x-2) = round_coef( core[3] * rcp_sqr_zeta ); /* HH */
 	}
 
 #	undef cc
@@ -398,6 +570,51 @@ void dwtfloat_encode_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t str
 #	undef dd
 }
 
+static void dwtfloat_encode_core2_interior(float core[4], float *buff_y, float *buff_x)
+{
+	/* horizontal filtering */
+	dwtfloat_encode_core_interior(&core[0], buff_y + 4*(0));
+	dwtfloat_encode_core_interior(&core[2], buff_y + 4*(1));
+	transpose(core);
+	/* vertical filtering */
+	dwtfloat_encode_core_interior(&core[0], buff_x + 4*(0));
+	dwtfloat_encode_core_interior(&core[2], buff_x + 4*(1));
+	transpose(core);
+}
+
+/*
+ * dwtfloat_encode_quad() specialized for the interior quads, 3 <= n < N
+ *
+ * All the levers are zero and all the coefficients are defined.
+ */
+static void dwtfloat_encode_quad_interior(coef *data, ptrdiff_t stride_y, ptrdiff_t stride_x, float *buff_y, float *buff_x, ptrdiff_t n_y, ptrdiff_t n_x)
+{
+	/* order on input: 0=HH, 1=LH, 2=HH, 3=LL */
+	float core[4];
+
+#	define cc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
+#	define dc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
+#	define cd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
+#	define dd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
+
+	core[0] = (float) dd(n_y-1, n_x-1); /* HH */
+	core[1] = (float) cd(n_y-1, n_x-0); /* LH */
+	core[2] = (float) dc(n_y-0, n_x-1); /* HL */
+	core[3] = (float) cc(n_y-0, n_x-0); /* LL */
+
+	dwtfloat_encode_core2_interior(core, buff_y, buff_x + 4*(2*n_x+0));
+
+	cc(n_y-2, n_x-2) = round_coef( core[0] * sqr_zeta     ); /* LL */
+	dc(n_y-2, n_x-2) = round_coef( core[1] * -1           ); /* HL */
+	cd(n_y-2, n_x-2) = round_coef( core[2] * -1           ); /* LH */
+	dd(n_y-2, n_x-2) = round_coef( core[3] * rcp_sqr_zeta ); /* HH */
+
+#	undef cc
+#	undef dc
+#	undef cd
+#	undef dd
+}
+
 /*static*/ void dwtfloat_decode_core2(float core[4], float *buff_y, float *buff_x, int lever[2][4])
 {
 	/* horizontal filtering */
@@ -410,7 +627,12 @@ void dwtfloat_encode_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t str
 	transpose(core);
 }
 
-void dwtfloat_decode_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, float *buff_y, float *buff_x, ptrdiff_t n_y, ptrdiff_t n_x)
+/*
+ * see dwtfloat_encode_quad()
+ *
+ * The data holds the quad rows from o_y on, the streaming transform keeps a window of rows.
+ */
+void dwtfloat_decode_quad(coef *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, float *buff_y, float *buff_x, ptrdiff_t n_y, ptrdiff_t n_x, ptrdiff_t o_y)
 {
 	/* vertical lever at [0], horizontal at [1] */
 	int lever[2][4];
@@ -424,10 +646,10 @@ void dwtfloat_decode_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t str
 	decode_adjust_levers(lever[0], n_y, N_y);
 	decode_adjust_levers(lever[1], n_x, N_x);
 
-#	define cc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
-#	define dc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
-#	define cd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
-#	define dd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
+#	define cc(n_y, n_x) data[ stride_y*(2*((n_y)-o_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
+#	define dc(n_y, n_x) data[ stride_y*(2*((n_y)-o_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
+#	define cd(n_y, n_x) data[ stride_y*(2*((n_y)-o_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
+#	define dd(n_y, n_x) data[ stride_y*(2*((n_y)-o_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
 
 	if ( signal_defined(n_y-0, N_y) && signal_defined(n_x-0, N_x) ) {
 		core[0] = (float) cc(n_y, n_x) * rcp_sqr_zeta; /* LL */
@@ -441,16 +663,59 @@ void dwtfloat_decode_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t str
 		core[3] = 0;
 	}
 
-	dwtfloat_decode_core2(core, buff_y + 4*(2*n_y+0), buff_x + 4*(2*n_x+0), lever);
+	dwtfloat_decode_core2(core, buff_y, buff_x + 4*(2*n_x+0), lever);
 
 	if ( signal_defined(n_y-1, N_y) && signal_defined(n_x-1, N_x) )
-		cc(n_y-1, n_x-1) = int_roundf( core[3] ); /* LL */
+		cc(n_y-1, n_x-1) = round_coef( core[3] ); /* LL */
 	if ( signal_defined(n_y-1, N_y) && signal_defined(n_x-2, N_x) )
-		dc(n_y-1, n_x-2) = int_roundf( core[2] ); /* HL */
+		dc(n_y-1, n_x-2) = round_coef( core[2] ); /* HL */
 	if ( signal_defined(n_y-2, N_y) && signal_defined(n_x-1, N_x) )
-		cd(n_y-2, n_x-1) = int_roundf( core[1] ); /* LH */
+		cd(n_y-2, n_x-1) = round_coef( core[1] ); /* LH */
 	if ( signal_defined(n_y-2, N_y) && signal_defined(n_x-2, N_x) )
-		dd(n_y-2, n_x-2) = int_roundf( core[0] ); /* HH */
+		dd(n_y-2, n_x-2) = round_coef( core[0] ); /* HH */
+
+#	undef cc
+#	undef dc
+#	undef cd
+#	undef dd
+}
+
+static void dwtfloat_decode_core2_interior(float core[4], float *buff_y, float *buff_x)
+{
+	/* horizontal filtering */
+	dwtfloat_decode_core_interior(&core[0], buff_y + 4*(0));
+	dwtfloat_decode_core_interior(&core[2], buff_y + 4*(1));
+	transpose(core);
+	/* vertical filtering */
+	dwtfloat_decode_core_interior(&core[0], buff_x + 4*(0));
+	dwtfloat_decode_core_interior(&core[2], buff_x + 4*(1));
+	transpose(core);
+}
+
+/*
+ * dwtfloat_decode_quad() specialized for the interior quads, 3 <= n < N
+ */
+static void dwtfloat_decode_quad_interior(coef *data, ptrdiff_t stride_y, ptrdiff_t stride_x, float *buff_y, float *buff_x, ptrdiff_t n_y, ptrdiff_t n_x, ptrdiff_t o_y)
+{
+	/* order on input: 0=LL, 1=HL, 2=LH, 3=HH */
+	float core[4];
+
+#	define cc(n_y, n_x) data[ stride_y*(2*((n_y)-o_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
+#	define dc(n_y, n_x) data[ stride_y*(2*((n_y)-o_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
+#	define cd(n_y, n_x) data[ stride_y*(2*((n_y)-o_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
+#	define dd(n_y, n_x) data[ stride_y*(2*((n_y)-o_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
+
+	core[0] = (float) cc(n_y, n_x) * rcp_sqr_zeta; /* LL */
+	core[1] = (float) dc(n_y, n_x) * -1;           /* HL */
+	core[2] = (float) cd(n_y, n_x) * -1;           /* LH */
+	core[3] = (float) dd(n_y, n_x) * sqr_zeta;     /* HH */
+
+	dwtfloat_decode_core2_interior(core, buff_y, buff_x + 4*(2*n_x+0));
+
+	cc(n_y-1, n_x-1) = round_coef( core[3] ); /* LL */
+	dc(n_y-1, n_x-2) = round_coef( core[2] ); /* HL */
+	cd(n_y-2, n_x-1) = round_coef( core[1] ); /* LH */
+	dd(n_y-2, n_x-2) = round_coef( core[0] ); /* HH */
 
 #	undef cc
 #	undef dc
@@ -480,7 +745,7 @@ int dwtfloat_encode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
 
 	N = size / 2;
 
-	line_ = malloc( (size_t) size * sizeof(float) );
+	line_ = alloc_malloc( (size_t) size * sizeof(float) );
 
 	if (NULL == line_) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
@@ -536,7 +801,7 @@ int dwtfloat_encode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
 #	undef c
 #	undef d
 
-	free(line_);
+	alloc_free(line_);
 
 	return RET_SUCCESS;
 #endif
@@ -548,7 +813,7 @@ int dwtfloat_encode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
 
 	N = size / 2;
 
-	line_ = malloc( (size_t) size * sizeof(int) );
+	line_ = alloc_malloc( (size_t) size * sizeof(int) );
 
 	if (NULL == line_) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
@@ -596,7 +861,7 @@ int dwtfloat_encode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
 #	undef d
 #	undef x
 
-	free(line_);
+	alloc_free(line_);
 
 	return RET_SUCCESS;
 #endif
@@ -611,7 +876,7 @@ int dwtfloat_decode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
 
 	N = size / 2;
 
-	line_ = malloc( (size_t) size * sizeof(float) );
+	line_ = alloc_malloc( (size_t) size * sizeof(float) );
 
 	if (NULL == line_) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
@@ -667,11 +932,13 @@ int dwtfloat_decode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
 #	undef c
 #	undef d
 
-	free(line_);
+	alloc_free(line_);
 
 	return RET_SUCCESS;
 }
 
+/* the bands are used by CONFIG_DWT_MS_MODE 0, which keeps integer coefficients */
+#if (CONFIG_DWTFLOAT_MODE == 0)
 int dwtfloat_encode_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrdiff_t height, ptrdiff_t width)
 {
 	ptrdiff_t y, x;
@@ -691,7 +958,7 @@ int dwtfloat_encode_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrd
 #if (CONFIG_DWT2_MODE == 1)
 	float *buff;
 
-	buff = malloc( (size_t) width * 4 * sizeof(float) );
+	buff = alloc_malloc( (size_t) width * 4 * sizeof(float) );
 
 	if (NULL == buff) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
@@ -716,13 +983,13 @@ int dwtfloat_encode_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrd
 		}
 	}
 
-	free(buff);
+	alloc_free(buff);
 #endif
 #if (CONFIG_DWT2_MODE == 2)
 	float *buff_y, *buff_x;
 
-	buff_y = malloc( (size_t) (height+4) * 4 * sizeof(float) );
-	buff_x = malloc( (size_t) (width +4) * 4 * sizeof(float) );
+	buff_y = alloc_malloc( (size_t) (height+4) * 4 * sizeof(float) );
+	buff_x = alloc_malloc( (size_t) (width +4) * 4 * sizeof(float) );
 
 	if (NULL == buff_y || NULL == buff_x) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
@@ -733,12 +1000,12 @@ int dwtfloat_encode_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrd
 
 	for (y = 0; y < height/2+2; ++y) {
 		for (x = 0; x < width/2+2; ++x) {
-			dwtfloat_encode_quad(band, height/2, width/2, stride_y, stride_x, buff_y, buff_x, y, x);
+			dwtfloat_encode_quad(band, height/2, width/2, stride_y, stride_x, buff_y + 4*(2*y), buff_x, y, x);
 		}
 	}
 
-	free(buff_x);
-	free(buff_y);
+	alloc_free(buff_x);
+	alloc_free(buff_y);
 #endif
 
 	return RET_SUCCESS;
@@ -763,8 +1030,8 @@ int dwtfloat_decode_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrd
 #if (CONFIG_DWT2_MODE == 2)
 	float *buff_y, *buff_x;
 
-	buff_y = malloc( (size_t) (height+4) * 4 * sizeof(float) );
-	buff_x = malloc( (size_t) (width +4) * 4 * sizeof(float) );
+	buff_y = alloc_malloc( (size_t) (height+4) * 4 * sizeof(float) );
+	buff_x = alloc_malloc( (size_t) (width +4) * 4 * sizeof(float) );
 
 	if (NULL == buff_y || NULL == buff_x) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
@@ -775,133 +1042,332 @@ int dwtfloat_decode_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrd
 
 	for (y = 0; y < height/2+2; ++y) {
 		for (x = 0; x < width/2+2; ++x) {
-			dwtfloat_decode_quad(band, height/2, width/2, stride_y, stride_x, buff_y, buff_x, y, x);
+			dwtfloat_decode_quad(band, height/2, width/2, stride_y, stride_x, buff_y + 4*(2*y), buff_x, y, x, 0);
 		}
 	}
 
-	free(buff_x);
-	free(buff_y);
+	alloc_free(buff_x);
+	alloc_free(buff_y);
 #endif
 
 	return RET_SUCCESS;
 }
+#endif
 
-/* process 8x8 block using multi-scale transform */
-void dwtfloat_encode_block(int *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], float *buff_y[3], float *buff_x[3], ptrdiff_t y, ptrdiff_t x)
+/*
+ * encode quads [y0; y1) x [x0; x1) of one level
+ *
+ * The interior quads are processed by the specialized kernel. The levers and
+ * the bounds are checked only at the borders of the level.
+ */
+static void dwtfloat_encode_quads(coef *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, float *buff_y, float *buff_x, ptrdiff_t y0, ptrdiff_t y1, ptrdiff_t x0, ptrdiff_t x1)
 {
-	ptrdiff_t y_, x_;
+	ptrdiff_t y, x;
 
-	/* j = 0 */
-	for (y_ = y/2-1; y_ < y/2-1+4; ++y_) {
-		for (x_ = x/2-1; x_ < x/2-1+4; ++x_) {
-			dwtfloat_encode_quad(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y_, x_);
+	for (y = y0; y < y1; ++y) {
+		/* the horizontal lifting state of the quad row, see DWT_BUFF_Y_ROWS */
+		float *row;
+
+		if (y < 0)
+			continue;
+
+		row = buff_y + 4*(2*((size_t) y % DWT_BUFF_Y_ROWS));
+		x = x0;
+
+		if (y >= 3 && y < N_y) {
+			/* prologue */
+			for (; x < x1 && x < 3; ++x) {
+				dwtfloat_encode_quad(data, N_y, N_x, stride_y, stride_x, row, buff_x, y, x);
+			}
+			/* interior */
+			for (; x < x1 && x < N_x; ++x) {
+				dwtfloat_encode_quad_interior(data, stride_y, stride_x, row, buff_x, y, x);
+			}
 		}
-	}
-	/* j = 1 */
-	for (y_ = y/4-1; y_ < y/4-1+2; ++y_) {
-		for (x_ = x/4-1; x_ < x/4-1+2; ++x_) {
-			dwtfloat_encode_quad(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y_, x_);
+		/* epilogue, or the whole row at the top and bottom borders */
+		for (; x < x1; ++x) {
+			dwtfloat_encode_quad(data, N_y, N_x, stride_y, stride_x, row, buff_x, y, x);
 		}
 	}
-	/* j = 2 */
-	for (y_ = y/8-1; y_ < y/8-1+1; ++y_) {
-		for (x_ = x/8-1; x_ < x/8-1+1; ++x_) {
-			dwtfloat_encode_quad(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y_, x_);
+}
+
+/* see dwtfloat_encode_quads(), the data holds the quad rows from o_y on */
+static void dwtfloat_decode_quads(coef *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, float *buff_y, float *buff_x, ptrdiff_t y0, ptrdiff_t y1, ptrdiff_t x0, ptrdiff_t x1, ptrdiff_t o_y)
+{
+	ptrdiff_t y, x;
+
+	for (y = y0; y < y1; ++y) {
+		/* the horizontal lifting state of the quad row, see DWT_BUFF_Y_ROWS */
+		float *row;
+
+		if (y < 0)
+			continue;
+
+		row = buff_y + 4*(2*((size_t) y % DWT_BUFF_Y_ROWS));
+		x = x0;
+
+		if (y >= 3 && y < N_y) {
+			/* prologue */
+			for (; x < x1 && x < 3; ++x) {
+				dwtfloat_decode_quad(data, N_y, N_x, stride_y, stride_x, row, buff_x, y, x, o_y);
+			}
+			/* interior */
+			for (; x < x1 && x < N_x; ++x) {
+				dwtfloat_decode_quad_interior(data, stride_y, stride_x, row, buff_x, y, x, o_y);
+			}
+		}
+		/* epilogue, or the whole row at the top and bottom borders */
+		for (; x < x1; ++x) {
+			dwtfloat_decode_quad(data, N_y, N_x, stride_y, stride_x, row, buff_x, y, x, o_y);
 		}
 	}
 }
 
 /* process 8x8 block using multi-scale transform */
-void dwtfloat_decode_block(int *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], float *buff_y[3], float *buff_x[3], ptrdiff_t y, ptrdiff_t x)
+void dwtfloat_encode_block(coef *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], float *buff_y[3], float *buff_x[3], ptrdiff_t y, ptrdiff_t x)
 {
-	ptrdiff_t y_, x_;
+	/* j = 0 */
+	dwtfloat_encode_quads(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y/2-1, y/2-1+4, x/2-1, x/2-1+4);
+	/* j = 1 */
+	dwtfloat_encode_quads(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y/4-1, y/4-1+2, x/4-1, x/4-1+2);
+	/* j = 2 */
+	dwtfloat_encode_quads(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y/8-1, y/8-1+1, x/8-1, x/8-1+1);
+}
 
+/*
+ * process 8x8 block using multi-scale transform
+ *
+ * Only the levels j >= level are reconstructed, 0 for the complete inverse
+ * transform.
+ */
+void dwtfloat_decode_block(coef *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], float *buff_y[3], float *buff_x[3], ptrdiff_t y, ptrdiff_t x, int level)
+{
 	/* j = 2 */
-	for (y_ = y/8; y_ < y/8+1; ++y_) {
-		for (x_ = x/8; x_ < x/8+1; ++x_) {
-			dwtfloat_decode_quad(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y_ - 0, x_ - 0);
-		}
-	}
+	if (level < 3)
+		dwtfloat_decode_quads(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y/8-0, y/8-0+1, x/8-0, x/8-0+1, 0);
 	/* j = 1 */
-	for (y_ = y/4; y_ < y/4+2; ++y_) {
-		for (x_ = x/4; x_ < x/4+2; ++x_) {
-			dwtfloat_decode_quad(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y_ - 3, x_ - 3);
-		}
-	}
+	if (level < 2)
+		dwtfloat_decode_quads(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y/4-3, y/4-3+2, x/4-3, x/4-3+2, 0);
 	/* j = 0 */
-	for (y_ = y/2; y_ < y/2+4; ++y_) {
-		for (x_ = x/2; x_ < x/2+4; ++x_) {
-			dwtfloat_decode_quad(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y_ - 10, x_ - 10);
-		}
-	}
+	if (level < 1)
+		dwtfloat_decode_quads(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y/2-10, y/2-10+4, x/2-10, x/2-10+4, 0);
 }
 
 /* process strip using multi-scale transform */
-void dwtfloat_encode_strip(int *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], float *buff_y[3], float *buff_x[3], ptrdiff_t y)
+void dwtfloat_encode_strip(coef *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], float *buff_y[3], float *buff_x[3], ptrdiff_t y)
 {
-	ptrdiff_t y_, x_;
-
 	/* j = 0 */
-	for (y_ = y/2-1; y_ < y/2-1+4; ++y_) {
-		for (x_ = 0; x_ < width[0]+2; ++x_) {
-			dwtfloat_encode_quad(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y_, x_);
-		}
-	}
+	dwtfloat_encode_quads(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y/2-1, y/2-1+4, 0, width[0]+2);
 	/* j = 1 */
-	for (y_ = y/4-1; y_ < y/4-1+2; ++y_) {
-		for (x_ = 0; x_ < width[1]+2; ++x_) {
-			dwtfloat_encode_quad(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y_, x_);
-		}
-	}
+	dwtfloat_encode_quads(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y/4-1, y/4-1+2, 0, width[1]+2);
+	/* j = 2 */
+	dwtfloat_encode_quads(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y/8-1, y/8-1+1, 0, width[2]+2);
+}
+
+/*
+ * process strip using multi-scale transform
+ *
+ * The data holds the rows of pixels from top on (a multiple of 8).
+ */
+void dwtfloat_decode_strip(coef *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], float *buff_y[3], float *buff_x[3], ptrdiff_t y, int level, ptrdiff_t top)
+{
+	/* 0, 3, 10 .. hexagonal numbers? */
+
 	/* j = 2 */
-	for (y_ = y/8-1; y_ < y/8-1+1; ++y_) {
-		for (x_ = 0; x_ < width[2]+2; ++x_) {
-			dwtfloat_encode_quad(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y_, x_);
+	if (level < 3)
+		dwtfloat_decode_quads(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y/8-0, y/8-0+1, 0, width[2]+2, top >> 3);
+	/* j = 1 */
+	if (level < 2)
+		dwtfloat_decode_quads(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y/4-3, y/4-3+2, 0, width[1]+2, top >> 2);
+	/* j = 0 */
+	if (level < 1)
+		dwtfloat_decode_quads(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y/2-10, y/2-10+4, 0, width[0]+2, top >> 1);
+}
+
+/*
+ * process tile using multi-scale transform
+ *
+ * The tile covers blocks at [y0; y1) x [x0; x1), the coordinates are the same
+ * as for dwtfloat_encode_block(). The tile touches the vertical lifting state
+ * (buff_x) of its own columns only. The horizontal lifting state (buff_y) is
+ * handed over from the tile on the left. Therefore, the tile can be processed
+ * as soon as the tile on the left (covering the same rows) and the tile above
+ * (covering the same columns) have been processed.
+ */
+void dwtfloat_encode_tile(coef *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], float *buff_y[3], float *buff_x[3], ptrdiff_t y0, ptrdiff_t y1, ptrdiff_t x0, ptrdiff_t x1)
+{
+	ptrdiff_t y, x;
+
+	assert( is_multiple8(y0) && is_multiple8(x0) );
+
+	for (y = y0; y < y1; y += 8) {
+		for (x = x0; x < x1; x += 8) {
+			dwtfloat_encode_block(data, stride_y, stride_x, height, width, buff_y, buff_x, y, x);
 		}
 	}
 }
 
-void dwtfloat_decode_strip(int *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], float *buff_y[3], float *buff_x[3], ptrdiff_t y)
+/* see dwtfloat_encode_tile() */
+void dwtfloat_decode_tile(coef *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], float *buff_y[3], float *buff_x[3], ptrdiff_t y0, ptrdiff_t y1, ptrdiff_t x0, ptrdiff_t x1, int level)
 {
-	ptrdiff_t y_, x_;
+	ptrdiff_t y, x;
 
-	/* 0, 3, 10 .. hexagonal numbers? */
+	assert( is_multiple8(y0) && is_multiple8(x0) );
 
-	/* j = 2 */
-	for (y_ = y/8; y_ < y/8+1; ++y_) {
-		for (x_ = 0; x_ < width[2]+2; ++x_) {
-			dwtfloat_decode_quad(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y_ - 0, x_);
+	for (y = y0; y < y1; y += 8) {
+		for (x = x0; x < x1; x += 8) {
+			dwtfloat_decode_block(data, stride_y, stride_x, height, width, buff_y, buff_x, y, x, level);
 		}
 	}
-	/* j = 1 */
-	for (y_ = y/4; y_ < y/4+2; ++y_) {
-		for (x_ = 0; x_ < width[1]+2; ++x_) {
-			dwtfloat_decode_quad(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y_ - 3, x_);
+}
+
+/* reset the horizontal lifting state of the quad rows [n0; n1) of one level, see DWT_BUFF_Y_ROWS */
+static void zero_rows(float *buff_y, ptrdiff_t n0, ptrdiff_t n1)
+{
+	ptrdiff_t n;
+
+	for (n = n0 < 0 ? 0 : n0; n < n1; ++n) {
+		zero(buff_y + 4*(2*((size_t) n % DWT_BUFF_Y_ROWS)), 2 * 4);
+	}
+}
+
+/* reset the horizontal lifting state of the blocks at the rows [y0; y1), see dwtfloat_encode_block() */
+static void encode_zero_rows(float *buff_y[3], ptrdiff_t y0, ptrdiff_t y1)
+{
+	zero_rows(buff_y[0], y0/2-1, y1/2-1);
+	zero_rows(buff_y[1], y0/4-1, y1/4-1);
+	zero_rows(buff_y[2], y0/8-1, y1/8-1);
+}
+
+/* reset the horizontal lifting state of the blocks at the rows [y0; y1), see dwtfloat_decode_block() */
+static void decode_zero_rows(float *buff_y[3], ptrdiff_t y0, ptrdiff_t y1)
+{
+	zero_rows(buff_y[2], y0/8-0, y1/8-0);
+	zero_rows(buff_y[1], y0/4-3, y1/4-3);
+	zero_rows(buff_y[0], y0/2-10, y1/2-10);
+}
+
+/*
+ * forward multi-scale transform of the whole frame in tiles of tile_height x tile_width pixels
+ *
+ * The rows of tiles are processed top to bottom, and the tiles of each row left to right, which
+ * satisfies the dependencies of dwtfloat_encode_tile(). Only one row of tiles is in flight, so its
+ * horizontal lifting state fits into the ring of DWT_BUFF_Y_ROWS quad rows, reset at the start of
+ * each row of tiles. The tile_height is a multiple of 8 up to CONFIG_DWT_TILE_HEIGHT.
+ */
+static void dwtfloat_encode_tiles(coef *data, ptrdiff_t height, ptrdiff_t width, ptrdiff_t stride_y_[3], ptrdiff_t stride_x_[3], ptrdiff_t height_[3], ptrdiff_t width_[3], float *buff_y_[3], float *buff_x_[3], ptrdiff_t tile_height, ptrdiff_t tile_width)
+{
+	ptrdiff_t y, x;
+
+	assert( tile_height > 0 && tile_height <= CONFIG_DWT_TILE_HEIGHT && is_multiple8(tile_height) );
+	assert( tile_width > 0 && is_multiple8(tile_width) );
+
+	for (y = 0; y < height+24; y += tile_height) {
+		ptrdiff_t y1 = y + tile_height < height+24 ? y + tile_height : height+24;
+
+		encode_zero_rows(buff_y_, y, y1);
+
+		for (x = 0; x < width+24; x += tile_width) {
+			ptrdiff_t x1 = x + tile_width < width+24 ? x + tile_width : width+24;
+
+			dwtfloat_encode_tile(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, y1, x, x1);
 		}
 	}
-	/* j = 0 */
-	for (y_ = y/2; y_ < y/2+4; ++y_) {
-		for (x_ = 0; x_ < width[0]+2; ++x_) {
-			dwtfloat_decode_quad(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y_ - 10, x_);
+}
+
+/* see dwtfloat_encode_tiles(), and dwtfloat_decode_block() for the level */
+static void dwtfloat_decode_tiles(coef *data, ptrdiff_t height, ptrdiff_t width, ptrdiff_t stride_y_[3], ptrdiff_t stride_x_[3], ptrdiff_t height_[3], ptrdiff_t width_[3], float *buff_y_[3], float *buff_x_[3], int level, ptrdiff_t tile_height, ptrdiff_t tile_width)
+{
+	ptrdiff_t y, x;
+
+	assert( tile_height > 0 && tile_height <= CONFIG_DWT_TILE_HEIGHT && is_multiple8(tile_height) );
+	assert( tile_width > 0 && is_multiple8(tile_width) );
+
+	for (y = 0; y < height+24; y += tile_height) {
+		ptrdiff_t y1 = y + tile_height < height+24 ? y + tile_height : height+24;
+
+		decode_zero_rows(buff_y_, y, y1);
+
+		for (x = 0; x < width+24; x += tile_width) {
+			ptrdiff_t x1 = x + tile_width < width+24 ? x + tile_width : width+24;
+
+			dwtfloat_decode_tile(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, y1, x, x1, level);
 		}
 	}
 }
 
-int dwtfloat_encode(struct frame *frame)
+/* the levels of the multi-scale transform of 'height' x 'width' pixels, the vertical lifting state is reset */
+static void init_levels(struct dwt *dwt, ptrdiff_t height, ptrdiff_t width, ptrdiff_t height_[3], ptrdiff_t width_[3], ptrdiff_t stride_y_[3], ptrdiff_t stride_x_[3], float *buff_y_[3], float *buff_x_[3])
 {
 	int j;
+
+	for (j = 0; j < 3; ++j) {
+		height_[j] = (height >> j) >> 1;
+		width_ [j] = (width  >> j) >> 1;
+
+		stride_y_[j] = width << j;
+		stride_x_[j] =     1 << j;
+
+		buff_y_[j] = dwt->buff_y[j];
+		buff_x_[j] = dwt->buff_x[j];
+
+		zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 4);
+	}
+}
+
+/* the 'size' coefficients of the frame entering the multi-scale transform, converted into the float plane with CONFIG_DWTFLOAT_MODE 1 */
+static coef *load_coefs(struct dwt *dwt, struct frame *frame, size_t size)
+{
+#if (CONFIG_DWTFLOAT_MODE == 1)
+	if (frame->data16 != NULL) {
+		convert_array16(dwt->data, frame->data16, size);
+	} else {
+		convert_array(dwt->data, frame->data, size);
+	}
+
+	return dwt->data;
+#else
+	(void) dwt;
+	(void) size;
+
+	return frame->data;
+#endif
+}
+
+/* the 'size' coefficients leaving the multi-scale transform, rounded back into the frame with CONFIG_DWTFLOAT_MODE 1 */
+static void store_coefs(struct frame *frame, const coef *coefs, size_t size)
+{
+#if (CONFIG_DWTFLOAT_MODE == 1)
+	if (frame->data16 != NULL) {
+		round_array16(frame->data16, coefs, size);
+	} else {
+		round_array(frame->data, coefs, size);
+	}
+#else
+	(void) frame;
+	(void) coefs;
+	(void) size;
+#endif
+}
+
+int dwtfloat_encode(struct dwt *dwt, struct frame *frame)
+{
 	ptrdiff_t height, width;
-	int *data;
-#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2)
+#if (CONFIG_DWT_MS_MODE == 0)
+	int j;
+#endif
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
 	float *buff_x_[3], *buff_y_[3];
 	ptrdiff_t height_[3], width_[3];
 	ptrdiff_t stride_y_[3], stride_x_[3];
-	ptrdiff_t y;
+	coef *coefs;
 #endif
-#if (CONFIG_DWT_MS_MODE == 2)
-	ptrdiff_t x;
+#if (CONFIG_DWT_MS_MODE == 1)
+	ptrdiff_t y;
 #endif
 
+	assert( dwt );
+
 	assert( frame );
 
 	height = (ptrdiff_t) ceil_multiple8(frame->height);
@@ -909,9 +1375,11 @@ int dwtfloat_encode(struct frame *frame)
 
 	assert( is_multiple8(width) && is_multiple8(height) );
 
-	data = frame->data;
+	assert( frame->data != NULL || frame->data16 != NULL );
 
-	assert( data );
+	if ((size_t) height > dwt->height || (size_t) width > dwt->width) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
 
 	/* (2.2) forward two-dimensional transform */
 
@@ -924,137 +1392,219 @@ int dwtfloat_encode(struct frame *frame)
 		/* stride of input data (for level j) */
 		ptrdiff_t stride_y = width << j, stride_x = 1 << j;
 
-		dwtfloat_encode_band(data, stride_y, stride_x, height_j, width_j);
+		dwtfloat_encode_band(frame->data, stride_y, stride_x, height_j, width_j);
 	}
 #endif
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
+	init_levels(dwt, height, width, height_, width_, stride_y_, stride_x_, buff_y_, buff_x_);
+
+	coefs = load_coefs(dwt, frame, (size_t) (height * width));
+#endif
 #if (CONFIG_DWT_MS_MODE == 1)
-	for (j = 0; j < 3; ++j) {
-		height_[j] = (height >> j) >> 1;
-		width_ [j] = (width  >> j) >> 1;
+	for (y = 0; y < height+24; y += 8) {
+		encode_zero_rows(buff_y_, y, y+8);
 
-		stride_y_[j] = width << j;
-		stride_x_[j] =     1 << j;
+		dwtfloat_encode_strip(coefs, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y);
+	}
+#endif
+#if (CONFIG_DWT_MS_MODE == 2)
+	/* the rows of blocks */
+	dwtfloat_encode_tiles(coefs, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, 8, width+24);
+#endif
+#if (CONFIG_DWT_MS_MODE == 3)
+	dwtfloat_encode_tiles(coefs, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, CONFIG_DWT_TILE_HEIGHT, CONFIG_DWT_TILE_WIDTH);
+#endif
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
+	store_coefs(frame, coefs, (size_t) (height * width));
+#endif
 
-		buff_y_[j] = malloc( (size_t) (2 * height_[j] + (32 >> j) - 2) * 4 * sizeof(float) );
-		buff_x_[j] = malloc( (size_t) (2 * width_ [j] + (32 >> j) - 2) * 4 * sizeof(float) );
+	return RET_SUCCESS;
+}
 
-		if (NULL == buff_y_[j] || NULL == buff_x_[j]) {
-			return RET_FAILURE_MEMORY_ALLOCATION;
-		}
+int dwtfloat_decode_partial(struct dwt *dwt, struct frame *frame, int level)
+{
+	ptrdiff_t height, width;
+#if (CONFIG_DWT_MS_MODE == 0)
+	int j;
+#endif
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
+	float *buff_x_[3], *buff_y_[3];
+	ptrdiff_t height_[3], width_[3];
+	ptrdiff_t stride_y_[3], stride_x_[3];
+	coef *coefs;
+#endif
+#if (CONFIG_DWT_MS_MODE == 1)
+	ptrdiff_t y;
+#endif
 
-		zero(buff_y_[j], (size_t) (2 * height_[j] + (32 >> j) - 2) * 4);
-		zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 4);
-	}
+	assert( dwt );
 
-	for (y = 0; y < height+24; y += 8) {
-		dwtfloat_encode_strip(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y);
-	}
+	assert( frame );
 
-	for (j = 0; j < 3; ++j) {
-		free(buff_y_[j]);
-		free(buff_x_[j]);
+	height = (ptrdiff_t) ceil_multiple8(frame->height);
+	width  = (ptrdiff_t) ceil_multiple8(frame->width);
+
+	assert( is_multiple8(width) && is_multiple8(height) );
+
+	assert( frame->data != NULL || frame->data16 != NULL );
+
+	if ((size_t) height > dwt->height || (size_t) width > dwt->width) {
+		return RET_FAILURE_LOGIC_ERROR;
 	}
-#endif
-#if (CONFIG_DWT_MS_MODE == 2)
-	for (j = 0; j < 3; ++j) {
-		height_[j] = (height >> j) >> 1;
-		width_ [j] = (width  >> j) >> 1;
 
-		stride_y_[j] = width << j;
-		stride_x_[j] =     1 << j;
+	/* inverse two-dimensional transform */
 
-		buff_y_[j] = malloc( (size_t) (2 * height_[j] + (32 >> j) - 2) * 4 * sizeof(float) );
-		buff_x_[j] = malloc( (size_t) (2 * width_ [j] + (32 >> j) - 2) * 4 * sizeof(float) );
+#if (CONFIG_DWT_MS_MODE == 0)
+	for (j = 2; j >= level; --j) {
+		ptrdiff_t height_j = height >> j, width_j = width >> j;
 
-		if (NULL == buff_y_[j] || NULL == buff_x_[j]) {
-			return RET_FAILURE_MEMORY_ALLOCATION;
-		}
+		ptrdiff_t stride_y = width << j, stride_x = 1 << j;
 
-		zero(buff_y_[j], (size_t) (2 * height_[j] + (32 >> j) - 2) * 4);
-		zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 4);
+		dwtfloat_decode_band(frame->data, stride_y, stride_x, height_j, width_j);
 	}
+#endif
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
+	init_levels(dwt, height, width, height_, width_, stride_y_, stride_x_, buff_y_, buff_x_);
 
+	coefs = load_coefs(dwt, frame, (size_t) (height * width));
+#endif
+#if (CONFIG_DWT_MS_MODE == 1)
 	for (y = 0; y < height+24; y += 8) {
-		for (x = 0; x < width+24; x += 8) {
-			dwtfloat_encode_block(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, x);
-		}
-	}
+		decode_zero_rows(buff_y_, y, y+8);
 
-	for (j = 0; j < 3; ++j) {
-		free(buff_y_[j]);
-		free(buff_x_[j]);
+		dwtfloat_decode_strip(coefs, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, level, 0);
 	}
 #endif
+#if (CONFIG_DWT_MS_MODE == 2)
+	/* the rows of blocks */
+	dwtfloat_decode_tiles(coefs, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, level, 8, width+24);
+#endif
+#if (CONFIG_DWT_MS_MODE == 3)
+	dwtfloat_decode_tiles(coefs, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, level, CONFIG_DWT_TILE_HEIGHT, CONFIG_DWT_TILE_WIDTH);
+#endif
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
+	store_coefs(frame, coefs, (size_t) (height * width));
+#endif
 
 	return RET_SUCCESS;
 }
 
-int dwtfloat_decode(struct frame *frame)
+/* whether the tiles of 'tile_height' x 'tile_width' pixels are supported, see dwtfloat_encode_tiles() */
+static int valid_tiles(ptrdiff_t tile_height, ptrdiff_t tile_width)
+{
+	return tile_height > 0 && tile_height <= CONFIG_DWT_TILE_HEIGHT && is_multiple8(tile_height)
+		&& tile_width > 0 && is_multiple8(tile_width);
+}
+
+int dwtfloat_encode_tiled(struct dwt *dwt, struct frame *frame, ptrdiff_t tile_height, ptrdiff_t tile_width)
 {
-	int j;
 	ptrdiff_t height, width;
-	int *data;
-#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2)
 	float *buff_x_[3], *buff_y_[3];
 	ptrdiff_t height_[3], width_[3];
 	ptrdiff_t stride_y_[3], stride_x_[3];
-	ptrdiff_t y;
-#endif
-#if (CONFIG_DWT_MS_MODE == 2)
-	ptrdiff_t x;
-#endif
+	coef *coefs;
+
+	assert( dwt );
 
 	assert( frame );
 
 	height = (ptrdiff_t) ceil_multiple8(frame->height);
 	width  = (ptrdiff_t) ceil_multiple8(frame->width);
 
-	assert( is_multiple8(width) && is_multiple8(height) );
+	assert( frame->data != NULL || frame->data16 != NULL );
 
-	data = frame->data;
+	if ((size_t) height > dwt->height || (size_t) width > dwt->width || !valid_tiles(tile_height, tile_width)) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
 
-	assert( data );
+	init_levels(dwt, height, width, height_, width_, stride_y_, stride_x_, buff_y_, buff_x_);
 
-	/* inverse two-dimensional transform */
+	coefs = load_coefs(dwt, frame, (size_t) (height * width));
 
-#if (CONFIG_DWT_MS_MODE == 0)
-	for (j = 2; j >= 0; --j) {
-		ptrdiff_t height_j = height >> j, width_j = width >> j;
+	dwtfloat_encode_tiles(coefs, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, tile_height, tile_width);
 
-		ptrdiff_t stride_y = width << j, stride_x = 1 << j;
+	store_coefs(frame, coefs, (size_t) (height * width));
+
+	return RET_SUCCESS;
+}
+
+int dwtfloat_decode_tiled(struct dwt *dwt, struct frame *frame, ptrdiff_t tile_height, ptrdiff_t tile_width)
+{
+	ptrdiff_t height, width;
+	float *buff_x_[3], *buff_y_[3];
+	ptrdiff_t height_[3], width_[3];
+	ptrdiff_t stride_y_[3], stride_x_[3];
+	coef *coefs;
+
+	assert( dwt );
+
+	assert( frame );
 
-		dwtfloat_decode_band(data, stride_y, stride_x, height_j, width_j);
+	height = (ptrdiff_t) ceil_multiple8(frame->height);
+	width  = (ptrdiff_t) ceil_multiple8(frame->width);
+
+	assert( frame->data != NULL || frame->data16 != NULL );
+
+	if ((size_t) height > dwt->height || (size_t) width > dwt->width || !valid_tiles(tile_height, tile_width)) {
+		return RET_FAILURE_LOGIC_ERROR;
 	}
+
+	init_levels(dwt, height, width, height_, width_, stride_y_, stride_x_, buff_y_, buff_x_);
+
+	coefs = load_coefs(dwt, frame, (size_t) (height * width));
+
+	dwtfloat_decode_tiles(coefs, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, 0, tile_height, tile_width);
+
+	store_coefs(frame, coefs, (size_t) (height * width));
+
+	return RET_SUCCESS;
+}
+
+int dwtfloat_decode(struct dwt *dwt, struct frame *frame)
+{
+	return dwtfloat_decode_partial(dwt, frame, 0);
+}
+
+int dwtfloat_decode_strips(struct dwt *dwt, struct frame *frame, ptrdiff_t y0, ptrdiff_t y1, ptrdiff_t *top)
+{
+	int j;
+	ptrdiff_t height, width;
+	float *buff_x_[3], *buff_y_[3];
+	ptrdiff_t height_[3], width_[3];
+	ptrdiff_t stride_y_[3], stride_x_[3];
+	ptrdiff_t y;
+	coef *coefs;
+#if (CONFIG_DWTFLOAT_MODE == 1)
+	/* the rows of the float window */
+	ptrdiff_t window;
 #endif
-#if (CONFIG_DWT_MS_MODE == 1)
-	for (j = 0; j < 3; ++j) {
-		height_[j] = (height >> j) >> 1;
-		width_ [j] = (width  >> j) >> 1;
 
-		stride_y_[j] = width << j;
-		stride_x_[j] =     1 << j;
+	assert( dwt );
+
+	assert( frame );
 
-		buff_y_[j] = malloc( (size_t) (2 * height_[j] + (32 >> j) - 2) * 4 * sizeof(float) );
-		buff_x_[j] = malloc( (size_t) (2 * width_ [j] + (32 >> j) - 2) * 4 * sizeof(float) );
+	assert( top );
 
-		if (NULL == buff_y_[j] || NULL == buff_x_[j]) {
-			return RET_FAILURE_MEMORY_ALLOCATION;
-		}
+	assert( is_multiple8(y0) );
 
-		zero(buff_y_[j], (size_t) (2 * height_[j] + (32 >> j) - 2) * 4);
-		zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 4);
-	}
+	height = (ptrdiff_t) ceil_multiple8(frame->height);
+	width  = (ptrdiff_t) ceil_multiple8(frame->width);
 
-	for (y = 0; y < height+24; y += 8) {
-		dwtfloat_decode_strip(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y);
+	assert( frame->data != NULL || frame->data16 != NULL );
+
+	if ((size_t) width > dwt->width) {
+		return RET_FAILURE_LOGIC_ERROR;
 	}
 
-	for (j = 0; j < 3; ++j) {
-		free(buff_y_[j]);
-		free(buff_x_[j]);
+#if (CONFIG_DWTFLOAT_MODE == 1)
+	window = (ptrdiff_t) dwt->height;
+
+	/* the strip touches the rows [y - DWT_STRIP_DELAY; y + 8) */
+	if (window < DWT_STRIP_DELAY + 8 || dwt->data == NULL) {
+		return RET_FAILURE_LOGIC_ERROR;
 	}
 #endif
-#if (CONFIG_DWT_MS_MODE == 2)
+
 	for (j = 0; j < 3; ++j) {
 		height_[j] = (height >> j) >> 1;
 		width_ [j] = (width  >> j) >> 1;
@@ -1062,28 +1612,60 @@ int dwtfloat_decode(struct frame *frame)
 		stride_y_[j] = width << j;
 		stride_x_[j] =     1 << j;
 
-		buff_y_[j] = malloc( (size_t) (2 * height_[j] + (32 >> j) - 2) * 4 * sizeof(float) );
-		buff_x_[j] = malloc( (size_t) (2 * width_ [j] + (32 >> j) - 2) * 4 * sizeof(float) );
+		buff_y_[j] = dwt->buff_y[j];
+		buff_x_[j] = dwt->buff_x[j];
 
-		if (NULL == buff_y_[j] || NULL == buff_x_[j]) {
-			return RET_FAILURE_MEMORY_ALLOCATION;
-		}
-
-		zero(buff_y_[j], (size_t) (2 * height_[j] + (32 >> j) - 2) * 4);
-		zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 4);
+		if (y0 == 0)
+			zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 4);
 	}
 
-	for (y = 0; y < height+24; y += 8) {
-		for (x = 0; x < width+24; x += 8) {
-			dwtfloat_decode_block(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, x);
+	if (y0 == 0)
+		*top = 0;
+
+#if (CONFIG_DWTFLOAT_MODE == 1)
+	coefs = dwt->data;
+#else
+	coefs = frame->data;
+#endif
+
+	for (y = y0; y < y1; y += 8) {
+#if (CONFIG_DWTFLOAT_MODE == 1)
+		/* slide the window down, the rows still needed move to its top */
+		if (y + 8 > *top + window) {
+			ptrdiff_t next = y - DWT_STRIP_DELAY;
+
+			memmove(coefs, coefs + (next - *top) * width, (size_t) ((*top + window - next) * width) * sizeof *coefs);
+
+			*top = next;
 		}
-	}
 
-	for (j = 0; j < 3; ++j) {
-		free(buff_y_[j]);
-		free(buff_x_[j]);
-	}
+		/* the coefficients of the stripe y enter the transform */
+		if (y < height) {
+			ptrdiff_t n = (y - *top) * width;
+
+			if (frame->data16 != NULL) {
+				convert_array16(coefs + n, frame->data16 + y*width, (size_t) (8 * width));
+			} else {
+				convert_array(coefs + n, frame->data + y*width, (size_t) (8 * width));
+			}
+		}
 #endif
+		decode_zero_rows(buff_y_, y, y+8);
+
+		dwtfloat_decode_strip(coefs, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, 0, *top);
+#if (CONFIG_DWTFLOAT_MODE == 1)
+		/* the pixels of the stripe y - DWT_STRIP_DELAY are complete */
+		if (y >= DWT_STRIP_DELAY && y - DWT_STRIP_DELAY < height) {
+			ptrdiff_t n = (y - DWT_STRIP_DELAY) * width;
+
+			if (frame->data16 != NULL) {
+				round_array16(frame->data16 + n, coefs + (n - *top * width), (size_t) (8 * width));
+			} else {
+				round_array(frame->data + n, coefs + (n - *top * width), (size_t) (8 * width));
+			}
+		}
+#endif
+	}
 
 	return RET_SUCCESS;
 }
@@ -6,10 +6,34 @@
 #define DWTFLOAT_H_
 
 #include "frame.h"
+#include "dwt.h"
 #include "common.h"
 
-int dwtfloat_encode(struct frame *frame);
+int dwtfloat_encode(struct dwt *dwt, struct frame *frame);
 
-int dwtfloat_decode(struct frame *frame);
+int dwtfloat_decode(struct dwt *dwt, struct frame *frame);
+
+int dwtfloat_decode_partial(struct dwt *dwt, struct frame *frame, int level);
+
+/**
+ * \brief Forward transform in tiles of \p tile_height x \p tile_width pixels, see dwtint_encode_tiled()
+ */
+int dwtfloat_encode_tiled(struct dwt *dwt, struct frame *frame, ptrdiff_t tile_height, ptrdiff_t tile_width);
+
+/**
+ * \brief Inverse transform in tiles, see dwtint_encode_tiled()
+ */
+int dwtfloat_decode_tiled(struct dwt *dwt, struct frame *frame, ptrdiff_t tile_height, ptrdiff_t tile_width);
+
+/**
+ * \brief Inverse transform of the strips at the rows [\p y0; \p y1), see dwtint_decode_strips()
+ *
+ * With \c CONFIG_DWTFLOAT_MODE 1, the coefficients of each stripe are converted into the float workspace
+ * when the stripe enters the transform, and the pixels are rounded back into the \p frame when complete.
+ * The float plane of the workspace is a window of its \c height rows (at least <tt>DWT_STRIP_DELAY + 8</tt>)
+ * sliding down the frame, the \p top is the first row of the frame held by the window. It is reset at the
+ * row 0 and updated as the window slides.
+ */
+int dwtfloat_decode_strips(struct dwt *dwt, struct frame *frame, ptrdiff_t y0, ptrdiff_t y1, ptrdiff_t *top);
 
 #endif /* DWTFLOAT_H_ */
@@ -2,6 +2,7 @@
 #include "common.h"
 #include "dwt.h"
 #include "dwtint.h"
+#include "alloc.h"
 
 #include <stddef.h>
 #include <assert.h>
@@ -162,6 +163,75 @@ static void dwtint_decode_core(int data[2], int buff[5], int lever)
 	data[1] = c0;
 }
 
+/*
+ * dwtint_encode_core() specialized for lever = 0, i.e., for the interior
+ * of the signal
+ */
+static void dwtint_encode_core_interior(int data[2], int buff[5])
+{
+	int c0 = buff[0];
+	int c1 = buff[1];
+	int c2 = buff[2];
+	int d3 = buff[3];
+	int d4 = buff[4];
+
+	int x0 = data[0];
+	int x1 = data[1];
+
+	d3 = d3 - round_div_pow2(
+		-1*c2 +9*c1 +9*c0 -1*x1,
+		4
+	);
+
+	buff[0] = x1;
+	buff[1] = c0;
+	buff[2] = c1;
+	buff[3] = x0;
+	buff[4] = d3;
+
+	c1 = c1 - round_div_pow2(
+		-1*d4 -1*d3,
+		2
+	);
+
+	data[0] = c1;
+	data[1] = d3;
+}
+
+/*
+ * dwtint_decode_core() specialized for lever = 0
+ */
+static void dwtint_decode_core_interior(int data[2], int buff[5])
+{
+	int c0 = buff[0];
+	int c1 = buff[1];
+	int c2 = buff[2];
+	int d3 = buff[3];
+	int d4 = buff[4];
+
+	int x0 = data[0];
+	int x1 = data[1];
+
+	x0 = x0 + round_div_pow2(
+		-1*d3 -1*x1,
+		2
+	);
+
+	d4 = d4 + round_div_pow2(
+		-1*c2 +9*c1 +9*c0 -1*x0,
+		4
+	);
+
+	buff[0] = x0;
+	buff[1] = c0;
+	buff[2] = c1;
+	buff[3] = x1;
+	buff[4] = d3;
+
+	data[0] = d4;
+	data[1] = c0;
+}
+
 static void encode_adjust_levers(int lever[1], ptrdiff_t n, ptrdiff_t N)
 {
 	lever[0] = 0;
@@ -221,136 +291,79 @@ static void transpose(int core[4])
 	dwtint_decode_core(&core[2], buff_y + 5*(1), lever[1]);
 }
 
-#define signal_defined(n, N) ( (n) >= 0 && (n) < (N) )
-
-void dwtint_encode_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, int *buff_y, int *buff_x, ptrdiff_t n_y, ptrdiff_t n_x)
+static void dwtint_encode_core2_interior(int core[4], int *buff_y, int *buff_x)
 {
-	/* vertical lever at [0], horizontal at [1] */
-	int lever[2];
-	/* order on input: 0=HH, 1=LH, 2=HH, 3=LL */
-	int core[4];
-
-	/* we cannot access buff_x[] and buff_y[] at negative indices */
-	if ( n_y < 0 || n_x < 0 )
-		return;
-
-	encode_adjust_levers(lever+0, n_y, N_y);
-	encode_adjust_levers(lever+1, n_x, N_x);
-
-#	define cc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
-#	define dc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
-#	define cd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
-#	define dd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
-
-	core[0] = signal_defined(n_y-1, N_y) && signal_defined(n_x-1, N_x) ? (int) dd(n_y-1, n_x-1) : 0; /* HH */
-	core[1] = signal_defined(n_y-1, N_y) && signal_defined(n_x-0, N_x) ? (int) cd(n_y-1, n_x-0) : 0; /* LH */
-	core[2] = signal_defined(n_y-0, N_y) && signal_defined(n_x-1, N_x) ? (int) dc(n_y-0, n_x-1) : 0; /* HL */
-	core[3] = signal_defined(n_y-0, N_y) && signal_defined(n_x-0, N_x) ? (int) cc(n_y-0, n_x-0) : 0; /* LL */
-
-	dwtint_encode_core2(core, buff_y + 5*(2*n_y+0), buff_x + 5*(2*n_x+0), lever);
-
-	if (signal_defined(n_y-2, N_y) && signal_defined(n_x-2, N_x)) {
-		cc(n_y-2, n_x-2) = ( core[0] ); /* LL */
-		dc(n_y-2, n_x-2) = ( core[1] ); /* HL */
-		cd(n_y-2, n_x-2) = ( core[2] ); /* LH */
-		dd(n_y-2, n_x-2) = ( core[3] ); /* HH */
-	}
-
-#	undef cc
-#	undef dc
-#	undef cd
-#	undef dd
+	/* horizontal filtering */
+	dwtint_encode_core_interior(&core[0], buff_y + 5*(0));
+	dwtint_encode_core_interior(&core[2], buff_y + 5*(1));
+	transpose(core);
+	/* vertical filtering */
+	dwtint_encode_core_interior(&core[0], buff_x + 5*(0));
+	dwtint_encode_core_interior(&core[2], buff_x + 5*(1));
+	transpose(core);
 }
 
-void dwtint_weight_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrdiff_t n_y, ptrdiff_t n_x, const int weight[4])
+static void dwtint_decode_core2_interior(int core[4], int *buff_y, int *buff_x)
 {
-#	define cc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
-#	define dc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
-#	define cd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
-#	define dd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
-
-	if (signal_defined(n_y-2, N_y) && signal_defined(n_x-2, N_x)) {
-		cc(n_y-2, n_x-2) <<= weight[0]; /* LL */
-		dc(n_y-2, n_x-2) <<= weight[1]; /* HL */
-		cd(n_y-2, n_x-2) <<= weight[2]; /* LH */
-		dd(n_y-2, n_x-2) <<= weight[3]; /* HH */
-	}
-
-#	undef cc
-#	undef dc
-#	undef cd
-#	undef dd
+	transpose(core);
+	/* vertical filtering */
+	dwtint_decode_core_interior(&core[0], buff_x + 5*(0));
+	dwtint_decode_core_interior(&core[2], buff_x + 5*(1));
+	transpose(core);
+	/* horizontal filtering */
+	dwtint_decode_core_interior(&core[0], buff_y + 5*(0));
+	dwtint_decode_core_interior(&core[2], buff_y + 5*(1));
 }
 
-void dwtint_decode_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, int *buff_y, int *buff_x, ptrdiff_t n_y, ptrdiff_t n_x)
+#define signal_defined(n, N) ( (n) >= 0 && (n) < (N) )
+
+/* reset the horizontal lifting state of the quad rows [n0; n1) of one level, see DWT_BUFF_Y_ROWS */
+static void zero_rows(int *buff_y, ptrdiff_t n0, ptrdiff_t n1)
 {
-	/* vertical lever at [0], horizontal at [1] */
-	int lever[2];
-	/* order on input: 0=LL, 1=HL, 2=LH, 3=HH */
-	int core[4];
-
-	/* we cannot access buff_x[] and buff_y[] at negative indices */
-	if ( n_y < 0 || n_x < 0 )
-		return;
-
-	decode_adjust_levers(lever+0, n_y, N_y);
-	decode_adjust_levers(lever+1, n_x, N_x);
-
-#	define cc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
-#	define dc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
-#	define cd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
-#	define dd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
-
-	if ( signal_defined(n_y-0, N_y) && signal_defined(n_x-0, N_x) ) {
-		core[0] = (int) cc(n_y, n_x); /* LL */
-		core[1] = (int) dc(n_y, n_x); /* HL */
-		core[2] = (int) cd(n_y, n_x); /* LH */
-		core[3] = (int) dd(n_y, n_x); /* HH */
-	} else {
-		core[0] = 0;
-		core[1] = 0;
-		core[2] = 0;
-		core[3] = 0;
-	}
+	ptrdiff_t n;
 
-	dwtint_decode_core2(core, buff_y + 5*(2*n_y+0), buff_x + 5*(2*n_x+0), lever);
-
-	if ( signal_defined(n_y-1, N_y) && signal_defined(n_x-1, N_x) )
-		cc(n_y-1, n_x-1) = ( core[3] ); /* LL */
-	if ( signal_defined(n_y-1, N_y) && signal_defined(n_x-2, N_x) )
-		dc(n_y-1, n_x-2) = ( core[2] ); /* HL */
-	if ( signal_defined(n_y-2, N_y) && signal_defined(n_x-1, N_x) )
-		cd(n_y-2, n_x-1) = ( core[1] ); /* LH */
-	if ( signal_defined(n_y-2, N_y) && signal_defined(n_x-2, N_x) )
-		dd(n_y-2, n_x-2) = ( core[0] ); /* HH */
-
-#	undef cc
-#	undef dc
-#	undef cd
-#	undef dd
+	for (n = n0 < 0 ? 0 : n0; n < n1; ++n) {
+		zero(buff_y + 5*(2*((size_t) n % DWT_BUFF_Y_ROWS)), 2 * 5);
+	}
 }
 
-void dwtint_unweight_quad(int *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrdiff_t n_y, ptrdiff_t n_x, const int weight[4])
+/* reset the horizontal lifting state of the blocks at the rows [y0; y1), see dwtint_encode_block() */
+static void encode_zero_rows(int *buff_y[3], ptrdiff_t y0, ptrdiff_t y1)
 {
-#	define cc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
-#	define dc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
-#	define cd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
-#	define dd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
-
-	if ( signal_defined(n_y-0, N_y) && signal_defined(n_x-0, N_x) ) {
-		cc(n_y, n_x) >>= weight[0]; /* LL */
-		dc(n_y, n_x) >>= weight[1]; /* HL */
-		cd(n_y, n_x) >>= weight[2]; /* LH */
-		dd(n_y, n_x) >>= weight[3]; /* HH */
-	}
+	zero_rows(buff_y[0], y0/2-1, y1/2-1);
+	zero_rows(buff_y[1], y0/4-1, y1/4-1);
+	zero_rows(buff_y[2], y0/8-1, y1/8-1);
+}
 
-#	undef cc
-#	undef dc
-#	undef cd
-#	undef dd
+/* reset the horizontal lifting state of the blocks at the rows [y0; y1), see dwtint_decode_block() */
+static void decode_zero_rows(int *buff_y[3], ptrdiff_t y0, ptrdiff_t y1)
+{
+	zero_rows(buff_y[2], y0/8-0, y1/8-0);
+	zero_rows(buff_y[1], y0/4-3, y1/4-3);
+	zero_rows(buff_y[0], y0/2-10, y1/2-10);
 }
 
-void dwtint_encode_line_segment(int *line, ptrdiff_t size, ptrdiff_t stride, int *buff, ptrdiff_t n0, ptrdiff_t n1)
+/*
+ * The multi-scale kernels for the frames stored in int (see struct frame) and
+ * in 16-bit integers. The latter functions have the suffix 16.
+ */
+#define DATA_T int
+#define FN(name) name
+#include "dwtint_ms.h"
+#undef DATA_T
+#undef FN
+
+#define DATA_T short
+#define FN(name) name##16
+#include "dwtint_ms.h"
+#undef DATA_T
+#undef FN
+
+/*
+ * The weight[0] and weight[1] are the subband weights of the low-pass and
+ * high-pass outputs.
+ */
+void dwtint_encode_line_segment(int *line, ptrdiff_t size, ptrdiff_t stride, int *buff, ptrdiff_t n0, ptrdiff_t n1, const int weight[2])
 {
 	ptrdiff_t n, N;
 	int data[2];
@@ -385,18 +398,16 @@ void dwtint_encode_line_segment(int *line, ptrdiff_t size, ptrdiff_t stride, int
 		data[0] = (int) d(n-1);
 		data[1] = (int) c(n);
 		dwtint_encode_core(data, buff, lever); /* 0 */
-		c(n-2) = ( data[0] );
-		d(n-2) = ( data[1] );
+		c(n-2) = ( data[0] << weight[0] );
+		d(n-2) = ( data[1] << weight[1] );
 	}
 	/* regular */
 	for (; n < n1 && n < N; n++) {
-		int lever = 0;
-
 		data[0] = (int) d(n-1);
 		data[1] = (int) c(n);
-		dwtint_encode_core(data, buff, lever); /* j */
-		c(n-2) = ( data[0] );
-		d(n-2) = ( data[1] );
+		dwtint_encode_core_interior(data, buff); /* j */
+		c(n-2) = ( data[0] << weight[0] );
+		d(n-2) = ( data[1] << weight[1] );
 	}
 	/* epilogue */
 	for (; n < n1 && n == N; n++) {
@@ -405,8 +416,8 @@ void dwtint_encode_line_segment(int *line, ptrdiff_t size, ptrdiff_t stride, int
 		data[0] = (int) d(n-1);
 		data[1] = 0;
 		dwtint_encode_core(data, buff, lever); /* N-2 */
-		c(n-2) = ( data[0] );
-		d(n-2) = ( data[1] );
+		c(n-2) = ( data[0] << weight[0] );
+		d(n-2) = ( data[1] << weight[1] );
 	}
 	for (; n < n1 && n == N+1; n++) {
 		int lever = +2;
@@ -414,15 +425,16 @@ void dwtint_encode_line_segment(int *line, ptrdiff_t size, ptrdiff_t stride, int
 		data[0] = 0;
 		data[1] = 0;
 		dwtint_encode_core(data, buff, lever); /* N-1 */
-		c(n-2) = ( data[0] );
-		d(n-2) = ( data[1] );
+		c(n-2) = ( data[0] << weight[0] );
+		d(n-2) = ( data[1] << weight[1] );
 	}
 
 #undef c
 #undef d
 }
 
-int dwtint_encode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
+/* see dwtint_encode_line_segment() */
+int dwtint_encode_line(int *line, ptrdiff_t size, ptrdiff_t stride, const int weight[2])
 {
 #if (CONFIG_DWT1_MODE == 2)
 	ptrdiff_t N;
@@ -432,7 +444,7 @@ int dwtint_encode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
 
 	N = size / 2;
 
-	dwtint_encode_line_segment(line, size, stride, buff, 0, N+2);
+	dwtint_encode_line_segment(line, size, stride, buff, 0, N+2, weight);
 
 	return RET_SUCCESS;
 #endif
@@ -475,13 +487,21 @@ int dwtint_encode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
 
 	c(0) = c(0) - round_div_pow2(-d(0), 1);
 
+	c(0) <<= weight[0];
+
 	for (n = 1; n <= N-1; ++n) {
 		c(n) = c(n) - round_div_pow2(
 			-1*d(n-1) -1*d(n),
 			2
 		);
+
+		/* c(n) and d(n-1) are final */
+		c(n) <<= weight[0];
+		d(n-1) <<= weight[1];
 	}
 
+	d(N-1) <<= weight[1];
+
 #undef c
 #undef d
 
@@ -489,7 +509,8 @@ int dwtint_encode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
 #endif
 }
 
-int dwtint_decode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
+/* see dwtint_encode_line_segment() */
+int dwtint_decode_line(int *line, ptrdiff_t size, ptrdiff_t stride, const int weight[2])
 {
 	ptrdiff_t n, N;
 
@@ -504,10 +525,14 @@ int dwtint_decode_line(int *line, ptrdiff_t size, ptrdiff_t stride)
 
 	/* inverse lifting */
 
-	c(0) = c(0) + round_div_pow2(-d(0), 1);
+	d(0) >>= weight[1];
+
+	c(0) = (c(0) >> weight[0]) + round_div_pow2(-d(0), 1);
 
 	for (n = 1; n <= N-1; ++n) {
-		c(n) = c(n) + round_div_pow2(
+		d(n) >>= weight[1];
+
+		c(n) = (c(n) >> weight[0]) + round_div_pow2(
 			-1*d(n-1) -1*d(n),
 			2
 		);
@@ -546,26 +571,38 @@ int dwtint_encode_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrdif
 	ptrdiff_t y, x;
 
 #if (CONFIG_DWT2_MODE == 0)
+	int weight_row[2], weight_col[2][2];
+
+	weight_row[0] = 0;
+	weight_row[1] = 0;
+
+	/* weights of LL and LH */
+	weight_col[0][0] = weight[0];
+	weight_col[0][1] = weight[2];
+	/* weights of HL and HH */
+	weight_col[1][0] = weight[1];
+	weight_col[1][1] = weight[3];
+
 	/* for each row */
 	for (y = 0; y < height; ++y) {
 		/* invoke one-dimensional transform */
-		dwtint_encode_line(band + y*stride_y, width, stride_x);
+		dwtint_encode_line(band + y*stride_y, width, stride_x, weight_row);
 	}
-	/* for each column */
+	/* for each column, L columns at even indices, H columns at odd indices */
 	for (x = 0; x < width; ++x) {
 		/* invoke one-dimensional transform */
-		dwtint_encode_line(band + x*stride_x, height, stride_y);
+		dwtint_encode_line(band + x*stride_x, height, stride_y, weight_col[x&1]);
 	}
 #endif
 #if (CONFIG_DWT2_MODE == 2)
 	int *buff_y, *buff_x;
 
-	buff_y = malloc( (size_t) (height+4) * 5 * sizeof(int) );
-	buff_x = malloc( (size_t) (width +4) * 5 * sizeof(int) );
+	buff_y = alloc_malloc( (size_t) (height+4) * 5 * sizeof(int) );
+	buff_x = alloc_malloc( (size_t) (width +4) * 5 * sizeof(int) );
 
 	if (NULL == buff_y || NULL == buff_x) {
-		free(buff_x);
-		free(buff_y);
+		alloc_free(buff_x);
+		alloc_free(buff_y);
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
@@ -574,14 +611,12 @@ int dwtint_encode_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrdif
 
 	for (y = 0; y < height/2+2; ++y) {
 		for (x = 0; x < width/2+2; ++x) {
-			dwtint_encode_quad(band, height/2, width/2, stride_y, stride_x, buff_y, buff_x, y, x);
-
-			dwtint_weight_quad(band, height/2, width/2, stride_y, stride_x, y, x, weight);
+			dwtint_encode_quad(band, height/2, width/2, stride_y, stride_x, buff_y + 5*(2*y), buff_x, y, x, weight);
 		}
 	}
 
-	free(buff_x);
-	free(buff_y);
+	alloc_free(buff_x);
+	alloc_free(buff_y);
 #endif
 
 	return RET_SUCCESS;
@@ -592,26 +627,38 @@ int dwtint_decode_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrdif
 	ptrdiff_t y, x;
 
 #if (CONFIG_DWT2_MODE == 0) || (CONFIG_DWT2_MODE == 1)
-	/* for each column */
+	int weight_row[2], weight_col[2][2];
+
+	weight_row[0] = 0;
+	weight_row[1] = 0;
+
+	/* weights of LL and LH */
+	weight_col[0][0] = weight[0];
+	weight_col[0][1] = weight[2];
+	/* weights of HL and HH */
+	weight_col[1][0] = weight[1];
+	weight_col[1][1] = weight[3];
+
+	/* for each column, L columns at even indices, H columns at odd indices */
 	for (x = 0; x < width; ++x) {
 		/* invoke one-dimensional transform */
-		dwtint_decode_line(band + x*stride_x, height, stride_y);
+		dwtint_decode_line(band + x*stride_x, height, stride_y, weight_col[x&1]);
 	}
 	/* for each row */
 	for (y = 0; y < height; ++y) {
 		/* invoke one-dimensional transform */
-		dwtint_decode_line(band + y*stride_y, width, stride_x);
+		dwtint_decode_line(band + y*stride_y, width, stride_x, weight_row);
 	}
 #endif
 #if (CONFIG_DWT2_MODE == 2)
 	int *buff_y, *buff_x;
 
-	buff_y = malloc( (size_t) (height+4) * 5 * sizeof(int) );
-	buff_x = malloc( (size_t) (width +4) * 5 * sizeof(int) );
+	buff_y = alloc_malloc( (size_t) (height+4) * 5 * sizeof(int) );
+	buff_x = alloc_malloc( (size_t) (width +4) * 5 * sizeof(int) );
 
 	if (NULL == buff_y || NULL == buff_x) {
-		free(buff_x);
-		free(buff_y);
+		alloc_free(buff_x);
+		alloc_free(buff_y);
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
@@ -620,188 +667,109 @@ int dwtint_decode_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrdif
 
 	for (y = 0; y < height/2+2; ++y) {
 		for (x = 0; x < width/2+2; ++x) {
-			dwtint_unweight_quad(band, height/2, width/2, stride_y, stride_x, y, x, weight);
-
-			dwtint_decode_quad(band, height/2, width/2, stride_y, stride_x, buff_y, buff_x, y, x);
+			dwtint_decode_quad(band, height/2, width/2, stride_y, stride_x, buff_y + 5*(2*y), buff_x, y, x, weight);
 		}
 	}
 
-	free(buff_x);
-	free(buff_y);
+	alloc_free(buff_x);
+	alloc_free(buff_y);
 #endif
 
 	return RET_SUCCESS;
 }
 
-void dwtint_weight_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrdiff_t height, ptrdiff_t width, int weight)
-{
-	ptrdiff_t y, x;
-
-	assert(band);
-
-	for (y = 0; y < height; ++y) {
-		int *line = band + y*stride_y;
-
-		for (x = 0; x < width; ++x) {
-			line[stride_x*x] <<= weight;
-		}
-	}
-}
-
-void dwtint_unweight_band(int *band, ptrdiff_t stride_y, ptrdiff_t stride_x, ptrdiff_t height, ptrdiff_t width, int weight)
+/* the levels of the multi-scale transform of 'height' x 'width' pixels, the vertical lifting state is reset */
+static void init_levels(struct dwt *dwt, ptrdiff_t height, ptrdiff_t width, ptrdiff_t height_[3], ptrdiff_t width_[3], ptrdiff_t stride_y_[3], ptrdiff_t stride_x_[3], int *buff_y_[3], int *buff_x_[3])
 {
-	ptrdiff_t y, x;
-
-	assert(band);
-
-	for (y = 0; y < height; ++y) {
-		int *line = band + y*stride_y;
-
-		for (x = 0; x < width; ++x) {
-			line[stride_x*x] >>= weight;
-		}
-	}
-}
-
-/* process 8x8 block using multi-scale transform */
-void dwtint_encode_block(int *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], int *buff_y[3], int *buff_x[3], ptrdiff_t y, ptrdiff_t x, const int weight[12])
-{
-	ptrdiff_t y_, x_;
+	int j;
 
-	/* j = 0 */
-	for (y_ = y/2-1; y_ < y/2-1+4; ++y_) {
-		for (x_ = x/2-1; x_ < x/2-1+4; ++x_) {
-			dwtint_encode_quad(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y_, x_);
+	for (j = 0; j < 3; ++j) {
+		height_[j] = (height >> j) >> 1;
+		width_ [j] = (width  >> j) >> 1;
 
-			dwtint_weight_quad(data, height[0], width[0], stride_y[0], stride_x[0], y_, x_, weight + 4*0);
-		}
-	}
-	/* j = 1 */
-	for (y_ = y/4-1; y_ < y/4-1+2; ++y_) {
-		for (x_ = x/4-1; x_ < x/4-1+2; ++x_) {
-			dwtint_encode_quad(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y_, x_);
+		stride_y_[j] = width << j;
+		stride_x_[j] =     1 << j;
 
-			dwtint_weight_quad(data, height[1], width[1], stride_y[1], stride_x[1], y_, x_, weight + 4*1);
-		}
-	}
-	/* j = 2 */
-	for (y_ = y/8-1; y_ < y/8-1+1; ++y_) {
-		for (x_ = x/8-1; x_ < x/8-1+1; ++x_) {
-			dwtint_encode_quad(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y_, x_);
+		buff_y_[j] = dwt->buff_y[j];
+		buff_x_[j] = dwt->buff_x[j];
 
-			dwtint_weight_quad(data, height[2], width[2], stride_y[2], stride_x[2], y_, x_, weight + 4*2);
-		}
+		zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 5);
 	}
 }
 
-/* process 8x8 block using multi-scale transform */
-void dwtint_decode_block(int *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], int *buff_y[3], int *buff_x[3], ptrdiff_t y, ptrdiff_t x, const int weight[12])
+int dwtint_encode(struct dwt *dwt, struct frame *frame, const int weight[12])
 {
-	ptrdiff_t y_, x_;
-
-	/* j = 2 */
-	for (y_ = y/8; y_ < y/8+1; ++y_) {
-		for (x_ = x/8; x_ < x/8+1; ++x_) {
-			dwtint_unweight_quad(data, height[2], width[2], stride_y[2], stride_x[2], y_ - 0, x_ - 0, weight + 4*2);
+	ptrdiff_t height, width;
+	int *data;
+#if (CONFIG_DWT_MS_MODE == 0)
+	int j;
+#endif
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
+	int *buff_x_[3], *buff_y_[3];
+	ptrdiff_t height_[3], width_[3];
+	ptrdiff_t stride_y_[3], stride_x_[3];
+#endif
+	assert(dwt);
 
-			dwtint_decode_quad(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y_ - 0, x_ - 0);
-		}
-	}
-	/* j = 1 */
-	for (y_ = y/4; y_ < y/4+2; ++y_) {
-		for (x_ = x/4; x_ < x/4+2; ++x_) {
-			dwtint_unweight_quad(data, height[1], width[1], stride_y[1], stride_x[1], y_ - 3, x_ - 3, weight + 4*1);
+	assert(frame);
 
-			dwtint_decode_quad(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y_ - 3, x_ - 3);
-		}
-	}
-	/* j = 0 */
-	for (y_ = y/2; y_ < y/2+4; ++y_) {
-		for (x_ = x/2; x_ < x/2+4; ++x_) {
-			dwtint_unweight_quad(data, height[0], width[0], stride_y[0], stride_x[0], y_ - 10, x_ - 10, weight + 4*0);
+	assert(weight);
 
-			dwtint_decode_quad(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y_ - 10, x_ - 10);
-		}
-	}
-}
+	height = (ptrdiff_t) ceil_multiple8(frame->height);
+	width  = (ptrdiff_t) ceil_multiple8(frame->width);
 
-/* process strip using multi-scale transform */
-void dwtint_encode_strip(int *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], int *buff_y[3], int *buff_x[3], ptrdiff_t y, const int weight[12])
-{
-	ptrdiff_t y_, x_;
+	assert(is_multiple8(width) && is_multiple8(height));
 
-	/* j = 0 */
-	for (y_ = y/2-1; y_ < y/2-1+4; ++y_) {
-		for (x_ = 0; x_ < width[0]+2; ++x_) {
-			dwtint_encode_quad(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y_, x_);
+	data = frame->data;
 
-			dwtint_weight_quad(data, height[0], width[0], stride_y[0], stride_x[0], y_, x_, weight + 4*0);
-		}
-	}
-	/* j = 1 */
-	for (y_ = y/4-1; y_ < y/4-1+2; ++y_) {
-		for (x_ = 0; x_ < width[1]+2; ++x_) {
-			dwtint_encode_quad(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y_, x_);
+	assert(data != NULL || frame->data16 != NULL);
 
-			dwtint_weight_quad(data, height[1], width[1], stride_y[1], stride_x[1], y_, x_, weight + 4*1);
-		}
+	if ((size_t) height > dwt->height || (size_t) width > dwt->width) {
+		return RET_FAILURE_LOGIC_ERROR;
 	}
-	/* j = 2 */
-	for (y_ = y/8-1; y_ < y/8-1+1; ++y_) {
-		for (x_ = 0; x_ < width[2]+2; ++x_) {
-			dwtint_encode_quad(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y_, x_);
 
-			dwtint_weight_quad(data, height[2], width[2], stride_y[2], stride_x[2], y_, x_, weight + 4*2);
-		}
-	}
-}
-
-void dwtint_decode_strip(int *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], int *buff_y[3], int *buff_x[3], ptrdiff_t y, const int weight[12])
-{
-	ptrdiff_t y_, x_;
+	/* (2.2) forward two-dimensional transform */
 
-	/* 0, 3, 10 .. hexagonal numbers? */
+#if (CONFIG_DWT_MS_MODE == 0)
+	/* for each level */
+	for (j = 0; j < 3; ++j) {
+		/* number of elements for input */
+		ptrdiff_t height_j = height >> j, width_j = width >> j;
 
-	/* j = 2 */
-	for (y_ = y/8; y_ < y/8+1; ++y_) {
-		for (x_ = 0; x_ < width[2]+2; ++x_) {
-			dwtint_unweight_quad(data, height[2], width[2], stride_y[2], stride_x[2], y_ - 0, x_, weight + 4*2);
+		/* stride of input data (for level j) */
+		ptrdiff_t stride_y = width << j, stride_x = 1 << j;
 
-			dwtint_decode_quad(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y_ - 0, x_);
-		}
+		dwtint_encode_band(data, stride_y, stride_x, height_j, width_j, weight + 4*j);
 	}
-	/* j = 1 */
-	for (y_ = y/4; y_ < y/4+2; ++y_) {
-		for (x_ = 0; x_ < width[1]+2; ++x_) {
-			dwtint_unweight_quad(data, height[1], width[1], stride_y[1], stride_x[1], y_ - 3, x_, weight + 4*1);
+#endif
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
+	init_levels(dwt, height, width, height_, width_, stride_y_, stride_x_, buff_y_, buff_x_);
 
-			dwtint_decode_quad(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y_ - 3, x_);
-		}
+	if (frame->data16 != NULL) {
+		dwtint_encode_levels16(frame->data16, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight);
+	} else {
+		dwtint_encode_levels(data, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight);
 	}
-	/* j = 0 */
-	for (y_ = y/2; y_ < y/2+4; ++y_) {
-		for (x_ = 0; x_ < width[0]+2; ++x_) {
-			dwtint_unweight_quad(data, height[0], width[0], stride_y[0], stride_x[0], y_ - 10, x_, weight + 4*0);
+#endif
 
-			dwtint_decode_quad(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y_ - 10, x_);
-		}
-	}
+	return RET_SUCCESS;
 }
 
-int dwtint_encode(struct frame *frame, const int weight[12])
+int dwtint_decode_partial(struct dwt *dwt, struct frame *frame, const int weight[12], int level)
 {
-	int j;
 	ptrdiff_t height, width;
 	int *data;
-#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2)
+#if (CONFIG_DWT_MS_MODE == 0)
+	int j;
+#endif
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
 	int *buff_x_[3], *buff_y_[3];
 	ptrdiff_t height_[3], width_[3];
 	ptrdiff_t stride_y_[3], stride_x_[3];
-	ptrdiff_t y;
-#endif
-#if (CONFIG_DWT_MS_MODE == 2)
-	ptrdiff_t x;
 #endif
+
+	assert(dwt);
+
 	assert(frame);
 
 	assert(weight);
@@ -813,122 +781,84 @@ int dwtint_encode(struct frame *frame, const int weight[12])
 
 	data = frame->data;
 
-	assert(data);
+	assert(data != NULL || frame->data16 != NULL);
 
-	/* (2.2) forward two-dimensional transform */
+	if ((size_t) height > dwt->height || (size_t) width > dwt->width) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	/* inverse two-dimensional transform */
 
 #if (CONFIG_DWT_MS_MODE == 0)
-	/* for each level */
-	for (j = 0; j < 3; ++j) {
-		/* number of elements for input */
+	for (j = 2; j >= level; --j) {
 		ptrdiff_t height_j = height >> j, width_j = width >> j;
 
-		/* stride of input data (for level j) */
 		ptrdiff_t stride_y = width << j, stride_x = 1 << j;
 
-		dwtint_encode_band(data, stride_y, stride_x, height_j, width_j, weight + 4*j);
+		dwtint_decode_band(data, stride_y, stride_x, height_j, width_j, weight + 4*j);
 	}
 #endif
-#if (CONFIG_DWT_MS_MODE == 1)
-	for (j = 0; j < 3; ++j) {
-		height_[j] = (height >> j) >> 1;
-		width_ [j] = (width  >> j) >> 1;
-
-		stride_y_[j] = width << j;
-		stride_x_[j] =     1 << j;
-
-		buff_y_[j] = malloc( (size_t) (2 * height_[j] + (32 >> j) - 2) * 5 * sizeof(int) );
-		buff_x_[j] = malloc( (size_t) (2 * width_ [j] + (32 >> j) - 2) * 5 * sizeof(int) );
-
-		if (NULL == buff_y_[j] || NULL == buff_x_[j]) {
-			return RET_FAILURE_MEMORY_ALLOCATION;
-		}
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
+	init_levels(dwt, height, width, height_, width_, stride_y_, stride_x_, buff_y_, buff_x_);
 
-		zero(buff_y_[j], (size_t) (2 * height_[j] + (32 >> j) - 2) * 5);
-		zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 5);
-	}
-
-	for (y = 0; y < height+24; y += 8) {
-		dwtint_encode_strip(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, weight);
-	}
-
-	for (j = 0; j < 3; ++j) {
-		free(buff_y_[j]);
-		free(buff_x_[j]);
+	if (frame->data16 != NULL) {
+		dwtint_decode_levels16(frame->data16, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight, level);
+	} else {
+		dwtint_decode_levels(data, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight, level);
 	}
 #endif
-#if (CONFIG_DWT_MS_MODE == 2)
-	for (j = 0; j < 3; ++j) {
-		height_[j] = (height >> j) >> 1;
-		width_ [j] = (width  >> j) >> 1;
-
-		stride_y_[j] = width << j;
-		stride_x_[j] =     1 << j;
-
-		buff_y_[j] = malloc( (size_t) (2 * height_[j] + (32 >> j) - 2) * 5 * sizeof(int) );
-		buff_x_[j] = malloc( (size_t) (2 * width_ [j] + (32 >> j) - 2) * 5 * sizeof(int) );
 
-		if (NULL == buff_y_[j] || NULL == buff_x_[j]) {
-			return RET_FAILURE_MEMORY_ALLOCATION;
-		}
+	return RET_SUCCESS;
+}
 
-		zero(buff_y_[j], (size_t) (2 * height_[j] + (32 >> j) - 2) * 5);
-		zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 5);
-	}
+/* whether the tiles of 'tile_height' x 'tile_width' pixels are supported, see dwtint_encode_tiles() */
+static int valid_tiles(ptrdiff_t tile_height, ptrdiff_t tile_width)
+{
+	return tile_height > 0 && tile_height <= CONFIG_DWT_TILE_HEIGHT && is_multiple8(tile_height)
+		&& tile_width > 0 && is_multiple8(tile_width);
+}
 
-	for (y = 0; y < height+24; y += 8) {
-		for (x = 0; x < width+24; x += 8) {
-			dwtint_encode_block(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, x, weight);
-		}
-	}
+int dwtint_encode_tiled(struct dwt *dwt, struct frame *frame, const int weight[12], ptrdiff_t tile_height, ptrdiff_t tile_width)
+{
+	ptrdiff_t height, width;
+	int *buff_x_[3], *buff_y_[3];
+	ptrdiff_t height_[3], width_[3];
+	ptrdiff_t stride_y_[3], stride_x_[3];
 
-	for (j = 0; j < 3; ++j) {
-		free(buff_y_[j]);
-		free(buff_x_[j]);
-	}
-#endif
+	assert(dwt);
 
-	/* (2.3) apply Subband Weights */
+	assert(frame);
 
-#if (CONFIG_DWT_MS_MODE == 0) && (CONFIG_DWT2_MODE == 0)
-	for (j = 1; j < 4; ++j) {
-		ptrdiff_t height_j = height >> j, width_j = width >> j;
+	assert(weight);
 
-		ptrdiff_t stride_y = width << j, stride_x = 1 << j;
+	height = (ptrdiff_t) ceil_multiple8(frame->height);
+	width  = (ptrdiff_t) ceil_multiple8(frame->width);
 
-		int *band_ll = data +          0 +          0;
-		int *band_hl = data +          0 + stride_x/2;
-		int *band_lh = data + stride_y/2 +          0;
-		int *band_hh = data + stride_y/2 + stride_x/2;
+	assert(frame->data != NULL || frame->data16 != NULL);
 
-		dwtint_weight_band(band_hl, stride_y, stride_x, height_j, width_j, j); /* HL */
-		dwtint_weight_band(band_lh, stride_y, stride_x, height_j, width_j, j); /* LH */
-		dwtint_weight_band(band_hh, stride_y, stride_x, height_j, width_j, j-1); /* HH */
+	if ((size_t) height > dwt->height || (size_t) width > dwt->width || !valid_tiles(tile_height, tile_width)) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
 
-		if (j < 3)
-			continue;
+	init_levels(dwt, height, width, height_, width_, stride_y_, stride_x_, buff_y_, buff_x_);
 
-		dwtint_weight_band(band_ll, stride_y, stride_x, height_j, width_j, j); /* LL */
+	if (frame->data16 != NULL) {
+		dwtint_encode_tiles16(frame->data16, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight, tile_height, tile_width);
+	} else {
+		dwtint_encode_tiles(frame->data, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight, tile_height, tile_width);
 	}
-#endif
 
 	return RET_SUCCESS;
 }
 
-int dwtint_decode(struct frame *frame, const int weight[12])
+int dwtint_decode_tiled(struct dwt *dwt, struct frame *frame, const int weight[12], ptrdiff_t tile_height, ptrdiff_t tile_width)
 {
-	int j;
 	ptrdiff_t height, width;
-	int *data;
-#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2)
 	int *buff_x_[3], *buff_y_[3];
 	ptrdiff_t height_[3], width_[3];
 	ptrdiff_t stride_y_[3], stride_x_[3];
-	ptrdiff_t y;
-#endif
-#if (CONFIG_DWT_MS_MODE == 2)
-	ptrdiff_t x;
-#endif
+
+	assert(dwt);
 
 	assert(frame);
 
@@ -937,76 +867,55 @@ int dwtint_decode(struct frame *frame, const int weight[12])
 	height = (ptrdiff_t) ceil_multiple8(frame->height);
 	width  = (ptrdiff_t) ceil_multiple8(frame->width);
 
-	assert(is_multiple8(width) && is_multiple8(height));
-
-	data = frame->data;
-
-	assert(data);
-
-	/* undo Subband Weights */
-
-#if (CONFIG_DWT_MS_MODE == 0) && (CONFIG_DWT2_MODE == 0)
-	for (j = 1; j < 4; ++j) {
-		ptrdiff_t height_j = height >> j, width_j = width >> j;
-
-		ptrdiff_t stride_y = width << j, stride_x = 1 << j;
+	assert(frame->data != NULL || frame->data16 != NULL);
 
-		int *band_ll = data +          0 +          0;
-		int *band_hl = data +          0 + stride_x/2;
-		int *band_lh = data + stride_y/2 +          0;
-		int *band_hh = data + stride_y/2 + stride_x/2;
-
-		dwtint_unweight_band(band_hl, stride_y, stride_x, height_j, width_j, j); /* HL */
-		dwtint_unweight_band(band_lh, stride_y, stride_x, height_j, width_j, j); /* LH */
-		dwtint_unweight_band(band_hh, stride_y, stride_x, height_j, width_j, j-1); /* HH */
+	if ((size_t) height > dwt->height || (size_t) width > dwt->width || !valid_tiles(tile_height, tile_width)) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
 
-		if (j < 3)
-			continue;
+	init_levels(dwt, height, width, height_, width_, stride_y_, stride_x_, buff_y_, buff_x_);
 
-		dwtint_unweight_band(band_ll, stride_y, stride_x, height_j, width_j, j); /* LL */
+	if (frame->data16 != NULL) {
+		dwtint_decode_tiles16(frame->data16, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight, 0, tile_height, tile_width);
+	} else {
+		dwtint_decode_tiles(frame->data, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight, 0, tile_height, tile_width);
 	}
-#endif
 
-	/* inverse two-dimensional transform */
+	return RET_SUCCESS;
+}
 
-#if (CONFIG_DWT_MS_MODE == 0)
-	for (j = 2; j >= 0; --j) {
-		ptrdiff_t height_j = height >> j, width_j = width >> j;
+int dwtint_decode(struct dwt *dwt, struct frame *frame, const int weight[12])
+{
+	return dwtint_decode_partial(dwt, frame, weight, 0);
+}
 
-		ptrdiff_t stride_y = width << j, stride_x = 1 << j;
+int dwtint_decode_strips(struct dwt *dwt, struct frame *frame, const int weight[12], ptrdiff_t y0, ptrdiff_t y1)
+{
+	int j;
+	ptrdiff_t height, width;
+	int *buff_x_[3], *buff_y_[3];
+	ptrdiff_t height_[3], width_[3];
+	ptrdiff_t stride_y_[3], stride_x_[3];
+	ptrdiff_t y;
 
-		dwtint_decode_band(data, stride_y, stride_x, height_j, width_j, weight + 4*j);
-	}
-#endif
-#if (CONFIG_DWT_MS_MODE == 1)
-	for (j = 0; j < 3; ++j) {
-		height_[j] = (height >> j) >> 1;
-		width_ [j] = (width  >> j) >> 1;
+	assert(dwt);
 
-		stride_y_[j] = width << j;
-		stride_x_[j] =     1 << j;
+	assert(frame);
 
-		buff_y_[j] = malloc( (size_t) (2 * height_[j] + (32 >> j) - 2) * 5 * sizeof(int) );
-		buff_x_[j] = malloc( (size_t) (2 * width_ [j] + (32 >> j) - 2) * 5 * sizeof(int) );
+	assert(weight);
 
-		if (NULL == buff_y_[j] || NULL == buff_x_[j]) {
-			return RET_FAILURE_MEMORY_ALLOCATION;
-		}
+	assert(is_multiple8(y0));
 
-		zero(buff_y_[j], (size_t) (2 * height_[j] + (32 >> j) - 2) * 5);
-		zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 5);
-	}
+	height = (ptrdiff_t) ceil_multiple8(frame->height);
+	width  = (ptrdiff_t) ceil_multiple8(frame->width);
 
-	for (y = 0; y < height+24; y += 8) {
-		dwtint_decode_strip(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, weight);
-	}
+	assert(frame->data != NULL || frame->data16 != NULL);
 
-	for (j = 0; j < 3; ++j) {
-		free(buff_y_[j]);
-		free(buff_x_[j]);
+	/* the transform is in situ, only the lifting state is kept in the workspace */
+	if ((size_t) width > dwt->width) {
+		return RET_FAILURE_LOGIC_ERROR;
 	}
-#endif
-#if (CONFIG_DWT_MS_MODE == 2)
+
 	for (j = 0; j < 3; ++j) {
 		height_[j] = (height >> j) >> 1;
 		width_ [j] = (width  >> j) >> 1;
@@ -1014,28 +923,22 @@ int dwtint_decode(struct frame *frame, const int weight[12])
 		stride_y_[j] = width << j;
 		stride_x_[j] =     1 << j;
 
-		buff_y_[j] = malloc( (size_t) (2 * height_[j] + (32 >> j) - 2) * 5 * sizeof(int) );
-		buff_x_[j] = malloc( (size_t) (2 * width_ [j] + (32 >> j) - 2) * 5 * sizeof(int) );
-
-		if (NULL == buff_y_[j] || NULL == buff_x_[j]) {
-			return RET_FAILURE_MEMORY_ALLOCATION;
-		}
+		buff_y_[j] = dwt->buff_y[j];
+		buff_x_[j] = dwt->buff_x[j];
 
-		zero(buff_y_[j], (size_t) (2 * height_[j] + (32 >> j) - 2) * 5);
-		zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 5);
+		if (y0 == 0)
+			zero(buff_x_[j], (size_t) (2 * width_ [j] + (32 >> j) - 2) * 5);
 	}
 
-	for (y = 0; y < height+24; y += 8) {
-		for (x = 0; x < width+24; x += 8) {
-			dwtint_decode_block(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, x, weight);
-		}
-	}
+	for (y = y0; y < y1; y += 8) {
+		decode_zero_rows(buff_y_, y, y+8);
 
-	for (j = 0; j < 3; ++j) {
-		free(buff_y_[j]);
-		free(buff_x_[j]);
+		if (frame->data16 != NULL) {
+			dwtint_decode_strip16(frame->data16, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, weight, 0);
+		} else {
+			dwtint_decode_strip(frame->data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, weight, 0);
+		}
 	}
-#endif
 
 	return RET_SUCCESS;
 }
@@ -6,10 +6,40 @@
 #define DWTINT_H_
 
 #include "frame.h"
+#include "dwt.h"
 #include "common.h"
 
-int dwtint_encode(struct frame *frame, const int weight[12]);
+int dwtint_encode(struct dwt *dwt, struct frame *frame, const int weight[12]);
 
-int dwtint_decode(struct frame *frame, const int weight[12]);
+int dwtint_decode(struct dwt *dwt, struct frame *frame, const int weight[12]);
+
+int dwtint_decode_partial(struct dwt *dwt, struct frame *frame, const int weight[12], int level);
+
+/**
+ * \brief Forward transform in tiles of \p tile_height x \p tile_width pixels
+ *
+ * The rows of tiles are processed top to bottom, and the tiles of each row left to right
+ * (CONFIG_DWT_MS_MODE 3 uses CONFIG_DWT_TILE_HEIGHT x CONFIG_DWT_TILE_WIDTH). Both sizes are
+ * multiples of 8, and the \p tile_height does not exceed CONFIG_DWT_TILE_HEIGHT. The coefficients
+ * do not depend on the tile size.
+ */
+int dwtint_encode_tiled(struct dwt *dwt, struct frame *frame, const int weight[12], ptrdiff_t tile_height, ptrdiff_t tile_width);
+
+/**
+ * \brief Inverse transform in tiles, see dwtint_encode_tiled()
+ */
+int dwtint_decode_tiled(struct dwt *dwt, struct frame *frame, const int weight[12], ptrdiff_t tile_height, ptrdiff_t tile_width);
+
+/**
+ * \brief Inverse transform of the strips at the rows [\p y0; \p y1), multiples of 8
+ *
+ * The strip at the row \c y reads the coefficients up to the row <tt>y + 8</tt> and completes
+ * the pixels of the stripe at the row <tt>y - DWT_STRIP_DELAY</tt>. The consecutive calls must cover
+ * the rows from 0 to <tt>height + DWT_STRIP_DELAY</tt>. The vertical lifting state is reset at the row 0
+ * and carried over in the workspace between the calls. The height of the \p frame may grow between
+ * the calls. Until it is final, only the strips with <tt>y + 8 <= height</tt> may be processed, these
+ * do not depend on the bottom border.
+ */
+int dwtint_decode_strips(struct dwt *dwt, struct frame *frame, const int weight[12], ptrdiff_t y0, ptrdiff_t y1);
 
 #endif /* DWTINT_H_ */
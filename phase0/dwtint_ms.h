@@ -0,0 +1,427 @@
+/**
+ * \file dwtint_ms.h
+ * \brief Multi-scale Integer DWT kernels parametrized by the type of the frame data
+ *
+ * This file is included by dwtint.c once for each type of the frame storage.
+ * The includer defines \c DATA_T (the type of the coefficients in the frame)
+ * and \c FN(name) (the name of the instantiated function).
+ * The lifting buffers are always of type \c int.
+ */
+
+/*
+ * encode 2x2 coefficients
+ *
+ * The buff_y points to the horizontal lifting state of the quad row n_y.
+ */
+void FN(dwtint_encode_quad)(DATA_T *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, int *buff_y, int *buff_x, ptrdiff_t n_y, ptrdiff_t n_x, const int weight[4])
+{
+	/* vertical lever at [0], horizontal at [1] */
+	int lever[2];
+	/* order on input: 0=HH, 1=LH, 2=HH, 3=LL */
+	int core[4];
+
+	/* we cannot access buff_x[] and buff_y[] at negative indices */
+	if ( n_y < 0 || n_x < 0 )
+		return;
+
+	encode_adjust_levers(lever+0, n_y, N_y);
+	encode_adjust_levers(lever+1, n_x, N_x);
+
+#	define cc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
+#	define dc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
+#	define cd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
+#	define dd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
+
+	core[0] = signal_defined(n_y-1, N_y) && signal_defined(n_x-1, N_x) ? (int) dd(n_y-1, n_x-1) : 0; /* HH */
+	core[1] = signal_defined(n_y-1, N_y) && signal_defined(n_x-0, N_x) ? (int) cd(n_y-1, n_x-0) : 0; /* LH */
+	core[2] = signal_defined(n_y-0, N_y) && signal_defined(n_x-1, N_x) ? (int) dc(n_y-0, n_x-1) : 0; /* HL */
+	core[3] = signal_defined(n_y-0, N_y) && signal_defined(n_x-0, N_x) ? (int) cc(n_y-0, n_x-0) : 0; /* LL */
+
+	dwtint_encode_core2(core, buff_y, buff_x + 5*(2*n_x+0), lever);
+
+	if (signal_defined(n_y-2, N_y) && signal_defined(n_x-2, N_x)) {
+		cc(n_y-2, n_x-2) = (DATA_T) ( core[0] << weight[0] ); /* LL */
+		dc(n_y-2, n_x-2) = (DATA_T) ( core[1] << weight[1] ); /* HL */
+		cd(n_y-2, n_x-2) = (DATA_T) ( core[2] << weight[2] ); /* LH */
+		dd(n_y-2, n_x-2) = (DATA_T) ( core[3] << weight[3] ); /* HH */
+	}
+
+#	undef cc
+#	undef dc
+#	undef cd
+#	undef dd
+}
+
+/*
+ * dwtint_encode_quad() specialized for the interior quads, 3 <= n < N
+ *
+ * All the levers are zero and all the coefficients are defined.
+ */
+static void FN(dwtint_encode_quad_interior)(DATA_T *data, ptrdiff_t stride_y, ptrdiff_t stride_x, int *buff_y, int *buff_x, ptrdiff_t n_y, ptrdiff_t n_x, const int weight[4])
+{
+	/* order on input: 0=HH, 1=LH, 2=HH, 3=LL */
+	int core[4];
+
+#	define cc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
+#	define dc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
+#	define cd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
+#	define dd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
+
+	core[0] = dd(n_y-1, n_x-1); /* HH */
+	core[1] = cd(n_y-1, n_x-0); /* LH */
+	core[2] = dc(n_y-0, n_x-1); /* HL */
+	core[3] = cc(n_y-0, n_x-0); /* LL */
+
+	dwtint_encode_core2_interior(core, buff_y, buff_x + 5*(2*n_x+0));
+
+	cc(n_y-2, n_x-2) = (DATA_T) (core[0] << weight[0]); /* LL */
+	dc(n_y-2, n_x-2) = (DATA_T) (core[1] << weight[1]); /* HL */
+	cd(n_y-2, n_x-2) = (DATA_T) (core[2] << weight[2]); /* LH */
+	dd(n_y-2, n_x-2) = (DATA_T) (core[3] << weight[3]); /* HH */
+
+#	undef cc
+#	undef dc
+#	undef cd
+#	undef dd
+}
+
+/* see dwtint_encode_quad() */
+void FN(dwtint_decode_quad)(DATA_T *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, int *buff_y, int *buff_x, ptrdiff_t n_y, ptrdiff_t n_x, const int weight[4])
+{
+	/* vertical lever at [0], horizontal at [1] */
+	int lever[2];
+	/* order on input: 0=LL, 1=HL, 2=LH, 3=HH */
+	int core[4];
+
+	/* we cannot access buff_x[] and buff_y[] at negative indices */
+	if ( n_y < 0 || n_x < 0 )
+		return;
+
+	decode_adjust_levers(lever+0, n_y, N_y);
+	decode_adjust_levers(lever+1, n_x, N_x);
+
+#	define cc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
+#	define dc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
+#	define cd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
+#	define dd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
+
+	if ( signal_defined(n_y-0, N_y) && signal_defined(n_x-0, N_x) ) {
+		core[0] = (int) cc(n_y, n_x) >> weight[0]; /* LL */
+		core[1] = (int) dc(n_y, n_x) >> weight[1]; /* HL */
+		core[2] = (int) cd(n_y, n_x) >> weight[2]; /* LH */
+		core[3] = (int) dd(n_y, n_x) >> weight[3]; /* HH */
+	} else {
+		core[0] = 0;
+		core[1] = 0;
+		core[2] = 0;
+		core[3] = 0;
+	}
+
+	dwtint_decode_core2(core, buff_y, buff_x + 5*(2*n_x+0), lever);
+
+	if ( signal_defined(n_y-1, N_y) && signal_defined(n_x-1, N_x) )
+		cc(n_y-1, n_x-1) = (DATA_T) ( core[3] ); /* LL */
+	if ( signal_defined(n_y-1, N_y) && signal_defined(n_x-2, N_x) )
+		dc(n_y-1, n_x-2) = (DATA_T) ( core[2] ); /* HL */
+	if ( signal_defined(n_y-2, N_y) && signal_defined(n_x-1, N_x) )
+		cd(n_y-2, n_x-1) = (DATA_T) ( core[1] ); /* LH */
+	if ( signal_defined(n_y-2, N_y) && signal_defined(n_x-2, N_x) )
+		dd(n_y-2, n_x-2) = (DATA_T) ( core[0] ); /* HH */
+
+#	undef cc
+#	undef dc
+#	undef cd
+#	undef dd
+}
+
+/*
+ * dwtint_decode_quad() specialized for the interior quads, 3 <= n < N
+ */
+static void FN(dwtint_decode_quad_interior)(DATA_T *data, ptrdiff_t stride_y, ptrdiff_t stride_x, int *buff_y, int *buff_x, ptrdiff_t n_y, ptrdiff_t n_x, const int weight[4])
+{
+	/* order on input: 0=LL, 1=HL, 2=LH, 3=HH */
+	int core[4];
+
+#	define cc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+0) ] /* LL */
+#	define dc(n_y, n_x) data[ stride_y*(2*(n_y)+0) + stride_x*(2*(n_x)+1) ] /* HL */
+#	define cd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+0) ] /* LH */
+#	define dd(n_y, n_x) data[ stride_y*(2*(n_y)+1) + stride_x*(2*(n_x)+1) ] /* HH */
+
+	core[0] = cc(n_y, n_x) >> weight[0]; /* LL */
+	core[1] = dc(n_y, n_x) >> weight[1]; /* HL */
+	core[2] = cd(n_y, n_x) >> weight[2]; /* LH */
+	core[3] = dd(n_y, n_x) >> weight[3]; /* HH */
+
+	dwtint_decode_core2_interior(core, buff_y, buff_x + 5*(2*n_x+0));
+
+	cc(n_y-1, n_x-1) = (DATA_T) core[3]; /* LL */
+	dc(n_y-1, n_x-2) = (DATA_T) core[2]; /* HL */
+	cd(n_y-2, n_x-1) = (DATA_T) core[1]; /* LH */
+	dd(n_y-2, n_x-2) = (DATA_T) core[0]; /* HH */
+
+#	undef cc
+#	undef dc
+#	undef cd
+#	undef dd
+}
+
+/*
+ * encode quads [y0; y1) x [x0; x1) of one level
+ *
+ * The interior quads are processed by the specialized kernel. The levers and
+ * the bounds are checked only at the borders of the level.
+ */
+static void FN(dwtint_encode_quads)(DATA_T *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, int *buff_y, int *buff_x, ptrdiff_t y0, ptrdiff_t y1, ptrdiff_t x0, ptrdiff_t x1, const int weight[4])
+{
+	ptrdiff_t y, x;
+
+	for (y = y0; y < y1; ++y) {
+		/* the horizontal lifting state of the quad row, see DWT_BUFF_Y_ROWS */
+		int *row;
+
+		if (y < 0)
+			continue;
+
+		row = buff_y + 5*(2*((size_t) y % DWT_BUFF_Y_ROWS));
+		x = x0;
+
+		if (y >= 3 && y < N_y) {
+			/* prologue */
+			for (; x < x1 && x < 3; ++x) {
+				FN(dwtint_encode_quad)(data, N_y, N_x, stride_y, stride_x, row, buff_x, y, x, weight);
+			}
+			/* interior */
+			for (; x < x1 && x < N_x; ++x) {
+				FN(dwtint_encode_quad_interior)(data, stride_y, stride_x, row, buff_x, y, x, weight);
+			}
+		}
+		/* epilogue, or the whole row at the top and bottom borders */
+		for (; x < x1; ++x) {
+			FN(dwtint_encode_quad)(data, N_y, N_x, stride_y, stride_x, row, buff_x, y, x, weight);
+		}
+	}
+}
+
+/* see dwtint_encode_quads() */
+static void FN(dwtint_decode_quads)(DATA_T *data, ptrdiff_t N_y, ptrdiff_t N_x, ptrdiff_t stride_y, ptrdiff_t stride_x, int *buff_y, int *buff_x, ptrdiff_t y0, ptrdiff_t y1, ptrdiff_t x0, ptrdiff_t x1, const int weight[4])
+{
+	ptrdiff_t y, x;
+
+	for (y = y0; y < y1; ++y) {
+		/* the horizontal lifting state of the quad row, see DWT_BUFF_Y_ROWS */
+		int *row;
+
+		if (y < 0)
+			continue;
+
+		row = buff_y + 5*(2*((size_t) y % DWT_BUFF_Y_ROWS));
+		x = x0;
+
+		if (y >= 3 && y < N_y) {
+			/* prologue */
+			for (; x < x1 && x < 3; ++x) {
+				FN(dwtint_decode_quad)(data, N_y, N_x, stride_y, stride_x, row, buff_x, y, x, weight);
+			}
+			/* interior */
+			for (; x < x1 && x < N_x; ++x) {
+				FN(dwtint_decode_quad_interior)(data, stride_y, stride_x, row, buff_x, y, x, weight);
+			}
+		}
+		/* epilogue, or the whole row at the top and bottom borders */
+		for (; x < x1; ++x) {
+			FN(dwtint_decode_quad)(data, N_y, N_x, stride_y, stride_x, row, buff_x, y, x, weight);
+		}
+	}
+}
+
+/* process 8x8 block using multi-scale transform */
+void FN(dwtint_encode_block)(DATA_T *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], int *buff_y[3], int *buff_x[3], ptrdiff_t y, ptrdiff_t x, const int weight[12])
+{
+	/* j = 0 */
+	FN(dwtint_encode_quads)(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y/2-1, y/2-1+4, x/2-1, x/2-1+4, weight + 4*0);
+	/* j = 1 */
+	FN(dwtint_encode_quads)(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y/4-1, y/4-1+2, x/4-1, x/4-1+2, weight + 4*1);
+	/* j = 2 */
+	FN(dwtint_encode_quads)(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y/8-1, y/8-1+1, x/8-1, x/8-1+1, weight + 4*2);
+}
+
+/*
+ * process 8x8 block using multi-scale transform
+ *
+ * Only the levels j >= level are reconstructed, 0 for the complete inverse
+ * transform.
+ */
+void FN(dwtint_decode_block)(DATA_T *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], int *buff_y[3], int *buff_x[3], ptrdiff_t y, ptrdiff_t x, const int weight[12], int level)
+{
+	/* j = 2 */
+	if (level < 3)
+		FN(dwtint_decode_quads)(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y/8-0, y/8-0+1, x/8-0, x/8-0+1, weight + 4*2);
+	/* j = 1 */
+	if (level < 2)
+		FN(dwtint_decode_quads)(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y/4-3, y/4-3+2, x/4-3, x/4-3+2, weight + 4*1);
+	/* j = 0 */
+	if (level < 1)
+		FN(dwtint_decode_quads)(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y/2-10, y/2-10+4, x/2-10, x/2-10+4, weight + 4*0);
+}
+
+/* process strip using multi-scale transform */
+void FN(dwtint_encode_strip)(DATA_T *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], int *buff_y[3], int *buff_x[3], ptrdiff_t y, const int weight[12])
+{
+	/* j = 0 */
+	FN(dwtint_encode_quads)(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y/2-1, y/2-1+4, 0, width[0]+2, weight + 4*0);
+	/* j = 1 */
+	FN(dwtint_encode_quads)(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y/4-1, y/4-1+2, 0, width[1]+2, weight + 4*1);
+	/* j = 2 */
+	FN(dwtint_encode_quads)(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y/8-1, y/8-1+1, 0, width[2]+2, weight + 4*2);
+}
+
+void FN(dwtint_decode_strip)(DATA_T *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], int *buff_y[3], int *buff_x[3], ptrdiff_t y, const int weight[12], int level)
+{
+	/* 0, 3, 10 .. hexagonal numbers? */
+
+	/* j = 2 */
+	if (level < 3)
+		FN(dwtint_decode_quads)(data, height[2], width[2], stride_y[2], stride_x[2], buff_y[2], buff_x[2], y/8-0, y/8-0+1, 0, width[2]+2, weight + 4*2);
+	/* j = 1 */
+	if (level < 2)
+		FN(dwtint_decode_quads)(data, height[1], width[1], stride_y[1], stride_x[1], buff_y[1], buff_x[1], y/4-3, y/4-3+2, 0, width[1]+2, weight + 4*1);
+	/* j = 0 */
+	if (level < 1)
+		FN(dwtint_decode_quads)(data, height[0], width[0], stride_y[0], stride_x[0], buff_y[0], buff_x[0], y/2-10, y/2-10+4, 0, width[0]+2, weight + 4*0);
+}
+
+/*
+ * process tile using multi-scale transform
+ *
+ * The tile covers blocks at [y0; y1) x [x0; x1), the coordinates are the same
+ * as for dwtint_encode_block(). The tile touches the vertical lifting state
+ * (buff_x) of its own columns only. The horizontal lifting state (buff_y) is
+ * handed over from the tile on the left. Therefore, the tile can be processed
+ * as soon as the tile on the left (covering the same rows) and the tile above
+ * (covering the same columns) have been processed.
+ */
+void FN(dwtint_encode_tile)(DATA_T *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], int *buff_y[3], int *buff_x[3], ptrdiff_t y0, ptrdiff_t y1, ptrdiff_t x0, ptrdiff_t x1, const int weight[12])
+{
+	ptrdiff_t y, x;
+
+	assert(is_multiple8(y0) && is_multiple8(x0));
+
+	for (y = y0; y < y1; y += 8) {
+		for (x = x0; x < x1; x += 8) {
+			FN(dwtint_encode_block)(data, stride_y, stride_x, height, width, buff_y, buff_x, y, x, weight);
+		}
+	}
+}
+
+/* see dwtint_encode_tile() */
+void FN(dwtint_decode_tile)(DATA_T *data, ptrdiff_t stride_y[3], ptrdiff_t stride_x[3], ptrdiff_t height[3], ptrdiff_t width[3], int *buff_y[3], int *buff_x[3], ptrdiff_t y0, ptrdiff_t y1, ptrdiff_t x0, ptrdiff_t x1, const int weight[12], int level)
+{
+	ptrdiff_t y, x;
+
+	assert(is_multiple8(y0) && is_multiple8(x0));
+
+	for (y = y0; y < y1; y += 8) {
+		for (x = x0; x < x1; x += 8) {
+			FN(dwtint_decode_block)(data, stride_y, stride_x, height, width, buff_y, buff_x, y, x, weight, level);
+		}
+	}
+}
+
+/*
+ * forward multi-scale transform of the whole frame in tiles of tile_height x tile_width pixels
+ *
+ * The rows of tiles are processed top to bottom, and the tiles of each row left to right, which
+ * satisfies the dependencies of dwtint_encode_tile(). Only one row of tiles is in flight, so its
+ * horizontal lifting state fits into the ring of DWT_BUFF_Y_ROWS quad rows, reset at the start of
+ * each row of tiles. The tile_height is a multiple of 8 up to CONFIG_DWT_TILE_HEIGHT.
+ */
+static void FN(dwtint_encode_tiles)(DATA_T *data, ptrdiff_t height, ptrdiff_t width, ptrdiff_t stride_y_[3], ptrdiff_t stride_x_[3], ptrdiff_t height_[3], ptrdiff_t width_[3], int *buff_y_[3], int *buff_x_[3], const int weight[12], ptrdiff_t tile_height, ptrdiff_t tile_width)
+{
+	ptrdiff_t y, x;
+
+	assert(tile_height > 0 && tile_height <= CONFIG_DWT_TILE_HEIGHT && is_multiple8(tile_height));
+	assert(tile_width > 0 && is_multiple8(tile_width));
+
+	for (y = 0; y < height+24; y += tile_height) {
+		ptrdiff_t y1 = y + tile_height < height+24 ? y + tile_height : height+24;
+
+		encode_zero_rows(buff_y_, y, y1);
+
+		for (x = 0; x < width+24; x += tile_width) {
+			ptrdiff_t x1 = x + tile_width < width+24 ? x + tile_width : width+24;
+
+			FN(dwtint_encode_tile)(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, y1, x, x1, weight);
+		}
+	}
+}
+
+/* see dwtint_encode_tiles(), and dwtint_decode_block() for the level */
+static void FN(dwtint_decode_tiles)(DATA_T *data, ptrdiff_t height, ptrdiff_t width, ptrdiff_t stride_y_[3], ptrdiff_t stride_x_[3], ptrdiff_t height_[3], ptrdiff_t width_[3], int *buff_y_[3], int *buff_x_[3], const int weight[12], int level, ptrdiff_t tile_height, ptrdiff_t tile_width)
+{
+	ptrdiff_t y, x;
+
+	assert(tile_height > 0 && tile_height <= CONFIG_DWT_TILE_HEIGHT && is_multiple8(tile_height));
+	assert(tile_width > 0 && is_multiple8(tile_width));
+
+	for (y = 0; y < height+24; y += tile_height) {
+		ptrdiff_t y1 = y + tile_height < height+24 ? y + tile_height : height+24;
+
+		decode_zero_rows(buff_y_, y, y1);
+
+		for (x = 0; x < width+24; x += tile_width) {
+			ptrdiff_t x1 = x + tile_width < width+24 ? x + tile_width : width+24;
+
+			FN(dwtint_decode_tile)(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, y1, x, x1, weight, level);
+		}
+	}
+}
+
+#if (CONFIG_DWT_MS_MODE == 1) || (CONFIG_DWT_MS_MODE == 2) || (CONFIG_DWT_MS_MODE == 3)
+/* forward multi-scale transform of the whole frame */
+static void FN(dwtint_encode_levels)(DATA_T *data, ptrdiff_t height, ptrdiff_t width, ptrdiff_t stride_y_[3], ptrdiff_t stride_x_[3], ptrdiff_t height_[3], ptrdiff_t width_[3], int *buff_y_[3], int *buff_x_[3], const int weight[12])
+{
+#if (CONFIG_DWT_MS_MODE == 1)
+	ptrdiff_t y;
+
+	/* the strips span the whole width */
+	(void) width;
+
+	for (y = 0; y < height+24; y += 8) {
+		encode_zero_rows(buff_y_, y, y+8);
+
+		FN(dwtint_encode_strip)(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, weight);
+	}
+#endif
+#if (CONFIG_DWT_MS_MODE == 2)
+	/* the rows of blocks */
+	FN(dwtint_encode_tiles)(data, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight, 8, width+24);
+#endif
+#if (CONFIG_DWT_MS_MODE == 3)
+	FN(dwtint_encode_tiles)(data, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight, CONFIG_DWT_TILE_HEIGHT, CONFIG_DWT_TILE_WIDTH);
+#endif
+}
+
+/* inverse multi-scale transform of the whole frame, see dwtint_decode_block() for the level */
+static void FN(dwtint_decode_levels)(DATA_T *data, ptrdiff_t height, ptrdiff_t width, ptrdiff_t stride_y_[3], ptrdiff_t stride_x_[3], ptrdiff_t height_[3], ptrdiff_t width_[3], int *buff_y_[3], int *buff_x_[3], const int weight[12], int level)
+{
+#if (CONFIG_DWT_MS_MODE == 1)
+	ptrdiff_t y;
+
+	/* the strips span the whole width */
+	(void) width;
+
+	for (y = 0; y < height+24; y += 8) {
+		decode_zero_rows(buff_y_, y, y+8);
+
+		FN(dwtint_decode_strip)(data, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, y, weight, level);
+	}
+#endif
+#if (CONFIG_DWT_MS_MODE == 2)
+	/* the rows of blocks */
+	FN(dwtint_decode_tiles)(data, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight, level, 8, width+24);
+#endif
+#if (CONFIG_DWT_MS_MODE == 3)
+	FN(dwtint_decode_tiles)(data, height, width, stride_y_, stride_x_, height_, width_, buff_y_, buff_x_, weight, level, CONFIG_DWT_TILE_HEIGHT, CONFIG_DWT_TILE_WIDTH);
+#endif
+}
+#endif
@@ -0,0 +1,387 @@
+/**
+ * Compresses the image into the raw CCSDS 122.0 stream
+ *
+ * Unlike the compress tool, nothing but the stream is written unless
+ * the debug output is requested.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#	include <omp.h>
+#endif
+
+#include "config.h"
+#include "common.h"
+#include "frame.h"
+#include "dwt.h"
+#include "bio.h"
+#include "bpe.h"
+#include "cli.h"
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "[ERROR] usage: %s [<options>] <input image> [<output stream>]\n", name);
+	fprintf(stderr, "The image is PGM, the \"-\" stands for the standard input and output (default output). Options:\n");
+	fprintf(stderr, "  -t <DWTtype>                 0 for Float DWT (default), 1 for Integer DWT\n");
+	fprintf(stderr, "  -s <S>                       segment size in blocks (16 to 1048576)\n");
+	fprintf(stderr, "  -w <w0>,<w1>,...,<w11>       subband weights (0 to 3) for Integer DWT, w0 and w4 are 0\n");
+	fprintf(stderr, "  -d <OptDCSelect>             0 for heuristic, 1 for optimum selection of DC k parameter\n");
+	fprintf(stderr, "  -a <OptACSelect>             0 for heuristic, 1 for optimum selection of AC k parameter\n");
+	fprintf(stderr, "  -l <SegByteLimit>            maximum number of bytes in a coded segment\n");
+	fprintf(stderr, "  -b <TargetBytes>             target size of the stream in bytes\n");
+	fprintf(stderr, "  -m <TargetBytes>:<stream>    also save the stream truncated to the size, may be repeated\n");
+	fprintf(stderr, "  -p <BitPlaneStop>,<StageStop> stop the segments at the bit plane and stage\n");
+	fprintf(stderr, "  -r <width>,<height>,<bpp>,<8|16le|16be|raw10|raw12> the input is a headerless raster\n");
+	fprintf(stderr, "  -j <threads>                 number of threads (requires OpenMP)\n");
+	fprintf(stderr, "  -v                           dump the intermediate images and print the MSE\n");
+}
+
+/* parse the comma-separated list of 'count' integers */
+static int parse_list(const char *s, int *values, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; ++i) {
+		char *end;
+		long value = strtol(s, &end, 10);
+
+		if (end == s || *end != (i + 1 < count ? ',' : '\0')) {
+			return RET_FAILURE_LOGIC_ERROR;
+		}
+
+		values[i] = (int) value;
+		s = end + 1;
+	}
+
+	return RET_SUCCESS;
+}
+
+/* the weights are signaled by 2 bits each, the LL0 and LL1 bands do not exist */
+static int check_weights(const int *weight)
+{
+	int i;
+
+	for (i = 0; i < 12; ++i) {
+		if (weight[i] < 0 || weight[i] > 3) {
+			return RET_FAILURE_LOGIC_ERROR;
+		}
+	}
+
+	if (weight[DWT_LL0] != 0 || weight[DWT_LL1] != 0) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	return RET_SUCCESS;
+}
+
+/* parse the "<bytes>:<path>" pair */
+static int parse_rate(const char *s, size_t *bytes, const char **path)
+{
+	const char *colon = strchr(s, ':');
+	char number[32];
+
+	if (colon == NULL || colon[1] == '\0' || (size_t) (colon - s) >= sizeof number) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	memcpy(number, s, (size_t) (colon - s));
+	number[colon - s] = '\0';
+
+	*path = colon + 1;
+
+	return cli_parse_size(number, bytes);
+}
+
+static int parse_raw(const char *s, struct frame_raw *raw)
+{
+	unsigned long width, height, bpp;
+	char format[8];
+
+	if (sscanf(s, "%lu,%lu,%lu,%7s", &width, &height, &bpp, format) != 4) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	raw->width = (size_t) width;
+	raw->height = (size_t) height;
+	raw->bpp = (size_t) bpp;
+	raw->format = cli_parse_format(format);
+	raw->stride = 0;
+	raw->offset = 0;
+
+	return raw->format < 0 ? RET_FAILURE_LOGIC_ERROR : RET_SUCCESS;
+}
+
+/* decode the stream back, dump the coefficients and the image, and print the MSE */
+static int dump_decoded(unsigned char *ptr, const struct frame *input_frame, struct dwt *dwt)
+{
+	struct frame frame;
+	struct parameters parameters;
+	struct bio bio;
+	int err;
+
+	frame.height = 0;
+	frame.width = 0;
+	frame.bpp = 0;
+	frame.data = NULL;
+	frame.data16 = NULL;
+
+	init_parameters(&parameters);
+
+	bio_open(&bio, ptr, BIO_MODE_READ);
+	err = bpe_decode(&frame, &parameters, &bio);
+	bio_close(&bio);
+
+	if (err) {
+		return err;
+	}
+
+	frame_dump_chunked_as_semiplanar(&frame, "dwt3-decoded.pgm", 8);
+
+	err = dwt_decode(dwt, &frame, &parameters);
+
+	if (!err) {
+		frame_dump(&frame, "decoded.pgm", 1);
+
+		err = frame_dump_mse(&frame, input_frame);
+	}
+
+	frame_destroy(&frame);
+
+	return err;
+}
+
+int main(int argc, char *argv[])
+{
+	struct frame frame, input_frame;
+	struct frame_raw raw;
+	struct parameters parameters;
+	struct dwt dwt;
+	struct bio bio;
+	unsigned char *ptr;
+	size_t size;
+	size_t *bytes;
+	const char **paths;
+	size_t count = 0;
+	const char *input = NULL, *output = "-";
+	int is_raw = 0, verbose = 0;
+	int i;
+	int err;
+
+	init_parameters(&parameters);
+
+	/* the truncated streams, at most one per option */
+	bytes = malloc((size_t) argc * sizeof *bytes);
+	paths = malloc((size_t) argc * sizeof *paths);
+
+	if (bytes == NULL || paths == NULL) {
+		fprintf(stderr, "[ERROR] malloc failed\n");
+		return EXIT_FAILURE;
+	}
+
+	for (i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		err = RET_SUCCESS;
+
+		if (arg[0] != '-' || arg[1] == '\0') {
+			if (input == NULL) {
+				input = arg;
+			} else {
+				output = arg;
+			}
+			continue;
+		}
+
+		if (0 == strcmp(arg, "-v")) {
+			verbose = 1;
+			continue;
+		}
+
+		if (value == NULL || arg[2] != '\0') {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		switch (arg[1]) {
+			case 't':
+				parameters.DWTtype = atoi(value);
+				break;
+			case 's':
+				err = cli_parse_size(value, &parameters.S);
+				break;
+			case 'w':
+				err = parse_list(value, parameters.weight, 12);
+
+				if (!err) {
+					err = check_weights(parameters.weight);
+				}
+				break;
+			case 'd':
+				parameters.OptDCSelect = atoi(value);
+				break;
+			case 'a':
+				parameters.OptACSelect = atoi(value);
+				break;
+			case 'l':
+				err = cli_parse_size(value, &parameters.SegByteLimit);
+				break;
+			case 'b':
+				err = cli_parse_size(value, &parameters.TargetBytes);
+				break;
+			case 'm':
+				err = parse_rate(value, &bytes[count], &paths[count]);
+				++count;
+				break;
+			case 'p': {
+				int stop[2];
+
+				err = parse_list(value, stop, 2);
+
+				parameters.BitPlaneStop = (size_t) stop[0];
+				parameters.StageStop = stop[1];
+				break;
+			}
+			case 'r':
+				err = parse_raw(value, &raw);
+				is_raw = 1;
+				break;
+			case 'j':
+#ifdef _OPENMP
+				omp_set_num_threads(atoi(value));
+#else
+				fprintf(stderr, "[WARNING] compiled without OpenMP, the number of threads is ignored\n");
+#endif
+				break;
+			default:
+				err = RET_FAILURE_LOGIC_ERROR;
+		}
+
+		if (err) {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+
+		++i;
+	}
+
+	if (input == NULL) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if ((parameters.DWTtype != 0 && parameters.DWTtype != 1) || parameters.S < 16 || parameters.S > (1<<20)
+		|| parameters.SegByteLimit > 134217727 || parameters.BitPlaneStop > 31 || parameters.StageStop < 0 || parameters.StageStop > 3) {
+		fprintf(stderr, "[ERROR] invalid parameters\n");
+		return EXIT_FAILURE;
+	}
+
+	if (count > 0 && parameters.TargetBytes != 0) {
+		fprintf(stderr, "[ERROR] the truncated streams are cut from the whole stream, the target size cannot be combined with them\n");
+		return EXIT_FAILURE;
+	}
+
+	/* the MSE goes to the standard output */
+	if (verbose && 0 == strcmp(output, "-")) {
+		fprintf(stderr, "[ERROR] the debug output requires an output file\n");
+		return EXIT_FAILURE;
+	}
+
+	if (is_raw ? frame_load_raw(&frame, input, &raw) : frame_load_pgm(&frame, input)) {
+		fprintf(stderr, "[ERROR] unable to load image\n");
+		return EXIT_FAILURE;
+	}
+
+	if (frame.width > (1<<20) || frame.width < 17) {
+		fprintf(stderr, "[ERROR] unsupported image width\n");
+		return EXIT_FAILURE;
+	}
+
+	if (frame.height < 17) {
+		fprintf(stderr, "[ERROR] unsupported image height\n");
+		return EXIT_FAILURE;
+	}
+
+	if (verbose) {
+		frame_dump(&frame, "input.pgm", 1);
+
+		if (frame_clone(&frame, &input_frame)) {
+			fprintf(stderr, "[ERROR] unable to clone the frame\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (dwt_init(&dwt, frame.height, frame.width)) {
+		fprintf(stderr, "[ERROR] unable to allocate the DWT workspace\n");
+		return EXIT_FAILURE;
+	}
+
+	if (dwt_encode(&dwt, &frame, &parameters)) {
+		fprintf(stderr, "[ERROR] transform failed\n");
+		return EXIT_FAILURE;
+	}
+
+	if (verbose) {
+		frame_dump_chunked_as_semiplanar(&frame, "dwt3.pgm", 8);
+	}
+
+	ptr = malloc(get_maximum_stream_size(&frame));
+
+	if (ptr == NULL) {
+		fprintf(stderr, "[ERROR] malloc failed\n");
+		return EXIT_FAILURE;
+	}
+
+	bio_open(&bio, ptr, BIO_MODE_WRITE);
+
+	if (count > 0) {
+		err = cli_encode_multirate(&frame, &parameters, &bio, count, bytes, paths);
+	} else {
+		err = bpe_encode(&frame, &parameters, &bio);
+	}
+
+	if (err == RET_FAILURE_OVERFLOW_ERROR) {
+		fprintf(stderr, "[ERROR] not even the segment headers fit into the target size\n");
+		return EXIT_FAILURE;
+	}
+
+	if (err == RET_FAILURE_FILE_OPEN || err == RET_FAILURE_FILE_IO) {
+		fprintf(stderr, "[ERROR] unable to write the truncated stream\n");
+		return EXIT_FAILURE;
+	}
+
+	if (err) {
+		fprintf(stderr, "[ERROR] encoding failed\n");
+		return EXIT_FAILURE;
+	}
+
+	bio_close(&bio);
+
+	size = (size_t) (bio.ptr - ptr);
+
+	if (cli_save_file(output, ptr, size)) {
+		fprintf(stderr, "[ERROR] unable to write the stream\n");
+		return EXIT_FAILURE;
+	}
+
+	if (verbose) {
+		if (dump_decoded(ptr, &input_frame, &dwt)) {
+			fprintf(stderr, "[ERROR] unable to decode the stream\n");
+			return EXIT_FAILURE;
+		}
+
+		frame_destroy(&input_frame);
+	}
+
+	free(ptr);
+	free(bytes);
+	free(paths);
+
+	frame_destroy(&frame);
+
+	dwt_destroy(&dwt);
+
+	return EXIT_SUCCESS;
+}
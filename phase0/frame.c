@@ -1,12 +1,21 @@
 #include "config.h"
+#if (CONFIG_FRAME_MMAP == 1)
+#	define _POSIX_C_SOURCE 200112L
+#endif
 #include "frame.h"
 #include "common.h"
+#include "alloc.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
 #include <ctype.h>
 #include <assert.h>
+#if (CONFIG_FRAME_MMAP == 1)
+#	include <sys/types.h>
+#	include <sys/stat.h>
+#	include <sys/mman.h>
+#endif
 
 /**
  * \brief Compute the absolute value of an integer
@@ -83,11 +92,11 @@ static size_t convert_bpp_to_depth(size_t bpp)
 }
 
 /**
- * \brief Convert big-endian to native byte order
+ * \brief Convert native byte order to big endian
  *
- * This function is similar to htons(). However the htons() is not present in C89.
+ * This function is similar to ntohs(). However the ntohs() is not present in C89.
  */
-static unsigned short be_to_native_s(unsigned short a)
+static unsigned short native_to_be_s(unsigned short a)
 {
 #if (CONFIG_SWAP_BYTE_ORDER == 1)
 	return (unsigned short) (
@@ -100,20 +109,31 @@ static unsigned short be_to_native_s(unsigned short a)
 }
 
 /**
- * \brief Convert native byte order to big endian
- *
- * This function is similar to ntohs(). However the ntohs() is not present in C89.
+ * \brief Get the sample at the index \p n of the framebuffer, regardless of its storage
  */
-static unsigned short native_to_be_s(unsigned short a)
+static int get_sample(const struct frame *frame, size_t n)
 {
-#if (CONFIG_SWAP_BYTE_ORDER == 1)
-	return (unsigned short) (
-		((a & 0xff00U) >> 8U) |
-		((a & 0x00ffU) << 8U)
-	);
-#else
-	return a;
-#endif
+	return frame->data16 != NULL ? frame->data16[n] : frame->data[n];
+}
+
+/**
+ * \brief Set the sample at the index \p n of the framebuffer, regardless of its storage
+ */
+static void set_sample(struct frame *frame, size_t n, int sample)
+{
+	if (frame->data16 != NULL) {
+		frame->data16[n] = (short) sample;
+	} else {
+		frame->data[n] = sample;
+	}
+}
+
+/**
+ * \brief Decide whether the frame with no framebuffer allocated should use the 16-bit storage
+ */
+static int is_data16_bpp(size_t bpp)
+{
+	return bpp > 0 && bpp <= CONFIG_FRAME_DATA16_BPP;
 }
 
 int frame_write_pgm_header(const struct frame *frame, FILE *stream)
@@ -147,7 +167,6 @@ int frame_write_pgm_data(const struct frame *frame, FILE *stream)
 	size_t y, x;
 	int maxval;
 	void *line;
-	const int *data;
 
 	assert(frame != NULL);
 
@@ -160,15 +179,13 @@ int frame_write_pgm_data(const struct frame *frame, FILE *stream)
 	width = ceil_multiple8(frame->width);
 
 	/* allocate a line */
-	line = malloc(width_ * depth_);
+	line = alloc_malloc(width_ * depth_);
 
 	if (NULL == line) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	data = frame->data;
-
-	assert(data != NULL);
+	assert(frame->data != NULL || frame->data16 != NULL);
 
 	/* write data */
 	for (y = 0; y < height_; ++y) {
@@ -178,7 +195,7 @@ int frame_write_pgm_data(const struct frame *frame, FILE *stream)
 				unsigned char *line_ = line;
 				/* input data */
 				for (x = 0; x < width_; ++x) {
-					int sample = data [y*width + x];
+					int sample = get_sample(frame, y*width + x);
 					line_ [x] = (unsigned char) clamp(sample, 0, maxval);
 				}
 				break;
@@ -187,24 +204,24 @@ int frame_write_pgm_data(const struct frame *frame, FILE *stream)
 				unsigned short *line_ = line;
 				/* input data */
 				for (x = 0; x < width_; ++x) {
-					int sample = data [y*width + x];
+					int sample = get_sample(frame, y*width + x);
 					line_ [x] = native_to_be_s( (unsigned short) clamp(sample, 0, maxval) );
 				}
 				break;
 			}
 			default:
 				dprint (("[ERROR] unhandled bit depth\n"));
-				free(line);
+				alloc_free(line);
 				return RET_FAILURE_LOGIC_ERROR;
 		}
 		/* write line */
 		if (fwrite(line, depth_, width_, stream) < width_) {
-			free(line);
+			alloc_free(line);
 			return RET_FAILURE_FILE_IO;
 		}
 	}
 
-	free(line);
+	alloc_free(line);
 
 	return RET_SUCCESS;
 }
@@ -372,367 +389,1180 @@ int frame_read_pgm_header(struct frame *frame, FILE *stream)
 	return RET_SUCCESS;
 }
 
-int frame_alloc_data(struct frame *frame)
-{
-	assert(frame != NULL);
-
-	frame->data = NULL;
-
-	return frame_realloc_data(frame);
-}
-
-int frame_realloc_data(struct frame *frame)
+/**
+ * \brief Resize the framebuffer to the dimensions of the \p frame using the given storage
+ *
+ * The empty frame releases its framebuffer, so that the storage can be selected again.
+ */
+static int realloc_data(struct frame *frame, int data16)
 {
 	size_t height, width;
 	size_t resolution;
-	int *data;
+	size_t size;
+	void *ptr;
 
 	assert(frame != NULL);
 
 	height = ceil_multiple8(frame->height);
 	width = ceil_multiple8(frame->width);
 
-	data = frame->data;
-
 	if (width != 0 && height > SIZE_MAX_ / width) {
 		return RET_FAILURE_OVERFLOW_ERROR;
 	}
 
 	resolution = height * width;
 
-	if (resolution != 0 && sizeof *data > SIZE_MAX_ / resolution) {
+	if (resolution == 0) {
+		frame_destroy(frame);
+		return RET_SUCCESS;
+	}
+
+	size = data16 ? sizeof *frame->data16 : sizeof *frame->data;
+
+	if (size > SIZE_MAX_ / resolution) {
 		return RET_FAILURE_OVERFLOW_ERROR;
 	}
 
-	data = realloc(data, resolution * sizeof *data);
+	ptr = alloc_realloc(data16 ? (void *) frame->data16 : (void *) frame->data, resolution * size);
 
-	if (NULL == data && resolution != 0) {
+	if (NULL == ptr) {
 		return RET_FAILURE_MEMORY_ALLOCATION;
 	}
 
-	frame->data = data;
+	if (data16) {
+		frame->data16 = ptr;
+	} else {
+		frame->data = ptr;
+	}
 
 	return RET_SUCCESS;
 }
 
-int frame_read_pgm_data(struct frame *frame, FILE *stream)
+int frame_alloc_data(struct frame *frame)
 {
-	size_t height_, width_, depth_;
-	size_t height, width;
-	size_t y, x;
-	void *line;
-	int *data;
-
 	assert(frame != NULL);
 
-	height_ = frame->height;
-	width_ = frame->width;
-	depth_ = convert_bpp_to_depth(frame->bpp);
+	frame->data = NULL;
+	frame->data16 = NULL;
 
-	height = ceil_multiple8(frame->height);
-	width = ceil_multiple8(frame->width);
+	return frame_realloc_data(frame);
+}
 
-	/* allocate a line */
-	line = malloc(width_ * depth_);
+/**
+ * \brief Allocate the framebuffer using the same storage as the \p like frame
+ */
+static int frame_alloc_data_like(struct frame *frame, const struct frame *like)
+{
+	assert(frame != NULL);
+	assert(like != NULL);
 
-	if (NULL == line) {
-		return RET_FAILURE_MEMORY_ALLOCATION;
-	}
+	frame->data = NULL;
+	frame->data16 = NULL;
 
-	data = frame->data;
+	return realloc_data(frame, like->data16 != NULL);
+}
 
-	assert(data != NULL);
+int frame_realloc_data(struct frame *frame)
+{
+	assert(frame != NULL);
 
-	/* (2.1) copy the input raster into an array of 32-bit DWT coefficients, incl. padding */
-	for (y = 0; y < height_; ++y) {
-		/* read line */
-		if (fread(line, depth_, width_, stream) < width_) {
-			dprint (("[ERROR] end-of-file or error while reading a row\n"));
-			free(line);
-			return RET_FAILURE_FILE_IO;
-		}
-		/* copy pixels from line into framebuffer */
-		switch (depth_) {
-			case sizeof(char): {
-				const unsigned char *line_ = line;
-				/* input data */
-				for (x = 0; x < width_; ++x) {
-					data [y*width + x] = line_ [x];
-				}
-				/* padding */
-				for (; x < width; ++x) {
-					data [y*width + x] = line_ [width_-1];
-				}
-				break;
-			}
-			case sizeof(short): {
-				const unsigned short *line_ = line;
-				/* input data */
-				for (x = 0; x < width_; ++x) {
-					data [y*width + x] = be_to_native_s( line_ [x] );
-				}
-				/* padding */
-				for (; x < width; ++x) {
-					data [y*width + x] = be_to_native_s( line_ [width_-1] );
-				}
-				break;
-			}
-			default:
-				free(line);
-				return RET_FAILURE_LOGIC_ERROR;
-		}
-	}
-	/* padding */
-	for (; y < height; ++y) {
-		/* copy (y-1)-th row to y-th one */
-		memcpy(data + y*width, data + (y-1)*width, width * sizeof *data);
+	/* keep the current storage, otherwise select it according to the bit depth */
+	if (frame->data16 != NULL) {
+		return realloc_data(frame, 1);
 	}
 
-	free(line);
+	if (frame->data != NULL) {
+		return realloc_data(frame, 0);
+	}
 
-	return RET_SUCCESS;
+	return realloc_data(frame, is_data16_bpp(frame->bpp));
 }
 
-int frame_load_pgm(struct frame *frame, const char *path)
+int frame_reset_data(struct frame *frame)
 {
-	FILE *stream;
-	int err;
+	int data16;
 
-	/* open file */
-	if (0 == strcmp(path, "-"))
-		stream = stdin;
-	else
-		stream = fopen(path, "r");
+	assert(frame != NULL);
 
-	if (NULL == stream) {
-		dprint (("[ERROR] unable to open input file\n"));
-		return RET_FAILURE_FILE_OPEN;
-	}
+	data16 = is_data16_bpp(frame->bpp);
 
-	/* read header */
-	err = frame_read_pgm_header(frame, stream);
+	if (data16 && frame->data != NULL) {
+		alloc_free(frame->data);
+		frame->data = NULL;
+	}
 
-	if (err) {
-		if (stream != stdin) {
-			fclose(stream);
-		}
-		return err;
+	if (!data16 && frame->data16 != NULL) {
+		alloc_free(frame->data16);
+		frame->data16 = NULL;
 	}
 
-	/* allocate framebuffer */
-	err = frame_alloc_data(frame);
+	return realloc_data(frame, data16);
+}
 
-	if (err) {
-		if (stream != stdin) {
-			fclose(stream);
-		}
-		return err;
-	}
+size_t frame_sizeof(size_t height, size_t width, size_t bpp)
+{
+	size_t resolution;
+	size_t size;
 
-	/* read data */
-	err = frame_read_pgm_data(frame, stream);
+	height = ceil_multiple8(height);
+	width = ceil_multiple8(width);
 
-	if (err) {
-		if (stream != stdin) {
-			fclose(stream);
-		}
-		return err;
+	if (width != 0 && height > SIZE_MAX_ / width) {
+		return SIZE_MAX_;
 	}
 
-	/* close file */
-	if (stream != stdin) {
-		if (EOF == fclose(stream)) {
-			return RET_FAILURE_FILE_IO;
-		}
+	resolution = height * width;
+
+	if (resolution == 0) {
+		return 0;
 	}
 
-	assert(frame != NULL);
+	size = is_data16_bpp(bpp) ? sizeof(short) : sizeof(int);
 
-	dprint (("[INFO] frame %lu %lu %lu\n", (unsigned long) frame->width, (unsigned long) frame->height, (unsigned long) frame->bpp));
+	if (size > SIZE_MAX_ / resolution) {
+		return SIZE_MAX_;
+	}
 
-	/* return */
-	return RET_SUCCESS;
+	return arena_sizeof(resolution * size);
 }
 
-int frame_dump(const struct frame *frame, const char *path, int factor)
+int frame_widen_data(struct frame *frame)
 {
-	FILE *stream;
-	size_t height, width, depth;
-	size_t bpp;
-	size_t stride;
-	size_t y, x;
-	const int *data;
-	int maxval;
-	void *line;
-
-	stream = fopen(path, "w");
-
-	if (NULL == stream) {
-		return RET_FAILURE_FILE_OPEN;
-	}
+	size_t height, width;
+	size_t n;
+	short *data16;
+	int err;
 
 	assert(frame != NULL);
 
-	bpp = frame->bpp;
+	data16 = frame->data16;
 
-	maxval = (int) convert_bpp_to_maxval(bpp);
+	if (data16 == NULL) {
+		return RET_SUCCESS;
+	}
 
 	height = ceil_multiple8(frame->height);
 	width = ceil_multiple8(frame->width);
 
-	if (width > ULONG_MAX || height > ULONG_MAX) {
-		fclose(stream);
-		return RET_FAILURE_OVERFLOW_ERROR;
-	}
-
-	if (fprintf(stream, "P5\n%lu %lu\n%lu\n", (unsigned long) width, (unsigned long) height, (unsigned long) maxval) < 0) {
-		fclose(stream);
-		return RET_FAILURE_FILE_IO;
-	}
-
-	data = frame->data;
-
-	assert(data != NULL);
-	assert(factor != 0);
+	frame->data16 = NULL;
 
-	depth = convert_bpp_to_depth(bpp);
-	stride = width * depth;
-	line = malloc(stride);
+	err = realloc_data(frame, 0);
 
-	if (NULL == line) {
-		fclose(stream);
-		return RET_FAILURE_MEMORY_ALLOCATION;
+	if (err) {
+		frame->data16 = data16;
+		return err;
 	}
 
-	for (y = 0; y < height; ++y) {
-		for (x = 0; x < width; ++x) {
-			int sample = data [y*width + x];
-			int magnitude = safe_abs(sample) / factor;
-
-			switch (depth) {
-				case sizeof(char): {
-					unsigned char *line_ = line;
+	for (n = 0; n < height * width; ++n) {
+		frame->data[n] = data16[n];
+	}
 
-					line_ [x] = (unsigned char) clamp(magnitude, 0, maxval);
+	alloc_free(data16);
 
-					break;
-				}
-				case sizeof(short): {
-					unsigned short *line_ = line;
+	return RET_SUCCESS;
+}
 
-					line_ [x] = native_to_be_s( (unsigned short) clamp(magnitude, 0, maxval) );
+/**
+ * \brief Assemble the big-endian 16-bit sample at \p ptr
+ *
+ * The sample is read byte by byte, so \p ptr need not be aligned, and the result does not
+ * depend on the byte order of the machine. The loops using this function have no branches,
+ * so the compiler can vectorize them into the byte swap and the widening.
+ */
+static int be_to_int(const unsigned char *ptr)
+{
+	return (ptr[0] << 8) | ptr[1];
+}
 
-					break;
-				}
-				default:
-					dprint (("[ERROR] unhandled bit depth\n"));
-					free(line);
-					fclose(stream);
-					return RET_FAILURE_LOGIC_ERROR;
+/**
+ * \brief Copy the row of \p width_ pixels of the given depth into the framebuffer row of \p width samples, incl. padding
+ */
+static int read_line(int *data, const void *line, size_t width_, size_t width, size_t depth_)
+{
+	size_t x;
+
+	switch (depth_) {
+		case sizeof(char): {
+			const unsigned char *line_ = line;
+			/* input data */
+			for (x = 0; x < width_; ++x) {
+				data [x] = line_ [x];
+			}
+			/* padding */
+			for (; x < width; ++x) {
+				data [x] = line_ [width_-1];
 			}
+			break;
 		}
-
-		if (1 != fwrite(line, stride, 1, stream)) {
-			fclose(stream);
-			return RET_FAILURE_FILE_IO;
+		case sizeof(short): {
+			const unsigned char *line_ = line;
+			int last;
+			/* input data */
+			for (x = 0; x < width_; ++x) {
+				data [x] = be_to_int( line_ + 2*x );
+			}
+			/* padding */
+			last = be_to_int( line_ + 2*(width_-1) );
+			for (; x < width; ++x) {
+				data [x] = last;
+			}
+			break;
 		}
-	}
-
-	free(line);
-
-	if (EOF == fclose(stream)) {
-		return RET_FAILURE_FILE_IO;
+		default:
+			return RET_FAILURE_LOGIC_ERROR;
 	}
 
 	return RET_SUCCESS;
 }
 
-void frame_destroy(struct frame *frame)
+/**
+ * \brief Copy the row \p y of the raster at \p line into the framebuffer, incl. padding
+ *
+ * The 16-bit storage is filled through the \p samples row of ceil_multiple8(width) integers,
+ * so the rows of both storages are read by the same read_line().
+ */
+static int frame_read_row(struct frame *frame, size_t y, const void *line, int *samples)
 {
+	size_t width_, depth_;
+	size_t width;
+	size_t x;
+	int err;
+
 	assert(frame != NULL);
+	assert(frame->data != NULL || frame->data16 != NULL);
 
-	free(frame->data);
+	width_ = frame->width;
+	depth_ = convert_bpp_to_depth(frame->bpp);
 
-	frame->data = NULL;
-}
+	width = ceil_multiple8(frame->width);
 
-static void copy_band(int *dst, int *src, size_t height, size_t width, size_t stride_dst_x, size_t stride_dst_y, size_t stride_src_x, size_t stride_src_y)
-{
-	size_t y, x;
+	if (frame->data16 == NULL) {
+		return read_line(frame->data + y*width, line, width_, width, depth_);
+	}
 
-	assert(dst != NULL);
-	assert(src != NULL);
+	assert(samples != NULL);
+
+	err = read_line(samples, line, width_, width, depth_);
+
+	if (err) {
+		return err;
+	}
+
+	for (x = 0; x < width; ++x) {
+		frame->data16[y*width + x] = (short) samples[x];
+	}
+
+	return RET_SUCCESS;
+}
+
+/**
+ * \brief Allocate the \p samples row needed by frame_read_row(), NULL is set for the 32-bit storage
+ */
+static int alloc_samples(const struct frame *frame, int **samples)
+{
+	*samples = NULL;
+
+	if (frame->data16 == NULL) {
+		return RET_SUCCESS;
+	}
+
+	*samples = alloc_malloc(ceil_multiple8(frame->width) * sizeof **samples);
+
+	if (*samples == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	return RET_SUCCESS;
+}
+
+/**
+ * \brief Repeat the last row of the raster in the padding rows of the framebuffer
+ */
+static void frame_pad_rows(struct frame *frame)
+{
+	size_t height, width;
+	size_t y;
+	size_t size;
+	unsigned char *data;
+
+	assert(frame != NULL);
+
+	height = ceil_multiple8(frame->height);
+	width = ceil_multiple8(frame->width);
+
+	if (frame->data16 != NULL) {
+		data = (unsigned char *) frame->data16;
+		size = sizeof *frame->data16;
+	} else {
+		data = (unsigned char *) frame->data;
+		size = sizeof *frame->data;
+	}
+
+	for (y = frame->height; y < height; ++y) {
+		/* copy (y-1)-th row to y-th one */
+		memcpy(data + y*width*size, data + (y-1)*width*size, width * size);
+	}
+}
+
+int frame_read_pgm_data(struct frame *frame, FILE *stream)
+{
+	size_t height_, width_, depth_;
+	size_t y;
+	void *line;
+	int *samples;
+	int err;
+
+	assert(frame != NULL);
+
+	height_ = frame->height;
+	width_ = frame->width;
+	depth_ = convert_bpp_to_depth(frame->bpp);
+
+	assert(frame->data != NULL || frame->data16 != NULL);
+
+	/* allocate a line */
+	line = alloc_malloc(width_ * depth_);
+	err = alloc_samples(frame, &samples);
+
+	if (NULL == line || err) {
+		alloc_free(line);
+		alloc_free(samples);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	/* (2.1) copy the input raster into an array of 32-bit (or 16-bit) DWT coefficients, incl. padding */
+	for (y = 0; y < height_; ++y) {
+		/* read line */
+		if (fread(line, depth_, width_, stream) < width_) {
+			dprint (("[ERROR] end-of-file or error while reading a row\n"));
+			err = RET_FAILURE_FILE_IO;
+			break;
+		}
+		/* copy pixels from line into framebuffer */
+		err = frame_read_row(frame, y, line, samples);
+
+		if (err) {
+			break;
+		}
+	}
+	/* padding */
+	if (!err) {
+		frame_pad_rows(frame);
+	}
+
+	alloc_free(line);
+	alloc_free(samples);
+
+	return err;
+}
+
+#if (CONFIG_FRAME_MMAP == 1)
+/**
+ * \brief frame_read_pgm_data() converting the rows directly from the file mapped into memory
+ *
+ * The raster starts at the current position of the \p stream. The streams that cannot be
+ * mapped (pipes, terminals) are read using frame_read_pgm_data().
+ */
+static int frame_map_pgm_data(struct frame *frame, FILE *stream)
+{
+	size_t height_, width_, depth_;
+	size_t y;
+	size_t row, offset, size;
+	long position;
+	struct stat st;
+	unsigned char *map;
+	int *samples;
+	int fd;
+	int err;
+
+	assert(frame != NULL);
+
+	height_ = frame->height;
+	width_ = frame->width;
+	depth_ = convert_bpp_to_depth(frame->bpp);
+
+	position = ftell(stream);
+	fd = fileno(stream);
+
+	if (position < 0 || fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+		return frame_read_pgm_data(frame, stream);
+	}
+
+	offset = (size_t) position;
+	size = (size_t) st.st_size;
+
+	if (width_ > SIZE_MAX_ / depth_) {
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	row = width_ * depth_;
+
+	if (offset > size || (row != 0 && height_ > (size - offset) / row)) {
+		dprint (("[ERROR] end-of-file while reading the raster\n"));
+		return RET_FAILURE_FILE_IO;
+	}
+
+	map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (map == MAP_FAILED) {
+		return frame_read_pgm_data(frame, stream);
+	}
+
+	posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+
+	assert(frame->data != NULL || frame->data16 != NULL);
+
+	err = alloc_samples(frame, &samples);
+
+	/* (2.1) copy the input raster into an array of 32-bit (or 16-bit) DWT coefficients, incl. padding */
+	for (y = 0; y < height_ && !err; ++y) {
+		err = frame_read_row(frame, y, map + offset + y*row, samples);
+	}
+	/* padding */
+	if (!err) {
+		frame_pad_rows(frame);
+	}
+
+	alloc_free(samples);
+
+	if (munmap(map, size) != 0 && !err) {
+		err = RET_FAILURE_FILE_IO;
+	}
+
+	return err;
+}
+#endif
+
+size_t frame_raw_row_size(const struct frame_raw *raw)
+{
+	size_t width;
+
+	assert(raw != NULL);
+
+	width = raw->width;
+
+	if (raw->bpp == 0 || raw->bpp > 16 || width == 0 || width > SIZE_MAX_ / 2 - 3) {
+		return 0;
+	}
+
+	switch (raw->format) {
+		case FRAME_RAW_8:
+			return raw->bpp <= 8 ? width : 0;
+		case FRAME_RAW_16LE:
+		case FRAME_RAW_16BE:
+			return 2 * width;
+		case FRAME_RAW_PACKED10:
+			return raw->bpp <= 10 ? (width + 3) / 4 * 5 : 0;
+		case FRAME_RAW_PACKED12:
+			return raw->bpp <= 12 ? (width + 1) / 2 * 3 : 0;
+		default:
+			return 0;
+	}
+}
+
+void frame_raw_unpack_row(const struct frame_raw *raw, int *data, const unsigned char *line)
+{
+	size_t width;
+	size_t x;
+	int mask;
+
+	assert(raw != NULL);
+
+	width = raw->width;
+	mask = (int) convert_bpp_to_maxval(raw->bpp);
+
+	/* each format has its own loop without branches, so the compiler can vectorize it */
+	switch (raw->format) {
+		case FRAME_RAW_8:
+			for (x = 0; x < width; ++x) {
+				data[x] = line[x] & mask;
+			}
+			break;
+		case FRAME_RAW_16LE:
+			for (x = 0; x < width; ++x) {
+				data[x] = (line[2*x] | (line[2*x+1] << 8)) & mask;
+			}
+			break;
+		case FRAME_RAW_16BE:
+			for (x = 0; x < width; ++x) {
+				data[x] = be_to_int(line + 2*x) & mask;
+			}
+			break;
+		case FRAME_RAW_PACKED10:
+			for (x = 0; x < (width + 3) / 4; ++x) {
+				const unsigned char *group = line + 5*x;
+
+				data[4*x+0] = ((group[0] << 2) | ((group[4] >> 0) & 3)) & mask;
+				data[4*x+1] = ((group[1] << 2) | ((group[4] >> 2) & 3)) & mask;
+				data[4*x+2] = ((group[2] << 2) | ((group[4] >> 4) & 3)) & mask;
+				data[4*x+3] = ((group[3] << 2) | ((group[4] >> 6) & 3)) & mask;
+			}
+			break;
+		case FRAME_RAW_PACKED12:
+			for (x = 0; x < (width + 1) / 2; ++x) {
+				const unsigned char *group = line + 3*x;
+
+				data[2*x+0] = ((group[0] << 4) | (group[2] & 15)) & mask;
+				data[2*x+1] = ((group[1] << 4) | (group[2] >> 4)) & mask;
+			}
+			break;
+	}
+}
+
+void frame_store_row(struct frame *frame, size_t y, const int *samples)
+{
+	size_t width_, width;
+	size_t x;
+
+	assert(frame != NULL);
+	assert(frame->data != NULL || frame->data16 != NULL);
+	assert(y < frame->height);
+
+	width_ = frame->width;
+	width = ceil_multiple8(frame->width);
+
+	if (frame->data16 != NULL) {
+		short *data16 = frame->data16 + y*width;
+
+		for (x = 0; x < width_; ++x) {
+			data16[x] = (short) samples[x];
+		}
+		/* padding */
+		for (; x < width; ++x) {
+			data16[x] = data16[width_-1];
+		}
+	} else {
+		int *data = frame->data + y*width;
+
+		for (x = 0; x < width_; ++x) {
+			data[x] = samples[x];
+		}
+		/* padding */
+		for (; x < width; ++x) {
+			data[x] = data[width_-1];
+		}
+	}
+
+	if (y + 1 == frame->height) {
+		frame_pad_rows(frame);
+	}
+}
+
+/**
+ * \brief Read the headerless raster of the given layout from the current position of the \p stream
+ *
+ * The geometry of the \p frame must have been set from the \p raw, and its framebuffer allocated.
+ */
+static int frame_read_raw_data(struct frame *frame, FILE *stream, const struct frame_raw *raw)
+{
+	size_t row, stride;
+	size_t y;
+	unsigned char *line;
+	int *samples;
+	int err = RET_SUCCESS;
+
+	assert(frame != NULL);
+
+	row = frame_raw_row_size(raw);
+	stride = raw->stride != 0 ? raw->stride : row;
+
+	if (row == 0 || stride < row) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	line = alloc_malloc(stride);
+	/* the packed formats are unpacked in whole groups */
+	samples = alloc_malloc(ceil_multiple8(frame->width) * sizeof *samples);
+
+	if (line == NULL || samples == NULL) {
+		alloc_free(line);
+		alloc_free(samples);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	for (y = 0; y < frame->height; ++y) {
+		/* the bytes beyond the last row need not be present */
+		size_t size = y + 1 < frame->height ? stride : row;
+
+		if (fread(line, 1, size, stream) < size) {
+			dprint (("[ERROR] end-of-file or error while reading a row\n"));
+			err = RET_FAILURE_FILE_IO;
+			break;
+		}
+
+		frame_raw_unpack_row(raw, samples, line);
+
+		frame_store_row(frame, y, samples);
+	}
+
+	alloc_free(line);
+	alloc_free(samples);
+
+	return err;
+}
+
+int frame_load_raw(struct frame *frame, const char *path, const struct frame_raw *raw)
+{
+	FILE *stream;
+	size_t n;
+	int err;
+
+	assert(frame != NULL);
+	assert(raw != NULL);
+
+	if (frame_raw_row_size(raw) == 0 || raw->height == 0) {
+		dprint (("[ERROR] unsupported raw layout\n"));
+		return RET_FAILURE_FILE_UNSUPPORTED;
+	}
+
+	/* open file */
+	if (0 == strcmp(path, "-"))
+		stream = stdin;
+	else
+		stream = fopen(path, "rb");
+
+	if (NULL == stream) {
+		dprint (("[ERROR] unable to open input file\n"));
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	frame->height = raw->height;
+	frame->width = raw->width;
+	frame->bpp = raw->bpp;
+
+	/* allocate framebuffer */
+	err = frame_alloc_data(frame);
+
+	/* skip the header, the stdin cannot seek */
+	if (!err && raw->offset != 0 && fseek(stream, (long) raw->offset, SEEK_SET) != 0) {
+		for (n = 0; n < raw->offset && !err; ++n) {
+			if (getc(stream) == EOF) {
+				err = RET_FAILURE_FILE_IO;
+			}
+		}
+	}
+
+	/* read data */
+	if (!err) {
+		err = frame_read_raw_data(frame, stream, raw);
+	}
+
+	/* close file */
+	if (stream != stdin) {
+		if (EOF == fclose(stream) && !err) {
+			err = RET_FAILURE_FILE_IO;
+		}
+	}
+
+	if (err) {
+		frame_destroy(frame);
+		return err;
+	}
+
+	dprint (("[INFO] frame %lu %lu %lu\n", (unsigned long) frame->width, (unsigned long) frame->height, (unsigned long) frame->bpp));
+
+	return RET_SUCCESS;
+}
+
+/* load the PGM file into a new framebuffer, or into the framebuffer of the frame when 'reuse' is set */
+static int load_pgm(struct frame *frame, const char *path, int reuse)
+{
+	FILE *stream;
+	int err;
+
+	/* open file */
+	if (0 == strcmp(path, "-"))
+		stream = stdin;
+	else
+		stream = fopen(path, "r");
+
+	if (NULL == stream) {
+		dprint (("[ERROR] unable to open input file\n"));
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	/* read header */
+	err = frame_read_pgm_header(frame, stream);
+
+	if (err) {
+		if (stream != stdin) {
+			fclose(stream);
+		}
+		return err;
+	}
+
+	/* allocate framebuffer */
+	err = reuse ? frame_reset_data(frame) : frame_alloc_data(frame);
+
+	if (err) {
+		if (stream != stdin) {
+			fclose(stream);
+		}
+		return err;
+	}
+
+	/* read data */
+#if (CONFIG_FRAME_MMAP == 1)
+	err = frame_map_pgm_data(frame, stream);
+#else
+	err = frame_read_pgm_data(frame, stream);
+#endif
+
+	if (err) {
+		if (stream != stdin) {
+			fclose(stream);
+		}
+		return err;
+	}
+
+	/* close file */
+	if (stream != stdin) {
+		if (EOF == fclose(stream)) {
+			return RET_FAILURE_FILE_IO;
+		}
+	}
+
+	assert(frame != NULL);
+
+	dprint (("[INFO] frame %lu %lu %lu\n", (unsigned long) frame->width, (unsigned long) frame->height, (unsigned long) frame->bpp));
+
+	/* return */
+	return RET_SUCCESS;
+}
+
+int frame_load_pgm(struct frame *frame, const char *path)
+{
+	return load_pgm(frame, path, 0);
+}
+
+int frame_reload_pgm(struct frame *frame, const char *path)
+{
+	return load_pgm(frame, path, 1);
+}
+
+int frame_dump(const struct frame *frame, const char *path, int factor)
+{
+	FILE *stream;
+	size_t height, width, depth;
+	size_t bpp;
+	size_t stride;
+	size_t y, x;
+	int maxval;
+	void *line;
+
+	stream = fopen(path, "w");
+
+	if (NULL == stream) {
+		return RET_FAILURE_FILE_OPEN;
+	}
+
+	assert(frame != NULL);
+
+	bpp = frame->bpp;
+
+	maxval = (int) convert_bpp_to_maxval(bpp);
+
+	height = ceil_multiple8(frame->height);
+	width = ceil_multiple8(frame->width);
+
+	if (width > ULONG_MAX || height > ULONG_MAX) {
+		fclose(stream);
+		return RET_FAILURE_OVERFLOW_ERROR;
+	}
+
+	if (fprintf(stream, "P5\n%lu %lu\n%lu\n", (unsigned long) width, (unsigned long) height, (unsigned long) maxval) < 0) {
+		fclose(stream);
+		return RET_FAILURE_FILE_IO;
+	}
+
+	assert(frame->data != NULL || frame->data16 != NULL);
+	assert(factor != 0);
+
+	depth = convert_bpp_to_depth(bpp);
+	stride = width * depth;
+	line = alloc_malloc(stride);
+
+	if (NULL == line) {
+		fclose(stream);
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
 
-	/* for each row */
 	for (y = 0; y < height; ++y) {
-		/* for each coefficient */
 		for (x = 0; x < width; ++x) {
-			dst[y*stride_dst_y + x*stride_dst_x] = src[y*stride_src_y + x*stride_src_x];
+			int sample = get_sample(frame, y*width + x);
+			int magnitude = safe_abs(sample) / factor;
+
+			switch (depth) {
+				case sizeof(char): {
+					unsigned char *line_ = line;
+
+					line_ [x] = (unsigned char) clamp(magnitude, 0, maxval);
+
+					break;
+				}
+				case sizeof(short): {
+					unsigned short *line_ = line;
+
+					line_ [x] = native_to_be_s( (unsigned short) clamp(magnitude, 0, maxval) );
+
+					break;
+				}
+				default:
+					dprint (("[ERROR] unhandled bit depth\n"));
+					alloc_free(line);
+					fclose(stream);
+					return RET_FAILURE_LOGIC_ERROR;
+			}
+		}
+
+		if (1 != fwrite(line, stride, 1, stream)) {
+			fclose(stream);
+			return RET_FAILURE_FILE_IO;
 		}
 	}
+
+	alloc_free(line);
+
+	if (EOF == fclose(stream)) {
+		return RET_FAILURE_FILE_IO;
+	}
+
+	return RET_SUCCESS;
 }
 
-int frame_convert_chunked_to_semiplanar(struct frame *frame)
+void frame_destroy(struct frame *frame)
+{
+	assert(frame != NULL);
+
+	alloc_free(frame->data);
+	alloc_free(frame->data16);
+
+	frame->data = NULL;
+	frame->data16 = NULL;
+}
+
+/* copy \p n samples taking every \p src_step-th one from \p src into every \p dst_step-th one of \p dst */
+static void copy_samples(int *dst, size_t dst_step, const int *src, size_t src_step, size_t n)
+{
+	size_t c;
+
+	for (c = 0; c < n; ++c) {
+		dst[c * dst_step] = src[c * src_step];
+	}
+}
+
+/* copy_samples() for the 16-bit storage */
+static void copy_samples16(short *dst, size_t dst_step, const short *src, size_t src_step, size_t n)
+{
+	size_t c;
+
+	for (c = 0; c < n; ++c) {
+		dst[c * dst_step] = src[c * src_step];
+	}
+}
+
+/*
+ * The conversion processes the frame in strips of 8 rows in the chunked
+ * layout. Each strip holds (8>>j) rows of each subband at the level j, so
+ * the strip is read from the cache for all 10 subbands, while the subbands
+ * in the semiplanar layout are accessed row by row. The strips are
+ * independent and they are distributed among threads when compiled with
+ * OpenMP. The \p forward is nonzero for chunked to semiplanar.
+ */
+static void convert_layout(struct frame *dst, const struct frame *src, size_t height, size_t width, int forward)
+{
+	ptrdiff_t y;
+
+#ifdef _OPENMP
+#	pragma omp parallel for schedule(static)
+#endif
+	for (y = 0; y < (ptrdiff_t) height; y += 8) {
+		int j, b;
+
+		for (j = 1; j < 4; ++j) {
+			size_t rows = (size_t) 8 >> j, width_j = width >> j, step = (size_t) 1 << j;
+
+			/* b = 0 for LL (the level 3 only), 1 for HL, 2 for LH, 3 for HH */
+			for (b = (j == 3 ? 0 : 1); b < 4; ++b) {
+				size_t offset_y = (size_t) (b >> 1) << (j - 1);
+				size_t offset_x = (size_t) (b & 1) << (j - 1);
+				size_t band = (size_t) (b >> 1) * (height >> j) * width + (size_t) (b & 1) * width_j;
+				size_t r;
+
+				for (r = 0; r < rows; ++r) {
+					/* the offsets of the row in both the layouts */
+					size_t semiplanar = band + ((size_t) y / 8 * rows + r) * width;
+					size_t chunked = ((size_t) y + (r << j) + offset_y) * width + offset_x;
+
+					if (src->data16 != NULL) {
+						if (forward) {
+							copy_samples16(dst->data16 + semiplanar, 1, src->data16 + chunked, step, width_j);
+						} else {
+							copy_samples16(dst->data16 + chunked, step, src->data16 + semiplanar, 1, width_j);
+						}
+					} else {
+						if (forward) {
+							copy_samples(dst->data + semiplanar, 1, src->data + chunked, step, width_j);
+						} else {
+							copy_samples(dst->data + chunked, step, src->data + semiplanar, 1, width_j);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+ * \brief Prepare the framebuffer of \p dst to hold \p height x \p width pixels of \p src
+ *
+ * The framebuffer of \p dst is reused if it uses the storage of \p src.
+ */
+static int frame_prepare_like(struct frame *dst, const struct frame *src, size_t height, size_t width)
+{
+	assert(dst != NULL);
+	assert(src != NULL);
+	assert(dst->data == NULL || dst->data != src->data);
+	assert(dst->data16 == NULL || dst->data16 != src->data16);
+
+	if ((dst->data16 != NULL) != (src->data16 != NULL)) {
+		frame_destroy(dst);
+	}
+
+	dst->height = height;
+	dst->width = width;
+	dst->bpp = src->bpp;
+
+	if (dst->data == NULL && dst->data16 == NULL) {
+		return realloc_data(dst, src->data16 != NULL);
+	}
+
+	return frame_realloc_data(dst);
+}
+
+/**
+ * \brief Convert the framebuffer between the layouts, \p forward is nonzero for chunked to semiplanar
+ */
+static int frame_copy_layout(struct frame *dst, const struct frame *src, int forward)
 {
 	size_t height, width;
-	int *semiplanar_data, *chunked_data;
-	int j;
+	int err;
+
+	assert(src != NULL);
+	assert(src->data != NULL || src->data16 != NULL);
+
+	err = frame_prepare_like(dst, src, src->height, src->width);
+
+	if (err) {
+		return err;
+	}
+
+	height = ceil_multiple8(src->height);
+	width = ceil_multiple8(src->width);
+
+	convert_layout(dst, src, height, width, forward);
+
+	return RET_SUCCESS;
+}
+
+int frame_copy_chunked_to_semiplanar(struct frame *dst, const struct frame *src)
+{
+	return frame_copy_layout(dst, src, 1);
+}
+
+int frame_copy_semiplanar_to_chunked(struct frame *dst, const struct frame *src)
+{
+	return frame_copy_layout(dst, src, 0);
+}
+
+/**
+ * \brief Convert the layout of the \p frame using a temporary framebuffer
+ */
+static int frame_convert_layout(struct frame *frame, int forward)
+{
+	struct frame converted;
 	int err;
 
 	assert(frame != NULL);
 
-	height = ceil_multiple8(frame->height);
-	width = ceil_multiple8(frame->width);
+	converted.data = NULL;
+	converted.data16 = NULL;
 
-	chunked_data = frame->data;
+	err = frame_copy_layout(&converted, frame, forward);
 
-	err = frame_alloc_data(frame);
+	if (err) {
+		return err;
+	}
+
+	frame_destroy(frame);
+
+	*frame = converted;
+
+	return RET_SUCCESS;
+}
+
+int frame_convert_chunked_to_semiplanar(struct frame *frame)
+{
+	return frame_convert_layout(frame, 1);
+}
+
+int frame_convert_semiplanar_to_chunked(struct frame *frame)
+{
+	return frame_convert_layout(frame, 0);
+}
+
+int frame_decimate(struct frame *dst, const struct frame *src, int level)
+{
+	size_t height_, width_;
+	size_t height, width;
+	size_t src_width;
+	size_t y, x;
+	int err;
+
+	assert(src != NULL);
+	assert(src->data != NULL || src->data16 != NULL);
+	assert(level >= 0 && level <= 3);
+
+	height_ = (src->height + ((size_t) 1 << level) - 1) >> level;
+	width_  = (src->width  + ((size_t) 1 << level) - 1) >> level;
+
+	err = frame_prepare_like(dst, src, height_, width_);
 
 	if (err) {
 		return err;
 	}
 
-	semiplanar_data = frame->data;
+	height = ceil_multiple8(height_);
+	width = ceil_multiple8(width_);
+
+	src_width = ceil_multiple8(src->width);
+
+	/* the padding repeats the last row and column */
+	for (y = 0; y < height; ++y) {
+		size_t src_y = (y < height_ ? y : height_ - 1) << level;
+
+		for (x = 0; x < width; ++x) {
+			size_t src_x = (x < width_ ? x : width_ - 1) << level;
+
+			set_sample(dst, y*width + x, get_sample(src, src_y*src_width + src_x));
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+int frame_crop(struct frame *dst, const struct frame *src, size_t y, size_t x, size_t height_, size_t width_)
+{
+	size_t height, width;
+	size_t src_width;
+	size_t j, i;
+	int err;
+
+	assert(src != NULL);
+	assert(src->data != NULL || src->data16 != NULL);
+
+	if (height_ == 0 || width_ == 0 || y >= src->height || x >= src->width) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	/* clip the rectangle to the source */
+	if (height_ > src->height - y) {
+		height_ = src->height - y;
+	}
+
+	if (width_ > src->width - x) {
+		width_ = src->width - x;
+	}
 
-	/* for each level */
-	for (j = 1; j < 4; ++j) {
-		/* shared for both the layouts */
-		size_t width_j = width>>j, height_j = height>>j;
+	err = frame_prepare_like(dst, src, height_, width_);
 
-		/* semiplanar layout */
-		size_t stride_semiplanar_x = 1;
-		size_t stride_semiplanar_y = width;
+	if (err) {
+		return err;
+	}
 
-		int *band_semiplanar_ll = semiplanar_data +        0*stride_semiplanar_y +       0*stride_semiplanar_x;
-		int *band_semiplanar_hl = semiplanar_data +        0*stride_semiplanar_y + width_j*stride_semiplanar_x;
-		int *band_semiplanar_lh = semiplanar_data + height_j*stride_semiplanar_y +       0*stride_semiplanar_x;
-		int *band_semiplanar_hh = semiplanar_data + height_j*stride_semiplanar_y + width_j*stride_semiplanar_x;
+	height = ceil_multiple8(height_);
+	width = ceil_multiple8(width_);
 
-		/* chunked layout */
-		size_t stride_chunked_x = (1U << j);
-		size_t stride_chunked_y = (1U << j) * width;
+	src_width = ceil_multiple8(src->width);
 
-		int *band_chunked_ll = chunked_data + 0 + 0;
-		int *band_chunked_hl = chunked_data + 0 + stride_chunked_x/2;
-		int *band_chunked_lh = chunked_data + stride_chunked_y/2 + 0;
-		int *band_chunked_hh = chunked_data + stride_chunked_y/2 + stride_chunked_x/2;
+	/* the padding repeats the last row and column */
+	for (j = 0; j < height; ++j) {
+		size_t src_y = y + (j < height_ ? j : height_ - 1);
 
-		/* for each subband (HL, LH, HH) */
-		copy_band(band_semiplanar_hl, band_chunked_hl, height_j, width_j, stride_semiplanar_x, stride_semiplanar_y, stride_chunked_x, stride_chunked_y);
-		copy_band(band_semiplanar_lh, band_chunked_lh, height_j, width_j, stride_semiplanar_x, stride_semiplanar_y, stride_chunked_x, stride_chunked_y);
-		copy_band(band_semiplanar_hh, band_chunked_hh, height_j, width_j, stride_semiplanar_x, stride_semiplanar_y, stride_chunked_x, stride_chunked_y);
+		for (i = 0; i < width; ++i) {
+			size_t src_x = x + (i < width_ ? i : width_ - 1);
 
-		/* LL */
-		if (j == 3) {
-			copy_band(band_semiplanar_ll, band_chunked_ll, height_j, width_j, stride_semiplanar_x, stride_semiplanar_y, stride_chunked_x, stride_chunked_y);
+			set_sample(dst, j*width + i, get_sample(src, src_y*src_width + src_x));
 		}
 	}
 
-	free(chunked_data);
+	return RET_SUCCESS;
+}
+
+int frame_export_rows(const struct frame *frame, size_t y0, size_t height, void *ptr, size_t stride, int type)
+{
+	size_t width;
+	size_t frame_width;
+	size_t y, x;
+	int maxval;
+	unsigned char *row;
+
+	assert(frame != NULL);
+	assert(frame->data != NULL || frame->data16 != NULL);
+
+	if (ptr == NULL || frame->bpp == 0 || frame->bpp > 16 || y0 > frame->height || height > frame->height - y0) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	width = frame->width;
+
+	frame_width = ceil_multiple8(width);
+
+	maxval = (int) convert_bpp_to_maxval(frame->bpp);
+
+	if ((type == FRAME_TYPE_UCHAR && maxval > UCHAR_MAX) || (type == FRAME_TYPE_USHORT && (unsigned) maxval > USHRT_MAX)) {
+		return RET_FAILURE_LOGIC_ERROR;
+	}
+
+	for (y = y0, row = ptr; y < y0 + height; ++y, row += stride) {
+		const size_t n = y*frame_width;
+
+		switch (type) {
+			case FRAME_TYPE_UCHAR:
+				for (x = 0; x < width; ++x) {
+					row[x] = (unsigned char) clamp(get_sample(frame, n + x), 0, maxval);
+				}
+				break;
+			case FRAME_TYPE_USHORT:
+				for (x = 0; x < width; ++x) {
+					((unsigned short *) row)[x] = (unsigned short) clamp(get_sample(frame, n + x), 0, maxval);
+				}
+				break;
+			case FRAME_TYPE_INT:
+				for (x = 0; x < width; ++x) {
+					((int *) row)[x] = clamp(get_sample(frame, n + x), 0, maxval);
+				}
+				break;
+			case FRAME_TYPE_FLOAT:
+				for (x = 0; x < width; ++x) {
+					((float *) row)[x] = (float) clamp(get_sample(frame, n + x), 0, maxval);
+				}
+				break;
+			default:
+				return RET_FAILURE_LOGIC_ERROR;
+		}
+	}
 
 	return RET_SUCCESS;
 }
 
+int frame_export(const struct frame *frame, void *ptr, size_t stride, int type)
+{
+	assert(frame != NULL);
+
+	return frame_export_rows(frame, 0, frame->height, ptr, stride, type);
+}
+
 int frame_clone(const struct frame *frame, struct frame *cloned_frame)
 {
 	int err;
@@ -743,7 +1573,7 @@ int frame_clone(const struct frame *frame, struct frame *cloned_frame)
 
 	*cloned_frame = *frame;
 
-	err = frame_alloc_data(cloned_frame);
+	err = frame_alloc_data_like(cloned_frame, frame);
 
 	if (err) {
 		return err;
@@ -752,35 +1582,36 @@ int frame_clone(const struct frame *frame, struct frame *cloned_frame)
 	height = ceil_multiple8(frame->height);
 	width = ceil_multiple8(frame->width);
 
-	memcpy(cloned_frame->data, frame->data, height * width * sizeof(int));
+	if (frame->data16 != NULL) {
+		memcpy(cloned_frame->data16, frame->data16, height * width * sizeof(short));
+	} else {
+		memcpy(cloned_frame->data, frame->data, height * width * sizeof(int));
+	}
 
 	return RET_SUCCESS;
 }
 
 int frame_dump_chunked_as_semiplanar(const struct frame *frame, const char *path, int factor)
 {
-	struct frame clone;
+	struct frame semiplanar;
 	int err;
 
-	err = frame_clone(frame, &clone);
-
-	if (err) {
-		return err;
-	}
+	semiplanar.data = NULL;
+	semiplanar.data16 = NULL;
 
-	err = frame_convert_chunked_to_semiplanar(&clone);
+	err = frame_copy_chunked_to_semiplanar(&semiplanar, frame);
 
 	if (err) {
 		return err;
 	}
 
-	err = frame_dump(&clone, path, factor);
+	err = frame_dump(&semiplanar, path, factor);
 
 	if (err) {
 		return err;
 	}
 
-	frame_destroy(&clone);
+	frame_destroy(&semiplanar);
 
 	return RET_SUCCESS;
 }
@@ -809,7 +1640,6 @@ int frame_dump_mse(const struct frame *frameA, const struct frame *frameB)
 {
 	size_t height, width;
 	size_t y, x;
-	int *dataA, *dataB;
 	double mse;
 
 	assert(frameA != NULL);
@@ -823,18 +1653,15 @@ int frame_dump_mse(const struct frame *frameA, const struct frame *frameB)
 	height = frameA->height;
 	width = frameA->width;
 
-	dataA = frameA->data;
-	dataB = frameB->data;
-
-	assert(dataA != NULL);
-	assert(dataB != NULL);
+	assert(frameA->data != NULL || frameA->data16 != NULL);
+	assert(frameB->data != NULL || frameB->data16 != NULL);
 
 	mse = 0.;
 
 	for (y = 0; y < height; ++y) {
 		for (x = 0; x < width; ++x) {
-			int pixA = dataA[y*width + x];
-			int pixB = dataB[y*width + x];
+			int pixA = get_sample(frameA, y*width + x);
+			int pixB = get_sample(frameB, y*width + x);
 			int e;
 
 			if ((pixA < 0 && pixB > INT_MAX + pixA) || (pixA > 0 && pixB < INT_MIN + pixA)) {
@@ -878,7 +1705,6 @@ int frame_diff(struct frame *frame, const struct frame *frameA, const struct fra
 {
 	size_t height, width;
 	size_t y, x;
-	int *data, *dataA, *dataB;
 
 	if (frame_cmp(frame, frameA) || frame_cmp(frame, frameB)) {
 		dprint (("[ERROR] frame dimensions must be identical\n"));
@@ -892,18 +1718,14 @@ int frame_diff(struct frame *frame, const struct frame *frameA, const struct fra
 	height = ceil_multiple8(frame->height);
 	width = ceil_multiple8(frame->width);
 
-	data  = frame->data;
-	dataA = frameA->data;
-	dataB = frameB->data;
-
-	assert(data != NULL);
-	assert(dataA != NULL);
-	assert(dataB != NULL);
+	assert(frame->data != NULL || frame->data16 != NULL);
+	assert(frameA->data != NULL || frameA->data16 != NULL);
+	assert(frameB->data != NULL || frameB->data16 != NULL);
 
 	for (y = 0; y < height; ++y) {
 		for (x = 0; x < width; ++x) {
-			int pixA = dataA[y*width + x];
-			int pixB = dataB[y*width + x];
+			int pixA = get_sample(frameA, y*width + x);
+			int pixB = get_sample(frameB, y*width + x);
 			int e;
 
 			if ((pixA < 0 && pixB > INT_MAX + pixA) || (pixA > 0 && pixB < INT_MIN + pixA)) {
@@ -914,7 +1736,7 @@ int frame_diff(struct frame *frame, const struct frame *frameA, const struct fra
 			/* error */
 			e = pixB - pixA;
 
-			data[y*width + x] = safe_abs(e) * (1 << 5);
+			set_sample(frame, y*width + x, safe_abs(e) * (1 << 5));
 		}
 	}
 
@@ -926,7 +1748,6 @@ int frame_scale_pixels(struct frame *frame, size_t bpp)
 	size_t height, width;
 	size_t y, x;
 	size_t old_bpp;
-	int *data;
 
 	assert(frame != NULL);
 
@@ -935,16 +1756,22 @@ int frame_scale_pixels(struct frame *frame, size_t bpp)
 
 	old_bpp = frame->bpp;
 
-	data = frame->data;
+	assert(frame->data != NULL || frame->data16 != NULL);
 
-	assert(data != NULL);
+	/* the pixels will not fit into 16-bit storage */
+	if (!is_data16_bpp(bpp)) {
+		int err = frame_widen_data(frame);
+
+		if (err) {
+			return err;
+		}
+	}
 
 	if (old_bpp < bpp) {
 		for (y = 0; y < height; ++y) {
 			for (x = 0; x < width; ++x) {
-				int px = data[y*width + x];
-				data[y*width + x] <<= bpp - old_bpp;
-				data[y*width + x] |= px;
+				int px = get_sample(frame, y*width + x);
+				set_sample(frame, y*width + x, (px << (bpp - old_bpp)) | px);
 			}
 		}
 	}
@@ -959,21 +1786,18 @@ void frame_randomize(struct frame *frame)
 	size_t height, width;
 	size_t y, x;
 	int maxval;
-	int *data;
 
 	assert(frame != NULL);
 
 	height = ceil_multiple8(frame->height);
 	width = ceil_multiple8(frame->width);
 
-	data = frame->data;
-
 	maxval = (int) convert_bpp_to_maxval(frame->bpp);
 
 	for (y = 0; y < height; ++y) {
 		for (x = 0; x < width; ++x) {
 			int sample = (int) (x ^ y) & maxval;
-			data[y*width + x] = sample;
+			set_sample(frame, y*width + x, sample);
 		}
 	}
 }
@@ -12,6 +12,9 @@
  *
  * The \c width and \c height are exact image dimensions, i.e. not rounded to next multiple of eight.
  * However the \c data is a buffer having dimensions to be multiples of eight.
+ *
+ * Frames with \c bpp up to \c CONFIG_FRAME_DATA16_BPP store the samples in \c data16 instead of \c data.
+ * Exactly one of these buffers is allocated, the other one is \c NULL.
  */
 struct frame {
 	size_t height; /**< \brief number of rows, range [17; infty) */
@@ -19,6 +22,40 @@ struct frame {
 	size_t bpp;    /**< \brief pixel bit depth (valid in image domain, not in transform domain) */
 
 	int *data;     /**< \brief framebuffer */
+	short *data16; /**< \brief 16-bit framebuffer (used instead of \c data) */
+};
+
+/**
+ * \brief Pixel types of the caller buffers, see frame_export()
+ */
+enum {
+	FRAME_TYPE_UCHAR,
+	FRAME_TYPE_USHORT,
+	FRAME_TYPE_INT,
+	FRAME_TYPE_FLOAT
+};
+
+/**
+ * \brief Sample formats of the headerless rasters, see struct frame_raw
+ */
+enum {
+	FRAME_RAW_8,        /**< \brief one byte per sample */
+	FRAME_RAW_16LE,     /**< \brief two bytes per sample, little-endian */
+	FRAME_RAW_16BE,     /**< \brief two bytes per sample, big-endian */
+	FRAME_RAW_PACKED10, /**< \brief MIPI RAW10, four samples in five bytes (the high 8 bits of each, then the low 2 bits of all) */
+	FRAME_RAW_PACKED12  /**< \brief MIPI RAW12, two samples in three bytes (the high 8 bits of each, then the low 4 bits of both) */
+};
+
+/**
+ * \brief Layout of a headerless raster
+ */
+struct frame_raw {
+	size_t height; /**< \brief number of rows */
+	size_t width;  /**< \brief number of samples in a row */
+	size_t bpp;    /**< \brief bit depth of the samples, the bits above are ignored */
+	int format;    /**< \brief \c FRAME_RAW_* */
+	size_t stride; /**< \brief distance of the rows in bytes, 0 for the rows following each other */
+	size_t offset; /**< \brief number of bytes skipped at the beginning of the file */
 };
 
 /**
@@ -39,6 +76,42 @@ int frame_save_pgm(const struct frame *frame, const char *path);
  */
 int frame_load_pgm(struct frame *frame, const char *path);
 
+/**
+ * \brief Load image from PGM file into the framebuffer of the \p frame
+ *
+ * As frame_load_pgm(), but the framebuffer is reallocated rather than allocated anew, so
+ * that a single frame can be reused across many images. The \p frame must hold a framebuffer
+ * (possibly of another geometry), or have \c NULL data pointers.
+ */
+int frame_reload_pgm(struct frame *frame, const char *path);
+
+/**
+ * \brief Load image from a headerless raster file of the given layout
+ *
+ * The packed formats store each row in whole groups, i.e., the row length is rounded up to 4 or 2 samples.
+ * If \p path is \c "-", the input is read from the \c stdin.
+ */
+int frame_load_raw(struct frame *frame, const char *path, const struct frame_raw *raw);
+
+/**
+ * \brief Length of a row of the headerless raster in bytes, 0 for an unsupported layout
+ */
+size_t frame_raw_row_size(const struct frame_raw *raw);
+
+/**
+ * \brief Unpack the row of \c width samples of the headerless raster at \p line into \p data
+ *
+ * The packed formats are unpacked in whole groups, so the \p data must hold \c width samples rounded up to a multiple of 4.
+ */
+void frame_raw_unpack_row(const struct frame_raw *raw, int *data, const unsigned char *line);
+
+/**
+ * \brief Store the row of \c width \p samples into the row \p y of the framebuffer
+ *
+ * The padding columns repeat the last sample. Storing the last row also fills the padding rows.
+ */
+void frame_store_row(struct frame *frame, size_t y, const int *samples);
+
 /**
  * \brief Debugging dump
  *
@@ -57,6 +130,62 @@ void frame_destroy(struct frame *frame);
  */
 int frame_convert_chunked_to_semiplanar(struct frame *frame);
 
+/**
+ * \brief Convert DWT from semiplanar layout to chunked layout
+ * \sa \ref memoryLayouts
+ */
+int frame_convert_semiplanar_to_chunked(struct frame *frame);
+
+/**
+ * \brief Copy DWT in chunked layout from \p src into \p dst in semiplanar layout
+ *
+ * The framebuffer of \p dst is reused when it has the storage of \p src, otherwise it is allocated.
+ * The \p dst must be either a valid frame or have \c data and \c data16 set to \c NULL.
+ * \sa \ref memoryLayouts
+ */
+int frame_copy_chunked_to_semiplanar(struct frame *dst, const struct frame *src);
+
+/**
+ * \brief Copy DWT in semiplanar layout from \p src into \p dst in chunked layout
+ *
+ * See frame_copy_chunked_to_semiplanar().
+ */
+int frame_copy_semiplanar_to_chunked(struct frame *dst, const struct frame *src);
+
+/**
+ * \brief Copy every (1 << \p level)-th row and column of \p src into \p dst
+ *
+ * The \p dst gets the dimensions of \p src divided by (1 << \p level) and rounded up.
+ * For the frame in chunked layout, this extracts the LL band at the \p level.
+ * The framebuffer of \p dst is reused when possible, see frame_copy_chunked_to_semiplanar().
+ */
+int frame_decimate(struct frame *dst, const struct frame *src, int level);
+
+/**
+ * \brief Copy the rectangle of \p height x \p width pixels at (\p y, \p x) of \p src into \p dst
+ *
+ * The rectangle is clipped to \p src, it must not be empty nor start outside \p src.
+ * The padding of \p dst repeats the last row and column.
+ * The framebuffer of \p dst is reused when possible, see frame_copy_chunked_to_semiplanar().
+ */
+int frame_crop(struct frame *dst, const struct frame *src, size_t y, size_t x, size_t height, size_t width);
+
+/**
+ * \brief Store the pixels of the \p frame into the caller buffer at \p ptr
+ *
+ * The buffer holds \c height rows of \c width pixels of the \p type (\c FRAME_TYPE_*),
+ * the consecutive rows are \p stride bytes apart. The pixels are clamped to the range of
+ * the \c bpp bit samples. The buffer must be suitably aligned for the \p type.
+ */
+int frame_export(const struct frame *frame, void *ptr, size_t stride, int type);
+
+/**
+ * \brief Store the \p height rows of the \p frame starting at the row \p y into the caller buffer at \p ptr
+ *
+ * See frame_export(), the first row of the buffer receives the row \p y.
+ */
+int frame_export_rows(const struct frame *frame, size_t y, size_t height, void *ptr, size_t stride, int type);
+
 /*! \page memoryLayouts Memory layouts
  *
  * Considering the discrete wavelet transform, there are several ways how
@@ -128,6 +257,26 @@ int frame_scale_pixels(struct frame *frame, size_t bpp);
 int frame_alloc_data(struct frame *frame);
 int frame_realloc_data(struct frame *frame);
 
+/**
+ * \brief Reallocate the framebuffer for the current geometry
+ *
+ * Unlike frame_realloc_data(), which keeps the current storage, the storage is selected according
+ * to the bit depth, so that a reused framebuffer holds the same samples as a newly allocated one.
+ */
+int frame_reset_data(struct frame *frame);
+
+/**
+ * \brief Change the storage of the framebuffer from 16-bit integers to int, keeping the samples
+ *
+ * Does nothing if the framebuffer already uses the int storage.
+ */
+int frame_widen_data(struct frame *frame);
+
+/**
+ * \brief Number of bytes of an arena taken by the framebuffer of \p height x \p width pixels of \p bpp bits (zero selects the int storage), see arena_sizeof()
+ */
+size_t frame_sizeof(size_t height, size_t width, size_t bpp);
+
 int frame_create_random(struct frame *frame);
 
 void frame_randomize(struct frame *frame);
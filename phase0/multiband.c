@@ -0,0 +1,124 @@
+/**
+ * Compresses and decompresses the raw multiband image cubes
+ *
+ * Each band is coded as an independent CCSDS 122.0 stream, see cube.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "frame.h"
+#include "bpe.h"
+#include "cube.h"
+#include "cli.h"
+
+static int parse_interleave(const char *s)
+{
+	if (0 == strcmp(s, "bsq"))
+		return CUBE_BSQ;
+	if (0 == strcmp(s, "bil"))
+		return CUBE_BIL;
+	if (0 == strcmp(s, "bip"))
+		return CUBE_BIP;
+
+	return -1;
+}
+
+static int compress(int argc, char *argv[])
+{
+	struct cube cube;
+	struct frame_raw raw;
+	struct parameters parameters;
+	size_t bands;
+	int interleave;
+
+	if (argc < 10) {
+		fprintf(stderr, "[ERROR] usage: %s c <input cube> <output file> <width> <height> <bands> <bsq|bil|bip> <8|16le|16be|raw10|raw12> <bpp> [<DWTtype>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	raw.width = (size_t) atol(argv[4]);
+	raw.height = (size_t) atol(argv[5]);
+	bands = (size_t) atol(argv[6]);
+	interleave = parse_interleave(argv[7]);
+	raw.format = cli_parse_format(argv[8]);
+	raw.bpp = (size_t) atol(argv[9]);
+	raw.stride = 0;
+	raw.offset = 0;
+
+	init_parameters(&parameters);
+
+	parameters.DWTtype = argc > 10 ? atoi(argv[10]) : 0;
+
+	if (raw.width > (1<<20) || raw.width < 17 || raw.height < 17 || bands == 0 || interleave < 0 || raw.format < 0 || (parameters.DWTtype != 0 && parameters.DWTtype != 1)) {
+		fprintf(stderr, "[ERROR] invalid arguments\n");
+		return EXIT_FAILURE;
+	}
+
+	if (cube_load_raw(&cube, argv[2], &raw, bands, interleave)) {
+		fprintf(stderr, "[ERROR] unable to load the cube\n");
+		return EXIT_FAILURE;
+	}
+
+	if (cube_compress(&cube, &parameters, argv[3])) {
+		fprintf(stderr, "[ERROR] unable to compress the cube\n");
+		return EXIT_FAILURE;
+	}
+
+	cube_destroy(&cube);
+
+	return EXIT_SUCCESS;
+}
+
+static int decompress(int argc, char *argv[])
+{
+	struct cube cube;
+	struct parameters parameters;
+	int interleave, format;
+
+	if (argc < 6) {
+		fprintf(stderr, "[ERROR] usage: %s d <input file> <output cube> <bsq|bil|bip> <8|16le|16be>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	interleave = parse_interleave(argv[4]);
+	format = cli_parse_format(argv[5]);
+
+	if (interleave < 0 || format < 0) {
+		fprintf(stderr, "[ERROR] invalid arguments\n");
+		return EXIT_FAILURE;
+	}
+
+	init_parameters(&parameters);
+
+	if (cube_decompress(&cube, &parameters, argv[2])) {
+		fprintf(stderr, "[ERROR] unable to decompress the cube\n");
+		return EXIT_FAILURE;
+	}
+
+	if (cube_save_raw(&cube, argv[3], format, interleave)) {
+		fprintf(stderr, "[ERROR] unable to save the cube\n");
+		return EXIT_FAILURE;
+	}
+
+	cube_destroy(&cube);
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc > 1 && 0 == strcmp(argv[1], "c")) {
+		return compress(argc, argv);
+	}
+
+	if (argc > 1 && 0 == strcmp(argv[1], "d")) {
+		return decompress(argc, argv);
+	}
+
+	fprintf(stderr, "[ERROR] usage: %s c|d ...\n", argv[0]);
+
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,176 @@
+#include "open122.h"
+
+#include <assert.h>
+
+int open122_encoder_init(struct open122_encoder *encoder, size_t height, size_t width, const struct parameters *parameters)
+{
+	int err;
+
+	assert(encoder != NULL);
+	assert(parameters != NULL);
+
+	encoder->parameters = *parameters;
+
+	bpe_init_reuse(&encoder->bpe);
+
+	err = dwt_init(&encoder->dwt, height, width);
+
+	if (err) {
+		return err;
+	}
+
+	err = dwt_reserve(&encoder->dwt, height, width, parameters);
+
+	if (err) {
+		open122_encoder_destroy(encoder);
+		return err;
+	}
+
+	err = bpe_reserve(&encoder->bpe, height, width, parameters);
+
+	if (err) {
+		open122_encoder_destroy(encoder);
+		return err;
+	}
+
+	return RET_SUCCESS;
+}
+
+size_t open122_encoder_sizeof(size_t height, size_t width, const struct parameters *parameters)
+{
+	assert(parameters != NULL);
+
+	return dwt_sizeof(height, width, parameters) + bpe_sizeof(height, width, parameters);
+}
+
+void open122_encoder_destroy(struct open122_encoder *encoder)
+{
+	assert(encoder != NULL);
+
+	dwt_destroy(&encoder->dwt);
+	bpe_destroy(&encoder->bpe, NULL);
+}
+
+int open122_encode(struct open122_encoder *encoder, struct frame *frame, struct bio *bio)
+{
+	return open122_encode_indexed(encoder, frame, bio, NULL);
+}
+
+int open122_encode_indexed(struct open122_encoder *encoder, struct frame *frame, struct bio *bio, struct container *container)
+{
+	int err;
+
+	assert(encoder != NULL);
+
+	err = dwt_encode(&encoder->dwt, frame, &encoder->parameters);
+
+	if (err) {
+		return err;
+	}
+
+	return bpe_encode_reuse(&encoder->bpe, frame, &encoder->parameters, bio, container);
+}
+
+int open122_decoder_init(struct open122_decoder *decoder, size_t height, size_t width, const struct parameters *parameters)
+{
+	int err;
+
+	assert(decoder != NULL);
+	assert(parameters != NULL);
+
+	decoder->parameters = *parameters;
+
+	/* the framebuffer is allocated at once */
+	if (decoder->parameters.DecodeHeightHint == 0) {
+		decoder->parameters.DecodeHeightHint = height;
+	}
+
+	decoder->frame.height = 0;
+	decoder->frame.width = 0;
+	decoder->frame.bpp = 0;
+	decoder->frame.data = NULL;
+	decoder->frame.data16 = NULL;
+
+	bpe_init_reuse(&decoder->bpe);
+
+	err = dwt_init(&decoder->dwt, height, width);
+
+	if (err) {
+		return err;
+	}
+
+	err = dwt_reserve(&decoder->dwt, height, width, parameters);
+
+	if (err) {
+		open122_decoder_destroy(decoder);
+		return err;
+	}
+
+	err = bpe_reserve(&decoder->bpe, height, width, parameters);
+
+	if (err) {
+		open122_decoder_destroy(decoder);
+		return err;
+	}
+
+	return RET_SUCCESS;
+}
+
+size_t open122_decoder_sizeof(size_t height, size_t width, const struct parameters *parameters)
+{
+	size_t rows;
+
+	assert(parameters != NULL);
+
+	rows = parameters->DecodeHeightHint > height ? parameters->DecodeHeightHint : height;
+
+	/* the bit depth is not known, the framebuffer takes the widest storage */
+	return dwt_sizeof(height, width, parameters) + bpe_sizeof(height, width, parameters) + frame_sizeof(rows, width, 0);
+}
+
+void open122_decoder_destroy(struct open122_decoder *decoder)
+{
+	assert(decoder != NULL);
+
+	frame_destroy(&decoder->frame);
+	dwt_destroy(&decoder->dwt);
+	bpe_destroy(&decoder->bpe, NULL);
+}
+
+/* decode the coefficients, the DWTtype is read from the stream */
+static int open122_decode_coefficients(struct open122_decoder *decoder, struct bio *bio, struct parameters *parameters)
+{
+	assert(decoder != NULL);
+
+	*parameters = decoder->parameters;
+
+	return bpe_decode_reuse(&decoder->bpe, &decoder->frame, parameters, bio);
+}
+
+int open122_decode(struct open122_decoder *decoder, struct bio *bio)
+{
+	struct parameters parameters;
+	int err;
+
+	err = open122_decode_coefficients(decoder, bio, &parameters);
+
+	if (err) {
+		return err;
+	}
+
+	return dwt_decode(&decoder->dwt, &decoder->frame, &parameters);
+}
+
+int open122_decode_into(struct open122_decoder *decoder, struct bio *bio, void *ptr, size_t stride, int type)
+{
+	struct parameters parameters;
+	int err;
+
+	err = open122_decode_coefficients(decoder, bio, &parameters);
+
+	if (err) {
+		return err;
+	}
+
+	return dwt_decode_into(&decoder->dwt, &decoder->frame, &parameters, ptr, stride, type);
+}
@@ -0,0 +1,114 @@
+/**
+ * \file open122.h
+ * \brief Encoder and decoder contexts
+ *
+ * A context is initialized once for a geometry and a set of parameters, and
+ * it keeps the DWT workspace and the BPE buffers across the frames. Once the
+ * buffers have grown for the geometry, encoding a frame allocates no memory.
+ * Larger frames grow the buffers.
+ *
+ * For a fixed memory budget, the contexts can be carved from a single arena
+ * (see alloc.h) of the size given by open122_encoder_sizeof() and
+ * open122_decoder_sizeof().
+ */
+#ifndef OPEN122_H_
+#define OPEN122_H_
+
+#include "common.h"
+#include "frame.h"
+#include "dwt.h"
+#include "bio.h"
+#include "bpe.h"
+#include "container.h"
+
+#include <stddef.h>
+
+/**
+ * \brief Encoder context
+ */
+struct open122_encoder {
+	struct parameters parameters;
+
+	struct dwt dwt;
+	struct bpe bpe;
+};
+
+/**
+ * \brief Decoder context
+ */
+struct open122_decoder {
+	struct parameters parameters;
+
+	struct dwt dwt;
+	struct bpe bpe;
+
+	/** the decoded image, valid until the next call of open122_decode() */
+	struct frame frame;
+};
+
+/**
+ * \brief Initialize the encoder for frames of \p height x \p width pixels coded with the \p parameters
+ */
+int open122_encoder_init(struct open122_encoder *encoder, size_t height, size_t width, const struct parameters *parameters);
+
+/**
+ * \brief Number of bytes of an arena taken by the encoder for frames up to \p height x \p width pixels
+ *
+ * Once open122_encoder_init() has allocated this memory, encoding such frames allocates nothing.
+ */
+size_t open122_encoder_sizeof(size_t height, size_t width, const struct parameters *parameters);
+
+/**
+ * \brief Release the encoder
+ */
+void open122_encoder_destroy(struct open122_encoder *encoder);
+
+/**
+ * \brief Encode the \p frame into the \p bio
+ *
+ * The \p frame is transformed <em>in situ</em>, it holds the DWT coefficients afterwards.
+ * The \p bio must hold get_maximum_stream_size() bytes.
+ */
+int open122_encode(struct open122_encoder *encoder, struct frame *frame, struct bio *bio);
+
+/**
+ * \brief Encode the \p frame as open122_encode() does, and record the segments into the \p container
+ *
+ * See bpe_encode_indexed(), the stream is then passed to container_finish().
+ */
+int open122_encode_indexed(struct open122_encoder *encoder, struct frame *frame, struct bio *bio, struct container *container);
+
+/**
+ * \brief Initialize the decoder for frames of about \p height x \p width pixels
+ *
+ * Only the decoder stops, the height hint and the DWTtype of the \p parameters are used, the rest is read from
+ * the streams. The DWTtype selects the transform the workspace is reserved for, the Float DWT streams grow the
+ * workspace of the Integer DWT decoder.
+ * The framebuffer is allocated by the first frame.
+ */
+int open122_decoder_init(struct open122_decoder *decoder, size_t height, size_t width, const struct parameters *parameters);
+
+/**
+ * \brief Number of bytes of an arena taken by the decoder for frames up to \p height x \p width pixels
+ *
+ * This includes the framebuffer allocated by the first frame, counted in the \c int storage
+ * (the low bit depths take less). The streams must not use larger S than the \p parameters.
+ */
+size_t open122_decoder_sizeof(size_t height, size_t width, const struct parameters *parameters);
+
+/**
+ * \brief Release the decoder
+ */
+void open122_decoder_destroy(struct open122_decoder *decoder);
+
+/**
+ * \brief Decode the stream read from the \p bio into the \c frame of the \p decoder
+ */
+int open122_decode(struct open122_decoder *decoder, struct bio *bio);
+
+/**
+ * \brief Decode the stream read from the \p bio into the caller buffer at \p ptr, see frame_export()
+ */
+int open122_decode_into(struct open122_decoder *decoder, struct bio *bio, void *ptr, size_t stride, int type);
+
+#endif /* OPEN122_H_ */
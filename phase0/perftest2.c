@@ -20,6 +20,7 @@
 double measure_dwt_secs(struct frame *frame)
 {
 	struct parameters parameters;
+	struct dwt dwt;
 	clock_t begin, end;
 	int err;
 	struct bio bio;
@@ -30,6 +31,11 @@ double measure_dwt_secs(struct frame *frame)
 		return 0.;
 	}
 
+	if (dwt_init(&dwt, frame->height, frame->width)) {
+		fprintf(stderr, "[ERROR] DWT workspace allocation failed\n");
+		return 0.;
+	}
+
 	init_parameters(&parameters);
 
 	parameters.DWTtype = CONFIG_PERFTEST_DWTTYPE;
@@ -41,10 +47,10 @@ double measure_dwt_secs(struct frame *frame)
 	begin = clock();
 
 #if (CONFIG_PERFTEST_DIR == 0)
-	err = dwt_encode(frame, &parameters);
+	err = dwt_encode(&dwt, frame, &parameters);
 #endif
 #if (CONFIG_PERFTEST_DIR == 1)
-	err = dwt_decode(frame, &parameters);
+	err = dwt_decode(&dwt, frame, &parameters);
 #endif
 
 	if (err) {
@@ -69,6 +75,8 @@ double measure_dwt_secs(struct frame *frame)
 
 	frame_destroy(frame);
 
+	dwt_destroy(&dwt);
+
 	if (begin == (clock_t) -1 || end == (clock_t) -1) {
 		return 0.;
 	}
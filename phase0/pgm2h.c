@@ -9,7 +9,6 @@ int main(int argc, char *argv[])
 	struct frame frame;
 	size_t height, width;
 	size_t size;
-	int *data;
 	size_t i;
 
 	if (argc < 2) {
@@ -37,7 +36,6 @@ int main(int argc, char *argv[])
 	height = ceil_multiple8(frame.height);
 	width = ceil_multiple8(frame.width);
 	size = height * width;
-	data = frame.data;
 
 	if (argc < 3) {
 		fprintf(stderr, "[ERROR] second argument expected\n");
@@ -56,7 +54,7 @@ int main(int argc, char *argv[])
 		if (i % 16 == 0) {
 			puts("");
 		}
-		printf("%3i", data[i]);
+		printf("%3i", frame.data16 != NULL ? frame.data16[i] : frame.data[i]);
 		if (i < size - 1) {
 			printf(", ");
 		}
@@ -64,7 +62,7 @@ int main(int argc, char *argv[])
 	}
 	puts("};\n");
 
-	printf("struct frame input_frame = { %lu, %lu, %lu, input_data };\n",
+	printf("struct frame input_frame = { %lu, %lu, %lu, input_data, NULL };\n",
 		(unsigned long)frame.height,
 		(unsigned long)frame.width,
 		(unsigned long)frame.bpp
@@ -0,0 +1,1520 @@
+/**
+ * Round-trip checks of the coding paths
+ *
+ * Each check codes a synthetic image by two paths expected to give the same result
+ * (e.g., the encoder stop and the decoder stop) and compares the outputs. The codec
+ * is lossy even with the Integer DWT, so the paths are compared with each other,
+ * not with the original image. The program aborts at the first mismatch.
+ */
+
+#include "config.h"
+#if (CONFIG_FRAME_MMAP == 1)
+#	define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if (CONFIG_FRAME_MMAP == 1)
+#	include <unistd.h>
+#endif
+
+#include "common.h"
+#include "frame.h"
+#include "dwt.h"
+#include "dwtfloat.h"
+#include "dwtint.h"
+#include "bio.h"
+#include "bpe.h"
+#include "container.h"
+#include "cube.h"
+#include "alloc.h"
+#include "cli.h"
+#include "open122.h"
+
+static void fail(const char *what)
+{
+	fprintf(stderr, "[ERROR] %s\n", what);
+	abort();
+}
+
+/* the sample at the row y and the column x */
+static int get_pixel(const struct frame *frame, size_t y, size_t x)
+{
+	size_t n = y * ceil_multiple8(frame->width) + x;
+
+	return frame->data16 != NULL ? frame->data16[n] : frame->data[n];
+}
+
+/* a smooth gradient with a texture, so that all the bit planes are coded */
+static void make_image(struct frame *frame, size_t height, size_t width, size_t bpp)
+{
+	size_t y, x;
+	int maxval = (1 << bpp) - 1;
+
+	frame->height = height;
+	frame->width = width;
+	frame->bpp = bpp;
+	frame->data = NULL;
+	frame->data16 = NULL;
+
+	if (frame_alloc_data(frame)) {
+		fail("unable to allocate the image");
+	}
+
+	for (y = 0; y < ceil_multiple8(height); ++y) {
+		for (x = 0; x < ceil_multiple8(width); ++x) {
+			size_t y_ = y < height ? y : height - 1;
+			size_t x_ = x < width ? x : width - 1;
+			size_t n = y * ceil_multiple8(width) + x;
+			int sample = (int) (((x_ * 5 + y_ * 3) << (bpp - 8)) + ((x_ ^ y_) & 15) * ((size_t) maxval / 64)) & maxval;
+
+			if (frame->data16 != NULL) {
+				frame->data16[n] = (short) sample;
+			} else {
+				frame->data[n] = sample;
+			}
+		}
+	}
+}
+
+static void check_same(const struct frame *a, const struct frame *b, const char *what)
+{
+	size_t y, x;
+
+	if (a->height != b->height || a->width != b->width) {
+		fail(what);
+	}
+
+	for (y = 0; y < a->height; ++y) {
+		for (x = 0; x < a->width; ++x) {
+			if (get_pixel(a, y, x) != get_pixel(b, y, x)) {
+				fail(what);
+			}
+		}
+	}
+}
+
+/* encode the copy of the image, returns the stream size in bytes */
+static size_t encode(const struct frame *image, const struct parameters *parameters, unsigned char *ptr)
+{
+	struct open122_encoder encoder;
+	struct frame frame;
+	struct bio bio;
+
+	if (frame_clone(image, &frame)) {
+		fail("unable to copy the image");
+	}
+
+	if (open122_encoder_init(&encoder, frame.height, frame.width, parameters)) {
+		fail("unable to initialize the encoder");
+	}
+
+	bio_open(&bio, ptr, BIO_MODE_WRITE);
+
+	if (open122_encode(&encoder, &frame, &bio)) {
+		fail("encoding failed");
+	}
+
+	bio_close(&bio);
+
+	open122_encoder_destroy(&encoder);
+	frame_destroy(&frame);
+
+	return (size_t) (bio.ptr - ptr);
+}
+
+/* decode the stream into the new frame */
+static void decode(unsigned char *ptr, const struct parameters *parameters, struct frame *frame)
+{
+	struct open122_decoder decoder;
+	struct bio bio;
+
+	if (open122_decoder_init(&decoder, 0, 0, parameters)) {
+		fail("unable to initialize the decoder");
+	}
+
+	bio_open(&bio, ptr, BIO_MODE_READ);
+
+	if (open122_decode(&decoder, &bio)) {
+		fail("decoding failed");
+	}
+
+	bio_close(&bio);
+
+	if (frame_clone(&decoder.frame, frame)) {
+		fail("unable to copy the decoded image");
+	}
+
+	open122_decoder_destroy(&decoder);
+}
+
+/* the decoder stop on the full stream gives the image of the stream stopped by the encoder */
+static void check_decode_stop(const struct frame *image, int DWTtype, unsigned char *ptr)
+{
+	static const size_t stops[][2] = {
+		{ 9, 3 }, { 8, 0 }, { 7, 0 }, { 6, 0 }, { 5, 2 }, { 3, 1 }, { 2, 0 }, { 0, 3 }
+	};
+	size_t i;
+
+	for (i = 0; i < sizeof stops / sizeof *stops; ++i) {
+		struct parameters parameters;
+		struct frame stopped, full;
+
+		init_parameters(&parameters);
+		parameters.DWTtype = DWTtype;
+		parameters.BitPlaneStop = stops[i][0];
+		parameters.StageStop = (int) stops[i][1];
+
+		encode(image, &parameters, ptr);
+		decode(ptr, &parameters, &stopped);
+
+		init_parameters(&parameters);
+		parameters.DWTtype = DWTtype;
+		parameters.DecodeBitPlaneStop = stops[i][0];
+		parameters.DecodeStageStop = (int) stops[i][1];
+
+		encode(image, &parameters, ptr);
+		decode(ptr, &parameters, &full);
+
+		check_same(&stopped, &full, "the decoder stop differs from the encoder stop");
+
+		frame_destroy(&stopped);
+		frame_destroy(&full);
+	}
+}
+
+/* the region decode gives the rectangle of the full decode, also when crossing the border of the image */
+static void check_region(const struct frame *image, int DWTtype, unsigned char *ptr)
+{
+	static const size_t rectangles[][4] = {
+		{ 0, 0, 16, 16 }, { 40, 100, 20, 30 }, { 33, 7, 1, 1 }, { 90, 190, 20, 30 }, { 0, 150, 200, 100 },
+		{ 89, 195, 8, 8 }, { 96, 202, 1, 1 }, { 96, 202, SIZE_MAX_ - 96 - 7 - 32, SIZE_MAX_ - 202 - 7 - 32 }
+	};
+	struct parameters parameters;
+	struct frame full;
+	size_t i;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	encode(image, &parameters, ptr);
+	decode(ptr, &parameters, &full);
+
+	for (i = 0; i < sizeof rectangles / sizeof *rectangles; ++i) {
+		size_t y = rectangles[i][0], x = rectangles[i][1], height = rectangles[i][2], width = rectangles[i][3];
+		size_t window_y = y, window_x = x, window_height = height, window_width = width;
+		struct frame window, region, expected;
+		struct dwt dwt;
+		struct bio bio;
+
+		window.data = NULL;
+		window.data16 = NULL;
+		region.data = NULL;
+		region.data16 = NULL;
+		expected.data = NULL;
+		expected.data16 = NULL;
+
+		if (dwt_region_support(&window_y, &window_x, &window_height, &window_width)) {
+			fail("the support of the region overflows");
+		}
+
+		init_parameters(&parameters);
+
+		bio_open(&bio, ptr, BIO_MODE_READ);
+
+		if (bpe_decode_region(&window, &parameters, &bio, window_y, window_x, window_height, window_width)) {
+			fail("region decoding failed");
+		}
+
+		bio_close(&bio);
+
+		if (dwt_init(&dwt, window.height, window.width)) {
+			fail("unable to initialize the DWT");
+		}
+
+		if (dwt_decode_region(&dwt, &window, &parameters, y - window_y, x - window_x, height, width, &region)) {
+			fail("inverse transform of the region failed");
+		}
+
+		if (frame_crop(&expected, &full, y, x, height, width)) {
+			fail("unable to crop the full image");
+		}
+
+		check_same(&region, &expected, "the region differs from the full decode");
+
+		dwt_destroy(&dwt);
+		frame_destroy(&window);
+		frame_destroy(&region);
+		frame_destroy(&expected);
+	}
+
+	/* the support ending past SIZE_MAX_ is rejected */
+	{
+		size_t y = 8, x = 0, height = SIZE_MAX_ - 8 - 7 - 31, width = 1;
+
+		if (dwt_region_support(&y, &x, &height, &width) != RET_FAILURE_OVERFLOW_ERROR) {
+			fail("the support of the region wraps around");
+		}
+	}
+
+	frame_destroy(&full);
+}
+
+/*
+ * the full stream truncated at the SegByteLimit gives the stream encoded with the limit, also
+ * when the limit cuts the segment headers (the first segment has 19 bytes of headers) or the DC bits
+ */
+static void check_transcode(const struct frame *image, int DWTtype, unsigned char *ptr)
+{
+	static const size_t limits[] = { 6, 12, 24, 64, 256 };
+	struct parameters parameters;
+	unsigned char *full, *cut;
+	size_t size, i;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	size = encode(image, &parameters, ptr);
+
+	full = malloc(size);
+	/* every segment is at least 3 bytes long and can grow by Part 2 (5 bytes) */
+	cut = malloc(3 * size + 8);
+
+	if (full == NULL || cut == NULL) {
+		fail("unable to allocate the stream");
+	}
+
+	memcpy(full, ptr, size);
+
+	for (i = 0; i < sizeof limits / sizeof *limits; ++i) {
+		struct bio src, dst;
+		size_t cut_size;
+
+		parameters.SegByteLimit = limits[i];
+
+		bio_open(&src, full, BIO_MODE_READ);
+		bio_open(&dst, cut, BIO_MODE_WRITE);
+
+		if (bpe_truncate(&dst, &src, &parameters)) {
+			fail("unable to truncate the stream");
+		}
+
+		bio_close(&dst);
+		bio_close(&src);
+
+		cut_size = (size_t) (dst.ptr - cut);
+
+		if (encode(image, &parameters, ptr) != cut_size || memcmp(ptr, cut, cut_size) != 0) {
+			fail("the truncated stream differs from the stream encoded with the limit");
+		}
+	}
+
+	free(cut);
+	free(full);
+}
+
+/* the stream wrapped into the container, saved and loaded back is unchanged, its corruption is detected */
+static void check_container(const struct frame *image, int DWTtype, unsigned char *ptr)
+{
+	const char *path = "roundtrip.c122";
+	struct parameters parameters;
+	struct container container;
+	struct frame frame;
+	struct bio bio;
+	size_t size;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	size = encode(image, &parameters, ptr);
+
+	frame.height = 0;
+	frame.width = 0;
+	frame.bpp = 0;
+	frame.data = NULL;
+	frame.data16 = NULL;
+
+	container_init(&container);
+
+	bio_open(&bio, ptr, BIO_MODE_READ);
+
+	if (bpe_decode_indexed(&frame, &parameters, &bio, &container)) {
+		fail("indexed decoding failed");
+	}
+
+	bio_close(&bio);
+
+	if (container_finish(&container, ptr, size) || container_save(&container, path)) {
+		fail("unable to save the container");
+	}
+
+	container_destroy(&container);
+
+	if (container_load(&container, path)) {
+		fail("unable to load the container");
+	}
+
+	remove(path);
+
+	if (container.height != image->height || container.width != image->width || container.bpp != image->bpp || container.DWTtype != DWTtype) {
+		fail("the container holds another geometry");
+	}
+
+	if (container.size != size || memcmp(container.stream, ptr, size) != 0 || container_verify(&container)) {
+		fail("the container holds another stream");
+	}
+
+	container.stream[size / 2] ^= 1;
+
+	if (container_verify(&container) != RET_FAILURE_FILE_CORRUPTED) {
+		fail("the corrupted container passed the verification");
+	}
+
+	container_destroy(&container);
+	frame_destroy(&frame);
+}
+
+/* the TargetBytes stream fits into the target, it is cut as by the multi-rate encoding, and a too small target fails */
+static void check_target_bytes(const struct frame *image, int DWTtype, unsigned char *ptr)
+{
+	struct parameters parameters;
+	struct frame frame;
+	struct dwt dwt;
+	struct bio bio, outputs[4];
+	unsigned char *multirate[4];
+	size_t bytes[4];
+	size_t size, k;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	size = encode(image, &parameters, ptr);
+
+	/* from a part of the DC coefficients up to the whole stream */
+	bytes[0] = size / 8;
+	bytes[1] = size / 4;
+	bytes[2] = size - 1;
+	bytes[3] = size * 2;
+
+	if (frame_clone(image, &frame) || dwt_init(&dwt, frame.height, frame.width)) {
+		fail("unable to initialize the DWT");
+	}
+
+	if (dwt_encode(&dwt, &frame, &parameters)) {
+		fail("forward transform failed");
+	}
+
+	for (k = 0; k < 4; ++k) {
+		multirate[k] = malloc(get_maximum_stream_size(&frame));
+
+		if (multirate[k] == NULL) {
+			fail("unable to allocate the stream");
+		}
+
+		bio_open(&outputs[k], multirate[k], BIO_MODE_WRITE);
+	}
+
+	bio_open(&bio, ptr, BIO_MODE_WRITE);
+
+	if (bpe_encode_multirate(&frame, &parameters, &bio, 4, bytes, outputs)) {
+		fail("multi-rate encoding failed");
+	}
+
+	bio_close(&bio);
+
+	for (k = 0; k < 4; ++k) {
+		size_t multirate_size;
+		struct frame target, cut;
+
+		bio_close(&outputs[k]);
+
+		multirate_size = (size_t) (outputs[k].ptr - multirate[k]);
+
+		parameters.TargetBytes = bytes[k];
+
+		if (encode(image, &parameters, ptr) != multirate_size || memcmp(ptr, multirate[k], multirate_size) != 0) {
+			fail("the TargetBytes stream differs from the multi-rate output");
+		}
+
+		if (multirate_size > bytes[k] || (k == 3 && multirate_size != size)) {
+			fail("the TargetBytes stream does not fit the target");
+		}
+
+		decode(ptr, &parameters, &target);
+		decode(multirate[k], &parameters, &cut);
+
+		check_same(&target, &cut, "the TargetBytes stream decodes differently");
+
+		frame_destroy(&target);
+		frame_destroy(&cut);
+
+		free(multirate[k]);
+	}
+
+	dwt_destroy(&dwt);
+	frame_destroy(&frame);
+
+	/* not even the segment headers fit */
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+	parameters.TargetBytes = 8;
+
+	if (frame_clone(image, &frame)) {
+		fail("unable to copy the image");
+	}
+
+	bio_open(&bio, ptr, BIO_MODE_WRITE);
+
+	if (bpe_encode(&frame, &parameters, &bio) != RET_FAILURE_OVERFLOW_ERROR) {
+		fail("the too small target passed");
+	}
+
+	frame_destroy(&frame);
+}
+
+/* the decoded image does not depend on the height hint, even on the one which cannot be allocated */
+static void check_height_hint(const struct frame *image, int DWTtype, unsigned char *ptr)
+{
+	static const size_t hints[] = { 1, 97, 1000, SIZE_MAX_ / 2, SIZE_MAX_ };
+	struct parameters parameters;
+	struct frame full;
+	size_t i;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	encode(image, &parameters, ptr);
+	decode(ptr, &parameters, &full);
+
+	for (i = 0; i < sizeof hints / sizeof *hints; ++i) {
+		struct frame hinted;
+
+		parameters.DecodeHeightHint = hints[i];
+
+		decode(ptr, &parameters, &hinted);
+
+		check_same(&hinted, &full, "the height hint changes the decoded image");
+
+		frame_destroy(&hinted);
+	}
+
+	frame_destroy(&full);
+}
+
+/* the pixels completed by the streaming inverse transform are collected here */
+struct stream_output {
+	struct dwt_stream stream;
+	struct frame frame;
+
+	/* dwt_sizeof() of the workspace when the first pixels are complete */
+	size_t size;
+};
+
+static int stream_stripe(void *context, struct frame *frame)
+{
+	struct stream_output *output = context;
+
+	return dwt_stream_push(&output->stream, frame);
+}
+
+static int stream_rows(void *context, const struct frame *frame, size_t y, size_t height)
+{
+	struct stream_output *output = context;
+	const struct dwt *dwt = output->stream.dwt;
+	size_t stride = ceil_multiple8(frame->width);
+	size_t size = dwt_sizeof(dwt->height, dwt->width, output->stream.parameters);
+	size_t y_, x;
+
+	if (output->size == 0) {
+		output->size = size;
+	}
+
+	if (size != output->size) {
+		fail("the streaming workspace grows with the height");
+	}
+
+	for (y_ = y; y_ < y + height; ++y_) {
+		for (x = 0; x < frame->width; ++x) {
+			output->frame.data[y_ * stride + x] = get_pixel(frame, y_, x);
+		}
+	}
+
+	return RET_SUCCESS;
+}
+
+/*
+ * the streaming inverse transform using the workspace 'dwt' gives the image of the full decode,
+ * the transform is learned from the stream, returns dwt_sizeof() of the workspace
+ */
+static size_t stream_decode(const struct frame *image, int DWTtype, unsigned char *ptr, struct dwt *dwt)
+{
+	struct parameters parameters;
+	struct stream_output output;
+	struct frame full, frame;
+	struct bio bio;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	encode(image, &parameters, ptr);
+	decode(ptr, &parameters, &full);
+
+	frame.height = 0;
+	frame.width = 0;
+	frame.bpp = 0;
+	frame.data = NULL;
+	frame.data16 = NULL;
+
+	/* the pixels are stored in 'int' */
+	output.frame.height = image->height;
+	output.frame.width = image->width;
+	output.frame.bpp = 16;
+	output.frame.data = NULL;
+	output.frame.data16 = NULL;
+	output.size = 0;
+
+	if (frame_alloc_data(&output.frame)) {
+		fail("unable to allocate the streaming output");
+	}
+
+	/* the opposite transform, replaced by the one of the stream */
+	init_parameters(&parameters);
+	parameters.DWTtype = !DWTtype;
+
+	dwt_stream_init(&output.stream, dwt, &parameters, stream_rows, &output);
+
+	bio_open(&bio, ptr, BIO_MODE_READ);
+
+	if (bpe_decode_stripes(&frame, &parameters, &bio, stream_stripe, &output) || dwt_stream_finish(&output.stream, &frame)) {
+		fail("streaming decoding failed");
+	}
+
+	bio_close(&bio);
+
+	check_same(&output.frame, &full, "the streaming decode differs from the full decode");
+
+	frame_destroy(&frame);
+	frame_destroy(&output.frame);
+	frame_destroy(&full);
+
+	return output.size;
+}
+
+/* the streaming inverse transform in the workspace of the whole frame */
+static void check_streaming(const struct frame *image, int DWTtype, unsigned char *ptr)
+{
+	struct dwt dwt;
+
+	if (dwt_init(&dwt, image->height, image->width)) {
+		fail("unable to allocate the workspace");
+	}
+
+	stream_decode(image, DWTtype, ptr, &dwt);
+
+	dwt_destroy(&dwt);
+}
+
+/* the workspace of the streaming inverse transform of a tall image is bounded by the width */
+static void check_streaming_tall(size_t bpp, int DWTtype)
+{
+	struct parameters parameters;
+	struct frame image;
+	unsigned char *ptr;
+	struct dwt dwt;
+	size_t size;
+
+	make_image(&image, 1001, 45, bpp);
+
+	ptr = malloc(get_maximum_stream_size(&image));
+
+	if (ptr == NULL || dwt_init(&dwt, 0, 0)) {
+		fail("unable to allocate the stream");
+	}
+
+	size = stream_decode(&image, DWTtype, ptr, &dwt);
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	/* a few strips of the width, whatever the height */
+	if (size > dwt_sizeof(4 * (DWT_STRIP_DELAY + 8), image.width, &parameters)) {
+		fail("the streaming workspace exceeds a few strips");
+	}
+
+	dwt_destroy(&dwt);
+	free(ptr);
+	frame_destroy(&image);
+}
+
+/* all the coefficients of the frames are equal, including the padding to the multiples of 8 */
+static void check_same_coefs(const struct frame *a, const struct frame *b, const char *what)
+{
+	size_t y, x;
+
+	if (a->height != b->height || a->width != b->width) {
+		fail(what);
+	}
+
+	for (y = 0; y < ceil_multiple8(a->height); ++y) {
+		for (x = 0; x < ceil_multiple8(a->width); ++x) {
+			if (get_pixel(a, y, x) != get_pixel(b, y, x)) {
+				fail(what);
+			}
+		}
+	}
+}
+
+/* the transform in tiles (CONFIG_DWT_MS_MODE 3) gives the coefficients of the transform in the rows of blocks (CONFIG_DWT_MS_MODE 2) */
+static void check_tiles(const struct frame *image, int DWTtype)
+{
+	static const ptrdiff_t tiles[][2] = { { CONFIG_DWT_TILE_HEIGHT, CONFIG_DWT_TILE_WIDTH }, { CONFIG_DWT_TILE_HEIGHT, 64 }, { 8, 8 }, { 16, 40 } };
+	struct parameters parameters;
+	struct frame blocks, tiled;
+	struct dwt dwt;
+	size_t i;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	if (dwt_init(&dwt, 0, 0) || dwt_reserve(&dwt, image->height, image->width, &parameters)) {
+		fail("unable to allocate the workspace");
+	}
+
+	for (i = 0; i < sizeof tiles / sizeof *tiles; ++i) {
+		ptrdiff_t width = (ptrdiff_t) ceil_multiple8(image->width);
+		int err;
+
+		if (frame_clone(image, &blocks) || frame_clone(image, &tiled)) {
+			fail("unable to copy the image");
+		}
+
+		/* the rows of blocks are the tiles 8 pixels high spanning the whole width */
+		if (DWTtype == 0) {
+			err = dwtfloat_encode_tiled(&dwt, &blocks, 8, width + 24) || dwtfloat_encode_tiled(&dwt, &tiled, tiles[i][0], tiles[i][1]);
+		} else {
+			err = dwtint_encode_tiled(&dwt, &blocks, parameters.weight, 8, width + 24) || dwtint_encode_tiled(&dwt, &tiled, parameters.weight, tiles[i][0], tiles[i][1]);
+		}
+
+		if (err) {
+			fail("the transform in tiles failed");
+		}
+
+		check_same_coefs(&tiled, &blocks, "the forward transform in tiles differs from the rows of blocks");
+
+		if (DWTtype == 0) {
+			err = dwtfloat_decode_tiled(&dwt, &blocks, 8, width + 24) || dwtfloat_decode_tiled(&dwt, &tiled, tiles[i][0], tiles[i][1]);
+		} else {
+			err = dwtint_decode_tiled(&dwt, &blocks, parameters.weight, 8, width + 24) || dwtint_decode_tiled(&dwt, &tiled, parameters.weight, tiles[i][0], tiles[i][1]);
+		}
+
+		if (err) {
+			fail("the inverse transform in tiles failed");
+		}
+
+		check_same_coefs(&tiled, &blocks, "the inverse transform in tiles differs from the rows of blocks");
+
+		/* the configured transform, whichever CONFIG_DWT_MS_MODE */
+		if (dwt_encode(&dwt, &blocks, &parameters)) {
+			fail("the transform failed");
+		}
+
+		if (DWTtype == 0) {
+			err = dwtfloat_encode_tiled(&dwt, &tiled, tiles[i][0], tiles[i][1]);
+		} else {
+			err = dwtint_encode_tiled(&dwt, &tiled, parameters.weight, tiles[i][0], tiles[i][1]);
+		}
+
+		if (err) {
+			fail("the transform in tiles failed");
+		}
+
+		check_same_coefs(&tiled, &blocks, "the transform in tiles differs from the configured transform");
+
+		frame_destroy(&blocks);
+		frame_destroy(&tiled);
+	}
+
+	dwt_destroy(&dwt);
+}
+
+/* clamp the decoded pixels to the range of the samples, as the export into the caller buffers does */
+static void clamp_pixels(struct frame *frame)
+{
+	int maxval = (1 << frame->bpp) - 1;
+	size_t n;
+
+	for (n = 0; n < ceil_multiple8(frame->height) * ceil_multiple8(frame->width); ++n) {
+		if (frame->data16 != NULL) {
+			frame->data16[n] = (short) (frame->data16[n] < 0 ? 0 : frame->data16[n] > maxval ? maxval : frame->data16[n]);
+		} else {
+			frame->data[n] = frame->data[n] < 0 ? 0 : frame->data[n] > maxval ? maxval : frame->data[n];
+		}
+	}
+}
+
+/* each band of the cube saved into the file and restored gives the image decoded from its own stream */
+static void check_cube(const struct frame *image, int DWTtype, unsigned char *ptr)
+{
+	const char *path = "roundtrip.cube";
+	struct parameters parameters;
+	struct cube cube, restored;
+	struct frame expected;
+	size_t b;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	encode(image, &parameters, ptr);
+	decode(ptr, &parameters, &expected);
+
+	clamp_pixels(&expected);
+
+	cube_init(&cube);
+
+	/* released by cube_destroy() */
+	cube.frames = alloc_malloc(3 * sizeof *cube.frames);
+
+	if (cube.frames == NULL) {
+		fail("unable to allocate the cube");
+	}
+
+	for (b = 0; b < 3; ++b) {
+		if (frame_clone(image, &cube.frames[b])) {
+			fail("unable to copy the image");
+		}
+
+		cube.bands = b + 1;
+	}
+
+	if (cube_compress(&cube, &parameters, path)) {
+		fail("unable to compress the cube");
+	}
+
+	if (cube_decompress(&restored, &parameters, path)) {
+		fail("unable to decompress the cube");
+	}
+
+	remove(path);
+
+	if (restored.bands != 3) {
+		fail("the cube holds another number of bands");
+	}
+
+	for (b = 0; b < 3; ++b) {
+		check_same(&restored.frames[b], &expected, "the band differs from the decoded image");
+	}
+
+	frame_destroy(&expected);
+	cube_destroy(&cube);
+	cube_destroy(&restored);
+}
+
+/* the custom weights travel in the stream, the decoder needs not know them */
+static void check_custom_weights(const struct frame *image, int DWTtype, unsigned char *ptr)
+{
+	static const int weight[12] = {
+		0, 2, 2, 1,
+		0, 3, 3, 2,
+		2, 3, 3, 3
+	};
+	struct parameters parameters;
+	struct frame custom, informed;
+	int i;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	for (i = 0; i < 12; ++i) {
+		parameters.weight[i] = weight[i];
+	}
+
+	encode(image, &parameters, ptr);
+	decode(ptr, &parameters, &informed);
+
+	init_parameters(&parameters);
+
+	decode(ptr, &parameters, &custom);
+
+	check_same(&custom, &informed, "the weights are not read from the stream");
+
+	frame_destroy(&custom);
+	frame_destroy(&informed);
+}
+
+/*
+ * the image maximizing a coefficient of the HH band at the third level (a 10-bit sample where
+ * its impulse response is positive), weighted by the largest custom weights, takes more than 16 bits,
+ * it codes and decodes the same way whether the pixels are stored in 16-bit integers or in int
+ */
+static void check_data16_weights(void)
+{
+	static const int weight[12] = {
+		0, 3, 3, 3,
+		0, 3, 3, 3,
+		3, 3, 3, 3
+	};
+	const size_t size = 64, center = 36;
+	struct parameters parameters;
+	struct open122_decoder decoder;
+	struct dwt dwt;
+	struct frame image, wide, impulse, decoded;
+	struct bio bio;
+	unsigned char *ptr, *wide_ptr;
+	size_t bytes;
+	size_t n;
+	int i;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = 1;
+
+	for (i = 0; i < 12; ++i) {
+		parameters.weight[i] = 0;
+	}
+
+	make_image(&image, size, size, 10);
+	make_image(&impulse, size, size, 10);
+
+	if (frame_widen_data(&impulse) || dwt_init(&dwt, size, size)) {
+		fail("unable to initialize the DWT");
+	}
+
+	for (n = 0; n < size * size; ++n) {
+		size_t m;
+
+		for (m = 0; m < size * size; ++m) {
+			impulse.data[m] = m == n ? 1023 : 0;
+		}
+
+		if (dwt_encode(&dwt, &impulse, &parameters)) {
+			fail("DWT failed");
+		}
+
+		if (image.data16 != NULL) {
+			image.data16[n] = (short) (impulse.data[center * size + center] > 0 ? 1023 : 0);
+		} else {
+			image.data[n] = impulse.data[center * size + center] > 0 ? 1023 : 0;
+		}
+	}
+
+	dwt_destroy(&dwt);
+	frame_destroy(&impulse);
+
+	if (frame_clone(&image, &wide) || frame_widen_data(&wide)) {
+		fail("unable to copy the image");
+	}
+
+	for (i = 0; i < 12; ++i) {
+		parameters.weight[i] = weight[i];
+	}
+
+	ptr = malloc(get_maximum_stream_size(&image));
+	wide_ptr = malloc(get_maximum_stream_size(&image));
+
+	if (ptr == NULL || wide_ptr == NULL) {
+		fail("unable to allocate the stream");
+	}
+
+	bytes = encode(&image, &parameters, ptr);
+
+	if (encode(&wide, &parameters, wide_ptr) != bytes || memcmp(ptr, wide_ptr, bytes) != 0) {
+		fail("the weighted coefficients do not fit into the 16-bit storage of the encoder");
+	}
+
+	/* the second frame is decoded into the int framebuffer of the first one */
+	if (open122_decoder_init(&decoder, 0, 0, &parameters)) {
+		fail("unable to initialize the decoder");
+	}
+
+	bio_open(&bio, ptr, BIO_MODE_READ);
+
+	if (open122_decode(&decoder, &bio)) {
+		fail("decoding failed");
+	}
+
+	bio_close(&bio);
+
+	if (frame_clone(&decoder.frame, &decoded) || frame_widen_data(&decoder.frame)) {
+		fail("unable to copy the decoded image");
+	}
+
+	bio_open(&bio, ptr, BIO_MODE_READ);
+
+	if (open122_decode(&decoder, &bio)) {
+		fail("decoding failed");
+	}
+
+	bio_close(&bio);
+
+	check_same(&decoded, &decoder.frame, "the weighted coefficients do not fit into the 16-bit storage of the decoder");
+
+	open122_decoder_destroy(&decoder);
+	free(ptr);
+	free(wide_ptr);
+	frame_destroy(&decoded);
+	frame_destroy(&wide);
+	frame_destroy(&image);
+}
+
+/* store the sample at the column x of the row in the raw format */
+static void pack_sample(unsigned char *line, size_t x, int sample, int format)
+{
+	switch (format) {
+		case FRAME_RAW_8:
+			line[x] = (unsigned char) sample;
+			break;
+		case FRAME_RAW_16LE:
+			line[2*x+0] = (unsigned char) (sample & 255);
+			line[2*x+1] = (unsigned char) (sample >> 8);
+			break;
+		case FRAME_RAW_16BE:
+			line[2*x+0] = (unsigned char) (sample >> 8);
+			line[2*x+1] = (unsigned char) (sample & 255);
+			break;
+		case FRAME_RAW_PACKED10:
+			line[5*(x/4) + x%4] = (unsigned char) (sample >> 2);
+			line[5*(x/4) + 4] |= (unsigned char) ((sample & 3) << (2 * (x%4)));
+			break;
+		case FRAME_RAW_PACKED12:
+			line[3*(x/2) + x%2] = (unsigned char) (sample >> 4);
+			line[3*(x/2) + 2] |= (unsigned char) ((sample & 15) << (4 * (x%2)));
+			break;
+	}
+}
+
+/* the image saved as the headerless raster in each format that holds the bit depth loads back unchanged */
+static void check_raw(const struct frame *image)
+{
+	static const char *formats[] = { "8", "16le", "16be", "raw10", "raw12" };
+	static const size_t depths[] = { 8, 16, 16, 10, 12 };
+	const char *path = "roundtrip.raw";
+	size_t i;
+
+	for (i = 0; i < sizeof formats / sizeof *formats; ++i) {
+		struct frame_raw raw;
+		struct frame frame;
+		unsigned char *line;
+		size_t row, y, x;
+		FILE *stream;
+
+		if (image->bpp > depths[i]) {
+			continue;
+		}
+
+		raw.height = image->height;
+		raw.width = image->width;
+		raw.bpp = image->bpp;
+		raw.format = cli_parse_format(formats[i]);
+
+		row = frame_raw_row_size(&raw);
+
+		/* a header and padded rows are skipped */
+		raw.offset = 13;
+		raw.stride = row + 3;
+
+		line = calloc(raw.stride, 1);
+		stream = fopen(path, "wb");
+
+		if (raw.format < 0 || line == NULL || stream == NULL || fwrite(line, 1, raw.offset, stream) != raw.offset) {
+			fail("unable to write the raster");
+		}
+
+		for (y = 0; y < image->height; ++y) {
+			memset(line, 0, raw.stride);
+
+			for (x = 0; x < image->width; ++x) {
+				pack_sample(line, x, get_pixel(image, y, x), raw.format);
+			}
+
+			if (fwrite(line, 1, raw.stride, stream) != raw.stride) {
+				fail("unable to write the raster");
+			}
+		}
+
+		fclose(stream);
+		free(line);
+
+		if (frame_load_raw(&frame, path, &raw)) {
+			fail("unable to load the raster");
+		}
+
+		remove(path);
+
+		check_same(&frame, image, "the raster loads another image");
+
+		frame_destroy(&frame);
+	}
+}
+
+/*
+ * the chunked layout converted to the semiplanar one and back is unchanged, for the frames whose
+ * dimensions are not multiples of 8, in both storages; the semiplanar layout starts with the LL band
+ */
+static void check_layouts(size_t bpp)
+{
+	static const size_t sizes[][2] = { { 13, 21 }, { 97, 203 }, { 1, 9 }, { 17, 1 } };
+	size_t i;
+
+	for (i = 0; i < sizeof sizes / sizeof *sizes; ++i) {
+		struct frame chunked, semiplanar, back;
+		size_t y, x;
+
+		make_image(&chunked, sizes[i][0], sizes[i][1], bpp);
+
+		/* distinct coefficients, the padding included */
+		for (y = 0; y < ceil_multiple8(chunked.height); ++y) {
+			for (x = 0; x < ceil_multiple8(chunked.width); ++x) {
+				size_t n = y * ceil_multiple8(chunked.width) + x;
+				int sample = (int) (n % 30011) - 15005;
+
+				if (chunked.data16 != NULL) {
+					chunked.data16[n] = (short) sample;
+				} else {
+					chunked.data[n] = sample;
+				}
+			}
+		}
+
+		semiplanar.data = NULL;
+		semiplanar.data16 = NULL;
+		back.data = NULL;
+		back.data16 = NULL;
+
+		if (frame_copy_chunked_to_semiplanar(&semiplanar, &chunked) || frame_copy_semiplanar_to_chunked(&back, &semiplanar)) {
+			fail("unable to copy the layout");
+		}
+
+		check_same_coefs(&back, &chunked, "the chunked layout does not survive the semiplanar one");
+
+		for (y = 0; y < ceil_multiple8(chunked.height) / 8; ++y) {
+			for (x = 0; x < ceil_multiple8(chunked.width) / 8; ++x) {
+				if (get_pixel(&semiplanar, y, x) != get_pixel(&chunked, 8 * y, 8 * x)) {
+					fail("the semiplanar layout does not start with the LL band");
+				}
+			}
+		}
+
+		/* in place */
+		if (frame_convert_chunked_to_semiplanar(&back)) {
+			fail("unable to convert the layout");
+		}
+
+		check_same_coefs(&back, &semiplanar, "the converted layout differs from the copied one");
+
+		if (frame_convert_semiplanar_to_chunked(&back)) {
+			fail("unable to convert the layout");
+		}
+
+		check_same_coefs(&back, &chunked, "the chunked layout does not survive the semiplanar one");
+
+		frame_destroy(&back);
+		frame_destroy(&semiplanar);
+		frame_destroy(&chunked);
+	}
+}
+
+/*
+ * the preview of a smooth image (a ramp) at the level gives every (1 << level)-th pixel of the full decode
+ * away from the borders (the symmetric extension bends the ramp), up to the rounding of the scaled LL band;
+ * the Integer DWT is checked also with a custom weight of the LL band, which the preview at the level 3 removes
+ */
+static void check_preview(size_t bpp, int DWTtype, unsigned char *ptr)
+{
+	static const int weight[12] = {
+		0, 2, 2, 1,
+		0, 3, 3, 2,
+		1, 3, 3, 3
+	};
+	const size_t height = 96, width = 152, margin = 32;
+	struct parameters parameters;
+	struct frame image, coefs;
+	struct dwt dwt;
+	size_t y, x;
+	int custom;
+
+	make_image(&image, height, width, bpp);
+
+	/* the sample grows by 1 << (bpp - 8) per row and per column */
+	for (y = 0; y < height; ++y) {
+		for (x = 0; x < width; ++x) {
+			size_t n = y * width + x;
+			int sample = (int) ((y + x) << (bpp - 8));
+
+			if (image.data16 != NULL) {
+				image.data16[n] = (short) sample;
+			} else {
+				image.data[n] = sample;
+			}
+		}
+	}
+
+	if (dwt_init(&dwt, height, width)) {
+		fail("unable to initialize the DWT");
+	}
+
+	for (custom = 0; custom <= DWTtype; ++custom) {
+		int level, i;
+
+		init_parameters(&parameters);
+		parameters.DWTtype = DWTtype;
+
+		for (i = 0; custom && i < 12; ++i) {
+			parameters.weight[i] = weight[i];
+		}
+
+		encode(&image, &parameters, ptr);
+
+		for (level = 1; level <= 3; ++level) {
+			struct frame full, preview, expected;
+			struct bio bio;
+
+			/* the DWTtype and the weights are read from the stream */
+			init_parameters(&parameters);
+
+			coefs.height = 0;
+			coefs.width = 0;
+			coefs.bpp = 0;
+			coefs.data = NULL;
+			coefs.data16 = NULL;
+
+			bio_open(&bio, ptr, BIO_MODE_READ);
+
+			if (bpe_decode(&coefs, &parameters, &bio)) {
+				fail("decoding failed");
+			}
+
+			bio_close(&bio);
+
+			preview.data = NULL;
+			preview.data16 = NULL;
+			expected.data = NULL;
+			expected.data16 = NULL;
+
+			if (frame_clone(&coefs, &full) || dwt_decode(&dwt, &full, &parameters)) {
+				fail("inverse transform failed");
+			}
+
+			if (dwt_decode_preview(&dwt, &coefs, &parameters, level, &preview)) {
+				fail("preview failed");
+			}
+
+			if (frame_decimate(&expected, &full, level)) {
+				fail("unable to decimate the image");
+			}
+
+			for (y = margin >> level; y < (height - margin) >> level; ++y) {
+				for (x = margin >> level; x < (width - margin) >> level; ++x) {
+					int diff = get_pixel(&preview, y, x) - get_pixel(&expected, y, x);
+
+					if (diff < -1 || diff > 1) {
+						fail("the preview differs from the decimated image");
+					}
+				}
+			}
+
+			frame_destroy(&full);
+			frame_destroy(&preview);
+			frame_destroy(&expected);
+			frame_destroy(&coefs);
+		}
+	}
+
+	dwt_destroy(&dwt);
+	frame_destroy(&image);
+}
+
+/*
+ * the frames of growing and shrinking geometry coded using one encoder and one decoder give the streams and
+ * the images of the fresh ones, the workspaces of the larger frames keep no state for the smaller ones
+ */
+static void check_reuse(size_t bpp, int DWTtype)
+{
+	static const size_t sizes[][2] = { { 24, 40 }, { 97, 203 }, { 24, 40 }, { 40, 17 } };
+	struct parameters parameters;
+	struct open122_encoder encoder;
+	struct open122_decoder decoder;
+	unsigned char *ptr, *reused;
+	size_t i;
+
+	init_parameters(&parameters);
+	parameters.DWTtype = DWTtype;
+
+	if (open122_encoder_init(&encoder, 0, 0, &parameters) || open122_decoder_init(&decoder, 0, 0, &parameters)) {
+		fail("unable to initialize the codec");
+	}
+
+	for (i = 0; i < sizeof sizes / sizeof *sizes; ++i) {
+		struct frame image, frame, decoded;
+		struct bio bio;
+		size_t size;
+
+		make_image(&image, sizes[i][0], sizes[i][1], bpp);
+
+		/* another content for the repeated geometry */
+		if (i == 2) {
+			frame_randomize(&image);
+		}
+
+		ptr = malloc(get_maximum_stream_size(&image));
+		reused = malloc(get_maximum_stream_size(&image));
+
+		if (ptr == NULL || reused == NULL || frame_clone(&image, &frame)) {
+			fail("unable to allocate the stream");
+		}
+
+		size = encode(&image, &parameters, ptr);
+
+		bio_open(&bio, reused, BIO_MODE_WRITE);
+
+		if (open122_encode(&encoder, &frame, &bio)) {
+			fail("encoding failed");
+		}
+
+		bio_close(&bio);
+
+		if ((size_t) (bio.ptr - reused) != size || memcmp(ptr, reused, size) != 0) {
+			fail("the reused encoder gives another stream");
+		}
+
+		decode(ptr, &parameters, &decoded);
+
+		bio_open(&bio, ptr, BIO_MODE_READ);
+
+		if (open122_decode(&decoder, &bio)) {
+			fail("decoding failed");
+		}
+
+		bio_close(&bio);
+
+		check_same(&decoder.frame, &decoded, "the reused decoder gives another image");
+
+		frame_destroy(&decoded);
+		frame_destroy(&frame);
+		frame_destroy(&image);
+		free(reused);
+		free(ptr);
+	}
+
+	open122_decoder_destroy(&decoder);
+	open122_encoder_destroy(&encoder);
+}
+
+/* the expected exported value of the sample */
+static int clamp_sample(int sample, int maxval)
+{
+	return sample < 0 ? 0 : sample > maxval ? maxval : sample;
+}
+
+/*
+ * the samples (negative and beyond the bit depth, as produced by the inverse transform) are exported
+ * clamped into each pixel type holding the bit depth, into the buffer of rows padded beyond the width
+ */
+static void check_export(size_t bpp)
+{
+	static const int types[] = { FRAME_TYPE_UCHAR, FRAME_TYPE_USHORT, FRAME_TYPE_INT, FRAME_TYPE_FLOAT };
+	static const size_t sizes[] = { sizeof(unsigned char), sizeof(unsigned short), sizeof(int), sizeof(float) };
+	const size_t height = 13, width = 21, pad = 3, y0 = 5, rows = 4;
+	const int maxval = (1 << bpp) - 1;
+	struct frame frame;
+	size_t i, y, x;
+
+	make_image(&frame, height, width, bpp);
+
+	for (y = 0; y < height; ++y) {
+		for (x = 0; x < width; ++x) {
+			size_t n = y * ceil_multiple8(width) + x;
+			/* from -maxval to 2 * maxval */
+			int sample = (int) ((y * width + x) * 3 % 7) * maxval / 2 - maxval;
+
+			if (frame.data16 != NULL) {
+				frame.data16[n] = (short) sample;
+			} else {
+				frame.data[n] = sample;
+			}
+		}
+	}
+
+	for (i = 0; i < sizeof types / sizeof *types; ++i) {
+		size_t stride = (width + pad) * sizes[i];
+		unsigned char *buffer;
+
+		buffer = malloc(height * stride);
+
+		if (buffer == NULL) {
+			fail("unable to allocate the buffer");
+		}
+
+		if (types[i] == FRAME_TYPE_UCHAR && bpp > 8) {
+			if (frame_export(&frame, buffer, stride, types[i]) != RET_FAILURE_LOGIC_ERROR) {
+				fail("the pixels exported into a narrow type");
+			}
+
+			free(buffer);
+			continue;
+		}
+
+		/* the whole frame, then the rows [y0; y0 + rows) over it at the top of the buffer */
+		memset(buffer, 0xa5, height * stride);
+
+		if (frame_export(&frame, buffer, stride, types[i]) || frame_export_rows(&frame, y0, rows, buffer, stride, types[i])) {
+			fail("unable to export the frame");
+		}
+
+		for (y = 0; y < height; ++y) {
+			const unsigned char *row = buffer + y * stride;
+
+			for (x = 0; x < width + pad; ++x) {
+				int expected = clamp_sample(get_pixel(&frame, y < rows ? y0 + y : y, x < width ? x : 0), maxval);
+				int value;
+
+				if (x >= width) {
+					size_t k;
+
+					/* the padding is not touched */
+					for (k = 0; k < sizes[i]; ++k) {
+						if (row[x * sizes[i] + k] != 0xa5) {
+							fail("the padding of the row has been overwritten");
+						}
+					}
+					continue;
+				}
+
+				switch (types[i]) {
+					case FRAME_TYPE_UCHAR:
+						value = row[x];
+						break;
+					case FRAME_TYPE_USHORT:
+						value = ((const unsigned short *) row)[x];
+						break;
+					case FRAME_TYPE_INT:
+						value = ((const int *) row)[x];
+						break;
+					default:
+						value = (int) ((const float *) row)[x];
+						break;
+				}
+
+				if (value != expected) {
+					fail("the exported pixel differs from the clamped sample");
+				}
+			}
+		}
+
+		free(buffer);
+	}
+
+	frame_destroy(&frame);
+}
+
+/*
+ * the image saved as PGM loads back unchanged, also into a reused framebuffer; the file mapped
+ * into memory (CONFIG_FRAME_MMAP 1) gives the frame read using stdio from a pipe
+ */
+static void check_pgm(const struct frame *image)
+{
+	const char *path = "roundtrip.pgm";
+	struct frame frame, reloaded;
+
+	if (frame_save_pgm(image, path)) {
+		fail("unable to save the image");
+	}
+
+	if (frame_load_pgm(&frame, path)) {
+		fail("unable to load the image");
+	}
+
+	check_same(&frame, image, "the PGM file loads another image");
+
+	make_image(&reloaded, 13, 17, 8);
+
+	if (frame_reload_pgm(&reloaded, path)) {
+		fail("unable to reload the image");
+	}
+
+	check_same(&reloaded, image, "the PGM file reloads another image");
+
+#if (CONFIG_FRAME_MMAP == 1)
+	{
+		struct frame piped;
+		unsigned char *bytes;
+		size_t size;
+		int fd[2];
+
+		bytes = cli_load_file(path, &size);
+
+		/* the pipe holds the whole file, it cannot be mapped */
+		if (bytes == NULL || pipe(fd) != 0 || write(fd[1], bytes, size) != (ssize_t) size || close(fd[1]) != 0 || dup2(fd[0], 0) < 0) {
+			fail("unable to pipe the image");
+		}
+
+		close(fd[0]);
+		free(bytes);
+		clearerr(stdin);
+
+		if (frame_load_pgm(&piped, "-")) {
+			fail("unable to load the image from the pipe");
+		}
+
+		check_same(&piped, &frame, "the mapped and the piped PGM file differ");
+
+		frame_destroy(&piped);
+	}
+#endif
+
+	remove(path);
+
+	frame_destroy(&reloaded);
+	frame_destroy(&frame);
+}
+
+int main()
+{
+	static const size_t bpps[] = { 8, 10, 12 };
+	size_t i;
+
+	for (i = 0; i < sizeof bpps / sizeof *bpps; ++i) {
+		struct frame image;
+		unsigned char *ptr;
+		int DWTtype;
+
+		make_image(&image, 97, 203, bpps[i]);
+
+		ptr = malloc(get_maximum_stream_size(&image));
+
+		if (ptr == NULL) {
+			fail("unable to allocate the stream");
+		}
+
+		check_raw(&image);
+		check_pgm(&image);
+		check_export(bpps[i]);
+		check_layouts(bpps[i]);
+
+		for (DWTtype = 0; DWTtype < 2; ++DWTtype) {
+			dprint (("checking %lu-bit image, DWTtype %i\n", (unsigned long) bpps[i], DWTtype));
+
+			check_decode_stop(&image, DWTtype, ptr);
+			check_region(&image, DWTtype, ptr);
+			check_container(&image, DWTtype, ptr);
+			check_target_bytes(&image, DWTtype, ptr);
+			check_transcode(&image, DWTtype, ptr);
+			check_height_hint(&image, DWTtype, ptr);
+			check_streaming(&image, DWTtype, ptr);
+			check_streaming_tall(bpps[i], DWTtype);
+			check_tiles(&image, DWTtype);
+			check_cube(&image, DWTtype, ptr);
+			check_custom_weights(&image, DWTtype, ptr);
+			check_preview(bpps[i], DWTtype, ptr);
+			check_reuse(bpps[i], DWTtype);
+		}
+
+		free(ptr);
+		frame_destroy(&image);
+	}
+
+	check_data16_weights();
+
+	printf("OK\n");
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+/**
+ * Truncates the raw CCSDS 122.0 stream to a lower rate
+ *
+ * The segments are parsed and cut, the image is not reconstructed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "bio.h"
+#include "bpe.h"
+#include "cli.h"
+
+int main(int argc, char *argv[])
+{
+	struct parameters parameters;
+	struct bio src, dst;
+	unsigned char *ptr, *out;
+	size_t size;
+	FILE *stream;
+
+	if (argc < 4) {
+		fprintf(stderr, "[ERROR] usage: %s <input stream> <output stream> <SegByteLimit> [<BitPlaneStop> <StageStop>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	init_parameters(&parameters);
+
+	parameters.SegByteLimit = (size_t) atol(argv[3]);
+
+	if (argc >= 6) {
+		parameters.BitPlaneStop = (size_t) atol(argv[4]);
+		parameters.StageStop = atoi(argv[5]);
+	}
+
+	if (parameters.SegByteLimit > 134217727 || parameters.BitPlaneStop > 31 || parameters.StageStop < 0 || parameters.StageStop > 3) {
+		fprintf(stderr, "[ERROR] invalid arguments\n");
+		return EXIT_FAILURE;
+	}
+
+	ptr = cli_load_file(argv[1], &size);
+
+	if (ptr == NULL) {
+		fprintf(stderr, "[ERROR] unable to load the stream\n");
+		return EXIT_FAILURE;
+	}
+
+	/* every segment is at least 3 bytes long and can grow by Part 2 (5 bytes) */
+	out = malloc(3 * size + 8);
+
+	if (out == NULL) {
+		fprintf(stderr, "[ERROR] unable to allocate the output\n");
+		return EXIT_FAILURE;
+	}
+
+	bio_open(&src, ptr, BIO_MODE_READ);
+	bio_open(&dst, out, BIO_MODE_WRITE);
+
+	if (bpe_truncate(&dst, &src, &parameters)) {
+		fprintf(stderr, "[ERROR] unable to truncate the stream\n");
+		return EXIT_FAILURE;
+	}
+
+	bio_close(&dst);
+	bio_close(&src);
+
+	stream = fopen(argv[2], "wb");
+
+	if (stream == NULL) {
+		fprintf(stderr, "[ERROR] unable to open the output\n");
+		return EXIT_FAILURE;
+	}
+
+	if (fwrite(out, 1, (size_t) (dst.ptr - out), stream) != (size_t) (dst.ptr - out)) {
+		fprintf(stderr, "[ERROR] unable to write the output\n");
+		return EXIT_FAILURE;
+	}
+
+	fclose(stream);
+
+	printf("[INFO] %lu bytes -> %lu bytes\n", (unsigned long) size, (unsigned long) (dst.ptr - out));
+
+	free(ptr);
+	free(out);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+/**
+ * Strips the indexed container, writes the raw CCSDS 122.0 stream
+ *
+ * The checksums of the segments are verified.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "container.h"
+
+int main(int argc, char *argv[])
+{
+	struct container container;
+	FILE *stream;
+
+	if (argc < 3) {
+		fprintf(stderr, "[ERROR] usage: %s <container> <raw stream>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (container_load(&container, argv[1])) {
+		fprintf(stderr, "[ERROR] unable to load the container\n");
+		return EXIT_FAILURE;
+	}
+
+	if (container_verify(&container)) {
+		fprintf(stderr, "[ERROR] the container is corrupted\n");
+		return EXIT_FAILURE;
+	}
+
+	stream = fopen(argv[2], "wb");
+
+	if (stream == NULL) {
+		fprintf(stderr, "[ERROR] unable to open the output\n");
+		return EXIT_FAILURE;
+	}
+
+	if (fwrite(container.stream, 1, container.size, stream) != container.size) {
+		fprintf(stderr, "[ERROR] unable to write the stream\n");
+		fclose(stream);
+		return EXIT_FAILURE;
+	}
+
+	if (EOF == fclose(stream)) {
+		fprintf(stderr, "[ERROR] unable to write the stream\n");
+		return EXIT_FAILURE;
+	}
+
+	container_destroy(&container);
+
+	return EXIT_SUCCESS;
+}
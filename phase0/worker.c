@@ -0,0 +1,110 @@
+#include "worker.h"
+#include "alloc.h"
+
+#include <assert.h>
+#ifdef _OPENMP
+#	include <omp.h>
+#endif
+
+size_t worker_get_count(void)
+{
+#ifdef _OPENMP
+	return (size_t) omp_get_max_threads();
+#else
+	return 1;
+#endif
+}
+
+size_t worker_get_index(void)
+{
+#ifdef _OPENMP
+	return (size_t) omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+void workers_destroy(struct worker *workers, size_t count, int decode)
+{
+	size_t i;
+
+	for (i = 0; i < count; ++i) {
+		if (decode) {
+			open122_decoder_destroy(&workers[i].decoder);
+		} else {
+			open122_encoder_destroy(&workers[i].encoder);
+		}
+
+		frame_destroy(&workers[i].frame);
+		alloc_free(workers[i].buffer);
+	}
+
+	alloc_free(workers);
+}
+
+struct worker *workers_create(size_t count, size_t height, size_t width, const struct parameters *parameters, int decode)
+{
+	struct worker *workers;
+	size_t i;
+
+	assert(parameters != NULL);
+
+	if (count > SIZE_MAX_ / sizeof *workers) {
+		return NULL;
+	}
+
+	workers = alloc_malloc(count * sizeof *workers);
+
+	if (workers == NULL) {
+		return NULL;
+	}
+
+	for (i = 0; i < count; ++i) {
+		int err;
+
+		workers[i].frame.height = 0;
+		workers[i].frame.width = 0;
+		workers[i].frame.bpp = 0;
+		workers[i].frame.data = NULL;
+		workers[i].frame.data16 = NULL;
+		workers[i].buffer = NULL;
+		workers[i].capacity = 0;
+
+		if (decode) {
+			err = open122_decoder_init(&workers[i].decoder, height, width, parameters);
+		} else {
+			err = open122_encoder_init(&workers[i].encoder, height, width, parameters);
+		}
+
+		if (err) {
+			/* the failed context has released itself */
+			workers_destroy(workers, i, decode);
+			return NULL;
+		}
+	}
+
+	return workers;
+}
+
+int worker_reserve_buffer(struct worker *worker, size_t size)
+{
+	unsigned char *buffer;
+
+	assert(worker != NULL);
+
+	/* the buffer only grows */
+	if (size <= worker->capacity) {
+		return RET_SUCCESS;
+	}
+
+	buffer = alloc_realloc(worker->buffer, size);
+
+	if (buffer == NULL) {
+		return RET_FAILURE_MEMORY_ALLOCATION;
+	}
+
+	worker->buffer = buffer;
+	worker->capacity = size;
+
+	return RET_SUCCESS;
+}
@@ -0,0 +1,62 @@
+/**
+ * \file worker.h
+ * \brief Per-thread contexts of the tools coding many images in parallel
+ *
+ * When compiled with OpenMP, each thread of a parallel loop takes the worker
+ * of its own index, so that the contexts and the buffers are reused across
+ * the images without any locking. Without OpenMP, there is a single worker.
+ */
+#ifndef WORKER_H_
+#define WORKER_H_
+
+#include <stddef.h>
+
+#include "common.h"
+#include "frame.h"
+#include "open122.h"
+
+/**
+ * \brief Per-thread state reused across the images
+ */
+struct worker {
+	/** framebuffer growing with the images */
+	struct frame frame;
+
+	/** the contexts keeping the DWT workspace and the BPE buffers, one of them is initialized */
+	struct open122_encoder encoder;
+	struct open122_decoder decoder;
+
+	/** stream buffer of the given capacity */
+	unsigned char *buffer;
+	size_t capacity;
+};
+
+/**
+ * \brief The number of threads sharing the images
+ */
+size_t worker_get_count(void);
+
+/**
+ * \brief The index of the worker of the calling thread
+ */
+size_t worker_get_index(void);
+
+/**
+ * \brief Allocate the \p count workers with the encoders (or the decoders if \p decode is set)
+ *
+ * The contexts are reserved for the images of \p height x \p width pixels (0 x 0 lets them grow
+ * with the images). Returns NULL when the allocation fails, see workers_destroy().
+ */
+struct worker *workers_create(size_t count, size_t height, size_t width, const struct parameters *parameters, int decode);
+
+/**
+ * \brief Release the \p count workers created by workers_create() with the same \p decode
+ */
+void workers_destroy(struct worker *workers, size_t count, int decode);
+
+/**
+ * \brief Grow the stream buffer of the \p worker to at least \p size bytes
+ */
+int worker_reserve_buffer(struct worker *worker, size_t size);
+
+#endif /* WORKER_H_ */
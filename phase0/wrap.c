@@ -0,0 +1,75 @@
+/**
+ * Wraps the raw CCSDS 122.0 stream into the indexed container
+ *
+ * The stream is decoded once to locate the segments.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "frame.h"
+#include "bio.h"
+#include "bpe.h"
+#include "container.h"
+#include "cli.h"
+
+int main(int argc, char *argv[])
+{
+	struct frame frame;
+	struct parameters parameters;
+	struct container container;
+	struct bio bio;
+	unsigned char *ptr;
+	size_t size;
+
+	if (argc < 3) {
+		fprintf(stderr, "[ERROR] usage: %s <raw stream> <container>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	ptr = cli_load_file(argv[1], &size);
+
+	if (ptr == NULL) {
+		fprintf(stderr, "[ERROR] unable to load the stream\n");
+		return EXIT_FAILURE;
+	}
+
+	frame.height = 0;
+	frame.width = 0;
+	frame.bpp = 0;
+	frame.data = NULL;
+	frame.data16 = NULL;
+
+	init_parameters(&parameters);
+	container_init(&container);
+
+	bio_open(&bio, ptr, BIO_MODE_READ);
+
+	if (bpe_decode_indexed(&frame, &parameters, &bio, &container)) {
+		fprintf(stderr, "[ERROR] unable to decode the stream\n");
+		return EXIT_FAILURE;
+	}
+
+	bio_close(&bio);
+
+	frame_destroy(&frame);
+
+	if (container_finish(&container, ptr, size)) {
+		fprintf(stderr, "[ERROR] the stream is truncated\n");
+		return EXIT_FAILURE;
+	}
+
+	free(ptr);
+
+	if (container_save(&container, argv[2])) {
+		fprintf(stderr, "[ERROR] unable to save the container\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("[INFO] %lu x %lu pixels, %lu bpp, %lu segments\n", (unsigned long) container.height, (unsigned long) container.width, (unsigned long) container.bpp, (unsigned long) container.count);
+
+	container_destroy(&container);
+
+	return EXIT_SUCCESS;
+}